@@ -47,13 +47,19 @@
 #include "sokol_audio.h"
 
 #include "CodeAnalyser/CodeAnalyser.h"
+#include "CodeAnalyser/AnalysisJournal.h"
+#include "CodeAnalyser/AnalysisDatabase.h"
+#include "Debug/DebugLog.h"
+#include "Debug/ImGuiLog.h"
 #include "CodeAnalyser/UI/CodeAnalyserUI.h"
+#include "CodeAnalyser/UI/CharacterMapViewer.h"
 #include "Util/MemoryBuffer.h"
 #include "Util/FileUtil.h"
 #include "IOAnalysis/C64IOAnalysis.h"
 #include "GraphicsViewer/C64GraphicsViewer.h"
 #include "C64Display.h"
 #include "C64GamesList.h"
+#include "C64Config.h"
 #include <Util/Misc.h>
 
 class FC64Emulator : public ICPUInterface
@@ -162,6 +168,8 @@ public:
     void ResetCodeAnalysis(void);
     bool SaveCodeAnalysis(const FGameInfo* pGameInfo);
     bool LoadCodeAnalysis(const FGameInfo* pGameInfo);
+    std::vector<FCodeAnalysisPage*> GetJournalPages(void);
+    void AutoSaveCodeAnalysis(void);
 
     // Emulator Event Handlers
     void    OnBoot(void);
@@ -188,6 +196,14 @@ private:
     FCodeAnalysisPage   IOSystem[4];        // 4K IO System
     FCodeAnalysisPage   RAM[64];            // 64K RAM
 
+    // saved analysis - pages are loaded from it as they're accessed
+    FAnalysisDatabase   AnalysisDatabase;
+
+    // journal of analysis changes since the last full save
+    FAnalysisJournal    AnalysisJournal;
+    double              LastAutoSaveTime = 0;
+    uint32_t            SaveGeneration = 0;     // generation of the loaded save, journals from other saves aren't replayed
+
     uint8_t             LastMemPort = 0x7;  // Default startup
     uint16_t            LastPC = 0;
 
@@ -201,6 +217,8 @@ private:
     bool                bCharacterROMMapped = false;
     bool                bIOMapped = true;
 
+    bool                bShowDebugLog = false;
+
     m6502_tick_t    OldTickCB = nullptr;
 };
 
@@ -305,6 +323,8 @@ bool FC64Emulator::Init()
         }
     }
 #endif
+    LoadC64Config("C64Config.json");
+
     saudio_desc audiodesc;
     memset(&audiodesc, 0, sizeof(saudio_desc));
     saudio_setup(&audiodesc);
@@ -516,7 +536,20 @@ bool FC64Emulator::LoadGame(const FGameInfo* pGameInfo)
         {
             SetupCodeAnalysisLabels();
         }
+
+        // recover any changes made since the last full save
+        SaveGeneration = AnalysisDatabase.GetSaveGeneration();
+        const std::string journalFileName = "AnalysisData/" + pGameInfo->Name + ".journal";
+        const int noRecoveredPages = FAnalysisJournal::Replay(journalFileName.c_str(), GetJournalPages(), SaveGeneration);
+        if (noRecoveredPages > 0)
+        {
+            LOGINFO("Recovered %d analysis pages from '%s'", noRecoveredPages, journalFileName.c_str());
+            CodeAnalysis.SetCodeAnalysisDirty();
+        }
+        AnalysisJournal.Open(journalFileName.c_str(), GetJournalPages(), SaveGeneration);
+        LastAutoSaveTime = ImGui::GetTime();
         GenerateGlobalInfo(CodeAnalysis);// Note this might not work because pages might not have been set up
+        CodeAnalysis.XRefs.Invalidate();    // references have been replaced by the loaded analysis
 
         CurrentGame = pGameInfo;
         return true;
@@ -543,6 +576,9 @@ void FC64Emulator::ResetCodeAnalysis(void)
     for (int pageNo = 0; pageNo < 8; pageNo++)
         KernelROM[pageNo].Reset();
 
+    // pages have been reset so nothing is left to load from the old database
+    AnalysisDatabase.Close();
+
     // Reset other analysers
     InterruptHandlers.clear();
     IOAnalysis.Reset();
@@ -551,55 +587,97 @@ void FC64Emulator::ResetCodeAnalysis(void)
 
 bool FC64Emulator::SaveCodeAnalysis(const FGameInfo* pGameInfo)
 {
-    FMemoryBuffer saveBuffer;
-    saveBuffer.Init();
+    char fileName[128];
+    sprintf_s(fileName, "AnalysisData/%s.bin", pGameInfo->Name.c_str());
 
-    // Save RAM pages
-    for (int pageNo = 0; pageNo < 64; pageNo++)
-        RAM[pageNo].WriteToBuffer(saveBuffer);
+    // pages that haven't been accessed yet are copied across from the open database without loading them
+    const bool bSaved = AnalysisDatabase.IsOpen() ? AnalysisDatabase.SaveOpenFile(SaveGeneration + 1) : FAnalysisDatabase::Save(fileName, GetJournalPages(), SaveGeneration + 1);
+    if (bSaved == false)
+        return false;
 
-    // Save IO
-    for (int pageNo = 0; pageNo < 4; pageNo++)
-        IOSystem[pageNo].WriteToBuffer(saveBuffer);
+    // journal restarts from the state we've just saved
+    SaveGeneration++;
+    if (AnalysisJournal.IsOpen())
+        AnalysisJournal.Compact(SaveGeneration);
+    return true;
+}
 
-    // Save Basic ROM
+// Pages in the same order as the analysis save file
+std::vector<FCodeAnalysisPage*> FC64Emulator::GetJournalPages(void)
+{
+    std::vector<FCodeAnalysisPage*> pages;
+    for (int pageNo = 0; pageNo < 64; pageNo++)
+        pages.push_back(&RAM[pageNo]);
+    for (int pageNo = 0; pageNo < 4; pageNo++)
+        pages.push_back(&IOSystem[pageNo]);
     for (int pageNo = 0; pageNo < 8; pageNo++)
-        BasicROM[pageNo].WriteToBuffer(saveBuffer);
-
-    // Save Kernel ROM
+        pages.push_back(&BasicROM[pageNo]);
     for (int pageNo = 0; pageNo < 8; pageNo++)
-        KernelROM[pageNo].WriteToBuffer(saveBuffer);
+        pages.push_back(&KernelROM[pageNo]);
+    return pages;
+}
 
-    // Write to file
-    char fileName[128];
-    sprintf_s(fileName, "AnalysisData/%s.bin", pGameInfo->Name.c_str());
-    return saveBuffer.SaveToFile(fileName);
+// Cheap periodic save - only pages that have changed are written to the journal
+void FC64Emulator::AutoSaveCodeAnalysis(void)
+{
+    if (AnalysisJournal.IsOpen() == false)
+        return;
+
+    const int autoSaveInterval = GetC64Config().AutoSaveInterval;
+    if (autoSaveInterval <= 0)
+        return;
+
+    const double time = ImGui::GetTime();
+    if (time - LastAutoSaveTime < autoSaveInterval)
+        return;
+
+    LastAutoSaveTime = time;
+    AnalysisJournal.WriteChanges();
 }
 
 bool FC64Emulator::LoadCodeAnalysis(const FGameInfo *pGameInfo)
 {
     char fileName[128];
     sprintf_s(fileName, "AnalysisData/%s.bin",pGameInfo->Name.c_str());
+
+    if (FAnalysisDatabase::IsDatabaseFile(fileName))
+    {
+        if (AnalysisDatabase.Open(fileName, GetJournalPages()) == false)
+            return false;
+
+        CodeAnalysis.SetCodeAnalysisDirty();
+        return true;
+    }
+
+    // older saves have the pages one after another
     FMemoryBuffer loadBuffer;
 
     if (loadBuffer.LoadFromFile(fileName) == false)
         return false;
 
+    bool bLoaded = true;
+
     // Load RAM pages
-    for (int pageNo = 0; pageNo < 64; pageNo++)
-        RAM[pageNo].ReadFromBuffer(loadBuffer);
+    for (int pageNo = 0; pageNo < 64 && bLoaded; pageNo++)
+        bLoaded = RAM[pageNo].ReadFromBuffer(loadBuffer);
 
     // Load IO
-    for (int pageNo = 0; pageNo < 4; pageNo++)
-        IOSystem[pageNo].ReadFromBuffer(loadBuffer);
+    for (int pageNo = 0; pageNo < 4 && bLoaded; pageNo++)
+        bLoaded = IOSystem[pageNo].ReadFromBuffer(loadBuffer);
 
     // Load Basic ROM
-    for (int pageNo = 0; pageNo < 8; pageNo++)
-        BasicROM[pageNo].ReadFromBuffer(loadBuffer);
+    for (int pageNo = 0; pageNo < 8 && bLoaded; pageNo++)
+        bLoaded = BasicROM[pageNo].ReadFromBuffer(loadBuffer);
 
     // Load Kernel ROM
-    for (int pageNo = 0; pageNo < 8; pageNo++)
-        KernelROM[pageNo].ReadFromBuffer(loadBuffer);
+    for (int pageNo = 0; pageNo < 8 && bLoaded; pageNo++)
+        bLoaded = KernelROM[pageNo].ReadFromBuffer(loadBuffer);
+
+    if (bLoaded == false)   // don't keep a partially loaded analysis
+    {
+        ResetCodeAnalysis();
+        return false;
+    }
 
 	CodeAnalysis.SetCodeAnalysisDirty();
     return true;
@@ -610,6 +688,9 @@ void FC64Emulator::Shutdown()
 {
     if(CurrentGame != nullptr)
         SaveCodeAnalysis(CurrentGame);
+    AnalysisJournal.Close();
+    SaveC64Config("C64Config.json");
+    ShutdownCharacterMapViewer();
 
     ui_c64_discard(&C64UI);
     c64_discard(&C64Emu);
@@ -626,7 +707,22 @@ void FC64Emulator::Tick()
         ui_c64_after_exec(&C64UI);
     }
 
+    UpdateCodeAnalysisIndices(CodeAnalysis);
+    AutoSaveCodeAnalysis();
+
     ui_c64_draw(&C64UI, ExecTime);
+
+    // added to the chips UI menu bar
+    if (ImGui::BeginMainMenuBar())
+    {
+        if (ImGui::BeginMenu("Windows"))
+        {
+            ImGui::MenuItem("DebugLog", 0, &bShowDebugLog);
+            ImGui::EndMenu();
+        }
+        ImGui::EndMainMenuBar();
+    }
+
     if (ImGui::Begin("C64 Screen"))
     {
         ImGui::Text("Mapped: ");
@@ -694,6 +790,11 @@ void FC64Emulator::Tick()
     }
     ImGui::End();
 
+    if (bShowDebugLog)
+        g_ImGuiLog.Draw("Debug Log", &bShowDebugLog);
+    else
+        g_ImGuiLog.Update();
+
 #if 0
     gfx_draw(c64_display_width(&c64), c64_display_height(&c64));
     const uint32_t load_delay_frames = 180;
@@ -821,8 +922,6 @@ int    FC64Emulator::OnCPUTrap(uint16_t pc, int ticks, uint64_t pins)
     const bool bWrite = !!(pins & M6502_RW);
 
     bool bBreak = RegisterCodeExecuted(CodeAnalysis, LastPC, pc);
-    FCodeInfo* pCodeInfo = CodeAnalysis.GetCodeInfoForAddress(LastPC);
-    pCodeInfo->FrameLastExecuted = CodeAnalysis.CurrentFrameNo;
 
     // check for breakpointed code line
     if (bBreak)
@@ -0,0 +1,51 @@
+#include "C64Config.h"
+
+#include "json.hpp"
+
+#include <iomanip>
+#include <fstream>
+
+using json = nlohmann::json;
+
+FC64Config	g_C64Config;
+
+FC64Config& GetC64Config()
+{
+    return g_C64Config;
+}
+
+bool LoadC64Config(const char* fileName)
+{
+    FC64Config& config = GetC64Config();
+
+    std::ifstream inFileStream(fileName);
+    if (inFileStream.is_open() == false)
+        return false;
+
+    json jsonConfigFile;
+
+    inFileStream >> jsonConfigFile;
+    inFileStream.close();
+
+    if (jsonConfigFile.contains("AutoSaveInterval"))
+        config.AutoSaveInterval = jsonConfigFile["AutoSaveInterval"];
+
+    return true;
+}
+
+bool SaveC64Config(const char* fileName)
+{
+    const FC64Config& config = GetC64Config();
+    json jsonConfigFile;
+
+    jsonConfigFile["AutoSaveInterval"] = config.AutoSaveInterval;
+
+    std::ofstream outFileStream(fileName);
+    if (outFileStream.is_open())
+    {
+        outFileStream << std::setw(4) << jsonConfigFile << std::endl;
+        return true;
+    }
+
+    return false;
+}
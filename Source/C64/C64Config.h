@@ -0,0 +1,10 @@
+#pragma once
+
+struct FC64Config
+{
+	int		AutoSaveInterval = 60;	// seconds between analysis journal saves, 0 to disable
+};
+
+FC64Config& GetC64Config();
+bool LoadC64Config(const char* fileName);
+bool SaveC64Config(const char* fileName);
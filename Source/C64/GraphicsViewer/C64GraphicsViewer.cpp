@@ -1,6 +1,7 @@
 #include "C64GraphicsViewer.h"
 #include <CodeAnalyser/CodeAnalyser.h>
 #include <util/GraphicsView.h>
+#include <util/PixelBlit.h>
 #include <imgui.h>
 
 #include <chips/m6502.h>
@@ -17,8 +18,8 @@ void FC64GraphicsViewer::Init(FCodeAnalysisState* pAnalysis, void* pEmu)
 {
 	C64Emu = pEmu;
 	CodeAnalysis = pAnalysis;
-	CharacterView = new FGraphicsView(320, 408);	// 40 * 51 enough for a 16K Vic bank
-	SpriteView = new FGraphicsView(384, 16 * 21); // 16x16 sprites for a VIC bank
+	CharacterView = new FGraphicsView(320, 408, true);	// 40 * 51 enough for a 16K Vic bank
+	SpriteView = new FGraphicsView(384, 16 * 21, true); // 16x16 sprites for a VIC bank
 	SpriteCols[0] = 0x00000000;
 	SpriteCols[1] = 0xffffffff;
 	SpriteCols[2] = 0xff888888;
@@ -39,30 +40,15 @@ void DrawHiresImageAt(const uint8_t* pSrc, int xp, int yp, int widthChars, int h
 {
 	uint32_t* pBase = pGraphicsView->GetPixelBuffer() + (xp + (yp * pGraphicsView->GetWidth()));
 
-	*pBase = 0;
-	for (int y = 0; y < heightPix; y++)
-	{
-		for (int x = 0; x < widthChars; x++)
-		{
-			const uint8_t charLine = *pSrc++;
-
-			for (int xpix = 0; xpix < 8; xpix++)
-			{
-				const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
-				const uint32_t col = bSet ? cols[1] : cols[0];
-				// 0 check for sprites?
-				*(pBase + xpix + (x * 8)) = col;
-			}
-		}
-
-		pBase += pGraphicsView->GetWidth();
-	}
+	// 0 check for sprites?
+	BlitBitImage(pBase, pGraphicsView->GetWidth(), pSrc, widthChars, widthChars, heightPix, cols[1], cols[0]);
 }
 
 void DrawMultiColourImageAt(const uint8_t* pSrc, int xp, int yp, int widthChars, int heightPix, FGraphicsView* pGraphicsView, uint32_t* cols)
 {
 	uint32_t* pBase = pGraphicsView->GetPixelBuffer() + (xp + (yp * pGraphicsView->GetWidth()));
 
+	// kept as a plain loop - it's quicker than calling the blitter for 2bpp
 	*pBase = 0;
 	for (int y = 0; y < heightPix; y++)
 	{
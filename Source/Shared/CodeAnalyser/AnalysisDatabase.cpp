@@ -0,0 +1,230 @@
+#include "AnalysisDatabase.h"
+#include "CodeAnaysisPage.h"
+
+#include "Util/MemoryBuffer.h"
+#include "Util/Misc.h"
+#include "Debug/DebugLog.h"
+
+#include <cstdio>
+#include <cstring>
+
+static const uint32_t kDatabaseMagic = 0x41444246;	// 'ADBF'
+static const uint32_t kDatabaseVersion = 1;
+
+struct FDatabaseHeader
+{
+	uint32_t	Magic;
+	uint32_t	Version;
+	uint32_t	NoPages;
+	uint32_t	SaveGeneration;
+};
+
+bool FAnalysisDatabase::WriteFile(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration, std::vector<FPageEntry>& pageEntries)
+{
+	const size_t dataStart = sizeof(FDatabaseHeader) + pages.size() * sizeof(FPageEntry);
+
+	FMemoryBuffer pageData;
+	pageData.Init(64 * 1024);
+	pageEntries.clear();
+	for (FCodeAnalysisPage* pPage : pages)
+	{
+		const size_t pageStart = pageData.GetSize();
+		pPage->WriteToBuffer(pageData);
+
+		FPageEntry entry;
+		entry.Offset = (uint32_t)(dataStart + pageStart);
+		entry.Size = (uint32_t)(pageData.GetSize() - pageStart);
+		entry.Checksum = CalculateChecksum((const uint8_t*)pageData.GetData() + pageStart, entry.Size);
+		pageEntries.push_back(entry);
+	}
+
+	FILE* fp = fopen(pFileName, "wb");
+	if (fp == nullptr)
+	{
+		LOGERROR("Could not open analysis database '%s' for writing", pFileName);
+		return false;
+	}
+
+	const FDatabaseHeader header = { kDatabaseMagic, kDatabaseVersion, (uint32_t)pages.size(), saveGeneration };
+	bool bOk = fwrite(&header, sizeof(header), 1, fp) == 1;
+	bOk = bOk && (pageEntries.empty() || fwrite(pageEntries.data(), sizeof(FPageEntry), pageEntries.size(), fp) == pageEntries.size());
+	bOk = bOk && fwrite(pageData.GetData(), 1, pageData.GetSize(), fp) == pageData.GetSize();
+	bOk = (fclose(fp) == 0) && bOk;
+
+	if (bOk == false)
+	{
+		LOGERROR("Failed to write analysis database '%s'", pFileName);
+		remove(pFileName);
+	}
+	return bOk;
+}
+
+bool FAnalysisDatabase::ReplaceFile(const char* pTempFileName, const char* pFileName)
+{
+	remove(pFileName);
+	if (rename(pTempFileName, pFileName) != 0)
+	{
+		LOGERROR("Failed to replace analysis database '%s'", pFileName);
+		return false;
+	}
+	return true;
+}
+
+bool FAnalysisDatabase::Save(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration)
+{
+	const std::string tempFileName = std::string(pFileName) + ".tmp";
+	std::vector<FPageEntry> pageEntries;
+	return WriteFile(tempFileName.c_str(), pages, saveGeneration, pageEntries) && ReplaceFile(tempFileName.c_str(), pFileName);
+}
+
+bool FAnalysisDatabase::SaveOpenFile(uint32_t saveGeneration)
+{
+	if (IsOpen() == false)
+		return false;
+
+	// unloaded pages copy their data from the current mapping
+	const std::string tempFileName = FileName + ".tmp";
+	std::vector<FPageEntry> pageEntries;
+	if (WriteFile(tempFileName.c_str(), Pages, saveGeneration, pageEntries) == false)
+		return false;
+
+	// the file can't be replaced while it's mapped on every platform, so swap the mapping over to the new file
+	std::lock_guard<std::mutex> lock(MappingMutex);
+	MappedFile.Close();
+	const bool bReplaced = ReplaceFile(tempFileName.c_str(), FileName.c_str());
+	if (MappedFile.Open(bReplaced ? FileName.c_str() : tempFileName.c_str()) == false)
+	{
+		LOGERROR("Could not reopen analysis database '%s', pages that weren't loaded are lost", FileName.c_str());
+		return false;
+	}
+
+	PageEntries = pageEntries;
+	SaveGeneration = saveGeneration;
+	return bReplaced;
+}
+
+bool FAnalysisDatabase::IsDatabaseFile(const char* pFileName)
+{
+	FILE* fp = fopen(pFileName, "rb");
+	if (fp == nullptr)
+		return false;
+
+	uint32_t magic = 0;
+	const bool bRead = fread(&magic, sizeof(magic), 1, fp) == 1;
+	fclose(fp);
+	return bRead && magic == kDatabaseMagic;
+}
+
+bool FAnalysisDatabase::Open(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages)
+{
+	Close();
+
+	if (MappedFile.Open(pFileName) == false)
+		return false;
+
+	const uint8_t* pData = MappedFile.GetData();
+	const size_t fileSize = MappedFile.GetSize();
+	FDatabaseHeader header;
+	const size_t tableSize = pages.size() * sizeof(FPageEntry);
+	if (fileSize < sizeof(header) + tableSize)
+	{
+		MappedFile.Close();
+		return false;
+	}
+
+	memcpy(&header, pData, sizeof(header));
+	if (header.Magic != kDatabaseMagic || header.Version != kDatabaseVersion || header.NoPages != (uint32_t)pages.size())
+	{
+		LOGWARNING("Analysis database '%s' doesn't match this machine", pFileName);
+		MappedFile.Close();
+		return false;
+	}
+
+	PageEntries.resize(pages.size());
+	if (tableSize > 0)
+		memcpy(PageEntries.data(), pData + sizeof(header), tableSize);
+	for (const FPageEntry& entry : PageEntries)
+	{
+		if ((size_t)entry.Offset + entry.Size > fileSize)
+		{
+			LOGWARNING("Analysis database '%s' is truncated", pFileName);
+			PageEntries.clear();
+			MappedFile.Close();
+			return false;
+		}
+	}
+
+	FileName = pFileName;
+	Pages = pages;
+	SaveGeneration = header.SaveGeneration;
+	for (size_t pageNo = 0; pageNo < Pages.size(); pageNo++)
+	{
+		FCodeAnalysisPage* pPage = Pages[pageNo];
+		PageIndices[pPage] = pageNo;
+		pPage->Reset();
+		pPage->pPendingDatabase = this;
+		pPage->bDirty = false;
+	}
+
+	return true;
+}
+
+void FAnalysisDatabase::Close()
+{
+	for (FCodeAnalysisPage* pPage : Pages)
+	{
+		if (pPage->pPendingDatabase == this)
+			pPage->LoadPending();
+	}
+
+	FileName.clear();
+	Pages.clear();
+	PageEntries.clear();
+	PageIndices.clear();
+	SaveGeneration = 0;
+	MappedFile.Close();
+}
+
+const FAnalysisDatabase::FPageEntry* FAnalysisDatabase::GetPageEntry(const FCodeAnalysisPage* pPage) const
+{
+	const auto pageIt = PageIndices.find(pPage);
+	return pageIt != PageIndices.end() ? &PageEntries[pageIt->second] : nullptr;
+}
+
+bool FAnalysisDatabase::LoadPage(FCodeAnalysisPage* pPage)
+{
+	std::lock_guard<std::mutex> lock(MappingMutex);
+	const FPageEntry* pEntry = GetPageEntry(pPage);
+	if (pEntry == nullptr || MappedFile.IsOpen() == false)
+		return false;
+
+	const uint8_t* pPageData = MappedFile.GetData() + pEntry->Offset;
+	if (CalculateChecksum(pPageData, pEntry->Size) != pEntry->Checksum)
+	{
+		LOGWARNING("Analysis database page at offset %u is corrupt", pEntry->Offset);
+		pPage->FailedLoadData.assign(pPageData, pPageData + pEntry->Size);
+		return false;
+	}
+
+	FMemoryBuffer buffer;
+	buffer.InitView(pPageData, pEntry->Size);
+	if (pPage->ReadFromBuffer(buffer) == false)
+	{
+		pPage->Reset();	// don't leave it partly loaded
+		pPage->FailedLoadData.assign(pPageData, pPageData + pEntry->Size);
+		return false;
+	}
+
+	return true;
+}
+
+bool FAnalysisDatabase::WritePageData(const FCodeAnalysisPage* pPage, FMemoryBuffer& buffer) const
+{
+	std::lock_guard<std::mutex> lock(MappingMutex);
+	const FPageEntry* pEntry = GetPageEntry(pPage);
+	if (pEntry == nullptr || MappedFile.IsOpen() == false)
+		return false;
+
+	buffer.WriteBytes(MappedFile.GetData() + pEntry->Offset, pEntry->Size);
+	return true;
+}
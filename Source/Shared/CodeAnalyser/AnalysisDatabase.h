@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "Util/FileUtil.h"
+
+struct FCodeAnalysisPage;
+class FMemoryBuffer;
+
+// Code analysis pages stored at fixed offsets in a single file
+// The file is memory mapped on open and each page is only deserialised the first time it is accessed,
+// so switching to a large project doesn't have to wait for pages that are never looked at.
+//
+// Layout: header, page table (offset, size, checksum for each page), then the serialised pages.
+// Pages are in the order they were passed to Save() and must be opened with the same list.
+// Saves are written to a temp file which replaces the database once complete.
+class FAnalysisDatabase
+{
+public:
+	~FAnalysisDatabase() { Close(); }
+
+	static bool	Save(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration = 0);
+	static bool	IsDatabaseFile(const char* pFileName);
+
+	bool	Open(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages);	// resets pages and marks them to load on first access
+	void	Close();	// loads any pages that haven't been accessed yet then releases the file
+	bool	IsOpen() const { return MappedFile.IsOpen(); }
+	// save the opened pages over the open file - pages that haven't been accessed are copied from the mapping and
+	// stay unloaded, reading from the new file
+	bool	SaveOpenFile(uint32_t saveGeneration);
+	uint32_t	GetSaveGeneration() const { return SaveGeneration; }	// generation passed to Save(), for matching journals against
+
+	// called by the page itself - loads happen on whichever thread first touches the page
+	// A page that fails to load keeps its stored data so saving doesn't overwrite it.
+	bool	LoadPage(FCodeAnalysisPage* pPage);
+	bool	WritePageData(const FCodeAnalysisPage* pPage, FMemoryBuffer& buffer) const;	// copy a page's serialised data without loading it
+
+private:
+	struct FPageEntry
+	{
+		uint32_t	Offset;
+		uint32_t	Size;
+		uint32_t	Checksum;
+	};
+
+	static bool	WriteFile(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration, std::vector<FPageEntry>& pageEntries);
+	static bool	ReplaceFile(const char* pTempFileName, const char* pFileName);
+	const FPageEntry*	GetPageEntry(const FCodeAnalysisPage* pPage) const;
+
+	std::string						FileName;
+	FMappedFile						MappedFile;
+	mutable std::mutex				MappingMutex;	// held while the mapping is read from or swapped for a new save
+	std::vector<FCodeAnalysisPage*>	Pages;
+	std::vector<FPageEntry>			PageEntries;
+	std::unordered_map<const FCodeAnalysisPage*, size_t>	PageIndices;	// page to index of its entry
+	uint32_t						SaveGeneration = 0;
+};
@@ -0,0 +1,323 @@
+#include "AnalysisJournal.h"
+#include "CodeAnaysisPage.h"
+
+#include "Util/MemoryBuffer.h"
+#include "Util/FileUtil.h"
+#include "Util/Misc.h"
+#include "Debug/DebugLog.h"
+
+#include <map>
+#include <cstring>
+#include <cstdlib>
+
+static const uint32_t kJournalMagic = 0x414a4e4c;		// 'AJNL'
+static const uint32_t kJournalVersion = 2;				// 2 - save generation in header
+static const uint32_t kPageRecordMagic = 0x50414745;	// 'PAGE'
+static const uint32_t kCommitRecordMagic = 0x53594e43;	// 'SYNC'
+
+static const size_t kHeaderSize = 16;	// magic, version, no pages, save generation
+
+static const size_t kMinCompactionSize = 256 * 1024;	// don't bother compacting small journals
+static const size_t kCompactionRatio = 4;				// compact when journal is this many times the size of a snapshot
+
+static void SerialisePage(FCodeAnalysisPage* pPage, FMemoryBuffer& buffer)
+{
+	buffer.Init(4096);
+	pPage->WriteToBuffer(buffer);
+}
+
+bool FAnalysisJournal::Open(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration)
+{
+	Close();
+
+	FileName = pFileName;
+	Pages = pages;
+	RecordOffsets.assign(Pages.size(), -1);
+	SaveGeneration = saveGeneration;
+	return Compact();
+}
+
+void FAnalysisJournal::Close()
+{
+	if (FilePtr != nullptr)
+		fclose(FilePtr);
+	FilePtr = nullptr;
+}
+
+bool FAnalysisJournal::WritePageRecord(uint32_t pageIndex, const void* pData, uint32_t dataSize, uint32_t checksum)
+{
+	const uint32_t header[4] = { kPageRecordMagic, pageIndex, dataSize, checksum };
+	if (fwrite(header, sizeof(header), 1, FilePtr) != 1 || fwrite(pData, 1, dataSize, FilePtr) != dataSize)
+		return false;
+
+	JournalSize += sizeof(header) + dataSize;
+	return true;
+}
+
+bool FAnalysisJournal::WriteCommit()
+{
+	const uint32_t record[2] = { kCommitRecordMagic, ++CommitNo };
+	if (fwrite(record, sizeof(record), 1, FilePtr) != 1)
+		return false;
+
+	JournalSize += sizeof(record);
+	return fflush(FilePtr) == 0;
+}
+
+int FAnalysisJournal::WriteChanges()
+{
+	if (FilePtr == nullptr)
+		return -1;
+
+	// offsets only become the page's record once the commit marker is down
+	std::vector<std::pair<uint32_t, int64_t>> writtenRecords;
+	FMemoryBuffer buffer;
+	for (uint32_t pageIndex = 0; pageIndex < (uint32_t)Pages.size(); pageIndex++)
+	{
+		FCodeAnalysisPage* pPage = Pages[pageIndex];
+		if (pPage->bDirty == false || pPage->HasLoadFailed())
+			continue;
+
+		const int64_t recordOffset = (int64_t)JournalSize;
+		SerialisePage(pPage, buffer);
+		const uint32_t checksum = CalculateChecksum(buffer.GetData(), buffer.GetSize());
+		if (WritePageRecord(pageIndex, buffer.GetData(), (uint32_t)buffer.GetSize(), checksum) == false)
+		{
+			LOGERROR("Failed to write to analysis journal '%s'", FileName.c_str());
+			return -1;
+		}
+		writtenRecords.push_back({ pageIndex, recordOffset });
+	}
+
+	if (writtenRecords.empty())
+		return 0;
+
+	if (WriteCommit() == false)
+	{
+		LOGERROR("Failed to write to analysis journal '%s'", FileName.c_str());
+		return -1;
+	}
+
+	for (const auto& written : writtenRecords)
+	{
+		RecordOffsets[written.first] = written.second;
+		Pages[written.first]->bDirty = false;
+	}
+
+	if (JournalSize > kMinCompactionSize && JournalSize > SnapshotSize * kCompactionRatio)
+		Compact();
+
+	return (int)writtenRecords.size();
+}
+
+bool FAnalysisJournal::Compact(uint32_t saveGeneration)
+{
+	// the full save holds every page so the new journal starts empty
+	SaveGeneration = saveGeneration;
+	RecordOffsets.assign(Pages.size(), -1);
+	for (FCodeAnalysisPage* pPage : Pages)
+		pPage->bDirty = false;
+	return Compact();
+}
+
+// copy a committed record from the old journal to the one being written
+static bool CopyPageRecord(FILE* pSrcFile, int64_t offset, FILE* pDestFile, std::vector<uint8_t>& recordData)
+{
+	uint32_t header[4];
+	if (fseek(pSrcFile, (long)offset, SEEK_SET) != 0 || fread(header, sizeof(header), 1, pSrcFile) != 1 || header[0] != kPageRecordMagic)
+		return false;
+
+	recordData.resize(sizeof(header) + header[2]);
+	memcpy(recordData.data(), header, sizeof(header));
+	if (header[2] > 0 && fread(recordData.data() + sizeof(header), 1, header[2], pSrcFile) != header[2])
+		return false;
+
+	return fwrite(recordData.data(), 1, recordData.size(), pDestFile) == recordData.size();
+}
+
+// Write a journal holding one record per page that has one, then swap it in
+// Dirty pages are serialised, the records of clean pages are copied from the old journal as they are
+bool FAnalysisJournal::Compact()
+{
+	Close();
+
+	const std::string tempFileName = FileName + ".tmp";
+	FilePtr = fopen(tempFileName.c_str(), "wb");
+	if (FilePtr == nullptr)
+	{
+		LOGERROR("Could not open analysis journal '%s' for writing", tempFileName.c_str());
+		return false;
+	}
+
+	const uint32_t header[4] = { kJournalMagic, kJournalVersion, (uint32_t)Pages.size(), SaveGeneration };
+	bool bOk = fwrite(header, sizeof(header), 1, FilePtr) == 1;
+	JournalSize = sizeof(header);
+
+	FILE* pOldFile = nullptr;
+	for (int64_t offset : RecordOffsets)
+	{
+		if (offset >= 0)
+		{
+			pOldFile = fopen(FileName.c_str(), "rb");
+			break;
+		}
+	}
+
+	std::vector<int64_t> newOffsets(Pages.size(), -1);
+	std::vector<uint8_t> recordData;
+	FMemoryBuffer buffer;
+	for (uint32_t pageIndex = 0; pageIndex < (uint32_t)Pages.size() && bOk; pageIndex++)
+	{
+		FCodeAnalysisPage* pPage = Pages[pageIndex];
+		const int64_t recordOffset = (int64_t)JournalSize;
+		if (pPage->bDirty && pPage->HasLoadFailed() == false)
+		{
+			SerialisePage(pPage, buffer);
+			const uint32_t checksum = CalculateChecksum(buffer.GetData(), buffer.GetSize());
+			bOk = WritePageRecord(pageIndex, buffer.GetData(), (uint32_t)buffer.GetSize(), checksum);
+		}
+		else if (RecordOffsets[pageIndex] >= 0)
+		{
+			bOk = pOldFile != nullptr && CopyPageRecord(pOldFile, RecordOffsets[pageIndex], FilePtr, recordData);
+			JournalSize += recordData.size();
+		}
+		else
+		{
+			continue;
+		}
+		newOffsets[pageIndex] = recordOffset;
+	}
+	if (pOldFile != nullptr)
+		fclose(pOldFile);
+	bOk = bOk && WriteCommit();
+	fclose(FilePtr);
+	FilePtr = nullptr;
+
+	if (bOk == false)
+	{
+		LOGERROR("Failed to write analysis journal '%s'", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	remove(FileName.c_str());
+	if (rename(tempFileName.c_str(), FileName.c_str()) != 0)
+	{
+		LOGERROR("Failed to replace analysis journal '%s'", FileName.c_str());
+		return false;
+	}
+
+	RecordOffsets = newOffsets;
+	for (uint32_t pageIndex = 0; pageIndex < (uint32_t)Pages.size(); pageIndex++)
+	{
+		if (newOffsets[pageIndex] >= 0)
+			Pages[pageIndex]->bDirty = false;
+	}
+
+	SnapshotSize = JournalSize;
+	FilePtr = fopen(FileName.c_str(), "ab");
+	return FilePtr != nullptr;
+}
+
+int FAnalysisJournal::Replay(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration)
+{
+	// pages hold the full save's state at this point, only what the journal restores differs from it
+	for (FCodeAnalysisPage* pPage : pages)
+		pPage->bDirty = false;
+
+	size_t fileSize = 0;
+	uint8_t* pFileData = (uint8_t*)LoadBinaryFile(pFileName, fileSize);
+	if (pFileData == nullptr)
+		return -1;
+
+	const uint32_t* pHeader = (const uint32_t*)pFileData;
+	if (fileSize < kHeaderSize || pHeader[0] != kJournalMagic || pHeader[1] != kJournalVersion || pHeader[2] != (uint32_t)pages.size())
+	{
+		LOGWARNING("Analysis journal '%s' doesn't match this machine, ignoring", pFileName);
+		free(pFileData);
+		return -1;
+	}
+	if (pHeader[3] != saveGeneration)
+	{
+		LOGWARNING("Analysis journal '%s' was written against a different save (generation %u, loaded %u), ignoring", pFileName, pHeader[3], saveGeneration);
+		free(pFileData);
+		return -1;
+	}
+
+	// find the latest committed record for each page
+	std::map<uint32_t, size_t>	committedRecords;
+	std::map<uint32_t, size_t>	pendingRecords;
+	size_t pos = kHeaderSize;
+	while (pos + 8 <= fileSize)
+	{
+		uint32_t record[4];
+		memcpy(record, pFileData + pos, 8);
+		if (record[0] == kCommitRecordMagic)
+		{
+			for (const auto& pending : pendingRecords)
+				committedRecords[pending.first] = pending.second;
+			pendingRecords.clear();
+			pos += 8;
+		}
+		else if (record[0] == kPageRecordMagic && pos + 16 <= fileSize)
+		{
+			memcpy(record, pFileData + pos, 16);
+			if (record[1] >= pages.size() || pos + 16 + record[2] > fileSize)
+				break;
+			pendingRecords[record[1]] = pos;
+			pos += 16 + record[2];
+		}
+		else
+		{
+			break;	// torn write
+		}
+	}
+
+	if (pendingRecords.empty() == false)
+		LOGWARNING("Analysis journal '%s' has an incomplete save, %d pages discarded", pFileName, (int)pendingRecords.size());
+
+	int noPagesRestored = 0;
+	FMemoryBuffer buffer;
+	FCodeAnalysisPage* pScratchPage = new FCodeAnalysisPage;
+	for (const auto& committed : committedRecords)
+	{
+		uint32_t record[4];
+		memcpy(record, pFileData + committed.second, 16);
+		const uint8_t* pPageData = pFileData + committed.second + 16;
+		const uint32_t dataSize = record[2];
+		const uint32_t checksum = record[3];
+		if (CalculateChecksum(pPageData, dataSize) != checksum)
+		{
+			LOGWARNING("Analysis journal '%s' page %d is corrupt", pFileName, committed.first);
+			continue;
+		}
+
+		FCodeAnalysisPage* pPage = pages[committed.first];
+
+		// check the record reads before touching the page, so a bad record leaves the page as it was
+		const FItemAllocationMark allocationMark;
+		pScratchPage->Initialise(pPage->BaseAddress);
+		buffer.InitView(pPageData, dataSize);
+		const bool bReadOk = pScratchPage->ReadFromBuffer(buffer);
+		allocationMark.FreeItemsAllocatedSince();
+		if (bReadOk == false)
+		{
+			LOGWARNING("Analysis journal '%s' page %d failed to load, skipped", pFileName, committed.first);
+			continue;
+		}
+
+		// last writer info isn't journaled so keep what we have
+		uint16_t lastWriter[FCodeAnalysisPage::kPageSize];
+		memcpy(lastWriter, pPage->LastWriter, sizeof(lastWriter));
+		pPage->Reset();
+		buffer.InitView(pPageData, dataSize);
+		pPage->ReadFromBuffer(buffer);
+		memcpy(pPage->LastWriter, lastWriter, sizeof(lastWriter));
+		pPage->bDirty = true;	// not in the full save, so the restarted journal must keep it
+		noPagesRestored++;
+	}
+
+	delete pScratchPage;
+	free(pFileData);
+	return noPagesRestored;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct FCodeAnalysisPage;
+
+// Append only journal of code analysis pages
+// Each save appends the pages flagged dirty since the last save, followed by a commit marker.
+// Records after the last commit marker are ignored on replay, so a crash mid-save loses at most that save.
+// The journal is compacted back to a single record per page when it grows too large, unchanged records are copied across.
+// The header holds the generation of the full save the journal was started from. Replay is skipped if that doesn't
+// match the save that has been loaded, e.g. after a crash between a full save and the journal being restarted.
+class FAnalysisJournal
+{
+public:
+	~FAnalysisJournal() { Close(); }
+
+	bool	Open(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration);	// starts a new journal holding the dirty pages
+	void	Close();
+	bool	IsOpen() const { return FilePtr != nullptr; }
+
+	int		WriteChanges();	// returns number of pages written, -1 on error
+	bool	Compact();
+	bool	Compact(uint32_t saveGeneration);	// restart the journal after a full save with a new generation, all pages become clean
+
+	// apply the committed records of a journal to pages, returns number of pages restored or -1 if the journal can't be used
+	static int	Replay(const char* pFileName, const std::vector<FCodeAnalysisPage*>& pages, uint32_t saveGeneration);
+
+private:
+	bool	WritePageRecord(uint32_t pageIndex, const void* pData, uint32_t dataSize, uint32_t checksum);
+	bool	WriteCommit();
+
+	FILE*		FilePtr = nullptr;
+	std::string	FileName;
+	std::vector<FCodeAnalysisPage*>	Pages;
+	std::vector<int64_t>	RecordOffsets;	// offset of each page's latest committed record, -1 if it has none
+	uint32_t	CommitNo = 0;
+	uint32_t	SaveGeneration = 0;
+	size_t		JournalSize = 0;
+	size_t		SnapshotSize = 0;	// size of journal after last compaction
+};
@@ -270,7 +270,7 @@ public:
 	{
 		if (outputCallback != nullptr)
 		{
-			ENumberDisplayMode dispMode = GetNumberDisplayMode();
+			ENumberDisplayMode dispMode = DisplayMode;
 
 			if (pCodeInfoItem->OperandType == EOperandType::Decimal)
 				dispMode = ENumberDisplayMode::Decimal;
@@ -287,7 +287,7 @@ public:
 	{
 		if (outputCallback)
 		{
-			ENumberDisplayMode dispMode = GetNumberDisplayMode();
+			ENumberDisplayMode dispMode = DisplayMode;
 
 			if (pCodeInfoItem->OperandType == EOperandType::Decimal)
 				dispMode = ENumberDisplayMode::Decimal;
@@ -313,13 +313,14 @@ public:
 			{
 				outputCallback('+', this);
 			}
-			const char* outStr = NumStr((uint8_t)val);
+			const char* outStr = NumStr((uint8_t)val, DisplayMode);
 			for (int i = 0; i < strlen(outStr); i++)
 				outputCallback(outStr[i], this);
 		}
 	}
 
 	FCodeInfo* pCodeInfoItem = nullptr;
+	ENumberDisplayMode	DisplayMode = GetNumberDisplayMode();
 };
 
 
@@ -362,6 +363,36 @@ void UpdateCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc)
 }
 
 
+// Generate disassembly text for a code item without touching the item or any global state
+std::string GenerateDasmText(FCodeAnalysisState& state, uint16_t pc, ENumberDisplayMode displayMode)
+{
+	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
+	if (pCodeInfo == nullptr)
+		return std::string();
+
+	FAnalysisDasmState dasmState;
+	dasmState.pCodeInfoItem = pCodeInfo;
+	dasmState.CodeAnalysisState = &state;
+	dasmState.CurrentAddress = pc;
+	dasmState.DisplayMode = displayMode;
+	SetNumberOutput(&dasmState);
+	if (state.CPUInterface->CPUType == ECPUType::Z80)
+		z80dasm_op(pc, AnalysisDasmInputCB, AnalysisOutputCB, &dasmState);
+	else if (state.CPUInterface->CPUType == ECPUType::M6502)
+		m6502dasm_op(pc, AnalysisDasmInputCB, AnalysisOutputCB, &dasmState);
+	SetNumberOutput(nullptr);
+
+	return dasmState.Text;
+}
+
+// a new reference changes the saved page, counting an existing one doesn't
+static void AddLabelReference(FCodeAnalysisState& state, uint16_t labelAddr, uint16_t pc)
+{
+	FLabelInfo* pLabel = state.GetLabelForAddress(labelAddr);
+	if (pLabel != nullptr && pLabel->References[pc]++ == 0)
+		state.SetPageDirty(labelAddr);
+}
+
 uint16_t WriteCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc)
 {
 	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
@@ -382,7 +413,7 @@ uint16_t WriteCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc)
 	{
 		const bool isCall = CheckCallInstruction(state.CPUInterface, pc);
 		if (GenerateLabelForAddress(state, jumpAddr, isCall ? ELabelType::Function : ELabelType::Code))
-			state.GetLabelForAddress(jumpAddr)->References[pc]++;
+			AddLabelReference(state, jumpAddr, pc);
 
 		pCodeInfo->JumpAddress = jumpAddr;
 		if (pCodeInfo->OperandType == EOperandType::Unknown)
@@ -404,7 +435,7 @@ uint16_t WriteCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc)
 			if (pCodeInfo->OperandType == EOperandType::Unknown)
 				pCodeInfo->OperandType = EOperandType::Pointer;
 			if (GenerateLabelForAddress(state, ptr, ELabelType::Data))
-				state.GetLabelForAddress(ptr)->References[pc]++;
+				AddLabelReference(state, ptr, pc);
 		}
 	}
 
@@ -435,17 +466,13 @@ bool AnalyseAtPC(FCodeAnalysisState &state, uint16_t& pc)
 	uint16_t jumpAddr;
 	if (CheckJumpInstruction(state.CPUInterface, pc, &jumpAddr))
 	{
-		FLabelInfo* pLabel = state.GetLabelForAddress(jumpAddr);
-		if (pLabel != nullptr)
-			pLabel->References[pc]++;	// add/increment reference
+		AddLabelReference(state, jumpAddr, pc);
 	}
 
 	uint16_t ptr;
 	if (CheckPointerRefInstruction(state.CPUInterface, pc, &ptr))
 	{
-		FLabelInfo* pLabel = state.GetLabelForAddress(ptr);
-		if (pLabel != nullptr)
-			pLabel->References[pc]++;	// add/increment reference
+		AddLabelReference(state, ptr, pc);
 	}
 
 	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
@@ -469,6 +496,8 @@ bool AnalyseAtPC(FCodeAnalysisState &state, uint16_t& pc)
 					pCodeInfo->bSelfModifyingCode = true;
 				}					
 			}
+			if (pCodeInfo->bSelfModifyingCode == false)
+				state.SetPageDirty(pc);
 
 			return false;	// return
 		}
@@ -507,9 +536,14 @@ bool RegisterCodeExecuted(FCodeAnalysisState &state, uint16_t pc, uint16_t nextp
 
 	state.FrameTrace.push_back(pc);
 	
-	FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
-	if (pCodeInfo != nullptr)
-		pCodeInfo->FrameLastExecuted = state.CurrentFrameNo;
+	// mark all the instruction's bytes
+	const FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(pc);
+	const int byteSize = pCodeInfo != nullptr ? pCodeInfo->ByteSize : 1;
+	for (int byteNo = 0; byteNo < byteSize; byteNo++)
+	{
+		const uint16_t addr = pc + byteNo;
+		state.GetReadPage(addr)->FrameLastExecuted[addr & FCodeAnalysisState::kPageMask] = state.CurrentFrameNo;
+	}
 
 	if (state.CPUInterface->CPUType == ECPUType::Z80)
 		return RegisterCodeExecutedZ80(state, pc, nextpc);
@@ -528,17 +562,29 @@ void RegisterDataRead(FCodeAnalysisState& state, uint16_t pc, uint16_t dataAddr)
 {
 	if (state.GetCodeInfoForAddress(dataAddr) == nullptr)	// don't register instruction data reads
 	{
-		FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(dataAddr);
-		pDataInfo->LastFrameRead = state.CurrentFrameNo;
-		pDataInfo->Reads[pc]++;
+		FCodeAnalysisPage* pPage = state.GetReadPage(dataAddr);
+		FDataInfo* pDataInfo = &pPage->DataInfo[dataAddr & FCodeAnalysisState::kPageMask];
+		pPage->FrameLastRead[dataAddr & FCodeAnalysisState::kPageMask] = state.CurrentFrameNo;
+		pPage->FrameLastAccessed = state.CurrentFrameNo;
+		if (pDataInfo->Reads[pc]++ == 0)
+		{
+			state.XRefs.AddXRef(*pPage, dataAddr, pc, EXRefType::Read);
+			pPage->bDirty = true;
+		}
 	}
 }
 
 void RegisterDataWrite(FCodeAnalysisState &state, uint16_t pc,uint16_t dataAddr)
 {
-	FDataInfo* pDataInfo = state.GetWriteDataInfoForAddress(dataAddr);
-	pDataInfo->LastFrameWritten = state.CurrentFrameNo;
-	pDataInfo->Writes[pc]++;
+	FCodeAnalysisPage* pPage = state.GetWritePage(dataAddr);
+	FDataInfo* pDataInfo = &pPage->DataInfo[dataAddr & FCodeAnalysisState::kPageMask];
+	pPage->FrameLastWritten[dataAddr & FCodeAnalysisState::kPageMask] = state.CurrentFrameNo;
+	pPage->FrameLastAccessed = state.CurrentFrameNo;
+	if (pDataInfo->Writes[pc]++ == 0)
+	{
+		state.XRefs.AddXRef(*pPage, dataAddr, pc, EXRefType::Write);
+		pPage->bDirty = true;
+	}
 }
 
 void ReAnalyseCode(FCodeAnalysisState &state)
@@ -592,11 +638,11 @@ void ResetReferenceInfo(FCodeAnalysisState &state)
 		FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(i);
 		if (pDataInfo != nullptr)
 		{
-			pDataInfo->LastFrameRead = -1;
 			pDataInfo->Reads.clear();
-			pDataInfo->LastFrameWritten = -1;
 			pDataInfo->Writes.clear();
 		}
+		if ((i & FCodeAnalysisState::kPageMask) == 0)
+			state.GetReadPage(i)->ResetAccessFrames();
 
 		FLabelInfo* pLabelInfo = state.GetLabelForAddress(i);
 		if (pLabelInfo != nullptr)
@@ -606,6 +652,8 @@ void ResetReferenceInfo(FCodeAnalysisState &state)
 
 		state.SetLastWriterForAddress(i,  0);
 	}
+
+	state.XRefs.Invalidate();
 }
 
 
@@ -643,6 +691,12 @@ FCommentBlock* AddCommentBlock(FCodeAnalysisState& state, uint16_t address)
 	return pExistingBlock;
 }
 
+void UpdateCodeAnalysisIndices(FCodeAnalysisState& state)
+{
+	state.SearchIndex.Update(state);
+	state.XRefs.Update(state);
+}
+
 void GenerateGlobalInfo(FCodeAnalysisState &state)
 {
 	state.GlobalDataItems.clear();
@@ -776,7 +830,7 @@ void SetItemText(FCodeAnalysisState &state, FItem *pItem)
 			else
 			{
 				pDataItem->DataType = EDataType::Text;
-				state.SetCodeAnalysisDirty();
+				state.SetCodeAnalysisDirty(pDataItem->Address);
 			}
 		}
 	}
@@ -794,6 +848,7 @@ void SetItemImage(FCodeAnalysisState& state, FItem* pItem)
 
 		pDataItem->ImageData->ViewerId = 0;	// default to None
 		pDataItem->ByteSize = pDataItem->ImageData->SetSizeChars(1,1);
+		state.SetPageDirty(pDataItem->Address);
 	}
 }
 
@@ -838,11 +893,14 @@ void SetLabelName(FCodeAnalysisState &state, FLabelInfo *pLabel, const char *pTe
 	state.RemoveLabelName(pLabel->Name);
 	pLabel->Name = pText;
 	state.EnsureUniqueLabelName(pLabel->Name);
+	state.SetPageDirty(pLabel->Address);
+	state.LabelsChanged();
 }
 
 void SetItemCommentText(FCodeAnalysisState &state, FItem *pItem, const char *pText)
 {
 	pItem->Comment = pText;
+	state.SetPageDirty(pItem->Address);
 }
 
 void FormatData(FCodeAnalysisState& state, const FDataFormattingOptions& options)
@@ -884,6 +942,7 @@ void FormatData(FCodeAnalysisState& state, const FDataFormattingOptions& options
 
 		pDataInfo->ByteSize = options.ItemSize;
 		pDataInfo->DataType = options.DataType;
+		state.SetPageDirty(dataAddress);
 
 		if (options.DataType == EDataType::CharacterMap)
 		{
@@ -908,7 +967,8 @@ void FormatData(FCodeAnalysisState& state, const FDataFormattingOptions& options
 
 
 // number output abstraction
-IDasmNumberOutput* g_pNumberOutputObj = nullptr;
+// this is per thread so disassembly can be generated on worker threads
+static thread_local IDasmNumberOutput* g_pNumberOutputObj = nullptr;
 IDasmNumberOutput* GetNumberOutput()
 {
 	return g_pNumberOutputObj;
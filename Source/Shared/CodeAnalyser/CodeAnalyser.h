@@ -1,4 +1,5 @@
 #pragma once
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <map>
@@ -7,6 +8,8 @@
 #include <algorithm>
 
 #include "CodeAnaysisPage.h"
+#include "SearchIndex.h"
+#include "XRefStore.h"
 
 #define USE_PAGING 1
 
@@ -151,6 +154,14 @@ struct FLabelListFilter
 	uint16_t		MaxAddress = 0xffff;
 };
 
+// an instruction accessing the accessors tab range
+struct FXRefAccessor
+{
+	uint16_t	CodeAddress;
+	int			NoBytesRead;
+	int			NoBytesWritten;
+};
+
 // view state for code analysis window
 struct FCodeAnalysisViewState
 {
@@ -176,6 +187,20 @@ struct FCodeAnalysisViewState
 	FLabelListFilter			GlobalFunctionsFilter;
 	std::vector< FLabelInfo*>	FilteredGlobalFunctions;
 
+	// search box
+	std::string					SearchText;
+	std::vector<FSearchResult>	SearchResults;
+	int							SearchGeneration = -1;	// index generation the results came from
+
+	// range for the accessors tab
+	uint16_t					XRefStartAddress = 0;
+	uint16_t					XRefEndAddress = 0;
+	std::vector<FXRef>			XRefs;
+	std::vector<FXRefAccessor>	XRefAccessors;	// rebuilt when the range or the xref store generation changes
+	uint16_t					XRefAccessorsStart = 0;
+	uint16_t					XRefAccessorsEnd = 0;
+	int							XRefAccessorsGeneration = -1;
+
 	std::vector<uint16_t>	AddressStack;
 
 	bool					DataFormattingTabOpen = false;
@@ -207,15 +232,54 @@ struct FCodeAnalysisState
 		PageNames.push_back(pName);
 		return true;
 	}
-	FCodeAnalysisPage*		GetPage(int16_t id) { return RegisteredPages[id]; }
+	FCodeAnalysisPage*		GetPage(int16_t id)
+	{
+		FCodeAnalysisPage* pPage = RegisteredPages[id];
+		if (pPage->IsPendingLoad() && pPage->LoadPending())
+			PageContentsChanged(pPage);
+		return pPage;
+	}
+	// nullptr if the page is still waiting to be lazily loaded, for scans that shouldn't force a load
+	const FCodeAnalysisPage*	GetPageIfLoaded(int16_t id) const
+	{
+		const FCodeAnalysisPage* pPage = RegisteredPages[id];
+		return pPage->IsPendingLoad() ? nullptr : pPage;
+	}
+	// Load every page still waiting on an analysis database.
+	// Work spread across threads must call this first, so lookups from the workers only ever read the pages.
+	void					LoadAllPendingPages()
+	{
+		for (int16_t pageId = 0; pageId < (int16_t)RegisteredPages.size(); pageId++)
+			GetPage(pageId);
+		for (int pageNo = 0; pageNo < kAddressSize / FCodeAnalysisPage::kPageSize; pageNo++)
+		{
+			if (ReadPageTable[pageNo] != nullptr)
+				GetReadPage((uint16_t)(pageNo * FCodeAnalysisPage::kPageSize));
+			if (WritePageTable[pageNo] != nullptr)
+				GetWritePage((uint16_t)(pageNo * FCodeAnalysisPage::kPageSize));
+		}
+	}
+	int						GetNoPages() const { return (int)RegisteredPages.size(); }
 	const char*				GetPageName(int16_t id) { return PageNames[id].c_str(); }
 	int16_t					GetAddressReadPageId(uint16_t addr) { return GetReadPage(addr)->PageId; }
 	int16_t					GetAddressWritePageId(uint16_t addr) { return GetWritePage(addr)->PageId; }
 
-	FCodeAnalysisPage*		ReadPageTable[kAddressSize / FCodeAnalysisPage::kPageSize];
-	FCodeAnalysisPage*		WritePageTable[kAddressSize / FCodeAnalysisPage::kPageSize];
-	void					SetCodeAnalysisReadPage(int pageNo, FCodeAnalysisPage* pPage) { ReadPageTable[pageNo] = pPage; pPage->bUsed = true; }
-	void					SetCodeAnalysisWritePage(int pageNo, FCodeAnalysisPage* pPage) { WritePageTable[pageNo] = pPage; pPage->bUsed = true;}
+	FCodeAnalysisPage*		ReadPageTable[kAddressSize / FCodeAnalysisPage::kPageSize] = {};
+	FCodeAnalysisPage*		WritePageTable[kAddressSize / FCodeAnalysisPage::kPageSize] = {};
+	void					SetCodeAnalysisReadPage(int pageNo, FCodeAnalysisPage* pPage) 
+	{ 
+		if (ReadPageTable[pageNo] != pPage)
+			PageMappingChanged(pageNo);
+		ReadPageTable[pageNo] = pPage; 
+		pPage->bUsed = true; 
+	}
+	void					SetCodeAnalysisWritePage(int pageNo, FCodeAnalysisPage* pPage) 
+	{ 
+		if (WritePageTable[pageNo] != pPage)
+			PageMappingChanged(pageNo);
+		WritePageTable[pageNo] = pPage; 
+		pPage->bUsed = true;
+	}
 	void					SetCodeAnalysisRWPage(int pageNo, FCodeAnalysisPage* pReadPage, FCodeAnalysisPage *pWritePage)
 	{
 		SetCodeAnalysisReadPage(pageNo, pReadPage);
@@ -227,9 +291,40 @@ struct FCodeAnalysisState
 		bCodeAnalysisDataDirty = val; 
 	}
 
+	// analysis items at an address changed - marks the page holding them for saving as well
+	void	SetCodeAnalysisDirty(uint16_t addr)
+	{
+		SetPageDirty(addr);
+		SetCodeAnalysisDirty();
+	}
+	void	SetPageDirty(uint16_t addr)
+	{
+		FCodeAnalysisPage* pPage = ReadPageTable[addr >> kPageShift];
+		if (pPage != nullptr)
+			pPage->bDirty = true;
+	}
+
 	bool IsCodeAnalysisDataDirty() const { return bCodeAnalysisDataDirty; }
 
-	void	ResetLabelNames() { LabelUsage.clear(); }
+	// for UI that caches label text - call when a label is created, renamed or deleted
+	// Lazily loaded pages don't need it as label lookups load the page before any text can be cached from it.
+	void	LabelsChanged() { LabelGeneration++; }
+	int		GetLabelGeneration() const { return LabelGeneration; }
+
+	// a different page mapped in to a slot
+	void	PageMappingChanged(int /*pageNo*/)
+	{
+		XRefs.PageMappingChanged();
+	}
+
+	// a page loaded - only its cross references need rebuilding
+	void	PageContentsChanged(const FCodeAnalysisPage* pPage)
+	{
+		XRefs.InvalidatePage(*pPage);
+		SetCodeAnalysisDirty();	// the item list only had placeholders for the page if it was waiting to load
+	}
+
+	void	ResetLabelNames() { LabelUsage.clear(); LabelsChanged(); }
 	bool	EnsureUniqueLabelName(std::string& lableName);
 	bool	RemoveLabelName(const std::string& labelName);	// for changing label names
 
@@ -254,6 +349,7 @@ private:
 	std::map<std::string, int>	LabelUsage;
 
 	bool						bCodeAnalysisDataDirty = false;
+	std::atomic<int>			LabelGeneration{ 0 };
 
 public:
 
@@ -267,6 +363,9 @@ public:
 	std::vector< FLabelInfo*>	GlobalFunctions;
 	bool						bRebuildFilteredGlobalFunctions = true;
 
+	FSearchIndex				SearchIndex;
+	FXRefStore					XRefs;	// every code/data access, for range queries
+
 	static const int kNoViewStates = 4;
 	FCodeAnalysisViewState	ViewState[kNoViewStates];	// new multiple view states
 	int						FocussedWindowId = 0;
@@ -300,10 +399,24 @@ public:
 		{
 			printf("Read page %d NOT mapped", pageNo);
 		}
+		else if (pPage->IsPendingLoad() && pPage->LoadPending())	// lazily loaded from an analysis database
+		{
+			PageContentsChanged(pPage);
+		}
 
 		return pPage;
 	}
 	const FCodeAnalysisPage* GetReadPage(uint16_t addr) const { return ((FCodeAnalysisState *)this)->GetReadPage(addr); }
+	bool IsReadPageLoaded(uint16_t addr) const	// mapped & not waiting to be lazily loaded
+	{
+		const FCodeAnalysisPage* pPage = ReadPageTable[addr >> kPageShift];
+		return pPage != nullptr && pPage->IsPendingLoad() == false;
+	}
+	bool IsWritePageLoaded(uint16_t addr) const
+	{
+		const FCodeAnalysisPage* pPage = WritePageTable[addr >> kPageShift];
+		return pPage != nullptr && pPage->IsPendingLoad() == false;
+	}
 	FCodeAnalysisPage* GetWritePage(uint16_t addr) 
 	{
 		const int pageNo = addr >> kPageShift;
@@ -312,6 +425,10 @@ public:
 		{
 			printf("Write page %d NOT mapped", pageNo);
 		}
+		else if (pPage->IsPendingLoad() && pPage->LoadPending())	// lazily loaded from an analysis database
+		{
+			PageContentsChanged(pPage);
+		}
 
 		return pPage;
 	}
@@ -323,18 +440,28 @@ public:
 	{
 		if(pLabel != nullptr)	// ensure no name clashes
 			EnsureUniqueLabelName(pLabel->Name);
-		GetReadPage(addr)->Labels[addr & kPageMask] = pLabel; 
+		FCodeAnalysisPage* pPage = GetReadPage(addr);
+		pPage->Labels[addr & kPageMask] = pLabel;
+		pPage->bDirty = true;
+		LabelsChanged();
 	}
 
 	FCommentBlock* GetCommentBlockForAddress(uint16_t addr) const { return GetReadPage(addr)->CommentBlocks[addr & kPageMask]; }
 	void SetCommentBlockForAddress(uint16_t addr, FCommentBlock* pCommentBlock)
 	{
-		GetReadPage(addr)->CommentBlocks[addr & kPageMask] = pCommentBlock;
+		FCodeAnalysisPage* pPage = GetReadPage(addr);
+		pPage->CommentBlocks[addr & kPageMask] = pCommentBlock;
+		pPage->bDirty = true;
 	}
 
 	const FCodeInfo* GetCodeInfoForAddress(uint16_t addr) const { return GetReadPage(addr)->CodeInfo[addr & kPageMask]; }
 	FCodeInfo* GetCodeInfoForAddress(uint16_t addr) { return GetReadPage(addr)->CodeInfo[addr & kPageMask]; }
-	void SetCodeInfoForAddress(uint16_t addr, FCodeInfo* pCodeInfo) { GetReadPage(addr)->CodeInfo[addr & kPageMask] = pCodeInfo; }
+	void SetCodeInfoForAddress(uint16_t addr, FCodeInfo* pCodeInfo)
+	{
+		FCodeAnalysisPage* pPage = GetReadPage(addr);
+		pPage->CodeInfo[addr & kPageMask] = pCodeInfo;
+		pPage->bDirty = true;
+	}
 
 	const FDataInfo* GetReadDataInfoForAddress(uint16_t addr) const { return &GetReadPage(addr)->DataInfo[addr & kPageMask]; }
 	FDataInfo* GetReadDataInfoForAddress(uint16_t addr) { return &GetReadPage(addr)->DataInfo[addr & kPageMask]; }
@@ -342,6 +469,10 @@ public:
 	const FDataInfo* GetWriteDataInfoForAddress(uint16_t addr) const { return  &GetWritePage(addr)->DataInfo[addr & kPageMask]; }
 	FDataInfo* GetWriteDataInfoForAddress(uint16_t addr) { return &GetWritePage(addr)->DataInfo[addr & kPageMask]; }
 
+	int GetLastFrameExecuted(uint16_t addr) const { return GetReadPage(addr)->FrameLastExecuted[addr & kPageMask]; }
+	int GetLastFrameRead(uint16_t addr) const { return GetReadPage(addr)->FrameLastRead[addr & kPageMask]; }
+	int GetLastFrameWritten(uint16_t addr) const { return GetWritePage(addr)->FrameLastWritten[addr & kPageMask]; }
+
 	uint16_t GetLastWriterForAddress(uint16_t addr) const { return GetWritePage(addr)->LastWriter[addr & kPageMask]; }
 	void SetLastWriterForAddress(uint16_t addr, uint16_t lastWriter) { GetWritePage(addr)->LastWriter[addr & kPageMask] = lastWriter; }
 
@@ -357,10 +488,15 @@ void RunStaticCodeAnalysis(FCodeAnalysisState &state, uint16_t pc);
 bool RegisterCodeExecuted(FCodeAnalysisState &state, uint16_t pc, uint16_t nextpc);
 void ReAnalyseCode(FCodeAnalysisState &state);
 uint16_t WriteCodeInfoForAddress(FCodeAnalysisState& state, uint16_t pc);
+bool CheckJumpInstruction(ICPUInterface* pCPUInterface, uint16_t pc, uint16_t* out_addr);
+bool CheckPointerRefInstruction(ICPUInterface* pCPUInterface, uint16_t pc, uint16_t* out_addr);
+bool CheckPointerIndirectionInstruction(ICPUInterface* pCPUInterface, uint16_t pc, uint16_t* out_addr);
 void GenerateGlobalInfo(FCodeAnalysisState &state);
+void UpdateCodeAnalysisIndices(FCodeAnalysisState& state);	// once a frame, brings the search index up to date a slice at a time
 void RegisterDataRead(FCodeAnalysisState& state, uint16_t pc, uint16_t dataAddr);
 void RegisterDataWrite(FCodeAnalysisState &state, uint16_t pc, uint16_t dataAddr);
 void UpdateCodeInfoForAddress(FCodeAnalysisState &state, uint16_t pc);
+std::string GenerateDasmText(FCodeAnalysisState& state, uint16_t pc, ENumberDisplayMode displayMode);	// thread safe, doesn't update the code info
 void ResetReferenceInfo(FCodeAnalysisState &state);
 
 std::string GetItemText(FCodeAnalysisState& state, uint16_t address);
@@ -382,6 +518,9 @@ void SetItemCommentText(FCodeAnalysisState &state, FItem *pItem, const char *pTe
 
 void FormatData(FCodeAnalysisState& state, const FDataFormattingOptions& options);
 
+// Serialisation
+void BenchmarkPageSerialisation(FCodeAnalysisState& state);
+
 // number output abstraction
 IDasmNumberOutput* GetNumberOutput();
 void SetNumberOutput(IDasmNumberOutput* pNumberOutputObj);
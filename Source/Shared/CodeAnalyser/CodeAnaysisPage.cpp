@@ -1,10 +1,15 @@
 #include "CodeAnaysisPage.h"
 #include "CodeAnalyser.h"
+#include "AnalysisDatabase.h"
 
 #include "Util/MemoryBuffer.h"
 #include "Util/GraphicsView.h"
+#include "Debug/DebugLog.h"
 #include <cassert>
 #include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <mutex>
 
 //#include "json.hpp"
 std::vector<FCodeInfo*>		FCodeInfo::AllocatedList;
@@ -34,6 +39,14 @@ void FCodeInfo::FreeAll()
 	AllocatedList.clear();
 }
 
+void FCodeInfo::FreeAllocatedSince(size_t noAllocated)
+{
+	for (size_t i = noAllocated; i < AllocatedList.size(); i++)
+		delete AllocatedList[i];
+
+	AllocatedList.resize(std::min(noAllocated, AllocatedList.size()));
+}
+
 FLabelInfo* FLabelInfo::Allocate()
 {
 	FLabelInfo* pLabelInfo = new FLabelInfo;
@@ -49,6 +62,14 @@ void FLabelInfo::FreeAll()
 	AllocatedList.clear();
 }
 
+void FLabelInfo::FreeAllocatedSince(size_t noAllocated)
+{
+	for (size_t i = noAllocated; i < AllocatedList.size(); i++)
+		delete AllocatedList[i];
+
+	AllocatedList.resize(std::min(noAllocated, AllocatedList.size()));
+}
+
 FCommentBlock* FCommentBlock::Allocate()
 {
 	FCommentBlock* pCommentBlock = new FCommentBlock;
@@ -64,6 +85,28 @@ void FCommentBlock::FreeAll()
 	AllocatedList.clear();
 }
 
+void FCommentBlock::FreeAllocatedSince(size_t noAllocated)
+{
+	for (size_t i = noAllocated; i < AllocatedList.size(); i++)
+		delete AllocatedList[i];
+
+	AllocatedList.resize(std::min(noAllocated, AllocatedList.size()));
+}
+
+FItemAllocationMark::FItemAllocationMark()
+	: NoLabels(FLabelInfo::GetNoAllocated())
+	, NoCodeInfos(FCodeInfo::GetNoAllocated())
+	, NoCommentBlocks(FCommentBlock::GetNoAllocated())
+{
+}
+
+void FItemAllocationMark::FreeItemsAllocatedSince() const
+{
+	FLabelInfo::FreeAllocatedSince(NoLabels);
+	FCodeInfo::FreeAllocatedSince(NoCodeInfos);
+	FCommentBlock::FreeAllocatedSince(NoCommentBlocks);
+}
+
 FCommentLine* FCommentLine::Allocate()
 {
 	if (FreeList.size() == 0)
@@ -95,6 +138,7 @@ void FCodeAnalysisPage::Initialise(uint16_t address)
 	memset(CodeInfo, 0, sizeof(CodeInfo));
 	memset(CommentBlocks, 0, sizeof(CommentBlocks));
 	memset(LastWriter, 0, sizeof(LastWriter));
+	ResetAccessFrames();
 
 	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
 	{
@@ -106,6 +150,14 @@ void FCodeAnalysisPage::Initialise(uint16_t address)
 	}
 }
 
+void FCodeAnalysisPage::ResetAccessFrames(void)
+{
+	std::fill(FrameLastExecuted, FrameLastExecuted + kPageSize, -1);
+	std::fill(FrameLastRead, FrameLastRead + kPageSize, -1);
+	std::fill(FrameLastWritten, FrameLastWritten + kPageSize, -1);
+	FrameLastAccessed = -1;
+}
+
 // This is used to rebase pages if they move in system memory
 void FCodeAnalysisPage::ChangeAddress(uint16_t newAddress)
 {
@@ -129,11 +181,14 @@ void FCodeAnalysisPage::ChangeAddress(uint16_t newAddress)
 	}
 
 	BaseAddress = newAddress;
+	bDirty = true;
 }
 
 
 void FCodeAnalysisPage::Reset(void)
 {
+	pPendingDatabase = nullptr;	// whatever was waiting to load is discarded
+	FailedLoadData.clear();
 	for (int addr = 0; addr < FCodeAnalysisPage::kPageSize; addr++)
 	{
 		if (Labels[addr] != nullptr)
@@ -166,11 +221,41 @@ void FCodeAnalysisPage::Reset(void)
 }
 
 static const uint32_t kMagic = 0xc0de;
-static const uint32_t kVersionNo = 2;
+static const uint32_t kVersionNo = 4;
+static const uint32_t kOldestSupportedVersionNo = 2;
 
 uint32_t kLabelMagic = 'LABL';
 uint32_t kCodeMagic = 'CODE';
 uint32_t kDataMagic = 'DATA';
+uint32_t kCommentMagic = 'CMNT';
+
+// Varints - 7 bits per byte, top bit set if more bytes follow
+static void WriteVarInt(uint32_t value, FMemoryBuffer& buffer)
+{
+	while (value >= 0x80)
+	{
+		buffer.Write<uint8_t>((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.Write<uint8_t>((uint8_t)value);
+}
+
+// a 5th byte can only hold the top 4 bits, anything more means the stream is corrupt
+static uint32_t ReadVarInt(FMemoryBuffer& buffer)
+{
+	uint32_t value = 0;
+	for (int shift = 0; shift < 35; shift += 7)
+	{
+		const uint8_t byte = buffer.Read<uint8_t>();
+		if (shift == 28 && byte > 0x0f)
+			break;
+		value |= (uint32_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return value;
+	}
+	buffer.SetReadError();
+	return 0;
+}
 
 void WriteItemToBuffer(const FItem& item, FMemoryBuffer& buffer)
 {
@@ -181,7 +266,7 @@ void WriteItemToBuffer(const FItem& item, FMemoryBuffer& buffer)
 
 void ReadItemFromBuffer( FItem& item, FMemoryBuffer& buffer)
 {
-	item.Comment = buffer.ReadString();
+	item.Comment = buffer.ReadStringView();
 	//buffer.Read(item.Address);
 	buffer.Read(item.ByteSize);
 }
@@ -205,13 +290,171 @@ void ReadReferencesFromBuffer(std::map<uint16_t, int>& references, FMemoryBuffer
 	}
 }
 
+// v3 references - count then ascending addresses as varint deltas
+static void WriteReferencesToBufferV3(const std::map<uint16_t, int>& references, FMemoryBuffer& buffer)
+{
+	WriteVarInt((uint32_t)references.size(), buffer);
+	uint16_t lastAddr = 0;
+	for (const auto& ref : references)
+	{
+		WriteVarInt(ref.first - lastAddr, buffer);
+		lastAddr = ref.first;
+	}
+}
+
+static bool ReadReferencesFromBufferV3(std::map<uint16_t, int>& references, FMemoryBuffer& buffer)
+{
+	const uint32_t count = ReadVarInt(buffer);
+	if (count > FCodeAnalysisState::kAddressSize)
+		return false;
+
+	uint32_t addr = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		addr += ReadVarInt(buffer);
+		if (addr >= FCodeAnalysisState::kAddressSize || buffer.HasReadError())
+			return false;
+		references[(uint16_t)addr] = 1;
+	}
+	return true;
+}
+
+// does this data item differ from what Initialise() sets up?
+static bool IsDataInfoNonDefault(const FDataInfo& dataInfo)
+{
+	return dataInfo.Comment.empty() == false || dataInfo.ByteSize != 1 || dataInfo.DataType != EDataType::Byte ||
+		dataInfo.OperandType != EOperandType::Unknown || dataInfo.Flags != 0 ||
+		dataInfo.Reads.empty() == false || dataInfo.Writes.empty() == false;
+}
+
 void FCodeAnalysisPage::WriteToBuffer(FMemoryBuffer& buffer)
 {
+	// an unloaded page can't have changed so its stored data is still current
+	FAnalysisDatabase* pDatabase = pPendingDatabase.load(std::memory_order_acquire);
+	if (pDatabase != nullptr && pDatabase->WritePageData(this, buffer))
+		return;
+
+	// keep the data of a page that couldn't be loaded rather than replacing it with nothing
+	if (FailedLoadData.empty() == false)
+	{
+		buffer.WriteBytes(FailedLoadData.data(), FailedLoadData.size());
+		return;
+	}
+
 	buffer.Write(kMagic);
 	buffer.Write(kVersionNo);
 
 	buffer.Write(BaseAddress);
 
+	// Labels - page addresses are delta encoded
+	buffer.Write(kLabelMagic);
+	uint32_t noLabels = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (Labels[i] != nullptr)
+			noLabels++;
+	}
+	WriteVarInt(noLabels, buffer);
+	int lastPageAddr = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (Labels[i] != nullptr)
+		{
+			const FLabelInfo& label = *Labels[i];
+			WriteVarInt(i - lastPageAddr, buffer);
+			lastPageAddr = i;
+			WriteItemToBuffer(label, buffer);
+			buffer.Write((uint8_t)label.LabelType);
+			buffer.WriteString(label.Name);
+			buffer.Write(label.Global);
+			WriteReferencesToBufferV3(label.References, buffer);
+		}
+	}
+
+	// Code Section
+	buffer.Write(kCodeMagic);
+	uint32_t noCodeItems = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (CodeInfo[i] != nullptr && CodeInfo[i]->Address == BaseAddress + i)	// only first item
+			noCodeItems++;
+	}
+	WriteVarInt(noCodeItems, buffer);
+	lastPageAddr = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (CodeInfo[i] != nullptr && CodeInfo[i]->Address == BaseAddress + i)
+		{
+			const FCodeInfo& codeInfo = *CodeInfo[i];
+			WriteVarInt(i - lastPageAddr, buffer);
+			lastPageAddr = i;
+			WriteItemToBuffer(codeInfo, buffer);
+
+			buffer.Write<uint16_t>(codeInfo.JumpAddress);
+			buffer.Write<uint16_t>(codeInfo.PointerAddress);
+			WriteVarInt(codeInfo.Flags, buffer);
+			buffer.Write<uint8_t>((uint8_t)codeInfo.OperandType);
+		}
+	}
+
+	// Data Section - bitmap of entries which aren't in their default state, followed by those entries
+	buffer.Write(kDataMagic);
+	uint8_t presenceBitmap[kPageSize / 8] = { 0 };
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (IsDataInfoNonDefault(DataInfo[i]))
+			presenceBitmap[i >> 3] |= 1 << (i & 7);
+	}
+	buffer.WriteBytes(presenceBitmap, sizeof(presenceBitmap));
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (presenceBitmap[i >> 3] & (1 << (i & 7)))
+		{
+			const FDataInfo& dataInfo = DataInfo[i];
+			WriteItemToBuffer(dataInfo, buffer);
+
+			buffer.Write<uint8_t>((uint8_t)dataInfo.DataType);
+			buffer.Write<uint8_t>((uint8_t)dataInfo.OperandType);
+			WriteVarInt(dataInfo.Flags, buffer);
+			if (dataInfo.DataType == EDataType::CharacterMap)
+			{
+				buffer.Write<uint16_t>(dataInfo.CharSetAddress);
+				buffer.Write<uint8_t>(dataInfo.EmptyCharNo);
+			}
+			WriteReferencesToBufferV3(dataInfo.Reads, buffer);
+			WriteReferencesToBufferV3(dataInfo.Writes, buffer);
+		}
+	}
+
+	// Comment blocks
+	buffer.Write(kCommentMagic);
+	uint32_t noCommentBlocks = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (CommentBlocks[i] != nullptr)
+			noCommentBlocks++;
+	}
+	WriteVarInt(noCommentBlocks, buffer);
+	lastPageAddr = 0;
+	for (int i = 0; i < kPageSize; i++)
+	{
+		if (CommentBlocks[i] != nullptr)
+		{
+			WriteVarInt(i - lastPageAddr, buffer);
+			lastPageAddr = i;
+			buffer.WriteString(CommentBlocks[i]->Comment);
+		}
+	}
+}
+
+// Old dense format, only used for comparison
+void FCodeAnalysisPage::WriteToBufferV2(FMemoryBuffer& buffer)
+{
+	buffer.Write(kMagic);
+	buffer.Write((uint32_t)2);
+
+	buffer.Write(BaseAddress);
+
 	buffer.Write(kLabelMagic);
 	for (int i = 0; i < kPageSize; i++)
 	{
@@ -253,46 +496,53 @@ void FCodeAnalysisPage::WriteToBuffer(FMemoryBuffer& buffer)
 	buffer.Write(kDataMagic);
 	for (int i = 0; i < kPageSize; i++)
 	{
-		//if (DataInfo[i] != nullptr)
-		{
-			const FDataInfo& dataInfo = DataInfo[i];
-			buffer.Write<uint16_t>(i);	// address in page
-			WriteItemToBuffer(dataInfo, buffer);
+		const FDataInfo& dataInfo = DataInfo[i];
+		buffer.Write<uint16_t>(i);	// address in page
+		WriteItemToBuffer(dataInfo, buffer);
 
-			buffer.Write<uint8_t>((uint8_t)dataInfo.DataType);
-			WriteReferencesToBuffer(dataInfo.Reads, buffer);
-			WriteReferencesToBuffer(dataInfo.Writes, buffer);
-		}
+		buffer.Write<uint8_t>((uint8_t)dataInfo.DataType);
+		WriteReferencesToBuffer(dataInfo.Reads, buffer);
+		WriteReferencesToBuffer(dataInfo.Writes, buffer);
 	}
 	buffer.Write<uint16_t>(0xffff);	// terminator
-
 }
 
 bool FCodeAnalysisPage::ReadFromBuffer(FMemoryBuffer& buffer)
 {
+	pPendingDatabase = nullptr;
+
 	if (buffer.Read<uint32_t>() != kMagic)
 		return false;
 
 	const uint32_t fileVersion = buffer.Read<uint32_t>();
-	if (fileVersion != kVersionNo)
+	if (fileVersion < kOldestSupportedVersionNo || fileVersion > kVersionNo)
 		return false;
 
 	buffer.Read(BaseAddress);
 
+	const bool bResult = fileVersion == 2 ? ReadFromBufferV2(buffer) : ReadFromBufferSparse(buffer, fileVersion);
+	return bResult && buffer.HasReadError() == false;
+}
+
+bool FCodeAnalysisPage::ReadFromBufferV2(FMemoryBuffer& buffer)
+{
 	// Read Labels
-	assert(buffer.Read<uint32_t>() == kLabelMagic);
+	if (buffer.Read<uint32_t>() != kLabelMagic)
+		return false;
 
 	while (true)
 	{
 		const uint16_t pageAddr = buffer.Read<uint16_t>();
 		if (pageAddr == 0xffff)
 			break;
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
 
 		FLabelInfo* pNewLabel = FLabelInfo::Allocate();
 		ReadItemFromBuffer(*pNewLabel, buffer);
 		pNewLabel->Address = BaseAddress + pageAddr;
 		pNewLabel->LabelType = (ELabelType)buffer.Read<uint8_t>();
-		pNewLabel->Name = buffer.ReadString();
+		pNewLabel->Name = buffer.ReadStringView();
 		buffer.Read(pNewLabel->Global);
 		ReadReferencesFromBuffer(pNewLabel->References, buffer);
 
@@ -300,13 +550,16 @@ bool FCodeAnalysisPage::ReadFromBuffer(FMemoryBuffer& buffer)
 	}
 
 	// Read Code
-	assert(buffer.Read<uint32_t>() == kCodeMagic);
+	if (buffer.Read<uint32_t>() != kCodeMagic)
+		return false;
 
 	while (true)
 	{
 		const uint16_t pageAddr = buffer.Read<uint16_t>();
 		if (pageAddr == 0xffff)
 			break;
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
 
 		FCodeInfo* pNewCodeInfo = FCodeInfo::Allocate();
 		ReadItemFromBuffer(*pNewCodeInfo, buffer);
@@ -315,18 +568,21 @@ bool FCodeAnalysisPage::ReadFromBuffer(FMemoryBuffer& buffer)
 		buffer.Read(pNewCodeInfo->PointerAddress);
 		buffer.Read(pNewCodeInfo->Flags);
 
-		for(int i=0;i<pNewCodeInfo->ByteSize;i++)
+		for(int i=0;i<pNewCodeInfo->ByteSize && pageAddr + i < kPageSize;i++)
 			CodeInfo[pageAddr + i] = pNewCodeInfo;
 	}
 
 	// Read Data
-	assert(buffer.Read<uint32_t>() == kDataMagic);
+	if (buffer.Read<uint32_t>() != kDataMagic)
+		return false;
 
 	while (true)
 	{
 		const uint16_t pageAddr = buffer.Read<uint16_t>();
 		if (pageAddr == 0xffff)
 			break;
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
 
 		FDataInfo& dataInfo = DataInfo[pageAddr];
 		ReadItemFromBuffer(dataInfo, buffer);
@@ -339,6 +595,206 @@ bool FCodeAnalysisPage::ReadFromBuffer(FMemoryBuffer& buffer)
 	return true;
 }
 
+// v3 & v4 sparse formats - v4 adds operand types, data flags, character map info and comment blocks
+bool FCodeAnalysisPage::ReadFromBufferSparse(FMemoryBuffer& buffer, uint32_t fileVersion)
+{
+	// Read Labels
+	if (buffer.Read<uint32_t>() != kLabelMagic)
+		return false;
+
+	const uint32_t noLabels = ReadVarInt(buffer);
+	if (noLabels > kPageSize)
+		return false;
+	uint32_t pageAddr = 0;
+	for (uint32_t labelNo = 0; labelNo < noLabels; labelNo++)
+	{
+		pageAddr += ReadVarInt(buffer);
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
+
+		FLabelInfo* pNewLabel = FLabelInfo::Allocate();
+		ReadItemFromBuffer(*pNewLabel, buffer);
+		pNewLabel->Address = BaseAddress + pageAddr;
+		pNewLabel->LabelType = (ELabelType)buffer.Read<uint8_t>();
+		pNewLabel->Name = buffer.ReadStringView();
+		buffer.Read(pNewLabel->Global);
+		if (ReadReferencesFromBufferV3(pNewLabel->References, buffer) == false)
+			return false;
+
+		Labels[pageAddr] = pNewLabel;
+	}
+
+	// Read Code
+	if (buffer.Read<uint32_t>() != kCodeMagic)
+		return false;
+
+	const uint32_t noCodeItems = ReadVarInt(buffer);
+	if (noCodeItems > kPageSize)
+		return false;
+	pageAddr = 0;
+	for (uint32_t codeItemNo = 0; codeItemNo < noCodeItems; codeItemNo++)
+	{
+		pageAddr += ReadVarInt(buffer);
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
+
+		FCodeInfo* pNewCodeInfo = FCodeInfo::Allocate();
+		ReadItemFromBuffer(*pNewCodeInfo, buffer);
+		pNewCodeInfo->Address = BaseAddress + pageAddr;
+		buffer.Read(pNewCodeInfo->JumpAddress);
+		buffer.Read(pNewCodeInfo->PointerAddress);
+		pNewCodeInfo->Flags = ReadVarInt(buffer);
+		if (fileVersion >= 4)
+			pNewCodeInfo->OperandType = (EOperandType)buffer.Read<uint8_t>();
+
+		for (int i = 0; i < pNewCodeInfo->ByteSize && pageAddr + i < kPageSize; i++)
+			CodeInfo[pageAddr + i] = pNewCodeInfo;
+	}
+
+	// Read Data
+	if (buffer.Read<uint32_t>() != kDataMagic)
+		return false;
+
+	uint8_t presenceBitmap[kPageSize / 8];
+	buffer.ReadBytes(presenceBitmap, sizeof(presenceBitmap));
+	for (int i = 0; i < kPageSize; i++)
+	{
+		FDataInfo& dataInfo = DataInfo[i];
+		if ((presenceBitmap[i >> 3] & (1 << (i & 7))) == 0)
+		{
+			dataInfo.Reset(BaseAddress + i);
+			continue;
+		}
+
+		ReadItemFromBuffer(dataInfo, buffer);
+		dataInfo.Address = BaseAddress + i;
+		dataInfo.DataType = (EDataType)buffer.Read<uint8_t>();
+		if (fileVersion >= 4)
+		{
+			dataInfo.OperandType = (EOperandType)buffer.Read<uint8_t>();
+			dataInfo.Flags = ReadVarInt(buffer);
+			if (dataInfo.DataType == EDataType::CharacterMap)
+			{
+				buffer.Read(dataInfo.CharSetAddress);
+				buffer.Read(dataInfo.EmptyCharNo);
+			}
+		}
+		if (ReadReferencesFromBufferV3(dataInfo.Reads, buffer) == false || ReadReferencesFromBufferV3(dataInfo.Writes, buffer) == false)
+			return false;
+	}
+
+	if (fileVersion < 4)
+		return true;
+
+	// Read Comment Blocks
+	if (buffer.Read<uint32_t>() != kCommentMagic)
+		return false;
+
+	const uint32_t noCommentBlocks = ReadVarInt(buffer);
+	if (noCommentBlocks > kPageSize)
+		return false;
+	pageAddr = 0;
+	for (uint32_t blockNo = 0; blockNo < noCommentBlocks; blockNo++)
+	{
+		pageAddr += ReadVarInt(buffer);
+		if (pageAddr >= kPageSize || buffer.HasReadError())
+			return false;
+
+		FCommentBlock* pCommentBlock = FCommentBlock::Allocate();
+		pCommentBlock->Address = BaseAddress + pageAddr;
+		pCommentBlock->Comment = buffer.ReadStringView();
+		CommentBlocks[pageAddr] = pCommentBlock;
+	}
+
+	return true;
+}
+
+// Compare size & speed of the page formats using the registered pages
+// The items allocated by the reads are freed after each iteration.
+void BenchmarkPageSerialisation(FCodeAnalysisState& state)
+{
+	const int kNoIterations = 5;
+
+	// load any pages still pending first, so their items aren't freed with the scratch reads
+	for (int pageNo = 0; pageNo < state.GetNoPages(); pageNo++)
+		state.GetPage(pageNo);
+
+	FCodeAnalysisPage* pScratchPage = new FCodeAnalysisPage;
+	FMemoryBuffer buffers[2];
+	double writeTimeMs[2] = { 0 };
+	double readTimeMs[2] = { 0 };
+	int noPages = 0;
+	bool bReadOk = true;
+
+	for (int formatNo = 0; formatNo < 2; formatNo++)
+	{
+		FMemoryBuffer& buffer = buffers[formatNo];
+		for (int it = 0; it < kNoIterations; it++)
+		{
+			buffer.Init(1024 * 1024);
+			noPages = 0;
+			const auto writeStart = std::chrono::high_resolution_clock::now();
+			for (int pageNo = 0; pageNo < state.GetNoPages(); pageNo++)
+			{
+				FCodeAnalysisPage* pPage = state.GetPage(pageNo);
+				if (pPage->bUsed == false)
+					continue;
+				if (formatNo == 0)
+					pPage->WriteToBufferV2(buffer);
+				else
+					pPage->WriteToBuffer(buffer);
+				noPages++;
+			}
+			const auto writeEnd = std::chrono::high_resolution_clock::now();
+			writeTimeMs[formatNo] += std::chrono::duration<double, std::milli>(writeEnd - writeStart).count();
+
+			FMemoryBuffer readBuffer;
+			readBuffer.InitView(buffer.GetData(), buffer.GetSize());
+			const FItemAllocationMark allocationMark;
+			const auto readStart = std::chrono::high_resolution_clock::now();
+			for (int pageNo = 0; pageNo < noPages; pageNo++)
+			{
+				pScratchPage->Initialise(0);
+				bReadOk &= pScratchPage->ReadFromBuffer(readBuffer);
+			}
+			const auto readEnd = std::chrono::high_resolution_clock::now();
+			readTimeMs[formatNo] += std::chrono::duration<double, std::milli>(readEnd - readStart).count();
+			allocationMark.FreeItemsAllocatedSince();
+		}
+	}
+
+	delete pScratchPage;
+
+	LOGINFO("Page serialisation benchmark: %d pages, %d iterations%s", noPages, kNoIterations, bReadOk ? "" : " - READ FAILED");
+	for (int formatNo = 0; formatNo < 2; formatNo++)
+	{
+		LOGINFO("  v%d : %d bytes, write %.2fms, read %.2fms", formatNo == 0 ? 2 : kVersionNo, (int)buffers[formatNo].GetSize(),
+			writeTimeMs[formatNo] / kNoIterations, readTimeMs[formatNo] / kNoIterations);
+	}
+}
+
+// one lock for all pages - it's only taken while a page is still pending
+static std::mutex g_PageLoadMutex;
+
+bool FCodeAnalysisPage::LoadPending()
+{
+	if (IsPendingLoad() == false)
+		return false;
+
+	// the first thread to get here loads the page, any others wait for it to finish
+	std::lock_guard<std::mutex> lock(g_PageLoadMutex);
+	FAnalysisDatabase* pDatabase = pPendingDatabase.load(std::memory_order_relaxed);
+	if (pDatabase == nullptr)
+		return false;	// loaded while we waited
+
+	if (pDatabase->LoadPage(this) == false)
+		LOGWARNING("Failed to load analysis page at 0x%04X, its saved data will be kept", BaseAddress);
+
+	// cleared once loaded so other threads never see a partly loaded page
+	pPendingDatabase.store(nullptr, std::memory_order_release);
+	return true;
+}
+
 void FCodeAnalysisPage::SetLabelAtAddress(const char* pLabelName, ELabelType type, uint16_t addr)
 {
 	FLabelInfo* pLabel = Labels[addr];
@@ -1,5 +1,6 @@
 #pragma once
 #include <stdio.h>
+#include <atomic>
 #include <cstdint>
 #include <string>
 #include <map>
@@ -8,6 +9,7 @@
 #include <Util/Misc.h>
 
 class FMemoryBuffer;
+class FAnalysisDatabase;
 
 
 enum class ELabelType
@@ -58,6 +60,8 @@ struct FLabelInfo : FItem
 {
 	static FLabelInfo* Allocate();
 	static void FreeAll();
+	static size_t GetNoAllocated() { return AllocatedList.size(); }
+	static void FreeAllocatedSince(size_t noAllocated);	// free items allocated after GetNoAllocated() returned noAllocated
 
 	std::string				Name;
 	bool					Global = false;
@@ -74,12 +78,13 @@ struct FCodeInfo : FItem
 {
 	static FCodeInfo* Allocate();
 	static void FreeAll();
+	static size_t GetNoAllocated() { return AllocatedList.size(); }
+	static void FreeAllocatedSince(size_t noAllocated);	// free items allocated after GetNoAllocated() returned noAllocated
 
 	EOperandType	OperandType = EOperandType::Unknown;
 	std::string		Text;				// Disassembly text
 	uint16_t		JumpAddress = 0;	// optional jump address
 	uint16_t		PointerAddress = 0;	// optional pointer address
-	int				FrameLastExecuted = -1;
 
 	union
 	{
@@ -150,9 +155,7 @@ struct FDataInfo : FItem
 		DataType = EDataType::Byte;
 		OperandType = EOperandType::Unknown;
 		Comment.clear();
-		LastFrameRead = -1;
 		Reads.clear();
-		LastFrameWritten = -1;
 		Writes.clear();
 	}
 
@@ -183,9 +186,7 @@ struct FDataInfo : FItem
 		};
 	};
 
-	int						LastFrameRead = -1;
 	std::map<uint16_t, int>	Reads;	// address and counts of data access instructions
-	int						LastFrameWritten = -1;
 	std::map<uint16_t, int>	Writes;	// address and counts of data access instructions
 };
 
@@ -193,6 +194,8 @@ struct FCommentBlock : FItem
 {
 	static FCommentBlock* Allocate();
 	static void FreeAll();
+	static size_t GetNoAllocated() { return AllocatedList.size(); }
+	static void FreeAllocatedSince(size_t noAllocated);	// free items allocated after GetNoAllocated() returned noAllocated
 
 private:
 	FCommentBlock() : FItem() { Type = EItemType::CommentBlock; }
@@ -213,23 +216,61 @@ private:
 	static std::vector<FCommentLine*>	FreeList;
 };
 
+// Remembers how many labels, code infos & comment blocks have been allocated, so items allocated by scratch work
+// (e.g. reading pages that are thrown away) can be freed without waiting for the next FreeAll()
+// Nothing else can allocate items while the mark is in use.
+struct FItemAllocationMark
+{
+	FItemAllocationMark();
+	void	FreeItemsAllocatedSince() const;
+
+	size_t	NoLabels;
+	size_t	NoCodeInfos;
+	size_t	NoCommentBlocks;
+};
+
 struct FCodeAnalysisPage
 {
 	void Initialise(uint16_t address);
 	void ChangeAddress(uint16_t address);
 	void Reset(void);
+	void ResetAccessFrames(void);
 	void WriteToBuffer(FMemoryBuffer& buffer);
+	void WriteToBufferV2(FMemoryBuffer& buffer);
 	bool ReadFromBuffer(FMemoryBuffer& buffer);
 
+	// pages opened from an analysis database are loaded on first access through FCodeAnalysisState
+	// Loading is thread safe but work spread across threads should call FCodeAnalysisState::LoadAllPendingPages() first.
+	bool IsPendingLoad() const { return pPendingDatabase.load(std::memory_order_acquire) != nullptr; }
+	bool LoadPending();	// returns true if this call loaded the page
+	bool HasLoadFailed() const { return FailedLoadData.empty() == false; }
+
 	void SetLabelAtAddress(const char* pLabelName, ELabelType type, uint16_t addr);
 	static const int kPageSize = 1024;	// 1Kb page
 
 	bool			bUsed = false;	// has this page been used?
 	int16_t			PageId = -1;
+	bool			bDirty = false;	// analysis changed since the page was last saved or journaled
 	uint16_t		BaseAddress; // physical base address
 	FLabelInfo*		Labels[kPageSize];
 	FCodeInfo*		CodeInfo[kPageSize];
 	FDataInfo		DataInfo[kPageSize];
 	FCommentBlock*	CommentBlocks[kPageSize];
 	uint16_t		LastWriter[kPageSize];
+
+	// Frame numbers of the last execute, read & write of each byte, -1 if never.
+	// Kept as dense arrays, apart from the items, so heatmaps & stats can scan them quickly.
+	int32_t			FrameLastExecuted[kPageSize];
+	int32_t			FrameLastRead[kPageSize];
+	int32_t			FrameLastWritten[kPageSize];
+	int32_t			FrameLastAccessed = -1;	// latest data read or write in the page, so views of a range can tell nothing's changed
+	std::atomic<FAnalysisDatabase*>	pPendingDatabase{ nullptr };	// database this page still needs loading from
+
+	// stored data of a page that failed to load, written back in place of the page so a save doesn't overwrite it
+	// with an empty page. Cleared by Reset().
+	std::vector<uint8_t>	FailedLoadData;
+
+private:
+	bool ReadFromBufferV2(FMemoryBuffer& buffer);
+	bool ReadFromBufferSparse(FMemoryBuffer& buffer, uint32_t fileVersion);
 };
\ No newline at end of file
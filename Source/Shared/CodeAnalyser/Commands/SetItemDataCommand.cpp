@@ -16,19 +16,19 @@ void FSetItemDataCommand::Do(FCodeAnalysisState& state)
 		{
 			pDataItem->DataType = EDataType::Word;
 			pDataItem->ByteSize = 2;
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pItem->Address);
 		}
 		else if (pDataItem->DataType == EDataType::Word)
 		{
 			pDataItem->DataType = EDataType::Byte;
 			pDataItem->ByteSize = 1;
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pItem->Address);
 		}
 		else if (pDataItem->DataType == EDataType::Text)
 		{
 			pDataItem->DataType = EDataType::Byte;
 			pDataItem->ByteSize = 1;
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pItem->Address);
 		}
 	}
 	else if (pItem->Type == EItemType::Code)
@@ -37,7 +37,7 @@ void FSetItemDataCommand::Do(FCodeAnalysisState& state)
 		if (pCodeItem->bDisabled == false)
 		{
 			pCodeItem->bDisabled = true;
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pItem->Address);
 
 			FLabelInfo* pLabelInfo = state.GetLabelForAddress(pItem->Address);
 			if (pLabelInfo != nullptr)
@@ -51,6 +51,7 @@ void FSetItemDataCommand::Undo(FCodeAnalysisState& state)
 	FDataInfo* pDataItem = static_cast<FDataInfo*>(pItem);
 	pDataItem->DataType = oldDataType;
 	pDataItem->ByteSize = oldDataSize;
+	state.SetCodeAnalysisDirty(pItem->Address);
 }
 
 // Set Item Code
@@ -68,7 +69,7 @@ void FSetItemCodeCommand::Do(FCodeAnalysisState& state)
 		RunStaticCodeAnalysis(state, Addr);
 		UpdateCodeInfoForAddress(state, Addr);
 	}
-	state.SetCodeAnalysisDirty();
+	state.SetCodeAnalysisDirty(Addr);
 }
 
 void FSetItemCodeCommand::Undo(FCodeAnalysisState& state)
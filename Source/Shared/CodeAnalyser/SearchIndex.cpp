@@ -0,0 +1,276 @@
+#include "SearchIndex.h"
+#include "CodeAnalyser.h"
+
+#include <algorithm>
+#include <cctype>
+
+static void AppendLowerCase(std::string& dest, const std::string& src)
+{
+	for (const char c : src)
+		dest.push_back((char)tolower((unsigned char)c));
+}
+
+static uint32_t MakeTrigram(const char* pText)
+{
+	return ((uint32_t)(uint8_t)pText[0] << 16) | ((uint32_t)(uint8_t)pText[1] << 8) | (uint32_t)(uint8_t)pText[2];
+}
+
+// unique trigrams in text
+static void GetTrigrams(const std::string& text, std::vector<uint32_t>& outTrigrams)
+{
+	outTrigrams.clear();
+	for (size_t i = 0; i + 3 <= text.size(); i++)
+		outTrigrams.push_back(MakeTrigram(text.c_str() + i));
+
+	std::sort(outTrigrams.begin(), outTrigrams.end());
+	outTrigrams.erase(std::unique(outTrigrams.begin(), outTrigrams.end()), outTrigrams.end());
+}
+
+uint32_t FSearchIndex::MakeEntryKey(int pageId, int pageOffset)
+{
+	return ((uint32_t)pageId << FCodeAnalysisState::kPageShift) | (uint32_t)pageOffset;
+}
+
+const FSearchIndex::FEntry& FSearchIndex::GetEntry(uint32_t key) const
+{
+	return PageEntries[key >> FCodeAnalysisState::kPageShift][key & FCodeAnalysisState::kPageMask];
+}
+
+void FSearchIndex::BuildEntryText(const FCodeAnalysisPage& page, int pageOffset, FEntry& outEntry) const
+{
+	std::string& text = outEntry.Text;
+	text.clear();
+	outEntry.CommentStart = outEntry.CodeStart = 0;
+
+	// operand bytes share their instruction's code info, it's only indexed at the instruction's address
+	const FCodeInfo* pCodeInfo = page.CodeInfo[pageOffset];
+	if (pCodeInfo != nullptr && pCodeInfo->Address != (uint16_t)(page.BaseAddress + pageOffset))
+		return;
+
+	const FLabelInfo* pLabel = page.Labels[pageOffset];
+	if (pLabel != nullptr)
+		AppendLowerCase(text, pLabel->Name);
+
+	outEntry.CommentStart = (uint32_t)text.size();
+	const FCommentBlock* pCommentBlock = page.CommentBlocks[pageOffset];
+	if (pCommentBlock != nullptr)
+	{
+		text.push_back('\n');
+		AppendLowerCase(text, pCommentBlock->Comment);
+	}
+
+	const bool bCode = pCodeInfo != nullptr && pCodeInfo->bDisabled == false;
+	const FItem* pItem = bCode ? (const FItem*)pCodeInfo : (const FItem*)&page.DataInfo[pageOffset];
+	if (pItem != nullptr && pItem->Comment.empty() == false)
+	{
+		text.push_back('\n');
+		AppendLowerCase(text, pItem->Comment);
+	}
+
+	outEntry.CodeStart = (uint32_t)text.size();
+	if (bCode)
+	{
+		text.push_back('\n');
+		AppendLowerCase(text, pCodeInfo->Text);
+	}
+}
+
+void FSearchIndex::AddTrigrams(uint32_t key, const std::string& text)
+{
+	GetTrigrams(text, TempTrigrams);
+	for (const uint32_t trigram : TempTrigrams)
+	{
+		std::vector<uint32_t>& keys = Postings[trigram];
+		keys.insert(std::lower_bound(keys.begin(), keys.end(), key), key);
+	}
+}
+
+void FSearchIndex::RemoveTrigrams(uint32_t key, const std::string& text)
+{
+	GetTrigrams(text, TempTrigrams);
+	for (const uint32_t trigram : TempTrigrams)
+	{
+		auto postingIt = Postings.find(trigram);
+		if (postingIt == Postings.end())
+			continue;
+
+		std::vector<uint32_t>& keys = postingIt->second;
+		auto keyIt = std::lower_bound(keys.begin(), keys.end(), key);
+		if (keyIt != keys.end() && *keyIt == key)
+			keys.erase(keyIt);
+		if (keys.empty())
+			Postings.erase(postingIt);
+	}
+}
+
+void FSearchIndex::Update(const FCodeAnalysisState& state, int noItems)
+{
+	const int kPageSize = FCodeAnalysisPage::kPageSize;
+	const int noPages = state.GetNoPages();
+	if (noPages == 0)
+		return;
+	if ((int)PageEntries.size() < noPages)
+		PageEntries.resize(noPages);
+
+	// the first call indexes every loaded page, after that they're rechecked a slice at a time
+	const int noPageItems = noPages * kPageSize;
+	if (bIndexed == false)
+		noItems = noPageItems;
+	NextItem %= noPageItems;
+
+	bool bChanged = false;
+	for (int i = 0; i < noItems; i++)
+	{
+		const int pageId = NextItem / kPageSize;
+		const int pageOffset = NextItem % kPageSize;
+		NextItem = (NextItem + 1) % noPageItems;
+
+		// don't force a lazy load, skip the rest of the page
+		const FCodeAnalysisPage* pPage = state.GetPageIfLoaded((int16_t)pageId);
+		if (pPage == nullptr)
+		{
+			i += kPageSize - pageOffset - 1;
+			NextItem = ((pageId + 1) % noPages) * kPageSize;
+			continue;
+		}
+
+		std::vector<FEntry>& entries = PageEntries[pageId];
+		if (entries.empty())
+			entries.resize(kPageSize);
+
+		BuildEntryText(*pPage, pageOffset, TempEntry);
+		FEntry& entry = entries[pageOffset];
+		if (TempEntry.Text == entry.Text)
+			continue;
+
+		const uint32_t key = MakeEntryKey(pageId, pageOffset);
+		RemoveTrigrams(key, entry.Text);
+		AddTrigrams(key, TempEntry.Text);
+		std::swap(entry, TempEntry);
+		bChanged = true;
+	}
+
+	bIndexed = true;
+	if (bChanged)
+		Generation++;
+}
+
+bool FSearchIndex::ScoreEntry(uint32_t key, const std::vector<std::string>& terms, FSearchResult& outResult) const
+{
+	const FEntry& entry = GetEntry(key);
+	int score = 0;
+
+	for (size_t termNo = 0; termNo < terms.size(); termNo++)
+	{
+		const std::string& term = terms[termNo];
+		const size_t pos = entry.Text.find(term);
+		if (pos == std::string::npos)
+			return false;
+
+		ESearchField field = ESearchField::Label;
+		int fieldScore = 300;
+		if (pos >= entry.CodeStart)
+		{
+			field = ESearchField::Code;
+			fieldScore = 100;
+		}
+		else if (pos >= entry.CommentStart)
+		{
+			field = ESearchField::Comment;
+			fieldScore = 200;
+		}
+
+		// match at the start of a word
+		if (pos == 0 || isalnum((unsigned char)entry.Text[pos - 1]) == 0)
+			fieldScore += 50;
+		// whole label
+		if (pos == 0 && term.size() == entry.CommentStart)
+			fieldScore += 100;
+
+		if (termNo == 0)
+			outResult.Field = field;
+		score += fieldScore;
+	}
+
+	outResult.PageId = (int16_t)(key >> FCodeAnalysisState::kPageShift);
+	outResult.PageOffset = (uint16_t)(key & FCodeAnalysisState::kPageMask);
+	outResult.Score = score;
+	return true;
+}
+
+void FSearchIndex::Search(const std::string& query, std::vector<FSearchResult>& outResults, int maxResults) const
+{
+	outResults.clear();
+
+	// split into lower case terms
+	std::vector<std::string> terms;
+	std::string term;
+	for (const char c : query + " ")
+	{
+		if (isspace((unsigned char)c))
+		{
+			if (term.empty() == false)
+				terms.push_back(term);
+			term.clear();
+		}
+		else
+		{
+			term.push_back((char)tolower((unsigned char)c));
+		}
+	}
+	if (terms.empty())
+		return;
+
+	// candidates come from the shortest posting list of any trigram in the terms
+	const std::vector<uint32_t>* pCandidates = nullptr;
+	for (const std::string& searchTerm : terms)
+	{
+		for (size_t i = 0; i + 3 <= searchTerm.size(); i++)
+		{
+			const auto postingIt = Postings.find(MakeTrigram(searchTerm.c_str() + i));
+			if (postingIt == Postings.end())
+				return;	// a trigram nothing contains
+			if (pCandidates == nullptr || postingIt->second.size() < pCandidates->size())
+				pCandidates = &postingIt->second;
+		}
+	}
+
+	FSearchResult result;
+	if (pCandidates != nullptr)
+	{
+		for (const uint32_t key : *pCandidates)
+		{
+			if (ScoreEntry(key, terms, result))
+				outResults.push_back(result);
+		}
+	}
+	else
+	{
+		// all terms are too short for trigrams - check everything
+		for (int pageId = 0; pageId < (int)PageEntries.size(); pageId++)
+		{
+			const std::vector<FEntry>& entries = PageEntries[pageId];
+			for (int pageOffset = 0; pageOffset < (int)entries.size(); pageOffset++)
+			{
+				if (entries[pageOffset].Text.empty() == false && ScoreEntry(MakeEntryKey(pageId, pageOffset), terms, result))
+					outResults.push_back(result);
+			}
+		}
+	}
+
+	const auto byRank = [](const FSearchResult& a, const FSearchResult& b)
+	{
+		if (a.Score != b.Score)
+			return a.Score > b.Score;
+		return a.PageId != b.PageId ? a.PageId < b.PageId : a.PageOffset < b.PageOffset;
+	};
+	if ((int)outResults.size() > maxResults)
+	{
+		std::partial_sort(outResults.begin(), outResults.begin() + maxResults, outResults.end(), byRank);
+		outResults.resize(maxResults);
+	}
+	else
+	{
+		std::sort(outResults.begin(), outResults.end(), byRank);
+	}
+}
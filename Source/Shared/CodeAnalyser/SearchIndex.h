@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+struct FCodeAnalysisState;
+struct FCodeAnalysisPage;
+
+enum class ESearchField
+{
+	Label,
+	Comment,
+	Code,
+};
+
+struct FSearchResult
+{
+	int16_t			PageId;		// page the match is in, which might not be mapped in
+	uint16_t		PageOffset;
+	ESearchField	Field;	// where the first search term matched
+	int				Score;
+};
+
+// Trigram index over label names, comments and disassembly text, one entry per byte of every registered page
+// so banks that aren't mapped in can be searched too.
+// The text of each entry is rechecked a slice at a time from Update() and only entries whose text has changed
+// have their trigram posting lists updated, so the index follows edits without being rebuilt.
+// Pages waiting to be lazily loaded are skipped rather than loaded, they're indexed once something else loads them.
+class FSearchIndex
+{
+public:
+	static const int kItemsPerUpdate = 4096;
+
+	// recheck the next noItems page entries - the first call indexes every page that's loaded
+	void	Update(const FCodeAnalysisState& state, int noItems = kItemsPerUpdate);
+	int		GetGeneration() const { return Generation; }	// changes when anything in the index changes
+
+	// case insensitive, space separated terms which must all match
+	// results are ranked - label matches before comments before code, with matches at the start of text first
+	void	Search(const std::string& query, std::vector<FSearchResult>& outResults, int maxResults = 200) const;
+
+private:
+	// lower case 'label\ncomments\ncode' text for a page entry
+	struct FEntry
+	{
+		std::string	Text;
+		uint32_t	CommentStart = 0;
+		uint32_t	CodeStart = 0;
+	};
+
+	// entries are keyed by page id & offset
+	static uint32_t	MakeEntryKey(int pageId, int pageOffset);
+	const FEntry&	GetEntry(uint32_t key) const;
+
+	void	BuildEntryText(const FCodeAnalysisPage& page, int pageOffset, FEntry& outEntry) const;
+	void	AddTrigrams(uint32_t key, const std::string& text);
+	void	RemoveTrigrams(uint32_t key, const std::string& text);
+	bool	ScoreEntry(uint32_t key, const std::vector<std::string>& terms, FSearchResult& outResult) const;
+
+	std::vector<std::vector<FEntry>>	PageEntries;	// by page id, allocated when the page is first indexed
+	std::unordered_map<uint32_t, std::vector<uint32_t>>	Postings;	// trigram -> sorted entry keys containing it
+	std::vector<uint32_t>	TempTrigrams;
+	FEntry					TempEntry;
+	int		NextItem = 0;	// page id * page size + offset
+	int		Generation = 0;
+	bool	bIndexed = false;
+};
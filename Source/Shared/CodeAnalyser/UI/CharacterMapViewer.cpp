@@ -2,9 +2,12 @@
 #include "../CodeAnalyser.h"
 
 #include <imgui.h>
+#include <ImGuiSupport/ImGuiTexture.h>
 #include "CodeAnalyserUI.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
 
 static const char* g_MaskInfoTxt[] =
 {
@@ -170,8 +173,121 @@ struct FCharacterMapViewerUIState
 	uint16_t				SelectedCharAddress = 0;
 	int						SelectedCharX = -1;
 	int						SelectedCharY = -1;
+
+	// The map is composited into one image, with the read/write heat in another, so it's drawn as two quads.
+	// They're only updated when the memory or access frame of the map range has moved on, or the heat is still fading,
+	// & only cells whose value changed are redrawn.
+	FGraphicsView*			MapView = nullptr;
+	FGraphicsView*			HeatView = nullptr;
+	FCharMapCreateParams	ViewParams;		// params the images were made with
+	std::vector<uint8_t>	ViewCells;		// values the cells were drawn with
+	uint32_t				ViewCharSetGeneration = 0;
+	uint32_t				ViewMemoryGeneration = 0;
+	int						ViewLastAccessFrame = -1;	// last read or write in the map range when drawn
+	int						ViewFrameNo = -1;
+	bool					bViewHeat = false;	// heat image is up to date
 };
 
+static const int kCharMapCellSize = 8;	// pixels per cell in the map image
+static const int kHeatFadeFrames = 32;
+
+// latest frame any of the pages covering the range was read or written, -1 if never
+static int GetLastAccessFrameForRange(const FCodeAnalysisState& state, uint16_t address, int size)
+{
+	const int kNoPages = FCodeAnalysisState::kAddressSize / FCodeAnalysisPage::kPageSize;
+	const int firstPage = address >> FCodeAnalysisState::kPageShift;
+	const int noPages = std::min(((address & FCodeAnalysisState::kPageMask) + size + FCodeAnalysisState::kPageMask) >> FCodeAnalysisState::kPageShift, kNoPages);
+	int lastAccessFrame = -1;
+	for (int i = 0; i < noPages; i++)
+	{
+		const int pageNo = (firstPage + i) % kNoPages;
+		if (const FCodeAnalysisPage* pReadPage = state.ReadPageTable[pageNo])
+			lastAccessFrame = std::max(lastAccessFrame, pReadPage->FrameLastAccessed);
+		if (const FCodeAnalysisPage* pWritePage = state.WritePageTable[pageNo])
+			lastAccessFrame = std::max(lastAccessFrame, pWritePage->FrameLastAccessed);
+	}
+	return lastAccessFrame;
+}
+
+static void UpdateCharacterMapImage(FCharacterMapViewerUIState& uiState, FCodeAnalysisState& state, const FCharMapCreateParams& params, const FCharacterSet* pCharSet, bool bShowReadWrites)
+{
+	const int noCells = params.Width * params.Height;
+	if (noCells <= 0)
+		return;
+
+	if (uiState.MapView == nullptr || uiState.HeatView->GetWidth() != params.Width || uiState.HeatView->GetHeight() != params.Height)
+	{
+		delete uiState.MapView;
+		delete uiState.HeatView;
+		uiState.MapView = new FGraphicsView(params.Width * kCharMapCellSize, params.Height * kCharMapCellSize);
+		uiState.HeatView = new FGraphicsView(params.Width, params.Height, true);
+		uiState.ViewFrameNo = -1;
+	}
+
+	const FCharMapCreateParams& viewParams = uiState.ViewParams;
+	const bool bRedrawAll = uiState.ViewFrameNo == -1 ||
+		viewParams.Address != params.Address || viewParams.CharacterSet != params.CharacterSet || viewParams.IgnoreCharacter != params.IgnoreCharacter ||
+		(pCharSet != nullptr && pCharSet->Generation != uiState.ViewCharSetGeneration) || (bShowReadWrites && uiState.bViewHeat == false);
+
+	// nothing can have changed if the map memory hasn't been written or accessed, unless the heat is still fading out
+	const uint32_t memoryGeneration = GetCharacterMemoryGeneration();
+	const int lastAccessFrame = GetLastAccessFrameForRange(state, params.Address, noCells);
+	const bool bHeatFading = bShowReadWrites && state.CurrentFrameNo != uiState.ViewFrameNo &&
+		uiState.ViewLastAccessFrame != -1 && uiState.ViewFrameNo - uiState.ViewLastAccessFrame < kHeatFadeFrames;
+	if (bRedrawAll == false && bHeatFading == false && uiState.ViewMemoryGeneration == memoryGeneration && uiState.ViewLastAccessFrame == lastAccessFrame)
+		return;
+
+	uiState.ViewCells.resize(noCells);
+	const uint32_t* pCharSetPixels = pCharSet != nullptr ? pCharSet->Image->GetPixelBuffer() : nullptr;
+	const int charSetWidth = pCharSet != nullptr ? pCharSet->Image->GetWidth() : 0;
+
+	for (int cellNo = 0; cellNo < noCells; cellNo++)
+	{
+		const uint16_t addr = params.Address + cellNo;
+		const uint8_t val = state.CPUInterface->ReadByte(addr);
+		const int xCell = cellNo % params.Width;
+		const int yCell = cellNo / params.Width;
+
+		if (bRedrawAll || val != uiState.ViewCells[cellNo])
+		{
+			const int xp = xCell * kCharMapCellSize;
+			const int yp = yCell * kCharMapCellSize;
+			if (pCharSetPixels != nullptr && val != params.IgnoreCharacter)
+			{
+				const uint32_t* pCharPixels = pCharSetPixels + ((val & 15) * 8) + ((val >> 4) * 8 * charSetWidth);
+				uiState.MapView->CopyRect(pCharPixels, charSetWidth, xp, yp, kCharMapCellSize, kCharMapCellSize);
+			}
+			else
+			{
+				uiState.MapView->ClearRect(xp, yp, kCharMapCellSize, kCharMapCellSize, 0);
+			}
+			uiState.ViewCells[cellNo] = val;
+		}
+
+		// reads are green, writes red - fading out over 32 frames
+		if (bShowReadWrites)
+		{
+			const int lastFrameWritten = state.GetLastFrameWritten(addr);
+			const int lastFrameRead = state.GetLastFrameRead(addr);
+			const int framesSinceWritten = lastFrameWritten == -1 ? 255 : state.CurrentFrameNo - lastFrameWritten;
+			const int framesSinceRead = lastFrameRead == -1 ? 255 : state.CurrentFrameNo - lastFrameRead;
+			const int wBrightVal = (255 - std::min(framesSinceWritten << 3, 255)) & 0xff;
+			const int rBrightVal = (255 - std::min(framesSinceRead << 3, 255)) & 0xff;
+			const uint32_t alpha = std::max(wBrightVal, rBrightVal) >> 1;
+			uiState.HeatView->SetPixel(xCell, yCell, (alpha << 24) | (rBrightVal << 8) | wBrightVal);
+		}
+	}
+
+	uiState.ViewParams = params;
+	uiState.ViewCharSetGeneration = pCharSet != nullptr ? pCharSet->Generation : 0;
+	uiState.ViewFrameNo = state.CurrentFrameNo;
+	uiState.ViewMemoryGeneration = memoryGeneration;
+	uiState.ViewLastAccessFrame = lastAccessFrame;
+	uiState.bViewHeat = bShowReadWrites;
+	uiState.MapView->UpdateTexture();
+	uiState.HeatView->UpdateTexture();
+}
+
 void DrawCharacterMap(FCharacterMapViewerUIState& uiState, FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 {
 	FCharacterMap* pCharMap = GetCharacterMapFromAddress(uiState.SelectedCharMapAddr);
@@ -195,7 +311,7 @@ void DrawCharacterMap(FCharacterMapViewerUIState& uiState, FCodeAnalysisState& s
 
 	if (ImGui::Button("Apply"))
 	{
-		pCharMap->Params = params;
+		UpdateCharacterMap(*pCharMap, params);
 
 		// Reformat Memory
 		FDataFormattingOptions formattingOptions;
@@ -214,64 +330,43 @@ void DrawCharacterMap(FCharacterMapViewerUIState& uiState, FCodeAnalysisState& s
 	ImDrawList* dl = ImGui::GetWindowDrawList();
 	ImVec2 pos = ImGui::GetCursorScreenPos();
 	const float rectSize = 12.0f;
-	uint16_t byte = 0;
 	const FCharacterSet* pCharSet = GetCharacterSetFromAddress(params.CharacterSet);
 	static bool bShowReadWrites = true;
 
-	for (int y = 0; y < params.Height; y++)
+	UpdateCharacterMapImage(uiState, state, params, pCharSet, bShowReadWrites);
+
+	if (uiState.MapView != nullptr && params.Width > 0 && params.Height > 0)
 	{
-		for (int x = 0; x < params.Width; x++)
-		{
-			const uint8_t val = state.CPUInterface->ReadByte(params.Address + byte);
-			FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(params.Address + byte);
-			const int framesSinceWritten = pDataInfo->LastFrameWritten == -1 ? 255 : state.CurrentFrameNo - pDataInfo->LastFrameWritten;
-			const int framesSinceRead = pDataInfo->LastFrameRead == -1 ? 255 : state.CurrentFrameNo - pDataInfo->LastFrameRead;
-			const int wBrightVal = (255 - std::min(framesSinceWritten << 3, 255)) & 0xff;
-			const int rBrightVal = (255 - std::min(framesSinceRead << 3, 255)) & 0xff;
+		const ImVec2 mapMax(pos.x + (params.Width * rectSize), pos.y + (params.Height * rectSize));
 
-			if (val != params.IgnoreCharacter || wBrightVal > 0 || rBrightVal > 0)	// skip empty chars
+		if (pCharSet)
+		{
+			dl->AddImage((ImTextureID)uiState.MapView->GetTexture(), pos, mapMax);
+		}
+		else
+		{
+			// no character set so show the values
+			for (int cellNo = 0; cellNo < params.Width * params.Height; cellNo++)
 			{
-				const float xp = pos.x + (x * rectSize);
-				const float yp = pos.y + (y * rectSize);
-				ImVec2 rectMin(xp, yp);
-				ImVec2 rectMax(xp + rectSize, yp + rectSize);
-
-				if (val != params.IgnoreCharacter)
-				{
-					if (pCharSet)
-					{
-						const FCharUVS UVS = pCharSet->GetCharacterUVS(val);
-						dl->AddImage((ImTextureID)pCharSet->Image->GetTexture(), rectMin, rectMax, ImVec2(UVS.U0, UVS.V0), ImVec2(UVS.U1, UVS.V1));
-					}
-					else
-					{
-						char valTxt[8];
-						snprintf(valTxt,8, "%02x", val);
-						dl->AddRect(rectMin, rectMax, 0xffffffff);
-						dl->AddText(ImVec2(xp + 1, yp + 1), 0xffffffff, valTxt);
-						//dl->AddText(NULL, 8.0f, ImVec2(xp + 1, yp + 1), 0xffffffff, valTxt, NULL);
-					}
-				}
-
-				if (bShowReadWrites)
-				{
-					if (rBrightVal > 0)
-					{
-						const ImU32 col = 0xff000000 | (rBrightVal << 8);
-						dl->AddRect(rectMin, rectMax, col);
-
-						rectMin = ImVec2(rectMin.x + 1, rectMin.y + 1);
-						rectMax = ImVec2(rectMax.x - 1, rectMax.y - 1);
-					}
-					if (wBrightVal > 0)
-					{
-						const ImU32 col = 0xff000000 | (wBrightVal << 0);
-						dl->AddRect(rectMin, rectMax, col);
-					}
-				}
+				const uint8_t val = uiState.ViewCells[cellNo];
+				if (val == params.IgnoreCharacter)	// skip empty chars
+					continue;
+
+				const float xp = pos.x + ((cellNo % params.Width) * rectSize);
+				const float yp = pos.y + ((cellNo / params.Width) * rectSize);
+				char valTxt[8];
+				snprintf(valTxt, 8, "%02x", val);
+				dl->AddRect(ImVec2(xp, yp), ImVec2(xp + rectSize, yp + rectSize), 0xffffffff);
+				dl->AddText(ImVec2(xp + 1, yp + 1), 0xffffffff, valTxt);
 			}
+		}
 
-			byte++;	// go to next byte
+		// the heat image is a texel per cell, so it mustn't be filtered across cells
+		if (bShowReadWrites)
+		{
+			dl->AddCallback(ImGui_SetPointSampling, nullptr);
+			dl->AddImage((ImTextureID)uiState.HeatView->GetTexture(), pos, mapMax);
+			dl->AddCallback(ImDrawCallback_ResetRenderState, nullptr);
 		}
 	}
 
@@ -375,9 +470,21 @@ void DrawCharacterMap(FCharacterMapViewerUIState& uiState, FCodeAnalysisState& s
 	
 }
 
+static FCharacterMapViewerUIState g_CharacterMapViewerUIState;
+
+void ShutdownCharacterMapViewer()
+{
+	FCharacterMapViewerUIState& uiState = g_CharacterMapViewerUIState;
+	delete uiState.MapView;
+	delete uiState.HeatView;
+	uiState.MapView = nullptr;
+	uiState.HeatView = nullptr;
+	uiState.ViewFrameNo = -1;
+}
+
 void DrawCharacterMaps(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 {
-	static FCharacterMapViewerUIState uiState;
+	FCharacterMapViewerUIState& uiState = g_CharacterMapViewerUIState;
 
 	if (ImGui::BeginChild("##charmapselect", ImVec2(ImGui::GetWindowContentRegionWidth() * 0.25f, 0), true))
 	{
@@ -9,4 +9,5 @@ void DrawColourInfoComboBox(EColourInfo* pValue);
 void DrawCharacterSetComboBox(FCodeAnalysisState& state, uint16_t* pAddr);
 
 void DrawCharacterMapViewer(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState);
+void ShutdownCharacterMapViewer();	// frees the map images, call before the renderer goes
 
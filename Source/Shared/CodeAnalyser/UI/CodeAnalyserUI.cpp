@@ -13,6 +13,7 @@
 #include "misc/cpp/imgui_stdlib.h"
 #include <algorithm>
 #include <sstream>
+#include <cstring>
 #include "chips/z80.h"
 #include "CodeToolTips.h"
 
@@ -79,7 +80,8 @@ bool AddMemoryRegionDescGenerator(FMemoryRegionDescGenerator* pGen)
 	return true;
 }
 
-void DrawAddressLabel(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState, uint16_t addr, bool bFunctionRel)
+// label text for an address e.g. '[label + 4]', empty if there isn't one
+static void FormatAddressLabel(FCodeAnalysisState& state, uint16_t addr, bool bFunctionRel, std::string& outText)
 {
 	int labelOffset = 0;
 	const char *pLabelString = GetRegionDesc(addr);
@@ -102,45 +104,59 @@ void DrawAddressLabel(FCodeAnalysisState &state, FCodeAnalysisViewState& viewSta
 			labelOffset++;
 		}
 	}
-	
+
+	outText.clear();
 	if (pLabelString != nullptr)
 	{
-		ImGui::SameLine();
-		ImGui::PushStyleColor(ImGuiCol_Text, 0xff808080);
-		if(labelOffset == 0)
-			ImGui::Text("[%s]", pLabelString);
-		else
-			ImGui::Text("[%s + %d]", pLabelString, labelOffset);
+		outText = std::string("[") + pLabelString;
+		if (labelOffset != 0)
+			outText += " + " + std::to_string(labelOffset);
+		outText += "]";
+	}
+}
 
-		if (ImGui::IsItemHovered())
+static void DrawAddressLabelText(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, uint16_t addr, const char* pLabelText)
+{
+	ImGui::SameLine();
+	ImGui::PushStyleColor(ImGuiCol_Text, 0xff808080);
+	ImGui::Text("%s", pLabelText);
+
+	if (ImGui::IsItemHovered())
+	{
+		// Bring up snippet in tool tip
+		const int index = GetItemIndexForAddress(state, addr);
+		if(index !=-1)
 		{
-			// Bring up snippet in tool tip
-			const int index = GetItemIndexForAddress(state, addr);
-			if(index !=-1)
+			const int kToolTipNoLines = 10;
+			ImGui::BeginTooltip();
+			const int startIndex = std::max(index - (kToolTipNoLines / 2), 0);
+			for(int line=0;line < kToolTipNoLines;line++)
 			{
-				const int kToolTipNoLines = 10;
-				ImGui::BeginTooltip();
-				const int startIndex = std::max(index - (kToolTipNoLines / 2), 0);
-				for(int line=0;line < kToolTipNoLines;line++)
-				{
-					if(startIndex + line < (int)state.ItemList.size())
-						DrawCodeAnalysisItemAtIndex(state,viewState,startIndex + line);
-				}
-				ImGui::EndTooltip();
+				if(startIndex + line < (int)state.ItemList.size())
+					DrawCodeAnalysisItemAtIndex(state,viewState,startIndex + line);
 			}
-			
-
-			ImGuiIO& io = ImGui::GetIO();
-			if (io.KeyShift && ImGui::IsMouseDoubleClicked(0))
-				GoToAddress(state.GetAltViewState(), addr, false);
-			else if (ImGui::IsMouseDoubleClicked(0))
-				GoToAddress(viewState, addr, false);
-		
-			viewState.HoverAddress = addr;
+			ImGui::EndTooltip();
 		}
+		
 
-		ImGui::PopStyleColor();
+		ImGuiIO& io = ImGui::GetIO();
+		if (io.KeyShift && ImGui::IsMouseDoubleClicked(0))
+			GoToAddress(state.GetAltViewState(), addr, false);
+		else if (ImGui::IsMouseDoubleClicked(0))
+			GoToAddress(viewState, addr, false);
+	
+		viewState.HoverAddress = addr;
 	}
+
+	ImGui::PopStyleColor();
+}
+
+void DrawAddressLabel(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState, uint16_t addr, bool bFunctionRel)
+{
+	static std::string labelText;
+	FormatAddressLabel(state, addr, bFunctionRel, labelText);
+	if (labelText.empty() == false)
+		DrawAddressLabelText(state, viewState, addr, labelText.c_str());
 }
 
 void DrawCodeAddress(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState, uint16_t addr, bool bFunctionRel)
@@ -404,6 +420,7 @@ void DrawLabelDetails(FCodeAnalysisState &state, FCodeAnalysisViewState& viewSta
 			pLabelInfo->LabelType = ELabelType::Function;
 		if (pLabelInfo->LabelType == ELabelType::Function && pLabelInfo->Global == false)
 			pLabelInfo->LabelType = ELabelType::Code;
+		state.SetPageDirty(pLabelInfo->Address);
 		GenerateGlobalInfo(state);
 	}
 
@@ -424,7 +441,8 @@ void ShowCodeAccessorActivity(FCodeAnalysisState& state, const uint16_t accessor
 	const FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(accessorCodeAddr);
 	if (pCodeInfo != nullptr)
 	{
-		const int framesSinceExecuted = pCodeInfo->FrameLastExecuted != -1 ? state.CurrentFrameNo - pCodeInfo->FrameLastExecuted : 255;
+		const int lastFrameExecuted = state.GetLastFrameExecuted(pCodeInfo->Address);
+		const int framesSinceExecuted = lastFrameExecuted != -1 ? state.CurrentFrameNo - lastFrameExecuted : 255;
 		const int brightVal = (255 - std::min(framesSinceExecuted << 2, 255)) & 0xff;
 		const bool bPCLine = pCodeInfo->Address == state.CPUInterface->GetPC();
 
@@ -465,6 +483,59 @@ void ShowCodeAccessorActivity(FCodeAnalysisState& state, const uint16_t accessor
 	}
 }
 
+// Formatted text for a line of code, reused until labels, the number display mode or the operand change
+// Rows are kept per physical page so banked code doesn't share them.
+struct FCodeRowCache
+{
+	int					LabelGeneration = -1;
+	ENumberDisplayMode	NumberMode = ENumberDisplayMode::None;
+	uint16_t			Address = 0;
+	EOperandType		OperandType = EOperandType::Unknown;
+	uint16_t			OperandAddress = 0;
+	const FCodeAnalysisPage*	pOperandPage = nullptr;	// page mapped at the operand address, its labels are looked up
+	std::string			AddressText;
+	std::string			OperandLabelText;
+};
+
+static std::vector<std::vector<FCodeRowCache>>	g_CodeRowCache;	// by page id & page offset
+
+static const FCodeRowCache& GetCodeRowCache(FCodeAnalysisState& state, const FCodeInfo* pCodeInfo)
+{
+	const FCodeAnalysisPage* pPage = state.GetReadPage(pCodeInfo->Address);
+	if ((int)g_CodeRowCache.size() < state.GetNoPages())
+		g_CodeRowCache.resize(state.GetNoPages());
+	std::vector<FCodeRowCache>& pageRows = g_CodeRowCache[pPage->PageId];
+	if (pageRows.empty())
+		pageRows.resize(FCodeAnalysisPage::kPageSize);
+
+	FCodeRowCache& row = pageRows[pCodeInfo->Address & FCodeAnalysisState::kPageMask];
+	const ENumberDisplayMode numberMode = GetNumberDisplayMode();
+	uint16_t operandAddress = 0;
+	if (pCodeInfo->OperandType == EOperandType::JumpAddress)
+		operandAddress = pCodeInfo->JumpAddress;
+	else if (pCodeInfo->OperandType == EOperandType::Pointer)
+		operandAddress = pCodeInfo->PointerAddress;
+	const FCodeAnalysisPage* pOperandPage = state.ReadPageTable[operandAddress >> FCodeAnalysisState::kPageShift];
+
+	if (row.LabelGeneration != state.GetLabelGeneration() || row.NumberMode != numberMode || row.Address != pCodeInfo->Address ||
+		row.OperandType != pCodeInfo->OperandType || row.OperandAddress != operandAddress || row.pOperandPage != pOperandPage)
+	{
+		row.LabelGeneration = state.GetLabelGeneration();
+		row.NumberMode = numberMode;
+		row.Address = pCodeInfo->Address;
+		row.OperandType = pCodeInfo->OperandType;
+		row.OperandAddress = operandAddress;
+		row.pOperandPage = pOperandPage;
+		row.AddressText = NumStr(pCodeInfo->Address);
+
+		row.OperandLabelText.clear();
+		if (pCodeInfo->OperandType == EOperandType::JumpAddress || pCodeInfo->OperandType == EOperandType::Pointer)
+			FormatAddressLabel(state, operandAddress, false, row.OperandLabelText);
+	}
+
+	return row;
+}
+
 void DrawCodeInfo(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState, const FCodeInfo *pCodeInfo)
 {
 	const float line_height = ImGui::GetTextLineHeight();
@@ -533,7 +604,8 @@ void DrawCodeInfo(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState,
 		WriteCodeInfoForAddress(state, pCodeInfo->Address);
 	}
 
-	ImGui::Text("\t%s", NumStr(pCodeInfo->Address));
+	const FCodeRowCache& row = GetCodeRowCache(state, pCodeInfo);
+	ImGui::Text("\t%s", row.AddressText.c_str());
 	const float line_start_x = ImGui::GetCursorPosX();
 	ImGui::SameLine(line_start_x + cell_width * 4 + glyph_width * 2);
 
@@ -589,14 +661,8 @@ void DrawCodeInfo(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState,
 	}
 
 	// draw jump address label name
-	if (pCodeInfo->OperandType == EOperandType::JumpAddress)
-	{
-		DrawAddressLabel(state, viewState, pCodeInfo->JumpAddress);
-	}
-	else if (pCodeInfo->OperandType == EOperandType::Pointer)
-	{
-		DrawAddressLabel(state, viewState, pCodeInfo->PointerAddress);
-	}
+	if (row.OperandLabelText.empty() == false)
+		DrawAddressLabelText(state, viewState, row.OperandAddress, row.OperandLabelText.c_str());
 
 	DrawComment(pCodeInfo);
 
@@ -605,7 +671,10 @@ void DrawCodeInfo(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState,
 void DrawCodeDetails(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState, FCodeInfo *pCodeInfo)
 {
 	if (DrawOperandTypeCombo("Operand Type", pCodeInfo->OperandType))
+	{
 		pCodeInfo->Text.clear();	// clear for a rewrite
+		state.SetPageDirty(pCodeInfo->Address);
+	}
 
 	if (ImGui::Checkbox("NOP out instruction", &pCodeInfo->bNOPped))
 	{
@@ -668,7 +737,7 @@ void DrawCommentBlockDetails(FCodeAnalysisState& state, FCommentBlock* pCommentB
 	{
 		if (pCommentBlock->Comment.empty() == true)
 			state.SetCommentBlockForAddress(pCommentBlock->Address, nullptr);
-		state.SetCodeAnalysisDirty();
+		state.SetCodeAnalysisDirty(pCommentBlock->Address);
 	}
 
 }
@@ -717,6 +786,7 @@ void ProcessKeyCommands(FCodeAnalysisState& state, FCodeAnalysisViewState& viewS
 					pDataItem->DataType = EDataType::Bitmap;
 				else
 					pDataItem->DataType = EDataType::Byte;
+				state.SetPageDirty(pDataItem->Address);
 				//pDataItem->bShowBinary = !pDataItem->bShowBinary;
 			}
 		}
@@ -792,6 +862,8 @@ void UpdatePopups(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 		{
 			ImGui::CloseCurrentPopup();
 		}
+		if (ImGui::IsItemEdited())
+			state.SetPageDirty(pCursorItem->Address);
 		ImGui::SetItemDefaultFocus();
 		ImGui::EndPopup();
 	}
@@ -801,9 +873,11 @@ void UpdatePopups(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 		ImGui::SetKeyboardFocusHere();
 		if(ImGui::InputTextMultiline("##comment", &pCursorItem->Comment,ImVec2(), ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CtrlEnterForNewLine))
 		{
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pCursorItem->Address);
 			ImGui::CloseCurrentPopup();
 		}
+		if (ImGui::IsItemEdited())
+			state.SetPageDirty(pCursorItem->Address);
 		ImGui::SetItemDefaultFocus();
 		ImGui::EndPopup();
 	}
@@ -817,7 +891,11 @@ void UpdatePopups(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
 		if (ImGui::InputText("##comment", &LabelText, ImGuiInputTextFlags_EnterReturnsTrue))
 		{
 			if (LabelText.empty() == false)
+			{
 				pLabel->Name = LabelText;
+				state.SetPageDirty(pLabel->Address);
+				state.LabelsChanged();
+			}
 			ImGui::CloseCurrentPopup();
 		}
 		ImGui::SetItemDefaultFocus();
@@ -853,6 +931,28 @@ void UpdateItemList(FCodeAnalysisState &state)
 		// loop across address range
 		for (int addr = 0; addr < (1 << 16); addr++)
 		{
+			// pages waiting to be loaded are listed as bytes rather than loaded here
+			// drawing them loads them, which marks the list to be rebuilt
+			if ((addr & FCodeAnalysisState::kPageMask) == 0 && state.IsReadPageLoaded(addr) == false)
+			{
+				FCodeAnalysisPage* pPage = state.ReadPageTable[addr >> FCodeAnalysisState::kPageShift];
+				if (pPage != nullptr)
+				{
+					for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+					{
+						state.ItemList.push_back(&pPage->DataInfo[pageAddr]);
+						for (int i = 0; i < FCodeAnalysisState::kNoViewStates; i++)
+						{
+							if (state.ViewState[i].GetCursorItem() == state.ItemList.back())
+								state.ViewState[i].CursorItemIndex = (int)state.ItemList.size() - 1;
+						}
+					}
+					addr += FCodeAnalysisPage::kPageSize - 1;
+					nextItemAddress = addr + 1;
+					continue;
+				}
+			}
+
 			// convert comment block into multiple comment lines
 			FCommentBlock* pCommentBlock = state.GetCommentBlockForAddress(addr);
 			if (pCommentBlock != nullptr)
@@ -1559,6 +1659,158 @@ void GenerateFilteredLabelList(const FLabelListFilter&filter,const std::vector<F
 	}
 }
 
+// text shown for a search result - the index may be a few frames behind so items could have gone
+static void DrawSearchResultText(const FCodeAnalysisPage& page, const FSearchResult& result)
+{
+	const FLabelInfo* pLabel = page.Labels[result.PageOffset];
+	const FCodeInfo* pCodeInfo = page.CodeInfo[result.PageOffset];
+	const char* pText = nullptr;
+
+	switch (result.Field)
+	{
+	case ESearchField::Label:
+		if (pLabel != nullptr)
+			pText = pLabel->Name.c_str();
+		break;
+	case ESearchField::Comment:
+		{
+			const FCommentBlock* pCommentBlock = page.CommentBlocks[result.PageOffset];
+			if (pCommentBlock != nullptr && pCommentBlock->Comment.empty() == false)
+				pText = pCommentBlock->Comment.c_str();
+			else if (pCodeInfo != nullptr && pCodeInfo->Comment.empty() == false)
+				pText = pCodeInfo->Comment.c_str();
+			else
+				pText = page.DataInfo[result.PageOffset].Comment.c_str();
+		}
+		break;
+	case ESearchField::Code:
+		if (pCodeInfo != nullptr)
+			pText = pCodeInfo->Text.c_str();
+		break;
+	}
+
+	if (pText == nullptr)
+		return;
+
+	// first line only
+	const char* pLineEnd = strchr(pText, '\n');
+	const int lineLength = pLineEnd != nullptr ? (int)(pLineEnd - pText) : (int)strlen(pText);
+	if (result.Field == ESearchField::Comment)
+		ImGui::TextColored(ImVec4(0.5f, 0.5f, 0.5f, 1.0f), "; %.*s", lineLength, pText);
+	else
+		ImGui::Text("%.*s", lineLength, pText);
+}
+
+void DrawSearchTab(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
+{
+	const bool bQueryChanged = ImGui::InputText("Find", &viewState.SearchText);
+	if (bQueryChanged || viewState.SearchGeneration != state.SearchIndex.GetGeneration())
+	{
+		state.SearchIndex.Search(viewState.SearchText, viewState.SearchResults);
+		viewState.SearchGeneration = state.SearchIndex.GetGeneration();
+	}
+
+	if (ImGui::BeginChild("SearchResultList", ImVec2(0, 0), false))
+	{
+		const float lineHeight = ImGui::GetTextLineHeight();
+		ImGuiListClipper clipper((int)viewState.SearchResults.size(), lineHeight);
+
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const FSearchResult& result = viewState.SearchResults[i];
+				const FCodeAnalysisPage* pPage = state.GetPage(result.PageId);
+				const uint16_t addr = pPage->BaseAddress + result.PageOffset;
+				const bool bMapped = state.ReadPageTable[addr >> FCodeAnalysisState::kPageShift] == pPage;
+
+				// results in banks that aren't mapped in are listed with the bank name but can't be gone to
+				ImGui::PushID(i);
+				if (ImGui::Selectable("##searchresult", false) && bMapped)
+					GoToAddress(viewState, addr, result.Field == ESearchField::Label);
+				ImGui::SameLine();
+				if (bMapped)
+					ImGui::Text("%s", NumStr(addr));
+				else
+					ImGui::TextDisabled("%s %s", state.GetPageName(result.PageId), NumStr(addr));
+				ImGui::SameLine(bMapped ? 80.0f : 0.0f);
+				DrawSearchResultText(*pPage, result);
+				ImGui::PopID();
+			}
+		}
+	}
+	ImGui::EndChild();
+}
+
+// instructions that access an address range
+void DrawAccessorsTab(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState)
+{
+	DrawAddressInput("Start", &viewState.XRefStartAddress);
+	DrawAddressInput("End", &viewState.XRefEndAddress);
+	const FItem* pCursorItem = viewState.GetCursorItem();
+	if (pCursorItem != nullptr && ImGui::Button("Use Cursor Item"))
+	{
+		viewState.XRefStartAddress = pCursorItem->Address;
+		viewState.XRefEndAddress = pCursorItem->Address + std::max(pCursorItem->ByteSize, (uint16_t)1) - 1;
+	}
+
+	if (viewState.XRefEndAddress < viewState.XRefStartAddress)
+		return;
+
+	// one line per instruction
+	std::vector<FXRefAccessor>& accessors = viewState.XRefAccessors;
+	if (viewState.XRefAccessorsGeneration != state.XRefs.GetGeneration() ||
+		viewState.XRefAccessorsStart != viewState.XRefStartAddress || viewState.XRefAccessorsEnd != viewState.XRefEndAddress)
+	{
+		std::vector<FXRef>& xrefs = viewState.XRefs;
+		state.XRefs.GetXRefsToData(state, viewState.XRefStartAddress, viewState.XRefEndAddress, xrefs);
+
+		std::map<uint16_t, FXRefAccessor> accessorMap;
+		for (const FXRef& xref : xrefs)
+		{
+			FXRefAccessor& accessor = accessorMap.insert({ xref.CodeAddress, { xref.CodeAddress, 0, 0 } }).first->second;
+			if (xref.Type == EXRefType::Read)
+				accessor.NoBytesRead++;
+			else
+				accessor.NoBytesWritten++;
+		}
+
+		accessors.clear();
+		for (const auto& accessorIt : accessorMap)
+			accessors.push_back(accessorIt.second);
+
+		viewState.XRefAccessorsGeneration = state.XRefs.GetGeneration();
+		viewState.XRefAccessorsStart = viewState.XRefStartAddress;
+		viewState.XRefAccessorsEnd = viewState.XRefEndAddress;
+	}
+
+	ImGui::Text("%d instructions access this range", (int)accessors.size());
+
+	if (ImGui::BeginChild("AccessorList", ImVec2(0, 0), false))
+	{
+		const float lineHeight = ImGui::GetTextLineHeight();
+		ImGuiListClipper clipper((int)accessors.size(), lineHeight);
+
+		while (clipper.Step())
+		{
+			for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+			{
+				const FXRefAccessor& accessor = accessors[i];
+
+				ImGui::PushID(i);
+				ShowCodeAccessorActivity(state, accessor.CodeAddress);
+				ImGui::Text("   %c%c", accessor.NoBytesRead > 0 ? 'R' : ' ', accessor.NoBytesWritten > 0 ? 'W' : ' ');
+				ImGui::SameLine();
+				DrawCodeAddress(state, viewState, accessor.CodeAddress, true);
+				ImGui::SameLine();
+				ImGui::Text("(%d read, %d written)", accessor.NoBytesRead, accessor.NoBytesWritten);
+				ImGui::PopID();
+			}
+		}
+	}
+	ImGui::EndChild();
+}
+
 void DrawGlobals(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState)
 {
 	if(ImGui::BeginTabBar("GlobalsTabBar"))
@@ -1607,6 +1859,18 @@ void DrawGlobals(FCodeAnalysisState &state, FCodeAnalysisViewState& viewState)
 			ImGui::EndTabItem();
 		}
 
+		if (ImGui::BeginTabItem("Search"))
+		{
+			DrawSearchTab(state, viewState);
+			ImGui::EndTabItem();
+		}
+
+		if (ImGui::BeginTabItem("Accessors"))
+		{
+			DrawAccessorsTab(state, viewState);
+			ImGui::EndTabItem();
+		}
+
 		// TODO: This should be somewhere else
 		if (ImGui::BeginTabItem("Format"))	
 		{
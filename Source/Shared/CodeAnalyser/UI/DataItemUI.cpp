@@ -253,10 +253,10 @@ void EditWordDataItem(FCodeAnalysisState& state, uint16_t address)
 
 void ShowDataItemActivity(FCodeAnalysisState& state, uint16_t addr)
 {
-	const FDataInfo* pReadDataInfo = state.GetReadDataInfoForAddress(addr);
-	const FDataInfo* pWriteDataInfo = state.GetWriteDataInfoForAddress(addr);
-	const int framesSinceWritten = pWriteDataInfo->LastFrameWritten == -1 ? 255 : state.CurrentFrameNo - pWriteDataInfo->LastFrameWritten;
-	const int framesSinceRead = pReadDataInfo->LastFrameRead == -1 ? 255 : state.CurrentFrameNo - pReadDataInfo->LastFrameRead;
+	const int lastFrameWritten = state.GetLastFrameWritten(addr);
+	const int lastFrameRead = state.GetLastFrameRead(addr);
+	const int framesSinceWritten = lastFrameWritten == -1 ? 255 : state.CurrentFrameNo - lastFrameWritten;
+	const int framesSinceRead = lastFrameRead == -1 ? 255 : state.CurrentFrameNo - lastFrameRead;
 	const int wBrightVal = (255 - std::min(framesSinceWritten << 2, 255)) & 0xff;
 	const int rBrightVal = (255 - std::min(framesSinceRead << 2, 255)) & 0xff;
 	float offset = 0;
@@ -588,7 +588,10 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 				if (pCodeInfo)
 				{
 					if (pCodeInfo->Comment.empty() || bOverride)
+					{
 						pCodeInfo->Comment = commentTxt;
+						state.SetPageDirty(accessorCodeAddr);
+					}
 				}
 			}
 		}
@@ -629,7 +632,10 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 				if (pCodeInfo)
 				{
 					if (pCodeInfo->Comment.empty() || bOverride)
+					{
 						pCodeInfo->Comment = commentTxt;
+						state.SetPageDirty(accessorCodeAddr);
+					}
 				}
 			}
 		}
@@ -649,7 +655,8 @@ void DrawDataAccesses(FCodeAnalysisState& state, FCodeAnalysisViewState& viewSta
 void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, FDataInfo* pDataInfo)
 {
 	ImGui::Text("Number Mode Override");
-	DrawOperandTypeCombo("##dataOperand",pDataInfo->OperandType);
+	if (DrawOperandTypeCombo("##dataOperand", pDataInfo->OperandType))
+		state.SetPageDirty(pDataInfo->Address);
 	switch (pDataInfo->DataType)
 	{
 	case EDataType::Byte:
@@ -678,7 +685,7 @@ void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 		if (ImGui::InputInt("Length", &length))
 		{
 			pDataInfo->ByteSize = length;
-			state.SetCodeAnalysisDirty();
+			state.SetCodeAnalysisDirty(pDataInfo->Address);
 		}
 	}
 	break;
@@ -730,10 +737,12 @@ void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 
 	case EDataType::CharacterMap:
 	{
+		const uint16_t oldCharSetAddress = pDataInfo->CharSetAddress;
 		DrawCharacterSetComboBox(state, &pDataInfo->CharSetAddress);
 		const char* format = "%02X";
 		int flags = ImGuiInputTextFlags_EnterReturnsTrue | ImGuiInputTextFlags_CharsHexadecimal;
-		ImGui::InputScalar("Null Character", ImGuiDataType_U8, &pDataInfo->EmptyCharNo,0,0,format,flags);
+		if (ImGui::InputScalar("Null Character", ImGuiDataType_U8, &pDataInfo->EmptyCharNo,0,0,format,flags) || pDataInfo->CharSetAddress != oldCharSetAddress)
+			state.SetPageDirty(pDataInfo->Address);
 	}
 	break;
 
@@ -748,7 +757,7 @@ void DrawDataDetails(FCodeAnalysisState& state, FCodeAnalysisViewState& viewStat
 			if (ImGui::InputInt2("Image Size (chars)", sz))
 			{
 				pDataInfo->ByteSize = pImageData->SetSizeChars(sz[0], sz[1]);
-				state.SetCodeAnalysisDirty();	// force redraw of items
+				state.SetCodeAnalysisDirty(pDataInfo->Address);	// force redraw of items
 				bRebuildImage = true;
 			}
 
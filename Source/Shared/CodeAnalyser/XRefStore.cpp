@@ -0,0 +1,221 @@
+#include "XRefStore.h"
+#include "CodeAnalyser.h"
+
+#include <algorithm>
+
+static const int kXRefPageShift = 10;
+static_assert(kXRefPageShift == FCodeAnalysisState::kPageShift, "xref pages must match analysis pages");
+static const int kXRefPageSize = 1 << kXRefPageShift;
+static const int kNoSlots = FCodeAnalysisState::kAddressSize >> kXRefPageShift;
+
+static void AddSortedKeys(std::vector<uint32_t>& keys, std::vector<uint32_t>& newKeys)
+{
+	std::sort(newKeys.begin(), newKeys.end());
+	const size_t oldSize = keys.size();
+	keys.insert(keys.end(), newKeys.begin(), newKeys.end());
+	std::inplace_merge(keys.begin(), keys.begin() + oldSize, keys.end());
+	keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+}
+
+void FXRefStore::AddXRef(const FCodeAnalysisPage& page, uint16_t dataAddr, uint16_t codeAddr, EXRefType type)
+{
+	// pages without a bucket yet get one built from their maps on the next update
+	if (page.PageId >= 0 && page.PageId < (int)Pages.size())
+		Pages[page.PageId]->Pending.push_back(MakeDataKey(dataAddr & (kXRefPageSize - 1), codeAddr, type));
+}
+
+void FXRefStore::InvalidatePage(const FCodeAnalysisPage& page)
+{
+	if (page.PageId >= 0 && page.PageId < (int)Pages.size())
+		Pages[page.PageId]->bDirty = true;
+}
+
+// replace the bucket's edges with the ones in the page's per-byte maps
+void FXRefStore::RebuildPage(const FCodeAnalysisPage& page, FPageXRefs& pageXRefs)
+{
+	pageXRefs.ByData.clear();
+	pageXRefs.Pending.clear();
+	for (int pageOffset = 0; pageOffset < kXRefPageSize; pageOffset++)
+	{
+		const FDataInfo& dataInfo = page.DataInfo[pageOffset];
+		for (const auto& reader : dataInfo.Reads)
+			pageXRefs.ByData.push_back(MakeDataKey(pageOffset, reader.first, EXRefType::Read));
+		for (const auto& writer : dataInfo.Writes)
+			pageXRefs.ByData.push_back(MakeDataKey(pageOffset, writer.first, EXRefType::Write));
+	}
+	std::sort(pageXRefs.ByData.begin(), pageXRefs.ByData.end());
+
+	pageXRefs.ByCode.resize(pageXRefs.ByData.size());
+	std::transform(pageXRefs.ByData.begin(), pageXRefs.ByData.end(), pageXRefs.ByCode.begin(), DataKeyToCodeKey);
+	std::sort(pageXRefs.ByCode.begin(), pageXRefs.ByCode.end());
+}
+
+void FXRefStore::MergePending(FPageXRefs& pageXRefs)
+{
+	std::vector<uint32_t> codeKeys(pageXRefs.Pending.size());
+	std::transform(pageXRefs.Pending.begin(), pageXRefs.Pending.end(), codeKeys.begin(), DataKeyToCodeKey);
+
+	AddSortedKeys(pageXRefs.ByData, pageXRefs.Pending);
+	AddSortedKeys(pageXRefs.ByCode, codeKeys);
+	pageXRefs.Pending.clear();
+}
+
+void FXRefStore::Update(const FCodeAnalysisState& state)
+{
+	while ((int)Pages.size() < state.GetNoPages())
+		Pages.push_back(std::make_unique<FPageXRefs>());
+
+	const bool bRebuildAll = bAllDirty.exchange(false);
+	bool bChanged = false;
+	for (int pageId = 0; pageId < (int)Pages.size(); pageId++)
+	{
+		FPageXRefs& pageXRefs = *Pages[pageId];
+		if (bRebuildAll)
+			pageXRefs.bDirty = true;
+
+		// pages still waiting to be lazily loaded stay dirty & get built when they load
+		if (pageXRefs.bDirty)
+		{
+			const FCodeAnalysisPage* pPage = pageId < state.GetNoPages() ? state.GetPageIfLoaded((int16_t)pageId) : nullptr;
+			if (pPage == nullptr)
+				continue;
+
+			pageXRefs.bDirty = false;
+			RebuildPage(*pPage, pageXRefs);
+			bChanged = true;
+		}
+		else if (pageXRefs.Pending.empty() == false)
+		{
+			MergePending(pageXRefs);
+			bChanged = true;
+		}
+	}
+
+	if (bChanged)
+		Generation++;
+}
+
+const FXRefStore::FPageXRefs* FXRefStore::GetPageXRefs(const FCodeAnalysisPage* pPage) const
+{
+	if (pPage == nullptr || pPage->PageId < 0 || pPage->PageId >= (int)Pages.size())
+		return nullptr;
+	return Pages[pPage->PageId].get();
+}
+
+// keys in [startKey, endKey) of one bucket, data addresses are given relative to the slot the page is mapped to
+void FXRefStore::AddPageXRefs(const std::vector<uint32_t>& keys, uint32_t startKey, uint32_t endKey, bool bToData, uint16_t slotAddr, int typeFilter, std::vector<FXRef>& outXRefs)
+{
+	const auto startIt = std::lower_bound(keys.begin(), keys.end(), startKey);
+	const auto endIt = std::lower_bound(startIt, keys.end(), endKey);
+	for (auto keyIt = startIt; keyIt != endIt; ++keyIt)
+	{
+		const uint32_t key = *keyIt;
+		const EXRefType type = (EXRefType)(key & 1);
+		if (typeFilter != kAnyType && (int)type != typeFilter)
+			continue;
+
+		if (bToData)
+			outXRefs.push_back({ (uint16_t)(key >> 1), (uint16_t)(slotAddr + (key >> 17)), type });
+		else
+			outXRefs.push_back({ (uint16_t)(key >> 11), (uint16_t)(slotAddr + ((key >> 1) & (kXRefPageSize - 1))), type });
+	}
+}
+
+int FXRefStore::CountPageXRefs(const std::vector<uint32_t>& keys, uint32_t startKey, uint32_t endKey, int typeFilter)
+{
+	const auto startIt = std::lower_bound(keys.begin(), keys.end(), startKey);
+	const auto endIt = std::lower_bound(startIt, keys.end(), endKey);
+	if (typeFilter == kAnyType)
+		return (int)(endIt - startIt);
+	return (int)std::count_if(startIt, endIt, [typeFilter](uint32_t key) { return (int)(key & 1) == typeFilter; });
+}
+
+// reads come from the read page & writes from the write page, or everything from one page mapped for both
+int FXRefStore::GetSlotBuckets(const FCodeAnalysisState& state, int slot, FSlotBucket outBuckets[2]) const
+{
+	const FPageXRefs* pReadXRefs = GetPageXRefs(state.ReadPageTable[slot]);
+	const FPageXRefs* pWriteXRefs = GetPageXRefs(state.WritePageTable[slot]);
+	int noBuckets = 0;
+	if (pReadXRefs == pWriteXRefs)
+	{
+		if (pReadXRefs != nullptr)
+			outBuckets[noBuckets++] = { pReadXRefs, kAnyType };
+		return noBuckets;
+	}
+
+	if (pReadXRefs != nullptr)
+		outBuckets[noBuckets++] = { pReadXRefs, (int)EXRefType::Read };
+	if (pWriteXRefs != nullptr)
+		outBuckets[noBuckets++] = { pWriteXRefs, (int)EXRefType::Write };
+	return noBuckets;
+}
+
+void FXRefStore::GetXRefsToData(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr, std::vector<FXRef>& outXRefs) const
+{
+	outXRefs.clear();
+	for (int slot = startAddr >> kXRefPageShift; slot <= endAddr >> kXRefPageShift; slot++)
+	{
+		const int slotAddr = slot << kXRefPageShift;
+		const uint32_t startKey = (uint32_t)(std::max((int)startAddr, slotAddr) - slotAddr) << 17;
+		const uint32_t endKey = (uint32_t)(std::min((int)endAddr, slotAddr + kXRefPageSize - 1) - slotAddr + 1) << 17;
+		FSlotBucket buckets[2];
+		const int noBuckets = GetSlotBuckets(state, slot, buckets);
+		for (int bucketNo = 0; bucketNo < noBuckets; bucketNo++)
+			AddPageXRefs(buckets[bucketNo].pXRefs->ByData, startKey, endKey, true, (uint16_t)slotAddr, buckets[bucketNo].TypeFilter, outXRefs);
+	}
+}
+
+void FXRefStore::GetXRefsFromCode(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr, std::vector<FXRef>& outXRefs) const
+{
+	const uint32_t startKey = (uint32_t)startAddr << 11;
+	const uint32_t endKey = ((uint32_t)endAddr + 1) << 11;
+
+	outXRefs.clear();
+	for (int slot = 0; slot < kNoSlots; slot++)
+	{
+		FSlotBucket buckets[2];
+		const int noBuckets = GetSlotBuckets(state, slot, buckets);
+		for (int bucketNo = 0; bucketNo < noBuckets; bucketNo++)
+			AddPageXRefs(buckets[bucketNo].pXRefs->ByCode, startKey, endKey, false, (uint16_t)(slot << kXRefPageShift), buckets[bucketNo].TypeFilter, outXRefs);
+	}
+}
+
+int FXRefStore::CountXRefsToData(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr) const
+{
+	int count = 0;
+	for (int slot = startAddr >> kXRefPageShift; slot <= endAddr >> kXRefPageShift; slot++)
+	{
+		const int slotAddr = slot << kXRefPageShift;
+		const uint32_t startKey = (uint32_t)(std::max((int)startAddr, slotAddr) - slotAddr) << 17;
+		const uint32_t endKey = (uint32_t)(std::min((int)endAddr, slotAddr + kXRefPageSize - 1) - slotAddr + 1) << 17;
+		FSlotBucket buckets[2];
+		const int noBuckets = GetSlotBuckets(state, slot, buckets);
+		for (int bucketNo = 0; bucketNo < noBuckets; bucketNo++)
+			count += CountPageXRefs(buckets[bucketNo].pXRefs->ByData, startKey, endKey, buckets[bucketNo].TypeFilter);
+	}
+	return count;
+}
+
+int FXRefStore::CountXRefsFromCode(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr) const
+{
+	const uint32_t startKey = (uint32_t)startAddr << 11;
+	const uint32_t endKey = ((uint32_t)endAddr + 1) << 11;
+
+	int count = 0;
+	for (int slot = 0; slot < kNoSlots; slot++)
+	{
+		FSlotBucket buckets[2];
+		const int noBuckets = GetSlotBuckets(state, slot, buckets);
+		for (int bucketNo = 0; bucketNo < noBuckets; bucketNo++)
+			count += CountPageXRefs(buckets[bucketNo].pXRefs->ByCode, startKey, endKey, buckets[bucketNo].TypeFilter);
+	}
+	return count;
+}
+
+int FXRefStore::GetNoXRefs() const
+{
+	int noXRefs = 0;
+	for (const auto& pPageXRefs : Pages)
+		noXRefs += (int)pPageXRefs->ByData.size();
+	return noXRefs;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+struct FCodeAnalysisState;
+struct FCodeAnalysisPage;
+
+enum class EXRefType : uint8_t
+{
+	Read,
+	Write,
+};
+
+// an instruction reading or writing a data address
+struct FXRef
+{
+	uint16_t	CodeAddress;
+	uint16_t	DataAddress;
+	EXRefType	Type;
+};
+
+// All code<->data access edges, kept in a bucket per analysis page so a bank switch needs no rebuilding.
+// Each bucket is sorted both by data page offset & by code address, queries go through the page tables to the
+// buckets of the pages mapped in - reads from read pages, writes from write pages.
+// New edges are appended by the access registration functions when a per-byte Reads/Writes map gets a new entry and
+// merged in on Update(). Anything that replaces the per-byte maps (resets, loading) invalidates the store so it gets
+// rebuilt from them. Loading a page only invalidates that page's bucket.
+class FXRefStore
+{
+public:
+	void	AddXRef(const FCodeAnalysisPage& page, uint16_t dataAddr, uint16_t codeAddr, EXRefType type);
+	void	Invalidate() { bAllDirty = true; }
+	void	InvalidatePage(const FCodeAnalysisPage& page);
+	void	PageMappingChanged() { Generation++; }	// query results change without the edges changing
+
+	// call before querying
+	void	Update(const FCodeAnalysisState& state);
+	int		GetGeneration() const { return Generation; }	// changes when query results could have
+
+	// inclusive address ranges
+	void	GetXRefsToData(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr, std::vector<FXRef>& outXRefs) const;
+	void	GetXRefsFromCode(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr, std::vector<FXRef>& outXRefs) const;
+	int		CountXRefsToData(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr) const;
+	int		CountXRefsFromCode(const FCodeAnalysisState& state, uint16_t startAddr, uint16_t endAddr) const;
+	int		GetNoXRefs() const;
+
+private:
+	// edges to data in one page
+	struct FPageXRefs
+	{
+		std::vector<uint32_t>	ByData;		// page offset, code address, type
+		std::vector<uint32_t>	ByCode;		// code address, page offset, type
+		std::vector<uint32_t>	Pending;	// by data keys
+		std::atomic<bool>		bDirty{ true };	// atomic as pages can be loaded from worker threads
+	};
+
+	// page offset in the top bits so keys sort by it, the code address & type below
+	static uint32_t	MakeDataKey(uint16_t pageOffset, uint16_t codeAddr, EXRefType type)
+	{
+		return ((uint32_t)pageOffset << 17) | ((uint32_t)codeAddr << 1) | (uint32_t)type;
+	}
+	static uint32_t	DataKeyToCodeKey(uint32_t key)
+	{
+		return ((key & 0x1fffe) << 10) | ((key >> 17) << 1) | (key & 1);
+	}
+
+	// a bucket a slot's edges come from & the type of edge taken from it, kAnyType for all
+	struct FSlotBucket
+	{
+		const FPageXRefs*	pXRefs;
+		int					TypeFilter;
+	};
+	static const int kAnyType = -1;
+
+	int		GetSlotBuckets(const FCodeAnalysisState& state, int slot, FSlotBucket outBuckets[2]) const;
+	static void	AddPageXRefs(const std::vector<uint32_t>& keys, uint32_t startKey, uint32_t endKey, bool bToData, uint16_t slotAddr, int typeFilter, std::vector<FXRef>& outXRefs);
+	static int	CountPageXRefs(const std::vector<uint32_t>& keys, uint32_t startKey, uint32_t endKey, int typeFilter);
+	void	RebuildPage(const FCodeAnalysisPage& page, FPageXRefs& pageXRefs);
+	void	MergePending(FPageXRefs& pageXRefs);
+	const FPageXRefs*	GetPageXRefs(const FCodeAnalysisPage* pPage) const;
+
+	std::vector<std::unique_ptr<FPageXRefs>>	Pages;	// by page id
+	std::atomic<bool>	bAllDirty{ true };
+	std::atomic<int>	Generation{ 0 };
+};
@@ -330,16 +330,19 @@ bool RegisterCodeExecutedZ80(FCodeAnalysisState& state, uint16_t pc, uint16_t ne
 			FDataInfo* pStackItem = state.GetWriteDataInfoForAddress(stackPointer);	// -2 because SP was recorded before instruction was 	
 			const FCodeInfo* pCodeItem = state.GetCodeInfoForAddress(pc);
 
-			if (pCodeItem != nullptr)// && pCodeItem->Comment.empty() == false)
-				pStackItem->Comment = pCodeItem->Comment;
-			else
-				pStackItem->Comment = "";
+			const std::string& comment = pCodeItem != nullptr ? pCodeItem->Comment : std::string();
+			if (pStackItem->Comment != comment)
+			{
+				pStackItem->Comment = comment;
+				state.GetWritePage(stackPointer)->bDirty = true;
+			}
 
 			// Format stack data item
 			if (pStackItem->DataType != EDataType::Word)
 			{
 				pStackItem->DataType = EDataType::Word;
 				pStackItem->ByteSize = 2;
+				state.GetWritePage(stackPointer)->bDirty = true;
 				state.SetCodeAnalysisDirty();
 			}
 		}
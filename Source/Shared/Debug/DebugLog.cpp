@@ -1,110 +1,454 @@
 #include "DebugLog.h"
-#include "ImGuiLog.h"
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
 #ifdef _WIN32
 #include <Windows.h>
 #endif
 
-#ifdef _WIN32
+static const uint32_t kQueueSize = 1024;	// must be a power of 2
+static const int kMaxArgs = 16;
+static const int kStringSpace = 256;		// for copies of string arguments, shared between them - longer strings are truncated with ...
+static const int kMaxLineLength = 1024;
 
-#define PLATFORM_FORMAT_LOG_MESSAGE(fn, level)  \
-	char buf[16*1024]; \
-    va_list ap; \
-    va_start(ap, fmt); \
-	vsprintf_s(buf,16*1024, fmt, ap); \
-	va_end(ap); \
-	fn(buf); 
-
-#define PLATFORM_FORMAT_LOG_MESSAGE_LF(fn, level)  \
-	char buf[16*1024]; \
-    va_list ap; \
-    va_start(ap, fmt); \
-	vsprintf_s(buf,16*1024, fmt, ap); \
-	va_end(ap); \
-	strcat_s(buf,16*1024, "\n"); \
-	fn(buf); 
-#else
-#define PLATFORM_FORMAT_LOG_MESSAGE(fn, level)  \
-	char buf[16*1024]; \
-    va_list ap; \
-    va_start(ap, fmt); \
-	vsprintf(buf, fmt, ap); \
-	va_end(ap); \
-	fn(buf); 
-
-#define PLATFORM_FORMAT_LOG_MESSAGE_LF(fn, level)  \
-	char buf[16*1024]; \
-    va_list ap; \
-    va_start(ap, fmt); \
-	vsprintf(buf, fmt, ap); \
-	va_end(ap); \
-	strcat(buf, "\n"); \
-	fn(buf); 
-#endif
+// each call site can log kSiteMaxMessages every kSiteWindowMs before messages are suppressed
+static const uint32_t kSiteMaxMessages = 50;
+static const uint32_t kSiteWindowMs = 1000;
+
+static const char* kLevelPrefix[] = { "[Fatal] ", "[Error] ", "[Warning] ", "[Info] ", "[Debug] " };
 
-void LogFatal(const char* str)
+struct FLogSlot
 {
-#ifdef WIN32
-	OutputDebugStringA(str);
-#endif
-	g_ImGuiLog.AddLog("[Fatal] %s", str);
+	std::atomic<uint32_t>	Sequence;
+	ELogLevel	Level;
+	uint8_t		NoArgs;
+	uint16_t	StringsUsed;
+	const char* Format;
+	FLogArg		Args[kMaxArgs];
+	char		Strings[kStringSpace];
+};
+
+// Bounded multi producer, single consumer queue
+// A slot's sequence number says whether it is free for the producer at that position or ready for the consumer.
+struct FLogQueue
+{
+	FLogQueue()
+	{
+		for (uint32_t i = 0; i < kQueueSize; i++)
+			Slots[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	// returns nullptr when the queue is full
+	FLogSlot* Reserve(uint32_t& outPos)
+	{
+		uint32_t pos = EnqueuePos.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			FLogSlot& slot = Slots[pos & (kQueueSize - 1)];
+			const int32_t diff = (int32_t)(slot.Sequence.load(std::memory_order_acquire) - pos);
+			if (diff == 0)
+			{
+				if (EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				{
+					outPos = pos;
+					return &slot;
+				}
+			}
+			else if (diff < 0)
+			{
+				return nullptr;
+			}
+			else
+			{
+				pos = EnqueuePos.load(std::memory_order_relaxed);
+			}
+		}
+	}
+
+	void Commit(FLogSlot* pSlot, uint32_t pos)
+	{
+		pSlot->Sequence.store(pos + 1, std::memory_order_release);
+	}
+
+	// consumer only
+	FLogSlot* Peek()
+	{
+		FLogSlot& slot = Slots[DequeuePos & (kQueueSize - 1)];
+		return slot.Sequence.load(std::memory_order_acquire) == DequeuePos + 1 ? &slot : nullptr;
+	}
+
+	void Pop(FLogSlot* pSlot)
+	{
+		pSlot->Sequence.store(DequeuePos + kQueueSize, std::memory_order_release);
+		DequeuePos++;
+	}
+
+	FLogSlot				Slots[kQueueSize];
+	std::atomic<uint32_t>	EnqueuePos = { 0 };
+	uint32_t				DequeuePos = 0;
+};
+
+static FLogQueue g_LogQueue;
+static std::atomic<uint32_t> g_NoDroppedMessages = { 0 };
+static std::atomic<FLogSite*> g_LogSites = { nullptr };	// every call site that has logged, for reporting suppressed messages
+
+static uint32_t GetLogTimeMs()
+{
+	static const auto startTime = std::chrono::steady_clock::now();
+	return (uint32_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
 }
 
-void LogError(const char* str)
+static void RegisterLogSite(FLogSite& site, ELogLevel level, const char* fmt)
 {
-#ifdef WIN32
-	OutputDebugStringA(str);
-#endif
-	g_ImGuiLog.AddLog("[Error] %s", str);
+	if (site.bRegistered.load(std::memory_order_acquire) || site.bRegistered.exchange(true))
+		return;
+
+	site.Format = fmt;
+	site.Level = level;
+	site.pNext = g_LogSites.load(std::memory_order_relaxed);
+	while (g_LogSites.compare_exchange_weak(site.pNext, &site, std::memory_order_release, std::memory_order_relaxed) == false)
+		;
 }
 
-void LogWarning(const char* str)
+static bool CheckLogSiteRate(FLogSite& site)
 {
-#ifdef WIN32
-	OutputDebugStringA(str);
-#endif
-	g_ImGuiLog.AddLog("[Warning] %s", str);
+	const uint32_t timeMs = GetLogTimeMs();
+	uint32_t windowStart = site.WindowStartMs.load(std::memory_order_relaxed);
+	if (timeMs - windowStart >= kSiteWindowMs && site.WindowStartMs.compare_exchange_strong(windowStart, timeMs, std::memory_order_relaxed))
+		site.WindowCount.store(0, std::memory_order_relaxed);
+
+	if (site.WindowCount.fetch_add(1, std::memory_order_relaxed) < kSiteMaxMessages)
+		return true;
+
+	site.NoSuppressed.fetch_add(1, std::memory_order_relaxed);
+	return false;
 }
 
-void LogInfo(const char* str)
+// fatal messages & errors are written straight out as well as being queued, so they're seen even if the log is never drained
+static bool IsWriteThroughLevel(ELogLevel level)
 {
-#ifdef WIN32
-	OutputDebugStringA(str);
-#endif
-	g_ImGuiLog.AddLog("[Info] %s", str);
+	return level == ELogLevel::Fatal || level == ELogLevel::Error;
 }
 
-void LogDebug(const char* str)
+static void WriteThroughLogMessage(ELogLevel level, const char* fmt, const FLogArg* pArgs, int noArgs);
+
+void _LogMessage(FLogSite& site, ELogLevel level, const char* fmt, const FLogArg* pArgs, int noArgs)
 {
-#ifdef WIN32
-	OutputDebugStringA(str);
-#endif
-	g_ImGuiLog.AddLog("[Debug] %s", str);
+	RegisterLogSite(site, level, fmt);
+	if (CheckLogSiteRate(site) == false)
+		return;
+
+	if (IsWriteThroughLevel(level))
+		WriteThroughLogMessage(level, fmt, pArgs, noArgs);
+
+	uint32_t pos;
+	FLogSlot* pSlot = g_LogQueue.Reserve(pos);
+	if (pSlot == nullptr)
+	{
+		g_NoDroppedMessages.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	pSlot->Level = level;
+	pSlot->Format = fmt;
+	pSlot->NoArgs = (uint8_t)std::min(noArgs, kMaxArgs);
+	pSlot->StringsUsed = 0;
+	int noStringArgs = 0;
+	for (int argNo = 0; argNo < pSlot->NoArgs; argNo++)
+	{
+		pSlot->Args[argNo] = pArgs[argNo];
+		if (pArgs[argNo].Type == ELogArgType::String)
+			noStringArgs++;
+	}
+
+	// copy the strings into the slot, each gets an even share of the space left so one long string can't starve the rest
+	for (int argNo = 0; argNo < pSlot->NoArgs; argNo++)
+	{
+		FLogArg& arg = pSlot->Args[argNo];
+		if (arg.Type != ELogArgType::String)
+			continue;
+
+		const int maxLength = (kStringSpace - pSlot->StringsUsed) / noStringArgs-- - 1;
+		if (arg.String == nullptr)
+			continue;
+
+		char* pCopy = pSlot->Strings + pSlot->StringsUsed;
+		size_t length = strnlen(arg.String, maxLength + 1);
+		if (length > (size_t)maxLength)
+		{
+			length = maxLength;
+			memcpy(pCopy, arg.String, length - 3);
+			memcpy(pCopy + length - 3, "...", 3);
+		}
+		else
+		{
+			memcpy(pCopy, arg.String, length);
+		}
+		pCopy[length] = 0;
+		pSlot->StringsUsed += (uint16_t)(length + 1);
+		arg.String = pCopy;
+	}
+
+	g_LogQueue.Commit(pSlot, pos);
+}
+
+// Formatting
+
+struct FLogLineWriter
+{
+	FLogLineWriter(char* pBuffer, int bufferSize) : pBuf(pBuffer), Size(bufferSize) { pBuf[0] = 0; }
+
+	void Append(const char* pText, int length)
+	{
+		length = std::min(length, Size - 1 - Length);
+		memcpy(pBuf + Length, pText, length);
+		Length += length;
+		pBuf[Length] = 0;
+	}
+
+	void Appendf(const char* fmt, ...)
+	{
+		if (Length >= Size - 1)
+			return;
+		va_list ap;
+		va_start(ap, fmt);
+		const int written = vsnprintf(pBuf + Length, Size - Length, fmt, ap);
+		va_end(ap);
+		if (written > 0)
+			Length = std::min(Length + written, Size - 1);
+	}
+
+	char*	pBuf;
+	int		Size;
+	int		Length = 0;
+};
+
+static bool IsNumberArg(const FLogArg* pArg)
+{
+	return pArg != nullptr && (pArg->Type == ELogArgType::Int || pArg->Type == ELogArgType::UInt || pArg->Type == ELogArgType::Float);
+}
+
+static int64_t GetIntArg(const FLogArg& arg)
+{
+	switch (arg.Type)
+	{
+	case ELogArgType::Int: return arg.Int;
+	case ELogArgType::UInt: return (int64_t)arg.UInt;
+	case ELogArgType::Float: return (int64_t)arg.Float;
+	default: return 0;
+	}
+}
+
+static double GetFloatArg(const FLogArg& arg)
+{
+	return arg.Type == ELogArgType::Float ? arg.Float : arg.Type == ELogArgType::UInt ? (double)arg.UInt : (double)GetIntArg(arg);
 }
 
-void _LogFatalfLF(const char* fmt, ...)
+// printf style formatting from captured arguments
+// Each conversion is formatted with its own snprintf call, with the length modifier replaced to match how the argument was stored.
+// Missing or mismatched arguments are shown as <?>
+static void FormatLogMessage(ELogLevel level, const char* fmt, const FLogArg* pArgs, int noArgs, FLogLineWriter& out)
 {
-	PLATFORM_FORMAT_LOG_MESSAGE_LF(LogFatal, 0);//dvLogLevel_Fatal);
+	out.Append(kLevelPrefix[(int)level], (int)strlen(kLevelPrefix[(int)level]));
+
+	const char* p = fmt;
+	int argNo = 0;
+	const auto nextArg = [&]() { return argNo < noArgs ? &pArgs[argNo++] : nullptr; };
+
+	while (*p != 0)
+	{
+		if (*p != '%')
+		{
+			const char* pStart = p;
+			while (*p != 0 && *p != '%')
+				p++;
+			out.Append(pStart, (int)(p - pStart));
+			continue;
+		}
+
+		p++;
+		if (*p == '%')
+		{
+			out.Append("%", 1);
+			p++;
+			continue;
+		}
+
+		// rebuild the conversion spec - flags, width & precision
+		char spec[32] = "%";
+		int specLen = 1;
+		const auto addSpecChar = [&](char c) { if (specLen < (int)sizeof(spec) - 4) spec[specLen++] = c; };
+		const auto addSpecStar = [&]()
+		{
+			const FLogArg* pArg = nextArg();
+			char number[16];
+			snprintf(number, sizeof(number), "%d", pArg != nullptr ? (int)GetIntArg(*pArg) : 0);
+			for (const char* pNum = number; *pNum != 0; pNum++)
+				addSpecChar(*pNum);
+			p++;
+		};
+
+		while (*p != 0 && strchr("-+ #0", *p) != nullptr)
+			addSpecChar(*p++);
+		if (*p == '*')
+			addSpecStar();
+		while (*p >= '0' && *p <= '9')
+			addSpecChar(*p++);
+		if (*p == '.')
+		{
+			addSpecChar(*p++);
+			if (*p == '*')
+				addSpecStar();
+			while (*p >= '0' && *p <= '9')
+				addSpecChar(*p++);
+		}
+		while (*p != 0 && strchr("hljztL", *p) != nullptr)
+			p++;
+
+		const char conversion = *p;
+		if (conversion == 0)
+			break;
+		p++;
+
+		const FLogArg* pArg = nextArg();
+		switch (conversion)
+		{
+		case 'd':
+		case 'i':
+		case 'u':
+		case 'o':
+		case 'x':
+		case 'X':
+			if (IsNumberArg(pArg))
+			{
+				addSpecChar('l');
+				addSpecChar('l');
+				addSpecChar(conversion);
+				spec[specLen] = 0;
+				if (conversion == 'd' || conversion == 'i')
+					out.Appendf(spec, (long long)GetIntArg(*pArg));
+				else
+					out.Appendf(spec, (unsigned long long)GetIntArg(*pArg));
+				continue;
+			}
+			break;
+		case 'c':
+			if (IsNumberArg(pArg))
+			{
+				addSpecChar('c');
+				spec[specLen] = 0;
+				out.Appendf(spec, (int)GetIntArg(*pArg));
+				continue;
+			}
+			break;
+		case 'f':
+		case 'F':
+		case 'e':
+		case 'E':
+		case 'g':
+		case 'G':
+		case 'a':
+		case 'A':
+			if (IsNumberArg(pArg))
+			{
+				addSpecChar(conversion);
+				spec[specLen] = 0;
+				out.Appendf(spec, GetFloatArg(*pArg));
+				continue;
+			}
+			break;
+		case 's':
+			if (pArg != nullptr && pArg->Type == ELogArgType::String)
+			{
+				addSpecChar('s');
+				spec[specLen] = 0;
+				out.Appendf(spec, pArg->String != nullptr ? pArg->String : "(null)");
+				continue;
+			}
+			break;
+		case 'p':
+			if (pArg != nullptr && (pArg->Type == ELogArgType::Pointer || pArg->Type == ELogArgType::UInt))
+			{
+				out.Appendf("%p", pArg->Pointer);
+				continue;
+			}
+			break;
+		}
+
+		out.Append("<?>", 3);
+	}
 }
 
-void _LogErrorfLF(const char* fmt, ...)
+static void WriteDebugOutput(const char* pText)
 {
-	PLATFORM_FORMAT_LOG_MESSAGE_LF(LogError, 0);//dvLogLevel_Error);
+#ifdef _WIN32
+	OutputDebugStringA(pText);
+	OutputDebugStringA("\n");
+#else
+	(void)pText;
+#endif
 }
 
-void _LogWarningfLF(const char* fmt, ...)
+static void WriteThroughLogMessage(ELogLevel level, const char* fmt, const FLogArg* pArgs, int noArgs)
 {
-	PLATFORM_FORMAT_LOG_MESSAGE_LF(LogWarning, 0);//dvLogLevel_Warning);
+	char line[kMaxLineLength];
+	FLogLineWriter out(line, sizeof(line));
+	FormatLogMessage(level, fmt, pArgs, std::min(noArgs, kMaxArgs), out);
+	WriteDebugOutput(line);
+#ifndef _WIN32
+	fprintf(stderr, "%s\n", line);
+#endif
 }
 
-void _LogInfofLF(const char* fmt, ...)
+static void OutputLogLine(ELogLevel level, const char* pText, FLogOutputFunc outputFunc, void* pUserData, bool bWriteDebugOutput = true)
 {
-	PLATFORM_FORMAT_LOG_MESSAGE_LF(LogInfo, 0);//dvLogLevel_Info);
+	if (bWriteDebugOutput)
+		WriteDebugOutput(pText);
+	outputFunc(level, pText, pUserData);
 }
 
-void _LogDebugfLF(const char* fmt, ...)
+int DrainLog(FLogOutputFunc outputFunc, void* pUserData)
 {
-	PLATFORM_FORMAT_LOG_MESSAGE_LF(LogDebug, 0);//dvLogLevel_Debug);
-}
\ No newline at end of file
+	char line[kMaxLineLength];
+	int noLines = 0;
+
+	while (FLogSlot* pSlot = g_LogQueue.Peek())
+	{
+		FLogLineWriter out(line, sizeof(line));
+		FormatLogMessage(pSlot->Level, pSlot->Format, pSlot->Args, pSlot->NoArgs, out);
+		const ELogLevel level = pSlot->Level;
+		g_LogQueue.Pop(pSlot);
+
+		OutputLogLine(level, line, outputFunc, pUserData, IsWriteThroughLevel(level) == false);
+		noLines++;
+	}
+
+	const uint32_t noDropped = g_NoDroppedMessages.exchange(0, std::memory_order_relaxed);
+	if (noDropped > 0)
+	{
+		snprintf(line, sizeof(line), "%s%u messages dropped - log queue full", kLevelPrefix[(int)ELogLevel::Warning], noDropped);
+		OutputLogLine(ELogLevel::Warning, line, outputFunc, pUserData);
+		noLines++;
+	}
+
+	// report suppressed messages at most once per rate window for each call site
+	const uint32_t timeMs = GetLogTimeMs();
+	for (FLogSite* pSite = g_LogSites.load(std::memory_order_acquire); pSite != nullptr; pSite = pSite->pNext)
+	{
+		if (pSite->NoSuppressed.load(std::memory_order_relaxed) == 0)
+			continue;
+		if (pSite->LastReportMs != 0 && timeMs - pSite->LastReportMs < kSiteWindowMs)
+			continue;
+
+		const uint32_t noSuppressed = pSite->NoSuppressed.exchange(0, std::memory_order_relaxed);
+		pSite->LastReportMs = std::max(timeMs, 1u);
+		snprintf(line, sizeof(line), "%s%u more messages suppressed from '%s'", kLevelPrefix[(int)pSite->Level], noSuppressed, pSite->Format);
+		OutputLogLine(pSite->Level, line, outputFunc, pUserData);
+		noLines++;
+	}
+
+	return noLines;
+}
@@ -1,13 +1,126 @@
 #pragma once
 
-void _LogFatalfLF(const char* fmt, ...);
-void _LogErrorfLF(const char* fmt, ...);
-void _LogWarningfLF(const char* fmt, ...);
-void _LogInfofLF(const char* fmt, ...);
-void _LogDebugfLF(const char* fmt, ...);
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
 
-#define LOGERROR(...) 		_LogErrorfLF(__VA_ARGS__)
-#define LOGWARNING(...) 	_LogWarningfLF(__VA_ARGS__)
-#define LOGINFO(...) 		_LogInfofLF(__VA_ARGS__)
-#define LOGDEBUG(...) 		_LogDebugfLF(__VA_ARGS__)
+// Logging doesn't format on the calling thread - the format string & arguments are copied into a fixed size
+// lock free queue and formatted when the log is drained (by the debug log UI each frame).
+// Format strings must be string literals. String arguments are copied (long ones truncated with ...), other arguments
+// are stored by value. Fatal messages & errors are also written straight to the debugger output when logged.
+// Each LOGxxx call site is rate limited, messages over the limit are counted and reported as a summary.
 
+enum class ELogLevel : uint8_t
+{
+	Fatal,
+	Error,
+	Warning,
+	Info,
+	Debug,
+};
+
+enum class ELogArgType : uint8_t
+{
+	Int,
+	UInt,
+	Float,
+	String,
+	Pointer,
+};
+
+struct FLogArg
+{
+	ELogArgType		Type;
+	union
+	{
+		int64_t		Int;
+		uint64_t	UInt;
+		double		Float;
+		const char* String;
+		const void* Pointer;
+	};
+};
+
+// per call site rate limiting state - static in each LOGxxx macro expansion
+struct FLogSite
+{
+	std::atomic<uint32_t>	WindowStartMs = 0;
+	std::atomic<uint32_t>	WindowCount = 0;
+	std::atomic<uint32_t>	NoSuppressed = 0;
+	std::atomic<bool>		bRegistered = false;
+	const char*				Format = nullptr;
+	ELogLevel				Level = ELogLevel::Info;
+	uint32_t				LastReportMs = 0;	// only touched when draining, 0 if never reported
+	FLogSite*				pNext = nullptr;
+};
+
+inline FLogArg MakeLogArg(const char* pString)
+{
+	FLogArg arg;
+	arg.Type = ELogArgType::String;
+	arg.String = pString;
+	return arg;
+}
+
+template <typename T>
+FLogArg MakeLogArg(T value)
+{
+	FLogArg arg;
+	if constexpr (std::is_same_v<T, char*>)
+	{
+		arg.Type = ELogArgType::String;
+		arg.String = value;
+	}
+	else if constexpr (std::is_pointer_v<T>)
+	{
+		arg.Type = ELogArgType::Pointer;
+		arg.Pointer = (const void*)value;
+	}
+	else if constexpr (std::is_floating_point_v<T>)
+	{
+		arg.Type = ELogArgType::Float;
+		arg.Float = (double)value;
+	}
+	else if constexpr (std::is_enum_v<T>)
+	{
+		arg.Type = ELogArgType::Int;
+		arg.Int = (int64_t)value;
+	}
+	else
+	{
+		static_assert(std::is_integral_v<T>, "unsupported log argument type");
+		if constexpr (std::is_signed_v<T>)
+		{
+			arg.Type = ELogArgType::Int;
+			arg.Int = (int64_t)value;
+		}
+		else
+		{
+			arg.Type = ELogArgType::UInt;
+			arg.UInt = (uint64_t)value;
+		}
+	}
+	return arg;
+}
+
+void _LogMessage(FLogSite& site, ELogLevel level, const char* fmt, const FLogArg* pArgs, int noArgs);
+
+template <typename... Args>
+void _LogMessage(FLogSite& site, ELogLevel level, const char* fmt, Args... args)
+{
+	const FLogArg logArgs[sizeof...(Args) + 1] = { MakeLogArg(args)... };
+	_LogMessage(site, level, fmt, logArgs, (int)sizeof...(Args));
+}
+
+// Format queued messages oldest first and pass them to outputFunc, along with summaries of suppressed & dropped messages
+// Call from one thread only. Returns the number of lines output.
+typedef void (*FLogOutputFunc)(ELogLevel level, const char* pText, void* pUserData);
+int DrainLog(FLogOutputFunc outputFunc, void* pUserData);
+
+#define LOG_MESSAGE(level, ...)		do { static FLogSite _logSite; _LogMessage(_logSite, level, __VA_ARGS__); } while (0)
+
+#define LOGFATAL(...) 		LOG_MESSAGE(ELogLevel::Fatal, __VA_ARGS__)
+#define LOGERROR(...) 		LOG_MESSAGE(ELogLevel::Error, __VA_ARGS__)
+#define LOGWARNING(...) 	LOG_MESSAGE(ELogLevel::Warning, __VA_ARGS__)
+#define LOGINFO(...) 		LOG_MESSAGE(ELogLevel::Info, __VA_ARGS__)
+#define LOGDEBUG(...) 		LOG_MESSAGE(ELogLevel::Debug, __VA_ARGS__)
@@ -3,6 +3,7 @@
 ImGuiLog g_ImGuiLog;
 
 ImGuiLog::ImGuiLog()
+	: Lines(kMaxLines)
 {
 	AutoScroll = true;
 	ScrollToBottom = false;
@@ -11,30 +12,52 @@ ImGuiLog::ImGuiLog()
 
 void    ImGuiLog::Clear()
 {
-	Buf.clear();
-	LineOffsets.clear();
-	LineOffsets.push_back(0);
+	FirstLine = 0;
+	NoLines = 0;
+	bFilterDirty = true;
 }
 
-void    ImGuiLog::AddLog(const char* fmt, ...)
+void    ImGuiLog::AddLine(ELogLevel level, const char* pText)
 {
-	int old_size = Buf.size();
-	va_list args;
-	va_start(args, fmt);
-	Buf.appendfv(fmt, args);
-	va_end(args);
-	for (int new_size = Buf.size(); old_size < new_size; old_size++)
-	{
-		if (Buf[old_size] == '\n')
-			LineOffsets.push_back(old_size + 1);
-	}
+	// reuse the oldest line when full so the history doesn't grow
+	FLine& line = Lines[(FirstLine + NoLines) % kMaxLines];
+	if (NoLines < kMaxLines)
+		NoLines++;
+	else
+		FirstLine = (FirstLine + 1) % kMaxLines;
+
+	line.Level = level;
+	line.Text = pText;
+	bFilterDirty = true;
 
 	if (AutoScroll)
 		ScrollToBottom = true;
 }
 
+void    ImGuiLog::Update()
+{
+	DrainLog([](ELogLevel level, const char* pText, void* pUserData)
+	{
+		((ImGuiLog*)pUserData)->AddLine(level, pText);
+	}, this);
+}
+
+void    ImGuiLog::UpdateFilteredLines()
+{
+	FilteredLines.clear();
+	for (int lineNo = 0; lineNo < NoLines; lineNo++)
+	{
+		const std::string& text = GetLine(lineNo).Text;
+		if (Filter.PassFilter(text.c_str(), text.c_str() + text.size()))
+			FilteredLines.push_back(lineNo);
+	}
+	bFilterDirty = false;
+}
+
 void    ImGuiLog::Draw(const char* title, bool* p_open)
 {
+	Update();
+
 	if (!ImGui::Begin(title, p_open))
 	{
 		ImGui::End();
@@ -58,57 +81,50 @@ void    ImGuiLog::Draw(const char* title, bool* p_open)
 	ImGui::SameLine();
 	bool copy = ImGui::Button("Copy");
 	ImGui::SameLine();
-	Filter.Draw("Filter", -100.0f);
+	if (Filter.Draw("Filter", -100.0f))
+		bFilterDirty = true;
 
 	ImGui::Separator();
 	ImGui::BeginChild("scrolling", ImVec2(0, 0), false, ImGuiWindowFlags_HorizontalScrollbar);
 
 	if (clear)
 		Clear();
-	if (copy)
-		ImGui::LogToClipboard();
 
-	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
-	const char* buf = Buf.begin();
-	const char* buf_end = Buf.end();
-	if (Filter.IsActive())
+	// the filtered line list gives random access for the clipper whether or not the filter is active
+	const bool bFiltered = Filter.IsActive();
+	if (bFiltered && bFilterDirty)
+		UpdateFilteredLines();
+	const int noDisplayLines = bFiltered ? (int)FilteredLines.size() : NoLines;
+
+	if (copy)
 	{
-		// In this example we don't use the clipper when Filter is enabled.
-		// This is because we don't have a random access on the result on our filter.
-		// A real application processing logs with ten of thousands of entries may want to store the result of search/filter.
-		// especially if the filtering function is not trivial (e.g. reg-exp).
-		for (int line_no = 0; line_no < LineOffsets.Size; line_no++)
+		std::string clipText;
+		for (int displayLineNo = 0; displayLineNo < noDisplayLines; displayLineNo++)
 		{
-			const char* line_start = buf + LineOffsets[line_no];
-			const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-			if (Filter.PassFilter(line_start, line_end))
-				ImGui::TextUnformatted(line_start, line_end);
+			clipText += GetLine(bFiltered ? FilteredLines[displayLineNo] : displayLineNo).Text;
+			clipText += '\n';
 		}
+		ImGui::SetClipboardText(clipText.c_str());
 	}
-	else
+
+	ImGui::PushStyleVar(ImGuiStyleVar_ItemSpacing, ImVec2(0, 0));
+	ImGuiListClipper clipper;
+	clipper.Begin(noDisplayLines);
+	while (clipper.Step())
 	{
-		// The simplest and easy way to display the entire buffer:
-		//   ImGui::TextUnformatted(buf_begin, buf_end);
-		// And it'll just work. TextUnformatted() has specialization for large blob of text and will fast-forward to skip non-visible lines.
-		// Here we instead demonstrate using the clipper to only process lines that are within the visible area.
-		// If you have tens of thousands of items and their processing cost is non-negligible, coarse clipping them on your side is recommended.
-		// Using ImGuiListClipper requires A) random access into your data, and B) items all being the  same height,
-		// both of which we can handle since we an array pointing to the beginning of each line of text.
-		// When using the filter (in the block of code above) we don't have random access into the data to display anymore, which is why we don't use the clipper.
-		// Storing or skimming through the search result would make it possible (and would be recommended if you want to search through tens of thousands of entries)
-		ImGuiListClipper clipper;
-		clipper.Begin(LineOffsets.Size);
-		while (clipper.Step())
+		for (int displayLineNo = clipper.DisplayStart; displayLineNo < clipper.DisplayEnd; displayLineNo++)
 		{
-			for (int line_no = clipper.DisplayStart; line_no < clipper.DisplayEnd; line_no++)
-			{
-				const char* line_start = buf + LineOffsets[line_no];
-				const char* line_end = (line_no + 1 < LineOffsets.Size) ? (buf + LineOffsets[line_no + 1] - 1) : buf_end;
-				ImGui::TextUnformatted(line_start, line_end);
-			}
+			const FLine& line = GetLine(bFiltered ? FilteredLines[displayLineNo] : displayLineNo);
+			const bool bError = line.Level == ELogLevel::Error || line.Level == ELogLevel::Fatal;
+			const bool bWarning = line.Level == ELogLevel::Warning;
+			if (bError || bWarning)
+				ImGui::PushStyleColor(ImGuiCol_Text, bError ? ImVec4(1.0f, 0.4f, 0.4f, 1.0f) : ImVec4(1.0f, 1.0f, 0.4f, 1.0f));
+			ImGui::TextUnformatted(line.Text.c_str(), line.Text.c_str() + line.Text.size());
+			if (bError || bWarning)
+				ImGui::PopStyleColor();
 		}
-		clipper.End();
 	}
+	clipper.End();
 	ImGui::PopStyleVar();
 
 	if (ScrollToBottom)
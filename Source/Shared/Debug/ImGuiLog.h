@@ -1,6 +1,10 @@
 #pragma once
 
 #include "imgui.h"
+#include "DebugLog.h"
+
+#include <string>
+#include <vector>
 
 class ImGuiLog
 {
@@ -9,16 +13,31 @@ public:
 	ImGuiLog();
 	void    Clear();
 
-	void    AddLog(const char* fmt, ...);
+	void    Update();	// drain queued log messages into the line history - call every frame
 
 	void    Draw(const char* title, bool* p_open = NULL);
 
 	private:
-		ImGuiTextBuffer     Buf;
+		static const int kMaxLines = 4096;
+
+		struct FLine
+		{
+			ELogLevel	Level = ELogLevel::Info;
+			std::string	Text;
+		};
+
+		void    AddLine(ELogLevel level, const char* pText);
+		const FLine& GetLine(int lineNo) const { return Lines[(FirstLine + lineNo) % kMaxLines]; }
+		void    UpdateFilteredLines();
+
+		std::vector<FLine>  Lines;              // ring buffer of the last kMaxLines lines, oldest at FirstLine
+		int                 FirstLine = 0;
+		int                 NoLines = 0;
 		ImGuiTextFilter     Filter;
-		ImVector<int>       LineOffsets;        // Index to lines offset. We maintain this with AddLog() calls, allowing us to have a random access on lines
+		std::vector<int>    FilteredLines;      // line numbers which pass the filter, rebuilt when the lines or filter change
+		bool                bFilterDirty = true;
 		bool                AutoScroll;
 		bool                ScrollToBottom;
 };
 
-extern ImGuiLog g_ImGuiLog;
\ No newline at end of file
+extern ImGuiLog g_ImGuiLog;
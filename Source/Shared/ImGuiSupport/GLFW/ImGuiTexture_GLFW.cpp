@@ -6,7 +6,7 @@
 
 
 // assume it's 8bpp
-ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height)
+ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height, bool bPartialUpdates)
 {
 	GLuint newTexture = 0;
 	GLint lastTexture;
@@ -50,6 +50,18 @@ void ImGui_UpdateTextureRGBA(ImTextureID texture,unsigned char* pixels)
 	glBindTexture(GL_TEXTURE_2D, lastTexture);
 }
 
+void ImGui_UpdateTextureRGBARows(ImTextureID texture, const unsigned char* pixels, int width, int firstRow, int noRows)
+{
+	GLint lastTexture;
+	glGetIntegerv(GL_TEXTURE_BINDING_2D, &lastTexture);
+
+	glBindTexture(GL_TEXTURE_2D, (GLuint)(intptr_t)texture);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, width, noRows, GL_RGBA, GL_UNSIGNED_BYTE, pixels + (firstRow * width * 4));	// assume 32bpp
+
+	// Restore state
+	glBindTexture(GL_TEXTURE_2D, lastTexture);
+}
+
 static std::vector<uint32_t>	g_UploadBuffer;
 
 void ImGui_UpdateTextureRGBA(ImTextureID texture, unsigned char* pixels, int srcWidth, int srcHeight)
@@ -85,3 +97,8 @@ void ImGui_UpdateTextureRGBA(ImTextureID texture, unsigned char* pixels, int src
 		//pDeviceCtx->Unmap(pTexture, 0);
 	}
 }
+
+// textures are created with nearest filtering so there's nothing to change
+void ImGui_SetPointSampling(const ImDrawList*, const ImDrawCmd*)
+{
+}
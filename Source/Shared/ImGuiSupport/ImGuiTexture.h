@@ -1,8 +1,16 @@
 #pragma once
 
 typedef void* ImTextureID;
+struct ImDrawList;
+struct ImDrawCmd;
 
-ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height);
+// bPartialUpdates - texture will be updated with ImGui_UpdateTextureRGBARows
+ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height, bool bPartialUpdates = false);
 void ImGui_FreeTexture(ImTextureID);
 void ImGui_UpdateTextureRGBA(ImTextureID texture, unsigned char* pixels);
 void ImGui_UpdateTextureRGBA(ImTextureID texture, unsigned char* pixels, int srcWidth, int srcHeight);
+// update rows [firstRow, firstRow + noRows) from a full image of the texture's size
+void ImGui_UpdateTextureRGBARows(ImTextureID texture, const unsigned char* pixels, int width, int firstRow, int noRows);
+
+// ImDrawList callback - images drawn after it use nearest sampling, add ImDrawCallback_ResetRenderState after them to go back to the default
+void ImGui_SetPointSampling(const ImDrawList* pDrawList, const ImDrawCmd* pCmd);
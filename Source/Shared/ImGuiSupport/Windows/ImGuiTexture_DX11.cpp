@@ -7,7 +7,7 @@ extern ID3D11DeviceContext*	GetDx11DeviceContext();
 
 
 // assume it's 8bpp
-ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height)
+ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height, bool bPartialUpdates)
 {
 	ImTextureID newTex;
 	ID3D11ShaderResourceView*	pTextureView = NULL;
@@ -26,9 +26,10 @@ ImTextureID ImGui_CreateTextureRGBA(unsigned char* pixels, int width, int height
 		desc.ArraySize = 1;
 		desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
 		desc.SampleDesc.Count = 1;
-		desc.Usage = D3D11_USAGE_DYNAMIC;
+		// dynamic textures can only be updated as a whole, default ones can be updated a box at a time
+		desc.Usage = bPartialUpdates ? D3D11_USAGE_DEFAULT : D3D11_USAGE_DYNAMIC;
 		desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-		desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		desc.CPUAccessFlags = bPartialUpdates ? 0 : D3D11_CPU_ACCESS_WRITE;
 
 		ID3D11Texture2D *pTexture = NULL;
 		D3D11_SUBRESOURCE_DATA subResource;
@@ -112,3 +113,51 @@ void ImGui_UpdateTextureRGBA(ImTextureID texture, unsigned char* pixels, int src
 		pDeviceCtx->Unmap(pTexture, 0);
 	}
 }
+
+void ImGui_UpdateTextureRGBARows(ImTextureID texture, const unsigned char* pixels, int width, int firstRow, int noRows)
+{
+	ID3D11ShaderResourceView* pTextureView = (ID3D11ShaderResourceView*)texture;
+	ID3D11DeviceContext* pDeviceCtx = GetDx11DeviceContext();
+
+	ID3D11Texture2D* pTexture = nullptr;
+	pTextureView->GetResource(reinterpret_cast<ID3D11Resource**>(&pTexture));
+
+	D3D11_TEXTURE2D_DESC desc;
+	pTexture->GetDesc(&desc);
+
+	if (desc.Usage == D3D11_USAGE_DEFAULT)
+	{
+		D3D11_BOX box;
+		box.left = 0;
+		box.right = width;
+		box.top = firstRow;
+		box.bottom = firstRow + noRows;
+		box.front = 0;
+		box.back = 1;
+		pDeviceCtx->UpdateSubresource(pTexture, 0, &box, pixels + (firstRow * width * 4), width * 4, 0);	// assume 32bpp
+	}
+	else
+	{
+		ImGui_UpdateTextureRGBA(texture, (unsigned char*)pixels);
+	}
+	pTexture->Release();
+}
+
+// the ImGui DX11 backend samples with linear filtering, this swaps in a point sampler until the render state is reset
+void ImGui_SetPointSampling(const ImDrawList*, const ImDrawCmd*)
+{
+	static ID3D11SamplerState* pPointSampler = nullptr;
+	if (pPointSampler == nullptr)
+	{
+		D3D11_SAMPLER_DESC desc;
+		ZeroMemory(&desc, sizeof(desc));
+		desc.Filter = D3D11_FILTER_MIN_MAG_MIP_POINT;
+		desc.AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
+		desc.AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
+		desc.AddressW = D3D11_TEXTURE_ADDRESS_CLAMP;
+		desc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+		if (GetDx11Device()->CreateSamplerState(&desc, &pPointSampler) != S_OK)
+			return;
+	}
+	GetDx11DeviceContext()->PSSetSamplers(0, 1, &pPointSampler);
+}
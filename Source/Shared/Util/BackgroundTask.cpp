@@ -0,0 +1,77 @@
+#include "BackgroundTask.h"
+
+#include "Debug/DebugLog.h"
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
+bool FBackgroundTask::Start(const char* pName, std::function<bool(FBackgroundTask&)> job)
+{
+	if (IsRunning())
+		return false;
+
+	Name = pName;
+	Progress = 0.0f;
+	bFinished = false;
+	bResult = false;
+	TimeMs = 0.0;
+
+	Thread = std::thread([this, job]()
+	{
+		const auto startTime = std::chrono::high_resolution_clock::now();
+		bResult = job(*this);
+		const auto endTime = std::chrono::high_resolution_clock::now();
+		TimeMs = std::chrono::duration<double, std::milli>(endTime - startTime).count();
+		Progress = 1.0f;
+		bFinished = true;
+	});
+
+	return true;
+}
+
+void FBackgroundTask::Wait()
+{
+	if (Thread.joinable())
+		Thread.join();
+}
+
+bool FBackgroundTask::Update()
+{
+	if (Thread.joinable() == false || bFinished == false)
+		return false;
+
+	Thread.join();
+	// logging isn't thread safe so report from here rather than the worker
+	if (bResult)
+		LOGDEBUG("%s took %.1fms", Name.c_str(), TimeMs);
+	else
+		LOGERROR("%s failed", Name.c_str());
+	return true;
+}
+
+int CalcNoParallelChunks(int noItems, int minItemsPerChunk)
+{
+	const int noThreads = std::max((int)std::thread::hardware_concurrency(), 1);
+	const int maxChunks = (noItems + minItemsPerChunk - 1) / std::max(minItemsPerChunk, 1);
+	return std::max(std::min(noThreads, maxChunks), 1);
+}
+
+void ParallelForChunks(int noItems, int noChunks, const std::function<void(int chunkNo, int begin, int end)>& chunkFunc)
+{
+	noChunks = std::max(noChunks, 1);
+	const int chunkSize = (noItems + noChunks - 1) / noChunks;
+
+	std::vector<std::thread> workers;
+	for (int chunkNo = 1; chunkNo < noChunks; chunkNo++)
+	{
+		const int begin = std::min(chunkNo * chunkSize, noItems);
+		const int end = std::min(begin + chunkSize, noItems);
+		workers.emplace_back(chunkFunc, chunkNo, begin, end);
+	}
+
+	chunkFunc(0, 0, std::min(chunkSize, noItems));
+
+	for (std::thread& worker : workers)
+		worker.join();
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Runs a job on a worker thread so long operations don't stall the UI
+// Only one job can be in flight, the UI polls Update() each frame to pick up completion.
+// The job must only touch data it owns - anything shared with the UI thread has to be copied before starting.
+class FBackgroundTask
+{
+public:
+	~FBackgroundTask() { Wait(); }
+
+	bool	Start(const char* pName, std::function<bool(FBackgroundTask&)> job);	// false if a job is already running
+	void	Wait();		// block until the current job has finished
+	bool	Update();	// returns true on the frame a job completes
+
+	bool	IsRunning() const { return Thread.joinable(); }
+	bool	GetResult() const { return bResult; }
+	const std::string&	GetName() const { return Name; }
+
+	// progress is 0-1, set from the worker
+	void	SetProgress(float progress) { Progress = progress; }
+	float	GetProgress() const { return Progress; }
+
+private:
+	std::thread			Thread;
+	std::string			Name;
+	std::atomic<float>	Progress = { 0.0f };
+	std::atomic<bool>	bFinished = { false };
+	bool				bResult = false;
+	double				TimeMs = 0.0;
+};
+
+// Split noItems into contiguous chunks and process them across worker threads, blocking until all are done
+// Chunk 0 runs on the calling thread. Chunks are ordered, so per-chunk output can be concatenated in chunk order.
+int		CalcNoParallelChunks(int noItems, int minItemsPerChunk);
+void	ParallelForChunks(int noItems, int noChunks, const std::function<void(int chunkNo, int begin, int end)>& chunkFunc);
@@ -0,0 +1,442 @@
+#include "ExecutionTrace.h"
+
+#include <zlib.h>
+#include <cstring>
+
+static const uint32_t kExecTraceFileMagic = 0x43525458;	// 'XTRC'
+static const uint32_t kExecTraceBlockMagic = 0x4b425458;	// 'XTBK'
+static const uint32_t kExecTraceIndexMagic = 0x58495458;	// 'XTIX'
+static const uint32_t kExecTraceFileVersion = 2;	// 2 - separate IO page summaries
+
+static const size_t kFileHeaderSize = 8;	// magic, version
+static const size_t kBlockHeaderSize = 4 + 3 * 4 + 7 * 8 + (int)ETraceColumn::Count * 8;	// magic, counts, cycles & page masks, column sizes
+static const size_t kIndexEntrySize = 8 + kBlockHeaderSize;	// file offset, block header
+static const size_t kFooterSize = 16;		// index offset, no blocks, magic
+
+static bool SeekTo(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t GetFilePos(FILE* fp)
+{
+#ifdef _WIN32
+	return (uint64_t)_ftelli64(fp);
+#else
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+static uint64_t GetFileSize(FILE* fp)
+{
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	return (uint64_t)_ftelli64(fp);
+#else
+	fseeko(fp, 0, SEEK_END);
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+// Little endian field packing for headers
+struct FHeaderPacker
+{
+	uint8_t*	pData;
+	size_t		Pos = 0;
+
+	template <class T>
+	void Put(T value)
+	{
+		memcpy(pData + Pos, &value, sizeof(T));
+		Pos += sizeof(T);
+	}
+
+	template <class T>
+	T Get()
+	{
+		T value;
+		memcpy(&value, pData + Pos, sizeof(T));
+		Pos += sizeof(T);
+		return value;
+	}
+};
+
+static void PackBlockHeader(const FTraceBlockInfo& block, uint8_t* pHeader)
+{
+	FHeaderPacker packer = { pHeader };
+	packer.Put(kExecTraceBlockMagic);
+	packer.Put(block.FrameNo);
+	packer.Put(block.NoEvents);
+	packer.Put(block.NoAccesses);
+	packer.Put(block.FirstCycle);
+	packer.Put(block.LastCycle);
+	packer.Put(block.ExecutedPages);
+	packer.Put(block.ReadPages);
+	packer.Put(block.WrittenPages);
+	packer.Put(block.IOReadPages);
+	packer.Put(block.IOWrittenPages);
+	for (const FTraceColumnInfo& column : block.Columns)
+	{
+		packer.Put(column.CompressedSize);
+		packer.Put(column.Size);
+	}
+}
+
+static bool UnpackBlockHeader(uint8_t* pHeader, FTraceBlockInfo& outBlock)
+{
+	FHeaderPacker packer = { pHeader };
+	if (packer.Get<uint32_t>() != kExecTraceBlockMagic)
+		return false;
+	outBlock.FrameNo = packer.Get<uint32_t>();
+	outBlock.NoEvents = packer.Get<uint32_t>();
+	outBlock.NoAccesses = packer.Get<uint32_t>();
+	outBlock.FirstCycle = packer.Get<uint64_t>();
+	outBlock.LastCycle = packer.Get<uint64_t>();
+	outBlock.ExecutedPages = packer.Get<uint64_t>();
+	outBlock.ReadPages = packer.Get<uint64_t>();
+	outBlock.WrittenPages = packer.Get<uint64_t>();
+	outBlock.IOReadPages = packer.Get<uint64_t>();
+	outBlock.IOWrittenPages = packer.Get<uint64_t>();
+	for (FTraceColumnInfo& column : outBlock.Columns)
+	{
+		column.CompressedSize = packer.Get<uint32_t>();
+		column.Size = packer.Get<uint32_t>();
+	}
+
+	// column sizes follow from the event counts, check them before anything is allocated from them
+	const uint64_t noEvents = outBlock.NoEvents;
+	const uint64_t noAccesses = outBlock.NoAccesses;
+	if (noEvents > FExecutionTraceWriter::kMaxBlockEvents || noAccesses > noEvents)
+		return false;
+	const FTraceColumnInfo* pColumns = outBlock.Columns;
+	return pColumns[(int)ETraceColumn::Type].Size == noEvents
+		&& pColumns[(int)ETraceColumn::Cycle].Size <= noEvents * 10	// varint of a 64 bit delta is at most 10 bytes
+		&& pColumns[(int)ETraceColumn::PC].Size == noEvents * 2
+		&& pColumns[(int)ETraceColumn::Address].Size == noAccesses * 2
+		&& pColumns[(int)ETraceColumn::Value].Size == noAccesses;
+}
+
+static uint64_t GetBlockDataSize(const FTraceBlockInfo& block)
+{
+	uint64_t size = 0;
+	for (const FTraceColumnInfo& column : block.Columns)
+		size += column.CompressedSize;
+	return size;
+}
+
+// Writer
+
+bool FExecutionTraceWriter::Open(const char* pFileName)
+{
+	Close();
+
+	FilePtr = fopen(pFileName, "wb");
+	if (FilePtr == nullptr)
+		return false;
+
+	const uint32_t header[2] = { kExecTraceFileMagic, kExecTraceFileVersion };
+	fwrite(header, sizeof(header), 1, FilePtr);
+
+	FileName = pFileName;
+	FrameNo = 0;
+	Cycle = 0;
+	LastEventCycle = 0;
+	NoEventsWritten = 0;
+	Block = FTraceBlockInfo();
+	BlockIndex.clear();
+	return true;
+}
+
+void FExecutionTraceWriter::Close()
+{
+	if (FilePtr == nullptr)
+		return;
+
+	FlushBlock();
+
+	// index of block headers
+	const uint64_t indexOffset = GetFilePos(FilePtr);
+	uint8_t entry[kIndexEntrySize];
+	for (const FTraceBlockInfo& block : BlockIndex)
+	{
+		memcpy(entry, &block.FileOffset, sizeof(uint64_t));
+		PackBlockHeader(block, entry + 8);
+		fwrite(entry, sizeof(entry), 1, FilePtr);
+	}
+
+	const uint32_t noBlocks = (uint32_t)BlockIndex.size();
+	fwrite(&indexOffset, sizeof(indexOffset), 1, FilePtr);
+	fwrite(&noBlocks, sizeof(noBlocks), 1, FilePtr);
+	fwrite(&kExecTraceIndexMagic, sizeof(kExecTraceIndexMagic), 1, FilePtr);
+	fclose(FilePtr);
+	FilePtr = nullptr;
+}
+
+void FExecutionTraceWriter::EndFrame()
+{
+	if (FilePtr == nullptr)
+		return;
+
+	FlushBlock();
+	FrameNo++;
+}
+
+void FExecutionTraceWriter::FlushBlock()
+{
+	if (Block.NoEvents == 0)
+		return;
+
+	Block.FrameNo = FrameNo;
+	Block.LastCycle = LastEventCycle;
+	Block.FileOffset = GetFilePos(FilePtr);
+
+	// compress the columns one after another after the header
+	std::vector<uint8_t>* columns[(int)ETraceColumn::Count] = { &TypeColumn, &CycleColumn, &PCColumn, &AddressColumn, &ValueColumn };
+	size_t totalBound = 0;
+	for (const std::vector<uint8_t>* pColumn : columns)
+		totalBound += compressBound((uLong)pColumn->size());
+	CompressBuffer.resize(totalBound);
+
+	size_t compressedPos = 0;
+	for (int columnNo = 0; columnNo < (int)ETraceColumn::Count; columnNo++)
+	{
+		const std::vector<uint8_t>& column = *columns[columnNo];
+		uLongf compressedSize = 0;
+		if (column.empty() == false)
+		{
+			compressedSize = (uLongf)(CompressBuffer.size() - compressedPos);
+			if (compress2(CompressBuffer.data() + compressedPos, &compressedSize, column.data(), (uLong)column.size(), Z_BEST_SPEED) != Z_OK)
+				compressedSize = 0;	// reader will reject the block
+		}
+		Block.Columns[columnNo].CompressedSize = (uint32_t)compressedSize;
+		Block.Columns[columnNo].Size = (uint32_t)column.size();
+		compressedPos += compressedSize;
+	}
+
+	uint8_t header[kBlockHeaderSize];
+	PackBlockHeader(Block, header);
+	fwrite(header, sizeof(header), 1, FilePtr);
+	fwrite(CompressBuffer.data(), 1, compressedPos, FilePtr);
+
+	BlockIndex.push_back(Block);
+	NoEventsWritten += Block.NoEvents;
+
+	Block = FTraceBlockInfo();
+	for (std::vector<uint8_t>* pColumn : columns)
+		pColumn->clear();
+}
+
+// Reader
+
+bool FExecutionTraceReader::Open(const char* pFileName)
+{
+	Close();
+
+	FilePtr = fopen(pFileName, "rb");
+	if (FilePtr == nullptr)
+		return false;
+
+	uint32_t header[2];
+	if (fread(header, sizeof(header), 1, FilePtr) != 1 || header[0] != kExecTraceFileMagic || header[1] != kExecTraceFileVersion)
+	{
+		Close();
+		return false;
+	}
+
+	bHasIndex = ReadIndexFromFooter();
+	if (bHasIndex == false)
+		ScanBlocks();
+	return true;
+}
+
+void FExecutionTraceReader::Close()
+{
+	if (FilePtr != nullptr)
+		fclose(FilePtr);
+	FilePtr = nullptr;
+	bHasIndex = false;
+	Blocks.clear();
+}
+
+bool FExecutionTraceReader::ReadIndexFromFooter()
+{
+	const uint64_t fileSize = GetFileSize(FilePtr);
+	if (fileSize < kFileHeaderSize + kFooterSize)
+		return false;
+
+	uint64_t indexOffset = 0;
+	uint32_t noBlocks = 0, magic = 0;
+	SeekTo(FilePtr, fileSize - kFooterSize);
+	if (fread(&indexOffset, sizeof(indexOffset), 1, FilePtr) != 1 || fread(&noBlocks, sizeof(noBlocks), 1, FilePtr) != 1 || fread(&magic, sizeof(magic), 1, FilePtr) != 1)
+		return false;
+	if (magic != kExecTraceIndexMagic || indexOffset + (uint64_t)noBlocks * kIndexEntrySize + kFooterSize != fileSize)
+		return false;
+
+	std::vector<uint8_t> indexData((size_t)noBlocks * kIndexEntrySize);
+	SeekTo(FilePtr, indexOffset);
+	if (indexData.empty() == false && fread(indexData.data(), indexData.size(), 1, FilePtr) != 1)
+		return false;
+
+	Blocks.resize(noBlocks);
+	for (uint32_t blockNo = 0; blockNo < noBlocks; blockNo++)
+	{
+		uint8_t* pEntry = indexData.data() + blockNo * kIndexEntrySize;
+		memcpy(&Blocks[blockNo].FileOffset, pEntry, sizeof(uint64_t));
+		if (UnpackBlockHeader(pEntry + 8, Blocks[blockNo]) == false)
+		{
+			Blocks.clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+// Walk the block headers for files without an index
+void FExecutionTraceReader::ScanBlocks()
+{
+	const uint64_t fileSize = GetFileSize(FilePtr);
+	uint64_t offset = kFileHeaderSize;
+	uint8_t header[kBlockHeaderSize];
+
+	Blocks.clear();
+	while (offset + kBlockHeaderSize <= fileSize)
+	{
+		FTraceBlockInfo block;
+		SeekTo(FilePtr, offset);
+		if (fread(header, sizeof(header), 1, FilePtr) != 1 || UnpackBlockHeader(header, block) == false)
+			break;
+
+		const uint64_t blockEnd = offset + kBlockHeaderSize + GetBlockDataSize(block);
+		if (blockEnd > fileSize)
+			break;	// torn write
+
+		block.FileOffset = offset;
+		Blocks.push_back(block);
+		offset = blockEnd;
+	}
+}
+
+uint64_t FExecutionTraceReader::GetNoEvents() const
+{
+	uint64_t noEvents = 0;
+	for (const FTraceBlockInfo& block : Blocks)
+		noEvents += block.NoEvents;
+	return noEvents;
+}
+
+bool FExecutionTraceReader::ReadColumn(const FTraceBlockInfo& block, ETraceColumn column, std::vector<uint8_t>& outData)
+{
+	const FTraceColumnInfo& columnInfo = block.Columns[(int)column];
+	outData.resize(columnInfo.Size);
+	if (columnInfo.Size == 0)
+		return true;
+
+	uint64_t columnOffset = block.FileOffset + kBlockHeaderSize;
+	for (int columnNo = 0; columnNo < (int)column; columnNo++)
+		columnOffset += block.Columns[columnNo].CompressedSize;
+
+	CompressedData.resize(columnInfo.CompressedSize);
+	if (SeekTo(FilePtr, columnOffset) == false || fread(CompressedData.data(), 1, CompressedData.size(), FilePtr) != CompressedData.size())
+		return false;
+
+	uLongf size = (uLongf)columnInfo.Size;
+	return uncompress(outData.data(), &size, CompressedData.data(), (uLong)CompressedData.size()) == Z_OK && size == columnInfo.Size;
+}
+
+bool FExecutionTraceReader::Query(const FTraceQuery& query, const std::function<bool(const FTraceEvent&)>& callback)
+{
+	NoBlocksRead = 0;
+	if (FilePtr == nullptr)
+		return false;
+
+	// pages the address range covers
+	uint64_t queryPages = 0;
+	for (int pageNo = query.FirstAddress >> 10; pageNo <= (query.LastAddress >> 10); pageNo++)
+		queryPages |= 1ull << pageNo;
+
+	const bool bWantAccesses = (query.TypeMask & ~kTraceMask_Instruction) != 0;
+
+	for (const FTraceBlockInfo& block : Blocks)
+	{
+		if (block.FrameNo < query.FirstFrame || block.FrameNo > query.LastFrame)
+			continue;
+		if (block.LastCycle < query.FirstCycle || block.FirstCycle > query.LastCycle)
+			continue;
+
+		uint64_t blockPages = 0;
+		if (query.TypeMask & kTraceMask_Instruction)
+			blockPages |= block.ExecutedPages;
+		if (query.TypeMask & kTraceMask_Read)
+			blockPages |= block.ReadPages;
+		if (query.TypeMask & kTraceMask_Write)
+			blockPages |= block.WrittenPages;
+		if (query.TypeMask & kTraceMask_IORead)
+			blockPages |= block.IOReadPages;
+		if (query.TypeMask & kTraceMask_IOWrite)
+			blockPages |= block.IOWrittenPages;
+		if ((blockPages & queryPages) == 0)
+			continue;
+
+		std::vector<uint8_t>& types = Columns[(int)ETraceColumn::Type];
+		std::vector<uint8_t>& cycles = Columns[(int)ETraceColumn::Cycle];
+		std::vector<uint8_t>& pcs = Columns[(int)ETraceColumn::PC];
+		std::vector<uint8_t>& addresses = Columns[(int)ETraceColumn::Address];
+		std::vector<uint8_t>& values = Columns[(int)ETraceColumn::Value];
+		if (ReadColumn(block, ETraceColumn::Type, types) == false || ReadColumn(block, ETraceColumn::Cycle, cycles) == false || ReadColumn(block, ETraceColumn::PC, pcs) == false)
+			return false;
+		if (bWantAccesses && (ReadColumn(block, ETraceColumn::Address, addresses) == false || ReadColumn(block, ETraceColumn::Value, values) == false))
+			return false;
+		if (types.size() != block.NoEvents || pcs.size() != block.NoEvents * 2 || (bWantAccesses && (addresses.size() != block.NoAccesses * 2 || values.size() != block.NoAccesses)))
+			return false;
+		NoBlocksRead++;
+
+		FTraceEvent event;
+		event.FrameNo = block.FrameNo;
+		event.Cycle = block.FirstCycle;
+		size_t cyclePos = 0;
+		uint32_t accessNo = 0;
+		for (uint32_t eventNo = 0; eventNo < block.NoEvents; eventNo++)
+		{
+			uint64_t delta = 0;
+			for (int shift = 0; cyclePos < cycles.size(); shift += 7)
+			{
+				const uint8_t byte = cycles[cyclePos++];
+				delta |= (uint64_t)(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					break;
+			}
+			event.Cycle += delta;
+			event.Type = (ETraceEventType)types[eventNo];
+			event.PC = pcs[eventNo * 2] | (pcs[eventNo * 2 + 1] << 8);
+			if (event.Type == ETraceEventType::Instruction)
+			{
+				event.Address = event.PC;
+				event.Value = 0;
+			}
+			else
+			{
+				if (bWantAccesses)
+				{
+					event.Address = addresses[accessNo * 2] | (addresses[accessNo * 2 + 1] << 8);
+					event.Value = values[accessNo];
+				}
+				accessNo++;
+			}
+
+			if ((query.TypeMask & (1 << (int)event.Type)) == 0)
+				continue;
+			if (event.Cycle < query.FirstCycle || event.Cycle > query.LastCycle)
+				continue;
+			if (event.Address < query.FirstAddress || event.Address > query.LastAddress)
+				continue;
+			if (callback(event) == false)
+				return true;
+		}
+	}
+
+	return true;
+}
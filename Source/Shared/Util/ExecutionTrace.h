@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Columnar execution trace
+// Executed instructions and memory/IO accesses are recorded as events, one block of events per frame.
+// Each block stores its events as separately zlib compressed columns - type, cycle delta, PC, address & value -
+// so a query only inflates the columns it needs. Block headers summarise which 1K pages were executed, read
+// and written, with IO ports summarised separately from memory, and an index of block headers is appended on close, so readers can find frames and cycle ranges
+// without reading the whole file. If the index is missing (crashed session) the block headers are scanned.
+//
+// Only depends on zlib so command line tools can use it.
+
+enum class ETraceEventType : uint8_t
+{
+	Instruction,
+	MemoryRead,
+	MemoryWrite,
+	IORead,
+	IOWrite,
+
+	Count
+};
+
+// event types as a bit mask
+static const uint32_t kTraceMask_Instruction = 1 << (int)ETraceEventType::Instruction;
+static const uint32_t kTraceMask_Read = 1 << (int)ETraceEventType::MemoryRead;
+static const uint32_t kTraceMask_Write = 1 << (int)ETraceEventType::MemoryWrite;
+static const uint32_t kTraceMask_IORead = 1 << (int)ETraceEventType::IORead;
+static const uint32_t kTraceMask_IOWrite = 1 << (int)ETraceEventType::IOWrite;
+static const uint32_t kTraceMask_All = (1 << (int)ETraceEventType::Count) - 1;
+
+struct FTraceEvent
+{
+	uint64_t		Cycle = 0;
+	uint32_t		FrameNo = 0;
+	uint16_t		PC = 0;			// instruction address, or address of the instruction making the access
+	uint16_t		Address = 0;	// same as PC for instructions
+	uint8_t			Value = 0;		// data read/written - 0 for instructions
+	ETraceEventType	Type = ETraceEventType::Instruction;
+};
+
+enum class ETraceColumn
+{
+	Type,
+	Cycle,		// varint delta from previous event
+	PC,
+	Address,	// accesses only
+	Value,		// accesses only
+
+	Count
+};
+
+struct FTraceColumnInfo
+{
+	uint32_t	CompressedSize = 0;
+	uint32_t	Size = 0;
+};
+
+struct FTraceBlockInfo
+{
+	uint32_t	FrameNo = 0;
+	uint32_t	NoEvents = 0;
+	uint32_t	NoAccesses = 0;	// number of events with address & value entries
+	uint64_t	FirstCycle = 0;
+	uint64_t	LastCycle = 0;
+	uint64_t	ExecutedPages = 0;	// bit per 1K page
+	uint64_t	ReadPages = 0;		// memory only
+	uint64_t	WrittenPages = 0;
+	uint64_t	IOReadPages = 0;	// bit per 1K of port addresses
+	uint64_t	IOWrittenPages = 0;
+	FTraceColumnInfo	Columns[(int)ETraceColumn::Count];
+
+	uint64_t	FileOffset = 0;	// offset of block header, not stored in the header
+};
+
+class FExecutionTraceWriter
+{
+public:
+	~FExecutionTraceWriter() { Close(); }
+
+	bool	Open(const char* pFileName);
+	void	Close();
+	bool	IsOpen() const { return FilePtr != nullptr; }
+
+	// called per machine cycle with the number of ticks it took
+	void	AddTicks(int noTicks) { Cycle += noTicks; }
+
+	void	AddInstruction(uint16_t pc)
+	{
+		AddEvent(ETraceEventType::Instruction, pc);
+		Block.ExecutedPages |= 1ull << (pc >> 10);
+		if (++Block.NoEvents >= kMaxBlockEvents)
+			FlushBlock();
+	}
+
+	void	AddAccess(ETraceEventType type, uint16_t pc, uint16_t address, uint8_t value)
+	{
+		AddEvent(type, pc);
+		AddressColumn.push_back((uint8_t)address);
+		AddressColumn.push_back((uint8_t)(address >> 8));
+		ValueColumn.push_back(value);
+		const uint64_t pageBit = 1ull << (address >> 10);
+		switch (type)
+		{
+		case ETraceEventType::MemoryRead:	Block.ReadPages |= pageBit; break;
+		case ETraceEventType::MemoryWrite:	Block.WrittenPages |= pageBit; break;
+		case ETraceEventType::IORead:		Block.IOReadPages |= pageBit; break;
+		case ETraceEventType::IOWrite:		Block.IOWrittenPages |= pageBit; break;
+		default: break;
+		}
+		Block.NoAccesses++;
+		if (++Block.NoEvents >= kMaxBlockEvents)
+			FlushBlock();
+	}
+
+	void	EndFrame();
+
+	uint32_t	GetFrameNo() const { return FrameNo; }
+	uint64_t	GetNoEventsWritten() const { return NoEventsWritten; }
+	const std::string&	GetFileName() const { return FileName; }
+
+	static const uint32_t	kMaxBlockEvents = 1 << 20;	// long frames are split
+private:
+	void	AddEvent(ETraceEventType type, uint16_t pc)
+	{
+		if (Block.NoEvents == 0)
+			Block.FirstCycle = LastEventCycle = Cycle;
+		TypeColumn.push_back((uint8_t)type);
+		uint64_t delta = Cycle - LastEventCycle;
+		while (delta >= 0x80)
+		{
+			CycleColumn.push_back((uint8_t)(delta | 0x80));
+			delta >>= 7;
+		}
+		CycleColumn.push_back((uint8_t)delta);
+		LastEventCycle = Cycle;
+		PCColumn.push_back((uint8_t)pc);
+		PCColumn.push_back((uint8_t)(pc >> 8));
+	}
+	void	FlushBlock();
+
+	FILE*			FilePtr = nullptr;
+	std::string		FileName;
+	uint32_t		FrameNo = 0;
+	uint64_t		Cycle = 0;
+	uint64_t		LastEventCycle = 0;
+	uint64_t		NoEventsWritten = 0;
+
+	FTraceBlockInfo			Block;
+	std::vector<uint8_t>	TypeColumn;
+	std::vector<uint8_t>	CycleColumn;
+	std::vector<uint8_t>	PCColumn;
+	std::vector<uint8_t>	AddressColumn;
+	std::vector<uint8_t>	ValueColumn;
+	std::vector<uint8_t>	CompressBuffer;
+	std::vector<FTraceBlockInfo>	BlockIndex;
+};
+
+// Range query - events must match all of the ranges
+struct FTraceQuery
+{
+	uint32_t	FirstFrame = 0;
+	uint32_t	LastFrame = UINT32_MAX;
+	uint64_t	FirstCycle = 0;
+	uint64_t	LastCycle = UINT64_MAX;
+	uint16_t	FirstAddress = 0;
+	uint16_t	LastAddress = 0xffff;
+	uint32_t	TypeMask = kTraceMask_All;
+};
+
+class FExecutionTraceReader
+{
+public:
+	~FExecutionTraceReader() { Close(); }
+
+	bool	Open(const char* pFileName);
+	void	Close();
+	bool	IsOpen() const { return FilePtr != nullptr; }
+	bool	HasIndex() const { return bHasIndex; }	// false if the blocks had to be scanned
+
+	const std::vector<FTraceBlockInfo>&	GetBlocks() const { return Blocks; }
+	uint32_t	GetNoFrames() const { return Blocks.empty() ? 0 : Blocks.back().FrameNo + 1; }
+	uint64_t	GetNoEvents() const;
+
+	// Calls the callback for each matching event in trace order, the callback returns false to stop.
+	// Only blocks whose frame, cycle & page summaries overlap the query are read.
+	// Returns false on a read error.
+	bool	Query(const FTraceQuery& query, const std::function<bool(const FTraceEvent&)>& callback);
+
+	int		GetNoBlocksRead() const { return NoBlocksRead; }	// by the last query
+
+private:
+	bool	ReadIndexFromFooter();
+	void	ScanBlocks();
+	bool	ReadColumn(const FTraceBlockInfo& block, ETraceColumn column, std::vector<uint8_t>& outData);
+
+	FILE*		FilePtr = nullptr;
+	bool		bHasIndex = false;
+	std::vector<FTraceBlockInfo>	Blocks;
+	int			NoBlocksRead = 0;
+
+	std::vector<uint8_t>	CompressedData;
+	std::vector<uint8_t>	Columns[(int)ETraceColumn::Count];
+};
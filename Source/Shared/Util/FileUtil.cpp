@@ -1,5 +1,6 @@
 #include "FileUtil.h"
 #include <string.h>
+#include <sys/stat.h>
 
 #undef UNICODE 
 #undef _UNICODE 
@@ -107,6 +108,29 @@ char *LoadTextFile(const char *pFilename)
 	return pTextData;
 }
 
+size_t GetFileSizeBytes(const char *pFilename)
+{
+	FILE* fp = fopen(pFilename, "rb");
+	if (fp == nullptr)
+		return 0;
+
+	fseek(fp, 0, SEEK_END);
+	const long byteCount = ftell(fp);
+	fclose(fp);
+	return byteCount < 0 ? 0 : (size_t)byteCount;
+}
+
+bool GetFileSizeAndModifiedTime(const char* pFilename, size_t& outSize, int64_t& outModifiedTime)
+{
+	struct stat fileStat;
+	if (stat(pFilename, &fileStat) != 0)
+		return false;
+
+	outSize = (size_t)fileStat.st_size;
+	outModifiedTime = (int64_t)fileStat.st_mtime;
+	return true;
+}
+
 void *LoadBinaryFile(const char *pFilename, size_t &byteCount)
 {
 	FILE* fp = fopen(pFilename, "rb");
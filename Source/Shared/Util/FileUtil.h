@@ -1,4 +1,5 @@
 #pragma once
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -26,6 +27,8 @@ bool EnumerateDirectory(const char *dir, FDirFileList &outDirListing);
 bool EnsureDirectoryExists(const char *pDirectory);	// Ensure a directory exists creating it if it doesn't, returns if it was created
 
 bool FileExists(const char *pFilename);
+size_t GetFileSizeBytes(const char *pFilename);	// returns 0 if the file can't be opened or its size can't be read
+bool GetFileSizeAndModifiedTime(const char* pFilename, size_t& outSize, int64_t& outModifiedTime);	// modified time is seconds since the epoch
 char *LoadTextFile(const char *pFilename);
 void *LoadBinaryFile(const char *pFilename, size_t &byteCount);
 bool SaveBinaryFile(const char *pFilename, const void * pData, size_t byteCount);
@@ -37,4 +40,27 @@ uint8_t ParseHexString8bit(const std::string& string);
 uint16_t ParseHexString16bit(const std::string& string);
 
 bool CreateDir(const char* osDir);
-char GetDirSep();
\ No newline at end of file
+char GetDirSep();
+
+// Read only memory mapped view of a whole file - pages are read in by the OS on first access
+// Open/Close are implemented per platform
+class FMappedFile
+{
+public:
+	FMappedFile() = default;
+	FMappedFile(const FMappedFile&) = delete;
+	FMappedFile& operator=(const FMappedFile&) = delete;
+	~FMappedFile() { Close(); }
+
+	bool			Open(const char* pFilename);	// fails for missing or empty files
+	void			Close();
+	bool			IsOpen() const { return pData != nullptr; }
+
+	const uint8_t*	GetData() const { return pData; }
+	size_t			GetSize() const { return Size; }
+
+private:
+	const uint8_t*	pData = nullptr;
+	size_t			Size = 0;
+	void*			pMappingHandle = nullptr;	// only used on Windows
+};
\ No newline at end of file
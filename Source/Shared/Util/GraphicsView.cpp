@@ -1,8 +1,11 @@
 #include "GraphicsView.h"
+#include "PixelBlit.h"
 #include "../CodeAnalyser/CodeAnalyser.h"
 #include <imgui.h>
 #include <ImGuiSupport/ImGuiTexture.h>
+#include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <vector>
 
 void DisplayTextureInspector(const ImTextureID texture, float width, float height, bool bScale = false, bool bMagnifier = true);
@@ -29,27 +32,93 @@ uint32_t GetColFromAttr(uint8_t colBits, bool bBright)
 		return outCol;
 }
 
-FGraphicsView::FGraphicsView(int width, int height)
+FGraphicsView::FGraphicsView(int width, int height, bool bSkipUnchangedRows)
 	: Width(width)
 	, Height(height)
 {
 	Width = width;
 	Height = height;
 	PixelBuffer = new uint32_t[width * height];
-	Texture = ImGui_CreateTextureRGBA((uint8_t*)PixelBuffer, width, height);
+	std::fill(PixelBuffer, PixelBuffer + (width * height), 0);
+	if (bSkipUnchangedRows)
+	{
+		UploadedPixels = new uint32_t[width * height];
+		std::fill(UploadedPixels, UploadedPixels + (width * height), 0);
+	}
+	Texture = ImGui_CreateTextureRGBA((uint8_t*)PixelBuffer, width, height, true);
 }
 
 FGraphicsView::~FGraphicsView()
 {
-	delete PixelBuffer;
+	delete[] PixelBuffer;
+	delete[] UploadedPixels;
 	if(Texture != nullptr)
 		ImGui_FreeTexture(Texture);
 }
 
 void FGraphicsView::Clear(const uint32_t col)
 {
-	for (int i = 0; i < Width * Height; i++)
-		PixelBuffer[i] = col;
+	// already clear
+	if (bCleared && col == ClearedCol)
+		return;
+
+	std::fill(PixelBuffer, PixelBuffer + (Width * Height), col);
+	MarkDirtyRows(0, Height);
+	bCleared = true;
+	ClearedCol = col;
+}
+
+void FGraphicsView::ClearRect(int xp, int yp, int width, int height, const uint32_t col)
+{
+	uint32_t* pBase = PixelBuffer + (xp + (yp * Width));
+	for (int y = 0; y < height; y++)
+	{
+		std::fill(pBase, pBase + width, col);
+		pBase += Width;
+	}
+	MarkDirtyRows(yp, height);
+}
+
+void FGraphicsView::CopyRect(const uint32_t* pSrc, int srcStride, int xp, int yp, int width, int height)
+{
+	uint32_t* pBase = PixelBuffer + (xp + (yp * Width));
+	for (int y = 0; y < height; y++)
+	{
+		memcpy(pBase, pSrc, width * sizeof(uint32_t));
+		pSrc += srcStride;
+		pBase += Width;
+	}
+	MarkDirtyRows(yp, height);
+}
+
+void FGraphicsView::SetPixel(int xp, int yp, uint32_t col)
+{
+	uint32_t& pixel = PixelBuffer[xp + (yp * Width)];
+	if (pixel == col)
+		return;
+
+	pixel = col;
+	MarkDirtyRows(yp, 1);
+}
+
+void FGraphicsView::MarkDirtyRows(int yp, int noRows)
+{
+	const int rowStart = std::max(yp, 0);
+	const int rowEnd = std::min(yp + noRows, Height);
+	if (rowStart >= rowEnd)
+		return;
+
+	if (DirtyRowStart >= DirtyRowEnd)
+	{
+		DirtyRowStart = rowStart;
+		DirtyRowEnd = rowEnd;
+	}
+	else
+	{
+		DirtyRowStart = std::min(DirtyRowStart, rowStart);
+		DirtyRowEnd = std::max(DirtyRowEnd, rowEnd);
+	}
+	bCleared = false;
 }
 
 void FGraphicsView::Draw(float xSize, float ySize, bool bScale, bool bMagnifier)
@@ -60,7 +129,36 @@ void FGraphicsView::Draw(float xSize, float ySize, bool bScale, bool bMagnifier)
 
 void FGraphicsView::UpdateTexture(void)
 {
-	ImGui_UpdateTextureRGBA(Texture, (uint8_t*)PixelBuffer);
+	if (DirtyRowStart >= DirtyRowEnd)
+		return;
+
+	if (UploadedPixels == nullptr)
+	{
+		if (Texture != nullptr)
+			ImGui_UpdateTextureRGBARows(Texture, (uint8_t*)PixelBuffer, Width, DirtyRowStart, DirtyRowEnd - DirtyRowStart);
+		DirtyRowStart = DirtyRowEnd = 0;
+		return;
+	}
+
+	// find the span of rows that differ from the texture
+	const size_t rowSize = Width * sizeof(uint32_t);
+	int firstChanged = -1;
+	int lastChanged = -1;
+	for (int y = DirtyRowStart; y < DirtyRowEnd; y++)
+	{
+		const size_t rowOffset = y * Width;
+		if (memcmp(PixelBuffer + rowOffset, UploadedPixels + rowOffset, rowSize) != 0)
+		{
+			memcpy(UploadedPixels + rowOffset, PixelBuffer + rowOffset, rowSize);
+			if (firstChanged == -1)
+				firstChanged = y;
+			lastChanged = y;
+		}
+	}
+	DirtyRowStart = DirtyRowEnd = 0;
+
+	if (firstChanged != -1 && Texture != nullptr)
+		ImGui_UpdateTextureRGBARows(Texture, (uint8_t*)PixelBuffer, Width, firstChanged, lastChanged + 1 - firstChanged);
 }
 
 void FGraphicsView::Draw(bool bMagnifier)
@@ -68,49 +166,31 @@ void FGraphicsView::Draw(bool bMagnifier)
 	Draw((float)Width, (float)Height, false, bMagnifier);
 }
 
+// black isn't drawn so images can be overlaid
+static const uint32_t kTransparentCol = 0xFF000000;
+
 void FGraphicsView::DrawCharLine(uint8_t charLine, int xp, int yp, uint32_t inkCol, uint32_t paperCol)
 {
-	uint32_t* pBase = PixelBuffer + (xp + (yp * Width));
-
-	for (int xpix = 0; xpix < 8; xpix++)
-	{
-		const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
-		const uint32_t col = bSet ? inkCol : paperCol;
-		if (col != 0xFF000000)
-			*(pBase + xpix) = col;
-	}
+	MarkDirtyRows(yp, 1);
+	BlitBitRowTransparent(PixelBuffer + (xp + (yp * Width)), charLine, inkCol, paperCol, kTransparentCol);
 }
 
 void FGraphicsView::DrawBitImage(const uint8_t* pSrc, int xp, int yp, int widthChars, int heightChars,  uint32_t inkCol, uint32_t paperCol)
 {
+	MarkDirtyRows(yp, heightChars * 8);
 	uint32_t* pBase = PixelBuffer + (xp + (yp * Width));
-
-	for (int y = 0; y < heightChars * 8; y++)
-	{
-		for (int x = 0; x < widthChars; x++)
-		{
-			const uint8_t charLine = *pSrc++;
-
-			for (int xpix = 0; xpix < 8; xpix++)
-			{
-				const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
-				const uint32_t col = bSet ? inkCol : paperCol;
-				if (col != 0xFF000000)
-					*(pBase + xpix + (x * 8)) = col;
-			}
-		}
-
-		pBase += Width;
-	}
+	BlitBitImageTransparent(pBase, Width, pSrc, widthChars, widthChars, heightChars * 8, inkCol, paperCol, kTransparentCol);
 }
 
 void FGraphicsView::DrawBitImageChars(const uint8_t* pSrc, int xp, int yp, int widthChars, int heightChars, uint32_t inkCol, uint32_t paperCol)
 {
+	MarkDirtyRows(yp, heightChars * 8);
 	for (int y = 0; y < heightChars; y++)
 	{
 		for (int x = 0; x < widthChars; x++)
 		{
-			DrawBitImage(pSrc, xp + (x * 8), yp + (y * 8), 1, 1, inkCol, paperCol);
+			uint32_t* pBase = PixelBuffer + (xp + (x * 8) + ((yp + (y * 8)) * Width));
+			BlitBitImageTransparent(pBase, Width, pSrc, 1, 1, 8, inkCol, paperCol, kTransparentCol);
 			pSrc+=8;
 		}
 	}
@@ -188,6 +268,48 @@ std::vector<FCharacterMap*>	g_CharacterMaps;
 
 void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& characterSet);
 
+// One bit per address read by a dynamic character set or a character map so other writes are ignored quickly
+static uint8_t g_CharacterSetWatchMap[(1 << 16) / 8];
+
+static int GetCharacterSetBytesPerChar(const FCharSetCreateParams& params)
+{
+	int bytesPerChar = params.MaskInfo == EMaskInfo::None ? 8 : 16;
+	if (params.ColourInfo == EColourInfo::InterleavedPre || params.ColourInfo == EColourInfo::InterleavedPost)
+		bytesPerChar++;
+	return bytesPerChar;
+}
+
+static void WatchCharacterSetRange(uint16_t address, int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		const uint16_t addr = (uint16_t)(address + i);
+		g_CharacterSetWatchMap[addr >> 3] |= 1 << (addr & 7);
+	}
+}
+
+static void RebuildCharacterSetWatchMap()
+{
+	memset(g_CharacterSetWatchMap, 0, sizeof(g_CharacterSetWatchMap));
+	for (const auto& it : g_CharacterSets)
+	{
+		if (it->Params.bDynamic == false)
+			continue;
+
+		WatchCharacterSetRange(it->Params.Address, GetCharacterSetBytesPerChar(it->Params) * 256);
+		if (it->Params.ColourInfo == EColourInfo::MemoryLUT)
+			WatchCharacterSetRange(it->Params.AttribsAddress, 256);
+	}
+
+	for (const auto& it : g_CharacterMaps)
+		WatchCharacterSetRange(it->Params.Address, std::min(it->Params.Width * it->Params.Height, 1 << 16));
+}
+
+// do [a, a + sizeA) and [b, b + sizeB) overlap in the 16 bit address space
+static bool AddressRangesOverlap(uint16_t a, int sizeA, uint16_t b, int sizeB)
+{
+	return (uint16_t)(b - a) < sizeA || (uint16_t)(a - b) < sizeB;
+}
 
 void InitCharacterSets()
 {
@@ -196,20 +318,82 @@ void InitCharacterSets()
 		delete it;
 
 	g_CharacterSets.clear();
+	RebuildCharacterSetWatchMap();
 
 	// char maps
 	for (auto& it : g_CharacterMaps)
 		delete it;
 
 	g_CharacterMaps.clear();
+	RebuildCharacterSetWatchMap();
+}
+
+static uint32_t g_CharacterMemoryGeneration = 0;
+
+uint32_t GetCharacterMemoryGeneration()
+{
+	return g_CharacterMemoryGeneration;
 }
 
+void OnCharacterSetMemoryWrite(uint16_t address)
+{
+	if ((g_CharacterSetWatchMap[address >> 3] & (1 << (address & 7))) == 0)
+		return;
+
+	g_CharacterMemoryGeneration++;
+
+	for (auto& it : g_CharacterSets)
+	{
+		if (it->Params.bDynamic == false)
+			continue;
+
+		const int bytesPerChar = GetCharacterSetBytesPerChar(it->Params);
+		const uint16_t dataOffset = address - it->Params.Address;
+		if (dataOffset < bytesPerChar * 256)
+			it->DirtyChars.set(dataOffset / bytesPerChar);
+
+		const uint16_t attribOffset = address - it->Params.AttribsAddress;
+		if (it->Params.ColourInfo == EColourInfo::MemoryLUT && attribOffset < 256)
+			it->DirtyChars.set(attribOffset);
+	}
+}
+
+void InvalidateCharacterSetMemory(uint16_t address, int size)
+{
+	g_CharacterMemoryGeneration++;
+	for (auto& it : g_CharacterSets)
+	{
+		if (it->Params.bDynamic == false)
+			continue;
+
+		const int bytesPerChar = GetCharacterSetBytesPerChar(it->Params);
+		for (int charNo = 0; charNo < 256; charNo++)
+		{
+			if (AddressRangesOverlap(it->Params.Address + (charNo * bytesPerChar), bytesPerChar, address, size) ||
+				(it->Params.ColourInfo == EColourInfo::MemoryLUT && AddressRangesOverlap(it->Params.AttribsAddress + charNo, 1, address, size)))
+				it->DirtyChars.set(charNo);
+		}
+	}
+}
+
+static void DrawCharacterSetChar(FCodeAnalysisState& state, FCharacterSet& characterSet, int charNo);
+
 void UpdateCharacterSets(FCodeAnalysisState& state)
 {
 	for (auto& it : g_CharacterSets)
 	{
-		if(it->Params.bDynamic)
-			UpdateCharacterSetImage(state, *it);
+		// only redraw characters that have been written to
+		if (it->Params.bDynamic && it->DirtyChars.any())
+		{
+			for (int charNo = 0; charNo < 256; charNo++)
+			{
+				if (it->DirtyChars[charNo])
+					DrawCharacterSetChar(state, *it, charNo);
+			}
+			it->DirtyChars.reset();
+			it->Image->UpdateTexture();
+			it->Generation++;
+		}
 	}
 }
 
@@ -221,6 +405,7 @@ int GetNoCharacterSets()
 void DeleteCharacterSet(int index)
 {
 	g_CharacterSets.erase(g_CharacterSets.begin() + index);
+	RebuildCharacterSetWatchMap();
 }
 
 FCharacterSet* GetCharacterSetFromIndex(int index)
@@ -242,58 +427,62 @@ FCharacterSet* GetCharacterSetFromAddress(uint16_t address)
 	return nullptr;
 }
 
-void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& characterSet)
+static void DrawCharacterSetChar(FCodeAnalysisState& state, FCharacterSet& characterSet, int charNo)
 {
-	uint16_t addr = characterSet.Params.Address;
+	uint16_t addr = characterSet.Params.Address + (charNo * GetCharacterSetBytesPerChar(characterSet.Params));
+	const int xp = (charNo & 15) * 8;
+	const int yp = (charNo >> 4) * 8;
+	uint32_t inkCol = 0xffffffff;
+	uint32_t paperCol = 0;
+	uint8_t colAttr = 0xff;
+	uint8_t charPix[8];
+	uint8_t charMask[8];
+
+	if (characterSet.Params.ColourInfo == EColourInfo::InterleavedPre)
+		colAttr = state.CPUInterface->ReadByte(addr++);
+
+	for (int i = 0; i < 8; i++)
+	{
+		if (characterSet.Params.MaskInfo == EMaskInfo::InterleavedBytesMP)
+			charMask[i] = state.CPUInterface->ReadByte(addr++);
+		charPix[i] = state.CPUInterface->ReadByte(addr++);
+		if (characterSet.Params.MaskInfo == EMaskInfo::InterleavedBytesPM)
+			charMask[i] = state.CPUInterface->ReadByte(addr++);
+	}
 
-	characterSet.Image->Clear(0);	// clear first
+	// Get colour from colour info
+	switch (characterSet.Params.ColourInfo)
+	{
+	case EColourInfo::MemoryLUT:
+		colAttr = state.CPUInterface->ReadByte(characterSet.Params.AttribsAddress + charNo);
+		break;
+	case EColourInfo::InterleavedPost:
+		colAttr = state.CPUInterface->ReadByte(addr++);
+		break;
+	}
 
-	for (int charNo = 0; charNo < 256; charNo++)
+	if (colAttr != 0xff)
 	{
-		const uint8_t* pCharData = state.CPUInterface->GetMemPtr(addr);
-		const int xp = (charNo & 15) * 8;
-		const int yp = (charNo >> 4) * 8;
-		uint32_t inkCol = 0xffffffff;
-		uint32_t paperCol = 0;
-		uint8_t colAttr = 0xff;
-		uint8_t charPix[8];
-		uint8_t charMask[8];
-
-		if (characterSet.Params.ColourInfo == EColourInfo::InterleavedPre)
-			colAttr = state.CPUInterface->ReadByte(addr++);
-
-		for (int i = 0; i < 8; i++)
-		{
-			if (characterSet.Params.MaskInfo == EMaskInfo::InterleavedBytesMP)
-				charMask[i] = state.CPUInterface->ReadByte(addr++);
-			charPix[i] = state.CPUInterface->ReadByte(addr++);
-			if (characterSet.Params.MaskInfo == EMaskInfo::InterleavedBytesPM)
-				charMask[i] = state.CPUInterface->ReadByte(addr++);
-		}
+		// get ink & paper
+		const bool bBright = !!(colAttr & (1 << 6));
+		inkCol = GetColFromAttr(colAttr & 7, bBright);
+		paperCol = GetColFromAttr((colAttr >> 3) & 7, bBright);
+	}
 
-		// Get colour from colour info
-		switch (characterSet.Params.ColourInfo)
-		{
-		case EColourInfo::MemoryLUT:
-			colAttr = state.CPUInterface->ReadByte(characterSet.Params.AttribsAddress + charNo);
-			break;
-		case EColourInfo::InterleavedPost:
-			colAttr = state.CPUInterface->ReadByte(addr++);
-			break;
-		}
+	characterSet.Image->ClearRect(xp, yp, 8, 8, 0);
+	characterSet.Image->DrawBitImage(charPix, xp, yp, 1, 1, inkCol, paperCol);
+}
 
-		if (colAttr != 0xff)
-		{
-			// get ink & paper
-			const bool bBright = !!(colAttr & (1 << 6));
-			inkCol = GetColFromAttr(colAttr & 7, bBright);
-			paperCol = GetColFromAttr((colAttr >> 3) & 7, bBright);
-		}
+void UpdateCharacterSetImage(FCodeAnalysisState& state, FCharacterSet& characterSet)
+{
+	characterSet.Image->Clear(0);	// clear first
 
-		characterSet.Image->DrawBitImage(charPix, xp, yp, 1, 1, inkCol, paperCol);
-	}
+	for (int charNo = 0; charNo < 256; charNo++)
+		DrawCharacterSetChar(state, characterSet, charNo);
 
+	characterSet.DirtyChars.reset();
 	characterSet.Image->UpdateTexture();
+	characterSet.Generation++;
 }
 
 void UpdateCharacterSet(FCodeAnalysisState& state, FCharacterSet& characterSet, const FCharSetCreateParams& params)
@@ -305,6 +494,7 @@ void UpdateCharacterSet(FCodeAnalysisState& state, FCharacterSet& characterSet,
 	characterSet.Params.bDynamic = params.bDynamic;
 
 	UpdateCharacterSetImage(state, characterSet);
+	RebuildCharacterSetWatchMap();
 }
 
 bool CreateCharacterSetAt(FCodeAnalysisState& state, const FCharSetCreateParams& params)
@@ -317,6 +507,7 @@ bool CreateCharacterSetAt(FCodeAnalysisState& state, const FCharSetCreateParams&
 	UpdateCharacterSet(state, *pNewCharSet, params);
 
 	g_CharacterSets.push_back(pNewCharSet);
+	RebuildCharacterSetWatchMap();
 	return true;
 }
 
@@ -333,6 +524,7 @@ int GetNoCharacterMaps()
 void DeleteCharacterMap(int index)
 {
 	g_CharacterMaps.erase(g_CharacterMaps.begin() + index);
+	RebuildCharacterSetWatchMap();
 }
 
 FCharacterMap* GetCharacterMapFromIndex(int index)
@@ -367,5 +559,12 @@ bool CreateCharacterMap(FCodeAnalysisState& state, const FCharMapCreateParams& p
 	pNewCharMap->Params = params;
 
 	g_CharacterMaps.push_back(pNewCharMap);
+	RebuildCharacterSetWatchMap();
 	return true;
+}
+
+void UpdateCharacterMap(FCharacterMap& characterMap, const FCharMapCreateParams& params)
+{
+	characterMap.Params = params;
+	RebuildCharacterSetWatchMap();
 }
\ No newline at end of file
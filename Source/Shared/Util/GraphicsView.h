@@ -1,5 +1,6 @@
 #pragma once
 
+#include <bitset>
 #include <cstdint>
 
 struct FCodeAnalysisState;
@@ -8,11 +9,16 @@ struct FCodeAnalysisState;
 class FGraphicsView
 {
 public:
-	FGraphicsView(int width, int height);
+	// bSkipUnchangedRows keeps a copy of the last upload so rows redrawn with the same pixels aren't sent again.
+	// Worth it for large views that are redrawn every frame, at the cost of twice the memory.
+	FGraphicsView(int width, int height, bool bSkipUnchangedRows = false);
 	~FGraphicsView();
 
 	void Clear(const uint32_t col = 0xff000000);
-	void UpdateTexture(void);
+	void ClearRect(int xp, int yp, int width, int height, const uint32_t col = 0xff000000);
+	void CopyRect(const uint32_t* pSrc, int srcStride, int xp, int yp, int width, int height);	// srcStride in pixels
+	void SetPixel(int xp, int yp, uint32_t col);	// only marks the row dirty if the pixel changes
+	void UpdateTexture(void);	// uploads rows that have changed since the last upload
 	void Draw(float xSize, float ySize, bool bScale = false, bool bMagnifier = true);
 	void Draw(bool bMagnifier = true);
 
@@ -27,8 +33,10 @@ public:
 	// image is arranged chat by char
 	void DrawBitImageChars(const uint8_t* pSrc, int xp, int yp, int widthChars, int heightChars, uint32_t inkCol, uint32_t paperCol);
 
-	uint32_t* GetPixelBuffer() { return PixelBuffer; }
+	// writing to the pixel buffer directly marks it all as dirty, use MarkDirtyRows to be more specific
+	uint32_t* GetPixelBuffer() { MarkDirtyRows(0, Height); return PixelBuffer; }
 	const uint32_t* GetPixelBuffer() const { return PixelBuffer; }
+	void MarkDirtyRows(int yp, int noRows);
 
 	int GetWidth() const { return Width; }
 	int GetHeight() const { return Height; }
@@ -38,6 +46,14 @@ private:
 	int				Height = 0;
 	uint32_t*		PixelBuffer = nullptr;
 	void*			Texture = nullptr;
+
+	// Dirty tracking - only rows in the dirty range are uploaded.
+	// With UploadedPixels they're also compared with what was last uploaded & only changed rows are sent.
+	uint32_t*		UploadedPixels = nullptr;
+	int				DirtyRowStart = 0;
+	int				DirtyRowEnd = 0;	// exclusive
+	bool			bCleared = false;	// nothing drawn since last Clear
+	uint32_t		ClearedCol = 0;
 };
 
 // Character set stuff
@@ -92,6 +108,8 @@ struct FCharacterSet
 	FCharSetCreateParams	Params;
 
 	FGraphicsView*	Image = nullptr;	
+	std::bitset<256>	DirtyChars;	// characters whose memory has been written since they were drawn
+	uint32_t		Generation = 0;	// incremented whenever the image is redrawn
 };
 
 // Character Maps
@@ -115,6 +133,12 @@ uint32_t GetColFromAttr(uint8_t colBits, bool bBright);
 // Character sets
 void InitCharacterSets();
 void UpdateCharacterSets(FCodeAnalysisState& state);
+// Dynamic character sets only redraw characters whose memory has changed.
+// Call for every memory write, and invalidate memory that changes by other means e.g. snapshot loads & paging.
+void OnCharacterSetMemoryWrite(uint16_t address);
+void InvalidateCharacterSetMemory(uint16_t address, int size);
+// changes when character set or map memory is written or invalidated, so views of it can tell if they need redrawing without a frame passing
+uint32_t GetCharacterMemoryGeneration();
 int GetNoCharacterSets();
 void DeleteCharacterSet(int index);
 FCharacterSet* GetCharacterSetFromIndex(int index);
@@ -128,4 +152,5 @@ void DeleteCharacterMap(int index);
 FCharacterMap* GetCharacterMapFromIndex(int index);
 FCharacterMap* GetCharacterMapFromAddress(uint16_t address);
 bool CreateCharacterMap(FCodeAnalysisState& state, const FCharMapCreateParams& params);
+void UpdateCharacterMap(FCharacterMap& characterMap, const FCharMapCreateParams& params);
 
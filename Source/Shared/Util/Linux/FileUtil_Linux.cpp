@@ -2,6 +2,9 @@
 
 #include <string.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 bool CreateDir(const char* osDir)
 {
@@ -20,3 +23,36 @@ char GetDirSep()
 {
 	return '/';
 }
+
+bool FMappedFile::Open(const char* pFilename)
+{
+	Close();
+
+	const int fd = open(pFilename, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat st = { 0 };
+	if (fstat(fd, &st) == -1 || st.st_size == 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	void* pMapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);	// the mapping keeps the file open
+	if (pMapped == MAP_FAILED)
+		return false;
+
+	pData = (const uint8_t*)pMapped;
+	Size = (size_t)st.st_size;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (pData != nullptr)
+		munmap((void*)pData, Size);
+	pData = nullptr;
+	Size = 0;
+}
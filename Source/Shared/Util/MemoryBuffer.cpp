@@ -1,51 +1,157 @@
 #include "MemoryBuffer.h"
 #include <stdlib.h>
 #include <string.h>
-#include <cassert>
 #include <cstdint>
 
 #include "FileUtil.h"
 
-void FMemoryBuffer::Init(size_t initialSize)
+static const size_t kMinAllocationSize = 64;
+
+FMemoryBuffer& FMemoryBuffer::operator=(FMemoryBuffer&& other) noexcept
 {
-	if (BasePtr != nullptr)	// free old buffer
+	if (this == &other)
+		return *this;
+
+	Free();
+	AllocationSize = other.AllocationSize;
+	CurrentSize = other.CurrentSize;
+	ReadPosition = other.ReadPosition;
+	BasePtr = other.BasePtr;
+	pMappedFile = other.pMappedFile;
+	bReadOnly = other.bReadOnly;
+	bReadError = other.bReadError;
+
+	other.AllocationSize = 0;
+	other.CurrentSize = 0;
+	other.ReadPosition = 0;
+	other.BasePtr = nullptr;
+	other.pMappedFile = nullptr;
+	other.bReadOnly = false;
+	other.bReadError = false;
+	return *this;
+}
+
+void FMemoryBuffer::Free()
+{
+	if (pMappedFile != nullptr)
+		delete pMappedFile;
+	else if (BasePtr != nullptr && bReadOnly == false)
 		free(BasePtr);
 
-	BasePtr = malloc(initialSize);
-	AllocationSize = initialSize;
+	pMappedFile = nullptr;
+	BasePtr = nullptr;
+	AllocationSize = 0;
 	CurrentSize = 0;
+	ReadPosition = 0;
+	bReadOnly = false;
+	bReadError = false;
+}
+
+void FMemoryBuffer::Init(size_t initialSize)
+{
+	Free();
+
+	if (initialSize < kMinAllocationSize)
+		initialSize = kMinAllocationSize;
+	BasePtr = (uint8_t*)malloc(initialSize);
+	AllocationSize = initialSize;
 }
 
-void FMemoryBuffer::Init(void *pData, size_t dataSize)
+void FMemoryBuffer::Init(const void *pData, size_t dataSize)
 {
 	Init(dataSize);
 	CurrentSize = dataSize;
 	memcpy(BasePtr,pData, dataSize);
 }
 
-void	FMemoryBuffer::WriteBytes(const void* pData, size_t noBytes)
+void FMemoryBuffer::InitView(const void* pData, size_t dataSize)
 {
-	assert(AllocationSize != 0);
+	Free();
 
-	if (CurrentSize + noBytes > AllocationSize)
+	BasePtr = (uint8_t*)pData;
+	AllocationSize = dataSize;
+	CurrentSize = dataSize;
+	bReadOnly = true;
+}
+
+void FMemoryBuffer::Reserve(size_t size)
+{
+	if (size <= AllocationSize)
+		return;
+
+	if (bReadOnly)	// writing to a view - take a copy first
 	{
-		AllocationSize = AllocationSize * 2;	// double allocation
-		BasePtr = realloc(BasePtr, AllocationSize);
+		uint8_t* pNewData = (uint8_t*)malloc(size);
+		memcpy(pNewData, BasePtr, CurrentSize);
+		delete pMappedFile;
+		pMappedFile = nullptr;
+		BasePtr = pNewData;
+		bReadOnly = false;
 	}
+	else
+	{
+		BasePtr = (uint8_t*)realloc(BasePtr, size);
+	}
+	AllocationSize = size;
+}
+
+void FMemoryBuffer::Grow(size_t noBytes)
+{
+	size_t newSize = AllocationSize < kMinAllocationSize ? kMinAllocationSize : AllocationSize;
+	while (CurrentSize + noBytes > newSize)
+		newSize = newSize * 2;	// double allocation
+	Reserve(newSize);
+}
 
-	memcpy((uint8_t*)BasePtr + CurrentSize, pData, noBytes);
+void	FMemoryBuffer::WriteBytes(const void* pData, size_t noBytes)
+{
+	if (CurrentSize + noBytes > AllocationSize)
+		Grow(noBytes);
+
+	if (noBytes == 0)
+		return;
+	memcpy(BasePtr + CurrentSize, pData, noBytes);
 	CurrentSize += noBytes;
 }
 
 void FMemoryBuffer::ReadBytes(void* Dest, size_t noBytes)
 {
-	assert(ReadPosition + noBytes <= CurrentSize);
-	memcpy(Dest, (uint8_t*)BasePtr + ReadPosition, noBytes);
+	const void* pSrc = ReadBytesView(noBytes);
+	if (pSrc == nullptr)	// don't read past the end - caller checks HasReadError()
+	{
+		memset(Dest, 0, noBytes);
+		return;
+	}
+	if (noBytes != 0)
+		memcpy(Dest, pSrc, noBytes);
+}
+
+const void* FMemoryBuffer::ReadBytesView(size_t noBytes)
+{
+	if (noBytes > CurrentSize - ReadPosition)
+	{
+		ReadPosition = CurrentSize;	// stop any further reads succeeding
+		bReadError = true;
+		return nullptr;
+	}
+
+	const void* pData = BasePtr + ReadPosition;
 	ReadPosition += noBytes;
+	return pData;
 }
 
 bool FMemoryBuffer::LoadFromFile(const char* pFileName)
 {
+	FMappedFile* pFile = new FMappedFile;
+	if (pFile->Open(pFileName))
+	{
+		InitView(pFile->GetData(), pFile->GetSize());
+		pMappedFile = pFile;
+		return true;
+	}
+	delete pFile;
+
+	// mapping fails for empty files so fall back to reading
 	size_t fileSize;
 	void* pData = LoadBinaryFile(pFileName, fileSize);
 	if (pData == nullptr)
@@ -59,4 +165,4 @@ bool FMemoryBuffer::LoadFromFile(const char* pFileName)
 bool FMemoryBuffer::SaveToFile(const char* pFileName) const
 {
 	return SaveBinaryFile(pFileName, BasePtr, CurrentSize);
-}
\ No newline at end of file
+}
@@ -1,42 +1,101 @@
 #pragma once 
 
 #include <string>
+#include <string_view>
+#include <cstdint>
+#include <cstring>
 
+class FMappedFile;
+
+// Byte buffer used for serialisation
+// Writes grow the buffer geometrically. Reads are bounds checked - reading past the end returns zeros and sets the read error flag.
+// A buffer can also be a read only view of memory it doesn't own, or of a memory mapped file, so reading doesn't need a copy.
 class FMemoryBuffer
 {
 public:
+	FMemoryBuffer() = default;
+	FMemoryBuffer(const FMemoryBuffer&) = delete;
+	FMemoryBuffer& operator=(const FMemoryBuffer&) = delete;
+	FMemoryBuffer(FMemoryBuffer&& other) noexcept { *this = std::move(other); }
+	FMemoryBuffer& operator=(FMemoryBuffer&& other) noexcept;
+	~FMemoryBuffer() { Free(); }
+
 	void	Init(size_t initialSize = 1024);
-	void	Init(void* pData, size_t dataSize);
+	void	Init(const void* pData, size_t dataSize);	// copy of data
+	void	InitView(const void* pData, size_t dataSize);	// read only, data must stay valid while the buffer is used
+	void	Reserve(size_t size);
 	void	WriteBytes(const void* pData, size_t noBytes);
 	void	ReadBytes(void* Dest, size_t noBytes);
+	const void*	ReadBytesView(size_t noBytes);	// pointer into the buffer, nullptr if there isn't enough data
 
 	template <class T>
-	void	Write(T item) { WriteBytes(&item, sizeof(T)); }
-	void	WriteString(const std::string& str)
+	void	Write(T item)
 	{
-		Write<uint16_t>((uint16_t)str.size());
-		WriteBytes(str.c_str(), str.size());
+		if (CurrentSize + sizeof(T) > AllocationSize)
+			Grow(sizeof(T));
+		memcpy(BasePtr + CurrentSize, &item, sizeof(T));
+		CurrentSize += sizeof(T);
+	}
+	// strings have a 16 bit length, strings of 64K or more are written as an 0xffff marker followed by a 32 bit length
+	// so existing data doesn't change format
+	void	WriteString(std::string_view str)
+	{
+		if (str.size() < kLongStringMarker)
+		{
+			Write<uint16_t>((uint16_t)str.size());
+		}
+		else
+		{
+			Write<uint16_t>(kLongStringMarker);
+			Write<uint32_t>((uint32_t)str.size());
+		}
+		WriteBytes(str.data(), str.size());
 	}
 
 	template <class T>
-	void	Read(T& item) { ReadBytes(&item, sizeof(T)); }
+	void	Read(T& item)
+	{
+		if (ReadPosition + sizeof(T) > CurrentSize)
+		{
+			ReadBytes(&item, sizeof(T));	// sets read error
+			return;
+		}
+		memcpy(&item, BasePtr + ReadPosition, sizeof(T));
+		ReadPosition += sizeof(T);
+	}
 	template <class T>
-	T	Read() { T item;  ReadBytes(&item, sizeof(T)); return item; }
+	T	Read() { T item;  Read(item); return item; }
 
-	std::string	ReadString(void)
+	std::string_view	ReadStringView(void)	// only valid while the buffer data is
 	{
-		std::string str;
-		uint16_t stringSize = Read<uint16_t>();
-		str.resize(stringSize);
-		ReadBytes(&str[0], stringSize);
-		return str;
+		const uint16_t shortSize = Read<uint16_t>();
+		const uint32_t stringSize = shortSize == kLongStringMarker ? Read<uint32_t>() : shortSize;
+		const char* pString = (const char*)ReadBytesView(stringSize);
+		return pString != nullptr ? std::string_view(pString, stringSize) : std::string_view();
 	}
+	std::string	ReadString(void) { return std::string(ReadStringView()); }
 
-	bool LoadFromFile(const char* pFileName);
+	bool LoadFromFile(const char* pFileName);	// maps the file where possible rather than reading it
 	bool SaveToFile(const char* pFileName) const;
+
+	const void*	GetData() const { return BasePtr; }
+	size_t		GetSize() const { return CurrentSize; }
+	size_t		GetReadPosition() const { return ReadPosition; }
+	size_t		GetRemainingSize() const { return CurrentSize - ReadPosition; }
+	bool		IsReadOnly() const { return bReadOnly; }
+	bool		HasReadError() const { return bReadError; }	// set if a read went past the end of the buffer
+	void		SetReadError() { bReadError = true; }	// for readers that find the data is corrupt
 private:
+	static constexpr uint16_t kLongStringMarker = 0xffff;
+
+	void	Grow(size_t noBytes);
+	void	Free();
+
 	size_t	AllocationSize = 0;
 	size_t	CurrentSize = 0;
 	size_t	ReadPosition = 0;
-	void* BasePtr = nullptr;
-};
\ No newline at end of file
+	uint8_t*	BasePtr = nullptr;
+	FMappedFile*	pMappedFile = nullptr;	// set when the buffer is a view of a mapped file
+	bool	bReadOnly = false;	// data isn't owned by the buffer
+	bool	bReadError = false;
+};
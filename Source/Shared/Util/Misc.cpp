@@ -7,8 +7,9 @@
 static ENumberDisplayMode g_NumDispMode = ENumberDisplayMode::HexAitch;
 static const int kTextLength = 8;
 static const int kNoStrings = 8;
-int g_StringIndex = 0;
-static char g_TextWorkspace[kNoStrings][kTextLength];
+// per thread so NumStr can be used by exporters formatting on worker threads
+static thread_local int g_StringIndex = 0;
+static thread_local char g_TextWorkspace[kNoStrings][kTextLength];
 
 char* GetStrPtr()
 {
@@ -105,4 +106,17 @@ void Tokenize(const std::string& stringToSplit, const char token, std::vector<st
 	{
 		splitStrings.push_back(line);
 	}
-}
\ No newline at end of file
+}
+
+uint32_t CalculateChecksum(const void* pData, size_t size)
+{
+	// FNV-1a
+	const uint8_t* pBytes = (const uint8_t*)pData;
+	uint32_t hash = 2166136261u;
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= pBytes[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
@@ -19,3 +19,4 @@ const char* NumStr(uint8_t);
 const char* NumStr(uint16_t num, ENumberDisplayMode numDispMode);
 const char* NumStr(uint16_t);
 void Tokenize(const std::string& stringToSplit, const char token, std::vector<std::string>& splitStrings);
+uint32_t CalculateChecksum(const void* pData, size_t size);	// FNV-1a
@@ -0,0 +1,223 @@
+#include "PixelBlit.h"
+
+#if !defined(BLIT_FORCE_SCALAR) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define BLIT_SSE2
+#include <emmintrin.h>
+#elif !defined(BLIT_FORCE_SCALAR) && (defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64))
+#define BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+// pixel masks for each byte value - all ones where the bit is set
+struct FBitMaskLUT
+{
+	constexpr FBitMaskLUT() : Masks()
+	{
+		for (int bits = 0; bits < 256; bits++)
+		{
+			for (int xpix = 0; xpix < 8; xpix++)
+				Masks[bits][xpix] = (bits & (0x80 >> xpix)) ? 0xffffffff : 0;
+		}
+	}
+
+	alignas(16) uint32_t Masks[256][8];
+};
+
+static constexpr FBitMaskLUT g_BitMaskLUT;
+
+// Colours are set up once per call so the row functions only do the lookup & blend
+// The write masks select which of ink & paper get written for transparency.
+#if defined(BLIT_SSE2)
+
+struct FBitBlender
+{
+	FBitBlender(uint32_t inkCol, uint32_t paperCol, uint32_t inkWrite = 0xffffffff, uint32_t paperWrite = 0xffffffff)
+		: Ink(_mm_set1_epi32((int)inkCol))
+		, Paper(_mm_set1_epi32((int)paperCol))
+		, InkWrite(_mm_set1_epi32((int)inkWrite))
+		, PaperWrite(_mm_set1_epi32((int)paperWrite))
+	{
+	}
+
+	static __m128i Select(__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); }
+
+	void Row(uint32_t* pDest, uint8_t bits) const
+	{
+		const __m128i* pMask = (const __m128i*)g_BitMaskLUT.Masks[bits];
+		_mm_storeu_si128((__m128i*)pDest, Select(_mm_load_si128(pMask), Ink, Paper));
+		_mm_storeu_si128((__m128i*)pDest + 1, Select(_mm_load_si128(pMask + 1), Ink, Paper));
+	}
+
+	void RowTransparent(uint32_t* pDest, uint8_t bits) const
+	{
+		const __m128i* pMask = (const __m128i*)g_BitMaskLUT.Masks[bits];
+		for (int half = 0; half < 2; half++)
+		{
+			const __m128i mask = _mm_load_si128(pMask + half);
+			const __m128i write = Select(mask, InkWrite, PaperWrite);
+			const __m128i dest = _mm_loadu_si128((const __m128i*)pDest + half);
+			_mm_storeu_si128((__m128i*)pDest + half, Select(write, Select(mask, Ink, Paper), dest));
+		}
+	}
+
+	__m128i	Ink, Paper;
+	__m128i	InkWrite, PaperWrite;
+};
+
+const char* GetBlitImplementationName() { return "SSE2"; }
+
+#elif defined(BLIT_NEON)
+
+struct FBitBlender
+{
+	FBitBlender(uint32_t inkCol, uint32_t paperCol, uint32_t inkWrite = 0xffffffff, uint32_t paperWrite = 0xffffffff)
+		: Ink(vdupq_n_u32(inkCol))
+		, Paper(vdupq_n_u32(paperCol))
+		, InkWrite(vdupq_n_u32(inkWrite))
+		, PaperWrite(vdupq_n_u32(paperWrite))
+	{
+	}
+
+	void Row(uint32_t* pDest, uint8_t bits) const
+	{
+		const uint32_t* pMask = g_BitMaskLUT.Masks[bits];
+		vst1q_u32(pDest, vbslq_u32(vld1q_u32(pMask), Ink, Paper));
+		vst1q_u32(pDest + 4, vbslq_u32(vld1q_u32(pMask + 4), Ink, Paper));
+	}
+
+	void RowTransparent(uint32_t* pDest, uint8_t bits) const
+	{
+		const uint32_t* pMask = g_BitMaskLUT.Masks[bits];
+		for (int half = 0; half < 8; half += 4)
+		{
+			const uint32x4_t mask = vld1q_u32(pMask + half);
+			const uint32x4_t write = vbslq_u32(mask, InkWrite, PaperWrite);
+			vst1q_u32(pDest + half, vbslq_u32(write, vbslq_u32(mask, Ink, Paper), vld1q_u32(pDest + half)));
+		}
+	}
+
+	uint32x4_t	Ink, Paper;
+	uint32x4_t	InkWrite, PaperWrite;
+};
+
+const char* GetBlitImplementationName() { return "NEON"; }
+
+#else
+
+struct FBitBlender
+{
+	FBitBlender(uint32_t inkCol, uint32_t paperCol, uint32_t inkWrite = 0xffffffff, uint32_t paperWrite = 0xffffffff)
+		: Ink(inkCol)
+		, Paper(paperCol)
+		, InkWrite(inkWrite)
+		, PaperWrite(paperWrite)
+	{
+	}
+
+	static uint32_t Select(uint32_t mask, uint32_t a, uint32_t b) { return (mask & a) | (~mask & b); }
+
+	void Row(uint32_t* pDest, uint8_t bits) const
+	{
+		const uint32_t* pMask = g_BitMaskLUT.Masks[bits];
+		for (int xpix = 0; xpix < 8; xpix++)
+			pDest[xpix] = Select(pMask[xpix], Ink, Paper);
+	}
+
+	void RowTransparent(uint32_t* pDest, uint8_t bits) const
+	{
+		const uint32_t* pMask = g_BitMaskLUT.Masks[bits];
+		for (int xpix = 0; xpix < 8; xpix++)
+		{
+			const uint32_t write = Select(pMask[xpix], InkWrite, PaperWrite);
+			pDest[xpix] = Select(write, Select(pMask[xpix], Ink, Paper), pDest[xpix]);
+		}
+	}
+
+	uint32_t	Ink, Paper;
+	uint32_t	InkWrite, PaperWrite;
+};
+
+const char* GetBlitImplementationName() { return "Scalar"; }
+
+#endif
+
+// 2bpp isn't vectorised - gathering 4 colours costs more than the plain loop, which compilers already do well
+static inline void MultiColourRow(uint32_t* pDest, uint8_t bits, const uint32_t* cols)
+{
+	for (int xpix = 0; xpix < 4; xpix++)
+	{
+		const uint32_t col = cols[(bits >> (6 - (xpix * 2))) & 3];
+		pDest[xpix * 2] = col;
+		pDest[xpix * 2 + 1] = col;
+	}
+}
+
+void BlitBitRow(uint32_t* pDest, uint8_t bits, uint32_t inkCol, uint32_t paperCol)
+{
+	FBitBlender(inkCol, paperCol).Row(pDest, bits);
+}
+
+void BlitBitRowTransparent(uint32_t* pDest, uint8_t bits, uint32_t inkCol, uint32_t paperCol, uint32_t transparentCol)
+{
+	const uint32_t inkWrite = inkCol != transparentCol ? 0xffffffff : 0;
+	const uint32_t paperWrite = paperCol != transparentCol ? 0xffffffff : 0;
+	if (inkWrite & paperWrite)
+		FBitBlender(inkCol, paperCol).Row(pDest, bits);
+	else if (inkWrite | paperWrite)
+		FBitBlender(inkCol, paperCol, inkWrite, paperWrite).RowTransparent(pDest, bits);
+}
+
+void BlitBitImage(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, uint32_t inkCol, uint32_t paperCol)
+{
+	const FBitBlender blender(inkCol, paperCol);
+
+	for (int y = 0; y < heightPix; y++)
+	{
+		for (int x = 0; x < widthBytes; x++)
+			blender.Row(pDest + (x * 8), pSrc[x]);
+
+		pSrc += srcStride;
+		pDest += destStride;
+	}
+}
+
+void BlitBitImageTransparent(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, uint32_t inkCol, uint32_t paperCol, uint32_t transparentCol)
+{
+	const uint32_t inkWrite = inkCol != transparentCol ? 0xffffffff : 0;
+	const uint32_t paperWrite = paperCol != transparentCol ? 0xffffffff : 0;
+	if (inkWrite & paperWrite)
+	{
+		BlitBitImage(pDest, destStride, pSrc, srcStride, widthBytes, heightPix, inkCol, paperCol);
+		return;
+	}
+	if ((inkWrite | paperWrite) == 0)
+		return;
+
+	const FBitBlender blender(inkCol, paperCol, inkWrite, paperWrite);
+
+	for (int y = 0; y < heightPix; y++)
+	{
+		for (int x = 0; x < widthBytes; x++)
+			blender.RowTransparent(pDest + (x * 8), pSrc[x]);
+
+		pSrc += srcStride;
+		pDest += destStride;
+	}
+}
+
+void BlitMultiColourRow(uint32_t* pDest, uint8_t bits, const uint32_t* cols)
+{
+	MultiColourRow(pDest, bits, cols);
+}
+
+void BlitMultiColourImage(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, const uint32_t* cols)
+{
+	for (int y = 0; y < heightPix; y++)
+	{
+		for (int x = 0; x < widthBytes; x++)
+			MultiColourRow(pDest + (x * 8), pSrc[x], cols);
+
+		pSrc += srcStride;
+		pDest += destStride;
+	}
+}
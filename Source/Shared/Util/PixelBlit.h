@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+
+// Expands packed bitmap graphics into RGBA pixel buffers, 8 pixels at a time
+// Bits are looked up in a table of pixel masks and the colours blended with SSE2, NEON or plain integer ops.
+// Define BLIT_FORCE_SCALAR to build without the SIMD versions.
+
+// 1bpp - set bits are ink, clear bits are paper, MSB is the leftmost pixel
+void BlitBitRow(uint32_t* pDest, uint8_t bits, uint32_t inkCol, uint32_t paperCol);
+
+// as above but pixels whose colour is transparentCol are left alone
+void BlitBitRowTransparent(uint32_t* pDest, uint8_t bits, uint32_t inkCol, uint32_t paperCol, uint32_t transparentCol);
+
+// Images are widthBytes bytes wide & heightPix lines high
+// srcStride is the distance in bytes between source lines, destStride the distance in pixels between dest lines
+void BlitBitImage(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, uint32_t inkCol, uint32_t paperCol);
+void BlitBitImageTransparent(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, uint32_t inkCol, uint32_t paperCol, uint32_t transparentCol);
+
+// 2bpp multicolour - each byte is 4 double width pixels which index cols[4], MSBs are the leftmost pixel
+// Plain loops only, callers drawing small images are better off with their own inlined loop.
+void BlitMultiColourRow(uint32_t* pDest, uint8_t bits, const uint32_t* cols);
+void BlitMultiColourImage(uint32_t* pDest, int destStride, const uint8_t* pSrc, int srcStride, int widthBytes, int heightPix, const uint32_t* cols);
+
+const char* GetBlitImplementationName();
@@ -81,6 +81,50 @@ char GetDirSep()
 	return '\\';
 }
 
+bool FMappedFile::Open(const char* pFilename)
+{
+	Close();
+
+	HANDLE hFile = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (GetFileSizeEx(hFile, &fileSize) == FALSE || fileSize.QuadPart == 0)
+	{
+		CloseHandle(hFile);
+		return false;
+	}
+
+	HANDLE hMapping = CreateFileMappingA(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(hFile);	// the mapping keeps the file open
+	if (hMapping == NULL)
+		return false;
+
+	void* pMapped = MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+	if (pMapped == NULL)
+	{
+		CloseHandle(hMapping);
+		return false;
+	}
+
+	pData = (const uint8_t*)pMapped;
+	Size = (size_t)fileSize.QuadPart;
+	pMappingHandle = hMapping;
+	return true;
+}
+
+void FMappedFile::Close()
+{
+	if (pData != nullptr)
+		UnmapViewOfFile(pData);
+	if (pMappingHandle != nullptr)
+		CloseHandle((HANDLE)pMappingHandle);
+	pData = nullptr;
+	Size = 0;
+	pMappingHandle = nullptr;
+}
+
 
 #if 0
 std::string g_BrowserURL;
@@ -0,0 +1,194 @@
+#include "ZipArchive.h"
+
+#include <zlib.h>
+#include <cstdlib>
+#include <cstring>
+
+static const uint32_t kEndOfCentralDirSig = 0x06054b50;
+static const uint32_t kCentralDirHeaderSig = 0x02014b50;
+static const uint32_t kLocalHeaderSig = 0x04034b50;
+static const size_t kEndOfCentralDirSize = 22;
+static const size_t kCentralDirHeaderSize = 46;
+static const size_t kLocalHeaderSize = 30;
+
+static uint16_t Get16(const uint8_t* pData) { return pData[0] | (pData[1] << 8); }
+static uint32_t Get32(const uint8_t* pData) { return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((uint32_t)pData[3] << 24); }
+
+bool FZipArchive::Open(const char* pFileName)
+{
+	Close();
+	if (MappedFile.Open(pFileName) == false)
+		return false;
+
+	const uint8_t* pData = MappedFile.GetData();
+	const size_t size = MappedFile.GetSize();
+	if (size < kEndOfCentralDirSize)
+	{
+		Close();
+		return false;
+	}
+
+	// end of central directory record is at the end, before a comment of up to 64K
+	const uint8_t* pEnd = nullptr;
+	const size_t searchEnd = size > kEndOfCentralDirSize + 0xffff ? size - kEndOfCentralDirSize - 0xffff : 0;
+	for (size_t pos = size - kEndOfCentralDirSize + 1; pos-- > searchEnd;)
+	{
+		if (Get32(pData + pos) == kEndOfCentralDirSig)
+		{
+			pEnd = pData + pos;
+			break;
+		}
+	}
+	if (pEnd == nullptr)
+	{
+		Close();
+		return false;
+	}
+
+	const int noEntries = Get16(pEnd + 10);
+	const size_t dirSize = Get32(pEnd + 12);
+	const size_t dirOffset = Get32(pEnd + 16);
+	if (dirOffset + dirSize > size)
+	{
+		Close();
+		return false;
+	}
+
+	const uint8_t* pHeader = pData + dirOffset;
+	const uint8_t* pDirEnd = pHeader + dirSize;
+	Entries.reserve(noEntries);
+	for (int entryNo = 0; entryNo < noEntries; entryNo++)
+	{
+		if (pHeader + kCentralDirHeaderSize > pDirEnd || Get32(pHeader) != kCentralDirHeaderSig)
+			break;
+
+		const uint16_t flags = Get16(pHeader + 8);
+		const uint16_t nameLength = Get16(pHeader + 28);
+		const uint16_t extraLength = Get16(pHeader + 30);
+		const uint16_t commentLength = Get16(pHeader + 32);
+		if (pHeader + kCentralDirHeaderSize + nameLength > pDirEnd)
+			break;
+
+		FZipEntry entry;
+		entry.Method = Get16(pHeader + 10);
+		entry.CRC = Get32(pHeader + 16);
+		entry.CompressedSize = Get32(pHeader + 20);
+		entry.Size = Get32(pHeader + 24);
+		entry.LocalHeaderOffset = Get32(pHeader + 42);
+		entry.FileName.assign((const char*)pHeader + kCentralDirHeaderSize, nameLength);
+
+		// skip directories & encrypted files
+		if (entry.FileName.empty() == false && entry.FileName.back() != '/' && (flags & 1) == 0)
+			Entries.push_back(entry);
+
+		pHeader += kCentralDirHeaderSize + nameLength + extraLength + commentLength;
+	}
+
+	return true;
+}
+
+void FZipArchive::Close()
+{
+	MappedFile.Close();
+	Entries.clear();
+}
+
+int FZipArchive::FindEntry(const char* pFileName) const
+{
+	for (int entryNo = 0; entryNo < (int)Entries.size(); entryNo++)
+	{
+		if (Entries[entryNo].FileName == pFileName)
+			return entryNo;
+	}
+	return -1;
+}
+
+bool FZipArchive::ExtractEntry(int index, std::vector<uint8_t>& outData) const
+{
+	if (index < 0 || index >= (int)Entries.size())
+		return false;
+
+	const FZipEntry& entry = Entries[index];
+	const uint8_t* pData = MappedFile.GetData();
+	const size_t size = MappedFile.GetSize();
+
+	// data follows the local header, whose name & extra field lengths can differ from the central directory's
+	if (entry.LocalHeaderOffset + kLocalHeaderSize > size || Get32(pData + entry.LocalHeaderOffset) != kLocalHeaderSig)
+		return false;
+	const uint8_t* pLocalHeader = pData + entry.LocalHeaderOffset;
+	const size_t dataOffset = entry.LocalHeaderOffset + kLocalHeaderSize + Get16(pLocalHeader + 26) + Get16(pLocalHeader + 28);
+	if (dataOffset + entry.CompressedSize > size)
+		return false;
+	const uint8_t* pCompressed = pData + dataOffset;
+
+	outData.resize(entry.Size);
+	if (entry.Method == 0)
+	{
+		if (entry.CompressedSize != entry.Size)
+			return false;
+		memcpy(outData.data(), pCompressed, entry.Size);
+	}
+	else if (entry.Method == 8)
+	{
+		z_stream stream;
+		memset(&stream, 0, sizeof(z_stream));
+		if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)	// raw deflate, no zlib header
+			return false;
+
+		stream.next_in = (Bytef*)pCompressed;
+		stream.avail_in = entry.CompressedSize;
+		stream.next_out = outData.data();
+		stream.avail_out = entry.Size;
+		const int result = inflate(&stream, Z_FINISH);
+		inflateEnd(&stream);
+		if (result != Z_STREAM_END || stream.total_out != entry.Size)
+			return false;
+	}
+	else
+	{
+		return false;
+	}
+
+	return crc32(0, outData.data(), entry.Size) == entry.CRC;
+}
+
+bool IsZipFileName(const std::string& fileName)
+{
+	if (fileName.size() < 4)
+		return false;
+
+	const char* pExt = fileName.c_str() + fileName.size() - 4;
+	return pExt[0] == '.' && (pExt[1] == 'z' || pExt[1] == 'Z') && (pExt[2] == 'i' || pExt[2] == 'I') && (pExt[3] == 'p' || pExt[3] == 'P');
+}
+
+bool SplitZipPath(const std::string& path, std::string& outArchiveName, std::string& outEntryName)
+{
+	for (size_t pos = path.find_first_of("/\\"); pos != std::string::npos; pos = path.find_first_of("/\\", pos + 1))
+	{
+		if (IsZipFileName(path.substr(0, pos)))
+		{
+			outArchiveName = path.substr(0, pos);
+			outEntryName = path.substr(pos + 1);
+			return true;
+		}
+	}
+	return false;
+}
+
+bool LoadFileData(const std::string& path, std::vector<uint8_t>& outData)
+{
+	std::string archiveName, entryName;
+	if (SplitZipPath(path, archiveName, entryName))
+	{
+		FZipArchive archive;
+		return archive.Open(archiveName.c_str()) && archive.ExtractEntry(archive.FindEntry(entryName.c_str()), outData);
+	}
+
+	size_t byteCount = 0;
+	void* pData = LoadBinaryFile(path.c_str(), byteCount);
+	if (pData == nullptr)
+		return false;
+	outData.assign((const uint8_t*)pData, (const uint8_t*)pData + byteCount);
+	free(pData);
+	return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "FileUtil.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Read only access to the files in a ZIP archive
+// The archive is memory mapped and entries are inflated straight into the caller's buffer.
+// Stored & deflated entries are supported, ZIP64 & encryption aren't.
+
+struct FZipEntry
+{
+	std::string	FileName;	// path inside the archive, '/' separated
+	uint32_t	CompressedSize = 0;
+	uint32_t	Size = 0;
+	uint32_t	CRC = 0;
+	uint16_t	Method = 0;	// 0 - stored, 8 - deflate
+	uint32_t	LocalHeaderOffset = 0;
+};
+
+class FZipArchive
+{
+public:
+	bool	Open(const char* pFileName);	// reads the central directory
+	void	Close();
+	bool	IsOpen() const { return MappedFile.IsOpen(); }
+
+	int		GetNoEntries() const { return (int)Entries.size(); }
+	const FZipEntry&	GetEntry(int index) const { return Entries[index]; }
+	int		FindEntry(const char* pFileName) const;	// -1 if not found
+
+	bool	ExtractEntry(int index, std::vector<uint8_t>& outData) const;	// checks the CRC
+
+private:
+	FMappedFile				MappedFile;
+	std::vector<FZipEntry>	Entries;
+};
+
+// Paths to files in archives look like 'Games/Library.zip/Game.z80'
+bool IsZipFileName(const std::string& fileName);
+bool SplitZipPath(const std::string& path, std::string& outArchiveName, std::string& outEntryName);	// false if not an archive path
+
+// load a file, which can be inside an archive
+bool LoadFileData(const std::string& path, std::vector<uint8_t>& outData);
@@ -0,0 +1,147 @@
+// Micro-benchmark for Util/PixelBlit against the per-pixel loops it replaced
+//
+// BlitBench [iterations]
+//
+// Draws a 320x408 view (a C64 VIC bank of characters) from random bitmap data with each blitter,
+// checks the output matches the reference and prints the time per 8x8 character.
+// 2bpp multicolour isn't benched as BlitMultiColourImage is the same plain loop the viewers used.
+
+#include "Util/PixelBlit.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+static const int kViewWidth = 320;
+static const int kViewHeight = 408;
+static const int kNoChars = (kViewWidth / 8) * (kViewHeight / 8);
+static const uint32_t kTransparentCol = 0xFF000000;
+
+// reference versions - how FGraphicsView & the C64 viewer drew before
+static void RefBitImageTransparent(uint32_t* pDest, const uint8_t* pSrc, uint32_t inkCol, uint32_t paperCol)
+{
+	for (int y = 0; y < 8; y++)
+	{
+		const uint8_t charLine = *pSrc++;
+
+		for (int xpix = 0; xpix < 8; xpix++)
+		{
+			const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
+			const uint32_t col = bSet ? inkCol : paperCol;
+			if (col != kTransparentCol)
+				*(pDest + xpix) = col;
+		}
+		pDest += kViewWidth;
+	}
+}
+
+static void RefHiresImage(uint32_t* pDest, const uint8_t* pSrc, const uint32_t* cols)
+{
+	for (int y = 0; y < 8; y++)
+	{
+		const uint8_t charLine = *pSrc++;
+
+		for (int xpix = 0; xpix < 8; xpix++)
+		{
+			const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
+			*(pDest + xpix) = bSet ? cols[1] : cols[0];
+		}
+		pDest += kViewWidth;
+	}
+}
+
+static void NewBitImageTransparent(uint32_t* pDest, const uint8_t* pSrc, uint32_t inkCol, uint32_t paperCol)
+{
+	BlitBitImageTransparent(pDest, kViewWidth, pSrc, 1, 1, 8, inkCol, paperCol, kTransparentCol);
+}
+
+static void NewHiresImage(uint32_t* pDest, const uint8_t* pSrc, const uint32_t* cols)
+{
+	BlitBitImage(pDest, kViewWidth, pSrc, 1, 1, 8, cols[1], cols[0]);
+}
+
+struct FBenchView
+{
+	FBenchView() : Pixels(kViewWidth * kViewHeight) {}
+
+	// draw every character, with colours changing from char to char
+	template <typename DrawFunc>
+	void DrawAll(const std::vector<uint8_t>& charData, DrawFunc drawFunc)
+	{
+		for (int charNo = 0; charNo < kNoChars; charNo++)
+		{
+			const int xp = (charNo % (kViewWidth / 8)) * 8;
+			const int yp = (charNo / (kViewWidth / 8)) * 8;
+			drawFunc(Pixels.data() + xp + (yp * kViewWidth), charData.data() + charNo * 8, charNo);
+		}
+	}
+
+	std::vector<uint32_t>	Pixels;
+};
+
+template <typename DrawFunc>
+static double TimeDraw(int iterations, const std::vector<uint8_t>& charData, FBenchView& view, DrawFunc drawFunc)
+{
+	const auto startTime = std::chrono::high_resolution_clock::now();
+	for (int i = 0; i < iterations; i++)
+		view.DrawAll(charData, drawFunc);
+	const auto endTime = std::chrono::high_resolution_clock::now();
+
+	const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(endTime - startTime).count();
+	return ns / ((double)iterations * kNoChars);
+}
+
+template <typename RefFunc, typename NewFunc>
+static bool RunTest(const char* pName, int iterations, const std::vector<uint8_t>& charData, RefFunc refFunc, NewFunc newFunc)
+{
+	FBenchView refView, newView;
+
+	// same starting contents for transparency
+	for (size_t i = 0; i < refView.Pixels.size(); i++)
+		refView.Pixels[i] = newView.Pixels[i] = 0xFF000000 | (uint32_t)(i * 2654435761u);
+
+	refView.DrawAll(charData, refFunc);
+	newView.DrawAll(charData, newFunc);
+	if (memcmp(refView.Pixels.data(), newView.Pixels.data(), refView.Pixels.size() * sizeof(uint32_t)) != 0)
+	{
+		printf("%-22s MISMATCH\n", pName);
+		return false;
+	}
+
+	const double refTime = TimeDraw(iterations, charData, refView, refFunc);
+	const double newTime = TimeDraw(iterations, charData, newView, newFunc);
+	printf("%-22s ref %6.2f ns/char  blit %6.2f ns/char  x%.1f\n", pName, refTime, newTime, refTime / newTime);
+	return true;
+}
+
+int main(int argc, char** argv)
+{
+	const int iterations = argc > 1 ? atoi(argv[1]) : 200;
+	if (iterations <= 0)
+	{
+		printf("usage: BlitBench [iterations]\n");
+		return 1;
+	}
+
+	std::vector<uint8_t> charData(kNoChars * 8);
+	srand(1234);
+	for (uint8_t& byte : charData)
+		byte = (uint8_t)rand();
+
+	static const uint32_t kColours[4] = { 0xFF000000, 0xFFFFFFFF, 0xFF0000D7, 0xFFD7D700 };
+	static const uint32_t kMultiColours[4] = { 0x00000000, 0xffffffff, 0xff888888, 0xff444444 };
+
+	printf("%s, %d chars x %d iterations\n", GetBlitImplementationName(), kNoChars, iterations);
+
+	bool bOk = true;
+	bOk &= RunTest("1bpp transparent", iterations, charData,
+		[](uint32_t* pDest, const uint8_t* pSrc, int charNo) { RefBitImageTransparent(pDest, pSrc, kColours[(charNo + 1) & 3], kColours[charNo & 3]); },
+		[](uint32_t* pDest, const uint8_t* pSrc, int charNo) { NewBitImageTransparent(pDest, pSrc, kColours[(charNo + 1) & 3], kColours[charNo & 3]); });
+	bOk &= RunTest("1bpp opaque", iterations, charData,
+		[](uint32_t* pDest, const uint8_t* pSrc, int charNo) { RefHiresImage(pDest, pSrc, &kMultiColours[charNo & 2]); },
+		[](uint32_t* pDest, const uint8_t* pSrc, int charNo) { NewHiresImage(pDest, pSrc, &kMultiColours[charNo & 2]); });
+
+	return bOk ? 0 : 1;
+}
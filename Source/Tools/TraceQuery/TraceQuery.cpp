@@ -0,0 +1,166 @@
+// Command line range queries on execution trace (.xtrace) files
+//
+// TraceQuery <file> info
+// TraceQuery <file> [--frames a-b] [--cycles a-b] [--addr a-b] [--exec] [--reads] [--writes] [--in] [--out] [--count] [--limit n]
+//
+// --reads & --writes are memory accesses, --in & --out are IO port accesses
+// e.g. all writes to 0x5B00-0x5BFF between frames 100 and 200:
+// TraceQuery Game.xtrace --frames 100-200 --addr 0x5B00-0x5BFF --writes
+
+#include "Util/ExecutionTrace.h"
+
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static const char* kEventTypeNames[] = { "exec", "read", "write", "in", "out" };
+
+static void PrintUsage()
+{
+	printf("usage: TraceQuery <file> info\n");
+	printf("       TraceQuery <file> [--frames a-b] [--cycles a-b] [--addr a-b] [--exec] [--reads] [--writes] [--in] [--out] [--count] [--limit n]\n");
+	printf("--reads & --writes are memory accesses, --in & --out are IO port accesses\n");
+	printf("numbers can be decimal or hex (0x), a single value is a range of one\n");
+}
+
+static bool ParseRange(const char* pString, uint64_t& outFirst, uint64_t& outLast)
+{
+	char* pEnd = nullptr;
+	outFirst = strtoull(pString, &pEnd, 0);
+	if (pEnd == pString)
+		return false;
+	if (*pEnd == 0)
+	{
+		outLast = outFirst;
+		return true;
+	}
+	if (*pEnd != '-')
+		return false;
+
+	const char* pLast = pEnd + 1;
+	outLast = strtoull(pLast, &pEnd, 0);
+	return pEnd != pLast && *pEnd == 0 && outLast >= outFirst;
+}
+
+static void PrintInfo(const FExecutionTraceReader& reader)
+{
+	const std::vector<FTraceBlockInfo>& blocks = reader.GetBlocks();
+	uint64_t compressedSize = 0, size = 0;
+	for (const FTraceBlockInfo& block : blocks)
+	{
+		for (const FTraceColumnInfo& column : block.Columns)
+		{
+			compressedSize += column.CompressedSize;
+			size += column.Size;
+		}
+	}
+
+	printf("frames: %u\n", reader.GetNoFrames());
+	printf("blocks: %d%s\n", (int)blocks.size(), reader.HasIndex() ? "" : " (no index - scanned)");
+	printf("events: %" PRIu64 "\n", reader.GetNoEvents());
+	if (blocks.empty() == false)
+		printf("cycles: %" PRIu64 "-%" PRIu64 "\n", blocks.front().FirstCycle, blocks.back().LastCycle);
+	printf("column data: %" PRIu64 " bytes, %" PRIu64 " compressed\n", size, compressedSize);
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 3)
+	{
+		PrintUsage();
+		return 1;
+	}
+
+	FExecutionTraceReader reader;
+	if (reader.Open(argv[1]) == false)
+	{
+		fprintf(stderr, "Could not open trace file '%s'\n", argv[1]);
+		return 1;
+	}
+
+	if (strcmp(argv[2], "info") == 0)
+	{
+		PrintInfo(reader);
+		return 0;
+	}
+
+	FTraceQuery query;
+	uint32_t typeMask = 0;
+	bool bCountOnly = false;
+	uint64_t limit = UINT64_MAX;
+	for (int argNo = 2; argNo < argc; argNo++)
+	{
+		const char* pArg = argv[argNo];
+		const char* pValue = argNo + 1 < argc ? argv[argNo + 1] : nullptr;
+		uint64_t first = 0, last = 0;
+
+		if (strcmp(pArg, "--exec") == 0)
+			typeMask |= kTraceMask_Instruction;
+		else if (strcmp(pArg, "--reads") == 0)
+			typeMask |= kTraceMask_Read;
+		else if (strcmp(pArg, "--writes") == 0)
+			typeMask |= kTraceMask_Write;
+		else if (strcmp(pArg, "--in") == 0)
+			typeMask |= kTraceMask_IORead;
+		else if (strcmp(pArg, "--out") == 0)
+			typeMask |= kTraceMask_IOWrite;
+		else if (strcmp(pArg, "--count") == 0)
+			bCountOnly = true;
+		else if (pValue != nullptr && strcmp(pArg, "--limit") == 0)
+		{
+			limit = strtoull(pValue, nullptr, 0);
+			argNo++;
+		}
+		else if (pValue != nullptr && strcmp(pArg, "--frames") == 0 && ParseRange(pValue, first, last) && last <= UINT32_MAX)
+		{
+			query.FirstFrame = (uint32_t)first;
+			query.LastFrame = (uint32_t)last;
+			argNo++;
+		}
+		else if (pValue != nullptr && strcmp(pArg, "--cycles") == 0 && ParseRange(pValue, first, last))
+		{
+			query.FirstCycle = first;
+			query.LastCycle = last;
+			argNo++;
+		}
+		else if (pValue != nullptr && strcmp(pArg, "--addr") == 0 && ParseRange(pValue, first, last) && last <= 0xffff)
+		{
+			query.FirstAddress = (uint16_t)first;
+			query.LastAddress = (uint16_t)last;
+			argNo++;
+		}
+		else
+		{
+			fprintf(stderr, "Bad argument '%s'\n", pArg);
+			PrintUsage();
+			return 1;
+		}
+	}
+	if (typeMask != 0)
+		query.TypeMask = typeMask;
+
+	uint64_t noMatches = 0;
+	const bool bOk = reader.Query(query, [&](const FTraceEvent& event)
+	{
+		if (bCountOnly == false)
+		{
+			if (event.Type == ETraceEventType::Instruction)
+				printf("%u %" PRIu64 " %04X %s\n", event.FrameNo, event.Cycle, event.PC, kEventTypeNames[(int)event.Type]);
+			else
+				printf("%u %" PRIu64 " %04X %s %04X %02X\n", event.FrameNo, event.Cycle, event.PC, kEventTypeNames[(int)event.Type], event.Address, event.Value);
+		}
+		return ++noMatches < limit;
+	});
+
+	if (bCountOnly)
+		printf("%" PRIu64 "\n", noMatches);
+	fprintf(stderr, "%" PRIu64 " events from %d of %d blocks\n", noMatches, reader.GetNoBlocksRead(), (int)reader.GetBlocks().size());
+
+	if (bOk == false)
+	{
+		fprintf(stderr, "Error reading trace file\n");
+		return 1;
+	}
+	return 0;
+}
@@ -3,10 +3,15 @@
 #include "Util/Misc.h"
 #include <util/z80dasm.h>
 #include "Debug/DebugLog.h"
+#include "Util/BackgroundTask.h"
 
 #include <string.h>
+#include <string>
+#include <vector>
 
 
+// Exports format items in parallel so nothing here may touch global state - the number display mode is passed in
+// and the code analysis is only read.
 class FExportDasmState : public FDasmStateBase
 {
 public:
@@ -14,12 +19,10 @@ public:
 	{
 		if (outputCallback != nullptr)
 		{
-			ENumberDisplayMode dispMode = GetNumberDisplayMode();
+			ENumberDisplayMode dispMode = HexDisplayMode;
 
 			if (pCodeInfoItem->OperandType == EOperandType::Decimal)
 				dispMode = ENumberDisplayMode::Decimal;
-			if (pCodeInfoItem->OperandType == EOperandType::Hex)
-				dispMode = HexDisplayMode;
 
 			const char* outStr = NumStr(val, dispMode);
 			for (int i = 0; i < strlen(outStr); i++)
@@ -31,7 +34,6 @@ public:
 	{
 		if (outputCallback)
 		{
-			const bool bOperandIsAddress = (pCodeInfoItem->OperandType == EOperandType::JumpAddress || pCodeInfoItem->OperandType == EOperandType::Pointer);
 			const FLabelInfo* pLabel = bOperandIsAddress ? CodeAnalysisState->GetLabelForAddress(val) : nullptr;
 			if (pLabel != nullptr)
 			{
@@ -42,12 +44,10 @@ public:
 			}
 			else
 			{
-				ENumberDisplayMode dispMode = GetNumberDisplayMode();
+				ENumberDisplayMode dispMode = HexDisplayMode;
 
 				if (pCodeInfoItem->OperandType == EOperandType::Decimal)
 					dispMode = ENumberDisplayMode::Decimal;
-				if (pCodeInfoItem->OperandType == EOperandType::Hex)
-					dispMode = HexDisplayMode;
 
 				const char* outStr = NumStr(val, dispMode);
 				for (int i = 0; i < strlen(outStr); i++)
@@ -69,13 +69,14 @@ public:
 			{
 				outputCallback('+', this);
 			}
-			const char* outStr = NumStr((uint8_t)val);
+			const char* outStr = NumStr((uint8_t)val, HexDisplayMode);
 			for (int i = 0; i < strlen(outStr); i++)
 				outputCallback(outStr[i], this);
 		}
 	}
 
 	FCodeInfo* pCodeInfoItem = nullptr;
+	bool	bOperandIsAddress = false;
 	ENumberDisplayMode	HexDisplayMode = ENumberDisplayMode::HexDollar;
 };
 
@@ -97,12 +98,46 @@ static void ExportOutputCB(char c, void* pUserData)
 	pDasmState->Text += c;
 }
 
-std::string GenerateDasmStringForAddress(FCodeAnalysisState& state, uint16_t pc, ENumberDisplayMode hexMode)
+// Operand addresses of an instruction, worked out the same way as WriteCodeInfoForAddress but without generating labels.
+// Returns if the operand should be treated as an address.
+static bool GetOperandAddresses(FCodeAnalysisState& state, const FCodeInfo* pCodeInfo, uint16_t& jumpAddress, uint16_t& pointerAddress)
+{
+	jumpAddress = pCodeInfo->JumpAddress;
+	pointerAddress = pCodeInfo->PointerAddress;
+
+	bool bFoundAddress = false;
+	uint16_t addr;
+	if (CheckJumpInstruction(state.CPUInterface, pCodeInfo->Address, &addr))
+	{
+		jumpAddress = addr;
+		bFoundAddress = true;
+	}
+	else
+	{
+		if (CheckPointerRefInstruction(state.CPUInterface, pCodeInfo->Address, &addr))
+		{
+			pointerAddress = addr;
+			bFoundAddress = true;
+		}
+		if (CheckPointerIndirectionInstruction(state.CPUInterface, pCodeInfo->Address, &addr))
+		{
+			pointerAddress = addr;
+			bFoundAddress = true;
+		}
+	}
+
+	if (pCodeInfo->OperandType == EOperandType::Unknown)
+		return bFoundAddress;
+	return pCodeInfo->OperandType == EOperandType::JumpAddress || pCodeInfo->OperandType == EOperandType::Pointer;
+}
+
+std::string GenerateDasmStringForAddress(FCodeAnalysisState& state, uint16_t pc, ENumberDisplayMode hexMode, bool bOperandIsAddress)
 {
 	FExportDasmState dasmState;
 	dasmState.CodeAnalysisState = &state;
 	dasmState.CurrentAddress = pc;
 	dasmState.HexDisplayMode = hexMode;
+	dasmState.bOperandIsAddress = bOperandIsAddress;
 	dasmState.pCodeInfoItem = state.GetCodeInfoForAddress(pc);
 	SetNumberOutput(&dasmState);
 	z80dasm_op(pc, ExportDasmInputCB, ExportOutputCB, &dasmState);
@@ -135,7 +170,7 @@ std::string GenerateAddressLabelString(FCodeAnalysisState& state, uint16_t addr)
 		if (labelOffset > 0)	// add offset string
 		{
 			char offsetString[16];
-			sprintf(offsetString, " + %d]", labelOffset);
+			snprintf(offsetString, sizeof(offsetString), " + %d]", labelOffset);
 			labelStr += offsetString;
 		}
 		else
@@ -147,164 +182,175 @@ std::string GenerateAddressLabelString(FCodeAnalysisState& state, uint16_t addr)
 	return labelStr;
 }
 
-uint16_t g_DbgAddress = 0xEA71;
-
-bool ExportAssembler(FCodeAnalysisState& state, const char* pTextFileName)
+// Append the assembler line for an item to outText
+static void WriteItemText(FCodeAnalysisState& state, const FItem* pItem, ENumberDisplayMode hexMode, std::string& outText)
 {
-	FILE* fp =fopen(pTextFileName, "wt");
-
-	if (fp == nullptr)
-		return false;
+	switch (pItem->Type)
+	{
+	case EItemType::Label:
+	{
+		const FLabelInfo* pLabelInfo = static_cast<const FLabelInfo*>(pItem);
+		outText += pLabelInfo->Name;
+		outText += ':';
+	}
+	break;
+	case EItemType::Code:
+	{
+		const FCodeInfo* pCodeInfo = static_cast<const FCodeInfo*>(pItem);
 
-	ENumberDisplayMode hexMode = ENumberDisplayMode::HexDollar;
+		uint16_t jumpAddress = 0;
+		uint16_t pointerAddress = 0;
+		const bool bOperandIsAddress = GetOperandAddresses(state, pCodeInfo, jumpAddress, pointerAddress);
 
-	ENumberDisplayMode oldMode = GetNumberDisplayMode();
-	SetNumberDisplayMode(hexMode);
+		outText += '\t';
+		outText += GenerateDasmStringForAddress(state, pCodeInfo->Address, hexMode, bOperandIsAddress);
 
-	// TODO: write screen memory regions
+		const uint16_t labelAddress = jumpAddress != 0 ? jumpAddress : pointerAddress;
+		if (labelAddress != 0)
+		{
+			const std::string labelStr = GenerateAddressLabelString(state, labelAddress);
+			if (labelStr.empty() == false)
+			{
+				outText += "\t;";
+				outText += labelStr;
+			}
+		}
+	}
+	break;
+	case EItemType::Data:
+	{
+		const FDataInfo* pDataInfo = static_cast<const FDataInfo*>(pItem);
+		ENumberDisplayMode dispMode = hexMode;
 
-	const uint16_t startAddr = kScreenAttrMemEnd + 1;	// start at the end of attrib memory
+		if (pDataInfo->OperandType == EOperandType::Decimal)
+			dispMode = ENumberDisplayMode::Decimal;
 
-	for (FItem* pItem : state.ItemList)
-	{
-		if (pItem->Address < startAddr)
-			continue;
+		const bool bOperandIsAddress = (pDataInfo->OperandType == EOperandType::JumpAddress || pDataInfo->OperandType == EOperandType::Pointer);
 
-		switch (pItem->Type)
+		outText += '\t';
+		switch (pDataInfo->DataType)
 		{
-		case EItemType::Label:
+		case EDataType::Byte:
 		{
-			const FLabelInfo* pLabelInfo = static_cast<FLabelInfo*>(pItem);
-			fprintf(fp, "%s:", pLabelInfo->Name.c_str());
+			const uint8_t val = state.CPUInterface->ReadByte(pDataInfo->Address);
+			outText += "db ";
+			outText += NumStr(val, dispMode);
 		}
 		break;
-		case EItemType::Code:
+		case EDataType::ByteArray:
 		{
-			const FCodeInfo* pCodeInfo = static_cast<FCodeInfo*>(pItem);
-
-			WriteCodeInfoForAddress(state, pCodeInfo->Address);	// needed to refresh code info
-			if (pCodeInfo->Address == g_DbgAddress)
-				LOGINFO("DebugAddress");
-
-			const std::string dasmString = GenerateDasmStringForAddress(state, pCodeInfo->Address, hexMode);
-			fprintf(fp, "\t%s", dasmString.c_str());
-
-			if (pCodeInfo->JumpAddress != 0)
-			{
-				const std::string labelStr = GenerateAddressLabelString(state, pCodeInfo->JumpAddress);
-				if (labelStr.empty() == false)
-					fprintf(fp, "\t;%s", labelStr.c_str());
-
-			}
-			else if (pCodeInfo->PointerAddress != 0)
+			outText += "db ";
+			for (int i = 0; i < pDataInfo->ByteSize; i++)
 			{
-				const std::string labelStr = GenerateAddressLabelString(state, pCodeInfo->PointerAddress);
-				if (labelStr.empty() == false)
-					fprintf(fp, "\t;%s", labelStr.c_str());
+				const uint8_t val = state.CPUInterface->ReadByte(pDataInfo->Address + i);
+				outText += NumStr(val, dispMode);
+				outText += i < pDataInfo->ByteSize - 1 ? ',' : ' ';
 			}
 		}
-
 		break;
-		case EItemType::Data:
+		case EDataType::Word:
 		{
-			const FDataInfo* pDataInfo = static_cast<FDataInfo*>(pItem);
-			ENumberDisplayMode dispMode = GetNumberDisplayMode();
-
-			if (pDataInfo->OperandType == EOperandType::Decimal)
-				dispMode = ENumberDisplayMode::Decimal;
-			if (pDataInfo->OperandType == EOperandType::Hex)
-				dispMode = hexMode;
+			const uint16_t val = state.CPUInterface->ReadWord(pDataInfo->Address);
 
-			const bool bOperandIsAddress = (pDataInfo->OperandType == EOperandType::JumpAddress || pDataInfo->OperandType == EOperandType::Pointer);
-
-
-			fprintf(fp, "\t");
-			switch (pDataInfo->DataType)
-			{
-			case EDataType::Byte:
-			{
-				const uint8_t val = state.CPUInterface->ReadByte(pDataInfo->Address);
-				fprintf(fp, "db %s", NumStr(val, dispMode));
-			}
-			break;
-			case EDataType::ByteArray:
+			const FLabelInfo* pLabel = bOperandIsAddress ? state.GetLabelForAddress(val) : nullptr;
+			outText += "dw ";
+			outText += pLabel != nullptr ? pLabel->Name.c_str() : NumStr(val, dispMode);
+		}
+		break;
+		case EDataType::WordArray:
+		{
+			const int wordSize = pDataInfo->ByteSize / 2;
+			outText += "dw ";
+			for (int i = 0; i < wordSize; i++)
 			{
-				std::string textString;
-				for (int i = 0; i < pDataInfo->ByteSize; i++)
-				{
-					const uint8_t val = state.CPUInterface->ReadByte(pDataInfo->Address + i);
-					char valTxt[16];
-					sprintf(valTxt, "%s%c", NumStr(val, dispMode), i < pDataInfo->ByteSize - 1 ? ',' : ' ');
-					textString += valTxt;
-				}
-				fprintf(fp, "db %s", textString.c_str());
+				const uint16_t val = state.CPUInterface->ReadWord(pDataInfo->Address + (i * 2));
+				outText += NumStr(val, hexMode);
+				outText += i < wordSize - 1 ? ',' : ' ';
 			}
-			break;
-			case EDataType::Word:
+		}
+		break;
+		case EDataType::Text:
+		{
+			outText += "ascii '";
+			for (int i = 0; i < pDataInfo->ByteSize; i++)
 			{
-				const uint16_t val = state.CPUInterface->ReadWord(pDataInfo->Address);
-
-				const FLabelInfo* pLabel = bOperandIsAddress ? state.GetLabelForAddress(val) : nullptr;
-				if (pLabel != nullptr)
-				{
-					fprintf(fp, "dw %s", pLabel->Name.c_str());
-				}
+				const char ch = state.CPUInterface->ReadByte(pDataInfo->Address + i);
+				if (ch == '\n')
+					outText += "<cr>";
+				if (pDataInfo->bBit7Terminator && ch & (1 << 7))	// check bit 7 terminator flag
+					outText += ch & ~(1 << 7);	// remove bit 7
 				else
-				{
-					fprintf(fp, "dw %s", NumStr(val, dispMode));
-				}
-			}
-			break;
-			case EDataType::WordArray:
-			{
-				const int wordSize = pDataInfo->ByteSize / 2;
-				std::string textString;
-				for (int i = 0; i < wordSize; i++)
-				{
-					const uint16_t val = state.CPUInterface->ReadWord(pDataInfo->Address + (i * 2));
-					char valTxt[16];
-					sprintf(valTxt, "%s%c", NumStr(val), i < wordSize - 1 ? ',' : ' ');
-					textString += valTxt;
-				}
-				fprintf(fp, "dw %s", textString.c_str());
-			}
-			break;
-			case EDataType::Text:
-			{
-				std::string textString;
-				for (int i = 0; i < pDataInfo->ByteSize; i++)
-				{
-					const char ch = state.CPUInterface->ReadByte(pDataInfo->Address + i);
-					if (ch == '\n')
-						textString += "<cr>";
-					if (pDataInfo->bBit7Terminator && ch & (1 << 7))	// check bit 7 terminator flag
-						textString += ch & ~(1 << 7);	// remove bit 7
-					else
-						textString += ch;
-				}
-				fprintf(fp, "ascii '%s'", textString.c_str());
-			}
-			break;
-
-			case EDataType::ScreenPixels:
-			case EDataType::Blob:
-			default:
-				fprintf(fp, "%d Bytes", pDataInfo->ByteSize);
-				break;
+					outText += ch;
 			}
+			outText += '\'';
 		}
 		break;
+
+		case EDataType::ScreenPixels:
+		case EDataType::Blob:
+		default:
+			outText += std::to_string(pDataInfo->ByteSize);
+			outText += " Bytes";
+			break;
 		}
+	}
+	break;
+	}
 
-		// put comment on the end
-		if (pItem->Comment.empty() == false)
-			fprintf(fp, "\t;%s", pItem->Comment.c_str());
-		fprintf(fp, "\n");
+	// put comment on the end
+	if (pItem->Comment.empty() == false)
+	{
+		outText += "\t;";
+		outText += pItem->Comment;
 	}
+	outText += '\n';
+}
 
-	fclose(fp);
+bool ExportAssembler(FCodeAnalysisState& state, const char* pTextFileName)
+{
+	FILE* fp =fopen(pTextFileName, "wt");
+
+	if (fp == nullptr)
+		return false;
+
+	const ENumberDisplayMode hexMode = ENumberDisplayMode::HexDollar;
 
+	// TODO: write screen memory regions
+
+	const uint16_t startAddr = kScreenAttrMemEnd + 1;	// start at the end of attrib memory
+
+	// format the item list in chunks across threads, each into its own buffer
+	// the workers only read the analysis & memory so every page is loaded first
+	state.LoadAllPendingPages();
+	const std::vector<FItem*>& itemList = state.ItemList;
+	const int kMinItemsPerChunk = 1024;
+	const int noChunks = CalcNoParallelChunks((int)itemList.size(), kMinItemsPerChunk);
+	std::vector<std::string> chunkText(noChunks);
+
+	ParallelForChunks((int)itemList.size(), noChunks, [&](int chunkNo, int begin, int end)
+	{
+		std::string& outText = chunkText[chunkNo];
+		outText.reserve((end - begin) * 32);
+		for (int itemNo = begin; itemNo < end; itemNo++)
+		{
+			const FItem* pItem = itemList[itemNo];
+			if (pItem != nullptr && pItem->Address >= startAddr)
+				WriteItemText(state, pItem, hexMode, outText);
+		}
+	});
+
+	// join the chunks and write in one go
+	size_t totalSize = 0;
+	for (const std::string& text : chunkText)
+		totalSize += text.size();
+
+	std::string outputText;
+	outputText.reserve(totalSize);
+	for (const std::string& text : chunkText)
+		outputText += text;
+
+	const bool bWritten = fwrite(outputText.data(), 1, outputText.size(), fp) == outputText.size();
+	fclose(fp);
 
-	SetNumberDisplayMode(oldMode);
-	return true;
+	return bWritten;
 }
@@ -2,109 +2,141 @@
 #include "CodeAnalyser/CodeAnalyser.h"
 #include "../SpectrumConstants.h"
 #include "../SpectrumEmu.h"
+#include "../GlobalConfig.h"
 
 #include <json.hpp>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
+#include <cstring>
 #include <Util/GraphicsView.h>
+#include <Util/BackgroundTask.h>
+#include <Util/FileUtil.h>
 #include <Debug/DebugLog.h>
 
+#include <rapidjson/filereadstream.h>
+#include <rapidjson/filewritestream.h>
+#include <rapidjson/prettywriter.h>
+#include <rapidjson/reader.h>
+#include <rapidjson/error/en.h>
+#include <chrono>
+
 using json = nlohmann::json;
 
 // We want to eventually move to using Json as it will allow merging 
-void WriteAddressRangeToJson(FCodeAnalysisState& state, int startAddress, int endAddress, json& jsonDoc);
 void WriteBankToJson(const FSpectrumEmu* pSpectrumEmu, int bankNo, json& jsonDoc);
 void ReadBankFromJson(FSpectrumEmu* pSpectrumEmu, int bankNo, const json& jsonDoc);
 
-bool ExportROMJson(FCodeAnalysisState& state, const char* pJsonFileName)
+static bool IsDataInfoNonDefault(const FDataInfo* pDataInfo)
 {
-	json jsonROMData;
+	return pDataInfo->DataType != EDataType::Byte || pDataInfo->OperandType != EOperandType::Unknown ||
+		pDataInfo->ByteSize != 1 || pDataInfo->Flags != 0 || pDataInfo->Comment.empty() == false ||
+		pDataInfo->Reads.empty() == false || pDataInfo->Writes.empty() == false;
+}
 
-	WriteAddressRangeToJson(state, 0, 0x3fff, jsonROMData);
+// Copy the items mapped in to an address range.
+// This must be done on the UI thread as it reads the live pages.
+static void SnapshotAddressRange(FCodeAnalysisState& state, int startAddress, int endAddress, FAnalysisJsonSnapshot& snapshot)
+{
+	const int kPageMask = FCodeAnalysisPage::kPageSize - 1;
+	snapshot.StartAddress = startAddress;
+	snapshot.EndAddress = endAddress;
 
-	std::ofstream outFileStream(pJsonFileName);
-	if (outFileStream.is_open())
-	{
-		outFileStream << std::setw(4) << jsonROMData << std::endl;
-		return true;
-	}
+	snapshot.LastWriter.reserve(endAddress - startAddress + 1);
+	for (int addr = startAddress; addr <= endAddress; addr++)
+		snapshot.LastWriter.push_back(state.GetWritePage(addr)->LastWriter[addr & kPageMask]);
 
-	return false;
-}
+	int address = startAddress;
+	while (address <= endAddress)
+	{
+		const FCodeAnalysisPage* pPage = state.GetReadPage(address);
+		const int pageAddr = address & kPageMask;
 
-#define WRITE_BANKS 0
+		const FCommentBlock* pCommentBlock = pPage->CommentBlocks[pageAddr];
+		if (pCommentBlock != nullptr && pCommentBlock->Comment.empty() == false)
+		{
+			FJsonSnapshotCommentBlock& commentBlock = snapshot.CommentBlocks.emplace_back();
+			commentBlock.Address = pCommentBlock->Address;
+			commentBlock.Comment = pCommentBlock->Comment;
+		}
 
-bool ExportGameJson(FSpectrumEmu* pSpectrumEmu, const char* pJsonFileName)
-{
-	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
-	json jsonGameData;
+		const FLabelInfo* pLabelInfo = pPage->Labels[pageAddr];
+		if (pLabelInfo)
+		{
+			FJsonSnapshotLabel& label = snapshot.Labels.emplace_back();
+			label.Address = pLabelInfo->Address;
+			label.Name = pLabelInfo->Name;
+			label.Comment = pLabelInfo->Comment;
+			label.Global = pLabelInfo->Global;
+			label.LabelType = pLabelInfo->LabelType;
+			label.References = pLabelInfo->References;
+		}
 
-	// write out RAM
-	const int startAddress = 0x4000;
-	const int endAddress = 0xffff;
+		const FCodeInfo* pCodeInfoItem = pPage->CodeInfo[pageAddr];
+		if (pCodeInfoItem && pCodeInfoItem->Address == address)	// only write code items for first byte of the instruction
+		{
+			FJsonSnapshotCodeInfo& codeInfo = snapshot.CodeInfo.emplace_back();
+			codeInfo.Address = pCodeInfoItem->Address;
+			codeInfo.ByteSize = pCodeInfoItem->ByteSize;
+			codeInfo.Comment = pCodeInfoItem->Comment;
+			codeInfo.Flags = pCodeInfoItem->Flags;
+			codeInfo.OperandType = pCodeInfoItem->OperandType;
+			codeInfo.bSelfModifyingCode = pCodeInfoItem->bSelfModifyingCode;
 
-	WriteAddressRangeToJson(state, startAddress, endAddress, jsonGameData);
+			if (pCodeInfoItem->bSelfModifyingCode == false)	// this is so that we can write info on SMC accesses
+				address += pCodeInfoItem->ByteSize;
+		}
 
-	// Write watches
-	for (const auto& watch : state.GetWatches())
-	{
-		jsonGameData["Watches"].push_back(watch);
+		if (pCodeInfoItem == nullptr || pCodeInfoItem->bSelfModifyingCode)
+		{
+			const FDataInfo* pDataInfo = &state.GetReadPage(address)->DataInfo[address & kPageMask];
+			if (IsDataInfoNonDefault(pDataInfo))
+				snapshot.DataInfo.push_back(*pDataInfo);
+			address += pDataInfo->ByteSize;
+		}
 	}
+}
 
-	// Write character sets
-	for (int i = 0; i < GetNoCharacterSets(); i++)
-	{
-		const FCharacterSet* pCharSet = GetCharacterSetFromIndex(i);
-		json jsonCharacterSet;
-
-		jsonCharacterSet["Address"] = pCharSet->Params.Address;
-		jsonCharacterSet["AttribsAddress"] = pCharSet->Params.AttribsAddress;
-		jsonCharacterSet["MaskInfo"] = pCharSet->Params.MaskInfo;
-		jsonCharacterSet["ColourInfo"] = pCharSet->Params.ColourInfo;
-		jsonCharacterSet["Dynamic"] = pCharSet->Params.bDynamic;
+FAnalysisJsonSnapshot* CreateROMJsonSnapshot(FCodeAnalysisState& state)
+{
+	FAnalysisJsonSnapshot* pSnapshot = new FAnalysisJsonSnapshot;
+	SnapshotAddressRange(state, 0, 0x3fff, *pSnapshot);
+	return pSnapshot;
+}
 
-		jsonGameData["CharacterSets"].push_back(jsonCharacterSet);
-	}
+FAnalysisJsonSnapshot* CreateGameJsonSnapshot(FSpectrumEmu* pSpectrumEmu)
+{
+	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+	FAnalysisJsonSnapshot* pSnapshot = new FAnalysisJsonSnapshot;
 
-	// Write character maps
-	for (int i = 0; i < GetNoCharacterMaps(); i++)
-	{
-		const FCharacterMap* pCharMap = GetCharacterMapFromIndex(i);
-		json jsonCharacterMap;
+	// RAM
+	SnapshotAddressRange(state, 0x4000, 0xffff, *pSnapshot);
 
-		jsonCharacterMap["Address"] = pCharMap->Params.Address;
-		jsonCharacterMap["Width"] = pCharMap->Params.Width;
-		jsonCharacterMap["Height"] = pCharMap->Params.Height;
-		jsonCharacterMap["CharacterSet"] = pCharMap->Params.CharacterSet;
-		jsonCharacterMap["IgnoreCharacter"] = pCharMap->Params.IgnoreCharacter;
+	pSnapshot->Watches = state.GetWatches();
 
-		jsonGameData["CharacterMaps"].push_back(jsonCharacterMap);
-	}
+	for (int i = 0; i < GetNoCharacterSets(); i++)
+		pSnapshot->CharacterSets.push_back(GetCharacterSetFromIndex(i)->Params);
 
-	// Write banks
-#if WRITE_BANKS
-	for (int bankNo = 0; bankNo < 8; bankNo++)
-	{
-		json bankData;
-		if (pSpectrumEmu->RAMPages[bankNo * FSpectrumEmu::kNoBankPages].bUsed)
-		{
-			LOGINFO("Bank %d has been used", bankNo);
-		}
+	for (int i = 0; i < GetNoCharacterMaps(); i++)
+		pSnapshot->CharacterMaps.push_back(GetCharacterMapFromIndex(i)->Params);
 
-		jsonGameData["Banks"].push_back(bankData);
-	}
-#endif
+	return pSnapshot;
+}
 
-	// Write file out
-	std::ofstream outFileStream(pJsonFileName);
-	if (outFileStream.is_open())
-	{
-		outFileStream << std::setw(4) << jsonGameData << std::endl;
-		return true;
-	}
+bool ExportROMJson(FCodeAnalysisState& state, const char* pJsonFileName)
+{
+	FAnalysisJsonSnapshot* pSnapshot = CreateROMJsonSnapshot(state);
+	const bool bSuccess = WriteJsonSnapshot(*pSnapshot, pJsonFileName);
+	delete pSnapshot;
+	return bSuccess;
+}
 
-	return false;
+bool ExportGameJson(FSpectrumEmu* pSpectrumEmu, const char* pJsonFileName)
+{
+	FAnalysisJsonSnapshot* pSnapshot = CreateGameJsonSnapshot(pSpectrumEmu);
+	const bool bSuccess = WriteJsonSnapshot(*pSnapshot, pJsonFileName);
+	delete pSnapshot;
+	return bSuccess;
 }
 
 bool WriteDataInfoToJson(const FDataInfo* pDataInfo, json& jsonDoc, int addressOverride = -1)
@@ -192,43 +224,263 @@ void WriteCommentBlockToJson(const FCommentBlock* pCommentBlock, json& jsonDoc,
 	jsonDoc["CommentBlocks"].push_back(commentBlockJson);
 }
 
-void WriteAddressRangeToJson(FCodeAnalysisState& state, int startAddress,int endAddress, json& jsonDoc)
+// Streaming writer
+// Items are written straight from the snapshot rather than building a whole document first.
+// Keys are written in the sorted order nlohmann::json uses so files saved by older versions diff cleanly.
+
+typedef rapidjson::PrettyWriter<rapidjson::FileWriteStream> FJsonStreamWriter;
+
+static void WriteString(FJsonStreamWriter& writer, const char* pKey, const std::string& str)
 {
-	int address = startAddress;
+	writer.Key(pKey);
+	writer.String(str.c_str(), (rapidjson::SizeType)str.size());
+}
 
-	// info on last writer
-	jsonDoc["LastWriterStart"] = startAddress;
-	for (int addr = startAddress; addr <= endAddress; addr++)
-		jsonDoc["LastWriter"].push_back(state.GetLastWriterForAddress(addr));
-	
-	while(address <= endAddress)
+static void WriteUint(FJsonStreamWriter& writer, const char* pKey, unsigned value)
+{
+	writer.Key(pKey);
+	writer.Uint(value);
+}
+
+static void WriteAddressList(FJsonStreamWriter& writer, const char* pKey, const std::map<uint16_t, int>& addresses)
+{
+	writer.Key(pKey);
+	writer.StartArray();
+	for (const auto& address : addresses)
+		writer.Uint(address.first);
+	writer.EndArray();
+}
+
+static void StreamCodeInfo(FJsonStreamWriter& writer, const FJsonSnapshotCodeInfo* pCodeInfo)
+{
+	writer.StartObject();
+	WriteUint(writer, "Address", pCodeInfo->Address);
+	WriteUint(writer, "ByteSize", pCodeInfo->ByteSize);
+	if (pCodeInfo->Comment.empty() == false)
+		WriteString(writer, "Comment", pCodeInfo->Comment);
+	if (pCodeInfo->Flags != 0)
+		WriteUint(writer, "Flags", pCodeInfo->Flags);
+	if (pCodeInfo->OperandType != EOperandType::Unknown)
+		WriteUint(writer, "OperandType", (unsigned)pCodeInfo->OperandType);
+	if (pCodeInfo->bSelfModifyingCode)
 	{
-		FCommentBlock* pCommentBlock = state.GetCommentBlockForAddress(address);
-		if (pCommentBlock != nullptr)
-			WriteCommentBlockToJson(pCommentBlock, jsonDoc);
+		writer.Key("SMC");
+		writer.Bool(true);
+	}
+	writer.EndObject();
+}
 
-		FLabelInfo* pLabelInfo = state.GetLabelForAddress(address);
-		if (pLabelInfo)
-			WriteLabelInfoToJson(pLabelInfo, jsonDoc);
+static void StreamCommentBlock(FJsonStreamWriter& writer, const FJsonSnapshotCommentBlock* pCommentBlock)
+{
+	writer.StartObject();
+	WriteUint(writer, "Address", pCommentBlock->Address);
+	WriteString(writer, "Comment", pCommentBlock->Comment);
+	writer.EndObject();
+}
 
-		FCodeInfo* pCodeInfoItem = state.GetCodeInfoForAddress(address);
-		if (pCodeInfoItem && pCodeInfoItem->Address == address)	// only write code items for first byte of the instruction
+static void StreamDataInfo(FJsonStreamWriter& writer, const FDataInfo* pDataInfo)
+{
+	writer.StartObject();
+	WriteUint(writer, "Address", pDataInfo->Address);
+	if (pDataInfo->ByteSize != 1)
+		WriteUint(writer, "ByteSize", pDataInfo->ByteSize);
+	if (pDataInfo->DataType == EDataType::CharacterMap)
+		WriteUint(writer, "CharSetAddress", pDataInfo->CharSetAddress);
+	if (pDataInfo->Comment.empty() == false)
+		WriteString(writer, "Comment", pDataInfo->Comment);
+	if (pDataInfo->DataType != EDataType::Byte)
+		WriteUint(writer, "DataType", (unsigned)pDataInfo->DataType);
+	if (pDataInfo->DataType == EDataType::CharacterMap)
+		WriteUint(writer, "EmptyCharNo", pDataInfo->EmptyCharNo);
+	if (pDataInfo->Flags != 0)
+		WriteUint(writer, "Flags", pDataInfo->Flags);
+	if (pDataInfo->OperandType != EOperandType::Unknown)
+		WriteUint(writer, "OperandType", (unsigned)pDataInfo->OperandType);
+	if (pDataInfo->Reads.empty() == false)
+		WriteAddressList(writer, "Reads", pDataInfo->Reads);
+	if (pDataInfo->Writes.empty() == false)
+		WriteAddressList(writer, "Writes", pDataInfo->Writes);
+	writer.EndObject();
+}
+
+static void StreamLabelInfo(FJsonStreamWriter& writer, const FJsonSnapshotLabel* pLabelInfo)
+{
+	writer.StartObject();
+	WriteUint(writer, "Address", pLabelInfo->Address);
+	if (pLabelInfo->Comment.empty() == false)
+		WriteString(writer, "Comment", pLabelInfo->Comment);
+	if (pLabelInfo->Global)
+	{
+		writer.Key("Global");
+		writer.Bool(true);
+	}
+	WriteUint(writer, "LabelType", (unsigned)pLabelInfo->LabelType);
+	WriteString(writer, "Name", pLabelInfo->Name);
+	if (pLabelInfo->References.empty() == false)
+		WriteAddressList(writer, "References", pLabelInfo->References);
+	writer.EndObject();
+}
+
+// progress through the snapshot's items, reported every so often rather than per item
+struct FSnapshotProgress
+{
+	FSnapshotProgress(const FAnalysisJsonSnapshot& snapshot, FBackgroundTask* pTask)
+		: pTask(pTask)
+		, NoItems(snapshot.CodeInfo.size() + snapshot.CommentBlocks.size() + snapshot.DataInfo.size() + snapshot.Labels.size())
+	{
+	}
+
+	void ItemWritten()
+	{
+		if (pTask != nullptr && (++NoItemsWritten & 1023) == 0)
+			pTask->SetProgress((float)NoItemsWritten / (float)NoItems);
+	}
+
+	FBackgroundTask*	pTask;
+	size_t				NoItems;
+	size_t				NoItemsWritten = 0;
+};
+
+// Safe to call from a worker thread
+// Written to a temp file which replaces the json once it's complete, so a failed write leaves the last save intact
+bool WriteJsonSnapshot(const FAnalysisJsonSnapshot& snapshot, const char* pJsonFileName, FBackgroundTask* pTask /* = nullptr */)
+{
+	const std::string tempFileName = std::string(pJsonFileName) + ".tmp";
+	FILE* fp = fopen(tempFileName.c_str(), "wb");
+	if (fp == nullptr)
+		return false;
+
+	FSnapshotProgress progress(snapshot, pTask);
+
+	char writeBuffer[64 * 1024];
+	rapidjson::FileWriteStream outStream(fp, writeBuffer, sizeof(writeBuffer));
+	FJsonStreamWriter writer(outStream);
+	writer.SetIndent(' ', 4);
+
+	writer.StartObject();
+
+	if (snapshot.CharacterMaps.empty() == false)
+	{
+		writer.Key("CharacterMaps");
+		writer.StartArray();
+		for (const FCharMapCreateParams& charMapParams : snapshot.CharacterMaps)
 		{
-			WriteCodeInfoToJson(pCodeInfoItem, jsonDoc);
-			
-			if (pCodeInfoItem->bSelfModifyingCode == false)	// this is so that we can write info on SMC accesses
-				address += pCodeInfoItem->ByteSize;
+			writer.StartObject();
+			WriteUint(writer, "Address", charMapParams.Address);
+			WriteUint(writer, "CharacterSet", charMapParams.CharacterSet);
+			writer.Key("Height");
+			writer.Int(charMapParams.Height);
+			WriteUint(writer, "IgnoreCharacter", charMapParams.IgnoreCharacter);
+			writer.Key("Width");
+			writer.Int(charMapParams.Width);
+			writer.EndObject();
 		}
-		
-		if(pCodeInfoItem == nullptr || pCodeInfoItem->bSelfModifyingCode)
+		writer.EndArray();
+	}
+
+	if (snapshot.CharacterSets.empty() == false)
+	{
+		writer.Key("CharacterSets");
+		writer.StartArray();
+		for (const FCharSetCreateParams& charSetParams : snapshot.CharacterSets)
 		{
-			FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(address);
-			WriteDataInfoToJson(pDataInfo, jsonDoc);
-			address += pDataInfo->ByteSize;
+			writer.StartObject();
+			WriteUint(writer, "Address", charSetParams.Address);
+			WriteUint(writer, "AttribsAddress", charSetParams.AttribsAddress);
+			WriteUint(writer, "ColourInfo", (unsigned)charSetParams.ColourInfo);
+			writer.Key("Dynamic");
+			writer.Bool(charSetParams.bDynamic);
+			WriteUint(writer, "MaskInfo", (unsigned)charSetParams.MaskInfo);
+			writer.EndObject();
 		}
+		writer.EndArray();
 	}
-}
 
+	if (snapshot.CodeInfo.empty() == false)
+	{
+		writer.Key("CodeInfo");
+		writer.StartArray();
+		for (const FJsonSnapshotCodeInfo& codeInfo : snapshot.CodeInfo)
+		{
+			StreamCodeInfo(writer, &codeInfo);
+			progress.ItemWritten();
+		}
+		writer.EndArray();
+	}
+
+	if (snapshot.CommentBlocks.empty() == false)
+	{
+		writer.Key("CommentBlocks");
+		writer.StartArray();
+		for (const FJsonSnapshotCommentBlock& commentBlock : snapshot.CommentBlocks)
+		{
+			StreamCommentBlock(writer, &commentBlock);
+			progress.ItemWritten();
+		}
+		writer.EndArray();
+	}
+
+	if (snapshot.DataInfo.empty() == false)
+	{
+		writer.Key("DataInfo");
+		writer.StartArray();
+		for (const FDataInfo& dataInfo : snapshot.DataInfo)
+		{
+			StreamDataInfo(writer, &dataInfo);
+			progress.ItemWritten();
+		}
+		writer.EndArray();
+	}
+
+	if (snapshot.Labels.empty() == false)
+	{
+		writer.Key("LabelInfo");
+		writer.StartArray();
+		for (const FJsonSnapshotLabel& label : snapshot.Labels)
+		{
+			StreamLabelInfo(writer, &label);
+			progress.ItemWritten();
+		}
+		writer.EndArray();
+	}
+
+	// info on last writer
+	writer.Key("LastWriter");
+	writer.StartArray();
+	for (const uint16_t lastWriter : snapshot.LastWriter)
+		writer.Uint(lastWriter);
+	writer.EndArray();
+	WriteUint(writer, "LastWriterStart", snapshot.StartAddress);
+
+	if (snapshot.Watches.empty() == false)
+	{
+		writer.Key("Watches");
+		writer.StartArray();
+		for (const uint16_t watch : snapshot.Watches)
+			writer.Uint(watch);
+		writer.EndArray();
+	}
+
+	writer.EndObject();
+	outStream.Put('\n');
+	outStream.Flush();
+
+	const bool bWritten = ferror(fp) == 0;
+	if (fclose(fp) != 0 || bWritten == false)
+	{
+		LOGERROR("Failed to write analysis json '%s'", tempFileName.c_str());
+		remove(tempFileName.c_str());
+		return false;
+	}
+
+	remove(pJsonFileName);
+	if (rename(tempFileName.c_str(), pJsonFileName) != 0)
+	{
+		LOGERROR("Failed to replace analysis json '%s'", pJsonFileName);
+		return false;
+	}
+	return true;
+}
 
 FCommentBlock* CreateCommentBlockFromJson(const json& commentBlockJson)
 {
@@ -322,105 +574,463 @@ void LoadDataInfoFromJson(FDataInfo* pDataInfo, const json & dataInfoJson)
 }
 
 
-bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName)
+// Streaming reader
+// Items are built directly as the file is parsed rather than going through a DOM.
+class FAnalysisJsonReader : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, FAnalysisJsonReader>
 {
-	std::ifstream inFileStream(pJsonFileName);
-	if (inFileStream.is_open() == false)
-		return false;
+public:
+	FAnalysisJsonReader(FCodeAnalysisState& state) : State(state) {}
+
+	bool Null() { return true; }
+	bool Bool(bool b) { return Number(b ? 1 : 0); }
+	bool Int(int i) { return Number(i); }
+	bool Uint(unsigned u) { return Number(u); }
+	bool Int64(int64_t i) { return Number(i); }
+	bool Uint64(uint64_t u) { return Number((int64_t)u); }
+	bool Double(double d) { return Number((int64_t)d); }
+
+	bool String(const char* pStr, rapidjson::SizeType length, bool copy);
+	bool Key(const char* pStr, rapidjson::SizeType length, bool copy);
+	bool StartObject();
+	bool EndObject(rapidjson::SizeType memberCount);
+	bool StartArray();
+	bool EndArray(rapidjson::SizeType elementCount);
+
+	// items are staged while parsing and only applied to the state here, so a file that fails to parse changes nothing
+	void Finish(std::vector<FCharSetCreateParams>* pOutCharacterSets, std::vector<FCharMapCreateParams>* pOutCharacterMaps);
+
+private:
+	enum class ESection
+	{
+		None,
+		LastWriter,
+		LastWriterStart,
+		CommentBlocks,
+		CodeInfo,
+		LabelInfo,
+		DataInfo,
+		Watches,
+		CharacterSets,
+		CharacterMaps,
+	};
+
+	bool	Number(int64_t value);
+	void	BeginItem();
+	void	EndItem();
+
+	// depth 1 is the top level object, 2 the section arrays, 3 the items and 4 arrays within items
+	enum { kSectionDepth = 2, kItemDepth = 3, kItemArrayDepth = 4 };
+
+	FCodeAnalysisState&	State;
+	int				Depth = 0;
+	ESection		Section = ESection::None;
+	std::string		ItemKey;
+
+	// items being built
+	FCodeInfo*		pCodeInfo = nullptr;
+	FLabelInfo*		pLabelInfo = nullptr;
+	FCommentBlock*	pCommentBlock = nullptr;
+	FDataInfo		DataInfo;
+	FCharSetCreateParams	CharSetParams;
+	FCharMapCreateParams	CharMapParams;
+
+	// last writer start can come after the array
+	int						LastWriterStart = 0;
+	std::vector<uint16_t>	LastWriters;
+
+	// staged items
+	std::vector<FCodeInfo*>		CodeInfos;
+	std::vector<FLabelInfo*>	Labels;
+	std::vector<FCommentBlock*>	CommentBlocks;
+	std::vector<FDataInfo>		DataInfos;
+	std::vector<uint16_t>		Watches;
+
+	std::vector<FCharSetCreateParams>	CharacterSets;
+	std::vector<FCharMapCreateParams>	CharacterMaps;
+};
+
+bool FAnalysisJsonReader::Key(const char* pStr, rapidjson::SizeType length, bool /*copy*/)
+{
+	if (Depth == 1)
+	{
+		if (strcmp(pStr, "LastWriter") == 0)
+			Section = ESection::LastWriter;
+		else if (strcmp(pStr, "LastWriterStart") == 0)
+			Section = ESection::LastWriterStart;
+		else if (strcmp(pStr, "CommentBlocks") == 0)
+			Section = ESection::CommentBlocks;
+		else if (strcmp(pStr, "CodeInfo") == 0)
+			Section = ESection::CodeInfo;
+		else if (strcmp(pStr, "LabelInfo") == 0)
+			Section = ESection::LabelInfo;
+		else if (strcmp(pStr, "DataInfo") == 0)
+			Section = ESection::DataInfo;
+		else if (strcmp(pStr, "Watches") == 0)
+			Section = ESection::Watches;
+		else if (strcmp(pStr, "CharacterSets") == 0)
+			Section = ESection::CharacterSets;
+		else if (strcmp(pStr, "CharacterMaps") == 0)
+			Section = ESection::CharacterMaps;
+		else
+			Section = ESection::None;
+	}
+	else if (Depth == kItemDepth)
+	{
+		ItemKey.assign(pStr, length);
+	}
+	return true;
+}
+
+bool FAnalysisJsonReader::StartObject()
+{
+	Depth++;
+	if (Depth == kItemDepth)
+		BeginItem();
+	return true;
+}
 
-	json jsonGameData;
+bool FAnalysisJsonReader::EndObject(rapidjson::SizeType /*memberCount*/)
+{
+	if (Depth == kItemDepth)
+		EndItem();
+	Depth--;
+	return true;
+}
 
-	inFileStream >> jsonGameData;
-	inFileStream.close();
+bool FAnalysisJsonReader::StartArray()
+{
+	Depth++;
+	return true;
+}
 
-	// info on last writer
-	if (jsonGameData.contains("LastWriterStart"))
+bool FAnalysisJsonReader::EndArray(rapidjson::SizeType /*elementCount*/)
+{
+	Depth--;
+	return true;
+}
+
+void FAnalysisJsonReader::BeginItem()
+{
+	ItemKey.clear();
+	switch (Section)
 	{
-		const int lwStart = jsonGameData["LastWriterStart"];
+	case ESection::CodeInfo:
+		pCodeInfo = FCodeInfo::Allocate();
+		break;
+	case ESection::LabelInfo:
+		pLabelInfo = FLabelInfo::Allocate();
+		break;
+	case ESection::CommentBlocks:
+		pCommentBlock = FCommentBlock::Allocate();
+		break;
+	case ESection::DataInfo:
+		DataInfo.Reset(0);
+		break;
+	case ESection::CharacterSets:
+		CharSetParams = FCharSetCreateParams();
+		break;
+	case ESection::CharacterMaps:
+		CharMapParams = FCharMapCreateParams();
+		break;
+	default:
+		break;
+	}
+}
 
-		const json& lastWriterArray = jsonGameData["LastWriter"];
-		const int noWriters = (int)lastWriterArray.size();
-		for (int i = 0;i<noWriters;i++)
-			state.SetLastWriterForAddress(lwStart + i, lastWriterArray[i]);
+void FAnalysisJsonReader::EndItem()
+{
+	switch (Section)
+	{
+	case ESection::CodeInfo:
+		CodeInfos.push_back(pCodeInfo);
+		pCodeInfo = nullptr;
+		break;
+	case ESection::LabelInfo:
+		Labels.push_back(pLabelInfo);
+		pLabelInfo = nullptr;
+		break;
+	case ESection::CommentBlocks:
+		CommentBlocks.push_back(pCommentBlock);
+		pCommentBlock = nullptr;
+		break;
+	case ESection::DataInfo:
+		DataInfos.push_back(std::move(DataInfo));
+		break;
+	case ESection::CharacterSets:
+		CharacterSets.push_back(CharSetParams);
+		break;
+	case ESection::CharacterMaps:
+		CharacterMaps.push_back(CharMapParams);
+		break;
+	default:
+		break;
 	}
+}
 
-	if (jsonGameData.contains("CommentBlocks"))
+bool FAnalysisJsonReader::Number(int64_t value)
+{
+	if (Depth == 1)
 	{
-		for (const auto commentBlockJson : jsonGameData["CommentBlocks"])
-		{
-			FCommentBlock* pCommentBlock = CreateCommentBlockFromJson(commentBlockJson);
-			state.SetCommentBlockForAddress(pCommentBlock->Address, pCommentBlock);
-		}
+		if (Section == ESection::LastWriterStart)
+			LastWriterStart = (int)value;
+		return true;
 	}
 
-	if (jsonGameData.contains("CodeInfo"))
+	if (Depth == kSectionDepth)
 	{
-		for (const auto codeInfoJson : jsonGameData["CodeInfo"])
-		{
-			FCodeInfo* pCodeInfo = CreateCodeInfoFromJson(codeInfoJson);
+		if (Section == ESection::LastWriter)
+			LastWriters.push_back((uint16_t)value);
+		else if (Section == ESection::Watches)
+			Watches.push_back((uint16_t)value);
+		return true;
+	}
 
-			for (int codeByte = 0; codeByte < pCodeInfo->ByteSize; codeByte++)	// set for whole instruction address range
-				state.SetCodeInfoForAddress(pCodeInfo->Address + codeByte, pCodeInfo);
-		}
+	if (Depth == kItemArrayDepth)	// address lists
+	{
+		if (Section == ESection::LabelInfo && ItemKey == "References")
+			pLabelInfo->References[(uint16_t)value] = 1;
+		else if (Section == ESection::DataInfo && ItemKey == "Reads")
+			DataInfo.Reads[(uint16_t)value] = 1;
+		else if (Section == ESection::DataInfo && ItemKey == "Writes")
+			DataInfo.Writes[(uint16_t)value] = 1;
+		return true;
 	}
 
-	if (jsonGameData.contains("LabelInfo"))
+	if (Depth != kItemDepth)
+		return true;
+
+	switch (Section)
 	{
-		for (const auto labelInfoJson : jsonGameData["LabelInfo"])
-		{
-			FLabelInfo* pLabelInfo = CreateLabelInfoFromJson(labelInfoJson);
+	case ESection::CodeInfo:
+		if (ItemKey == "Address")
+			pCodeInfo->Address = (uint16_t)value;
+		else if (ItemKey == "ByteSize")
+			pCodeInfo->ByteSize = (uint16_t)value;
+		else if (ItemKey == "SMC")
+			pCodeInfo->bSelfModifyingCode = value != 0;
+		else if (ItemKey == "OperandType")
+			pCodeInfo->OperandType = (EOperandType)value;
+		else if (ItemKey == "Flags")
+			pCodeInfo->Flags = (uint32_t)value;
+		break;
+	case ESection::LabelInfo:
+		if (ItemKey == "Address")
+			pLabelInfo->Address = (uint16_t)value;
+		else if (ItemKey == "Global")
+			pLabelInfo->Global = true;
+		else if (ItemKey == "LabelType")
+			pLabelInfo->LabelType = (ELabelType)value;
+		break;
+	case ESection::CommentBlocks:
+		if (ItemKey == "Address")
+			pCommentBlock->Address = (uint16_t)value;
+		break;
+	case ESection::DataInfo:
+		if (ItemKey == "Address")
+			DataInfo.Address = (uint16_t)value;
+		else if (ItemKey == "DataType")
+			DataInfo.DataType = (EDataType)value;
+		else if (ItemKey == "OperandType")
+			DataInfo.OperandType = (EOperandType)value;
+		else if (ItemKey == "ByteSize")
+			DataInfo.ByteSize = (uint16_t)value;
+		else if (ItemKey == "Flags")
+			DataInfo.Flags = (uint32_t)value;
+		else if (ItemKey == "CharSetAddress")
+			DataInfo.CharSetAddress = (uint16_t)value;
+		else if (ItemKey == "EmptyCharNo")
+			DataInfo.EmptyCharNo = (uint8_t)value;
+		break;
+	case ESection::CharacterSets:
+		if (ItemKey == "Address")
+			CharSetParams.Address = (uint16_t)value;
+		else if (ItemKey == "AttribsAddress")
+			CharSetParams.AttribsAddress = (uint16_t)value;
+		else if (ItemKey == "MaskInfo")
+			CharSetParams.MaskInfo = (EMaskInfo)value;
+		else if (ItemKey == "ColourInfo")
+			CharSetParams.ColourInfo = (EColourInfo)value;
+		else if (ItemKey == "Dynamic")
+			CharSetParams.bDynamic = value != 0;
+		break;
+	case ESection::CharacterMaps:
+		if (ItemKey == "Address")
+			CharMapParams.Address = (uint16_t)value;
+		else if (ItemKey == "Width")
+			CharMapParams.Width = (int)value;
+		else if (ItemKey == "Height")
+			CharMapParams.Height = (int)value;
+		else if (ItemKey == "CharacterSet")
+			CharMapParams.CharacterSet = (uint16_t)value;
+		else if (ItemKey == "IgnoreCharacter")
+			CharMapParams.IgnoreCharacter = (uint8_t)value;
+		break;
+	default:
+		break;
+	}
+	return true;
+}
 
-			state.SetLabelForAddress(pLabelInfo->Address,pLabelInfo);
-		}
+bool FAnalysisJsonReader::String(const char* pStr, rapidjson::SizeType length, bool /*copy*/)
+{
+	if (Depth != kItemDepth)
+		return true;
+
+	switch (Section)
+	{
+	case ESection::CodeInfo:
+		if (ItemKey == "Comment")
+			pCodeInfo->Comment.assign(pStr, length);
+		break;
+	case ESection::LabelInfo:
+		if (ItemKey == "Name")
+			pLabelInfo->Name.assign(pStr, length);
+		else if (ItemKey == "Comment")
+			pLabelInfo->Comment.assign(pStr, length);
+		break;
+	case ESection::CommentBlocks:
+		if (ItemKey == "Comment")
+			pCommentBlock->Comment.assign(pStr, length);
+		break;
+	case ESection::DataInfo:
+		if (ItemKey == "Comment")
+			DataInfo.Comment.assign(pStr, length);
+		break;
+	default:
+		break;
 	}
+	return true;
+}
 
-	if (jsonGameData.contains("DataInfo"))
+void FAnalysisJsonReader::Finish(std::vector<FCharSetCreateParams>* pOutCharacterSets, std::vector<FCharMapCreateParams>* pOutCharacterMaps)
+{
+	for (FCodeInfo* pCodeInfo : CodeInfos)
 	{
-		for (const auto dataInfoJson : jsonGameData["DataInfo"])
-		{
-			const int address = dataInfoJson["Address"];
-			FDataInfo* pDataInfo = state.GetReadDataInfoForAddress(address);
-			LoadDataInfoFromJson(pDataInfo, dataInfoJson);
-		}
+		for (int codeByte = 0; codeByte < pCodeInfo->ByteSize; codeByte++)	// set for whole instruction address range
+			State.SetCodeInfoForAddress(pCodeInfo->Address + codeByte, pCodeInfo);
 	}
+	for (FLabelInfo* pLabelInfo : Labels)
+		State.SetLabelForAddress(pLabelInfo->Address, pLabelInfo);
+	for (FCommentBlock* pCommentBlock : CommentBlocks)
+		State.SetCommentBlockForAddress(pCommentBlock->Address, pCommentBlock);
 
-	if (jsonGameData.contains("Watches"))
+	for (FDataInfo& dataInfo : DataInfos)
 	{
-		for (const auto& watch : jsonGameData["Watches"])
+		FDataInfo* pDataInfo = State.GetReadDataInfoForAddress(dataInfo.Address);
+		pDataInfo->Address = dataInfo.Address;
+		pDataInfo->DataType = dataInfo.DataType;
+		pDataInfo->OperandType = dataInfo.OperandType;
+		pDataInfo->ByteSize = dataInfo.ByteSize;
+		pDataInfo->Flags = dataInfo.Flags;
+		pDataInfo->Comment.swap(dataInfo.Comment);
+		for (const auto& read : dataInfo.Reads)
+			pDataInfo->Reads[read.first] = 1;
+		for (const auto& write : dataInfo.Writes)
+			pDataInfo->Writes[write.first] = 1;
+		if (dataInfo.DataType == EDataType::CharacterMap)
 		{
-			state.AddWatch(watch);
+			pDataInfo->CharSetAddress = dataInfo.CharSetAddress;
+			pDataInfo->EmptyCharNo = dataInfo.EmptyCharNo;
 		}
 	}
 
-	if (jsonGameData.contains("CharacterSets"))
+	for (const uint16_t watch : Watches)
+		State.AddWatch(watch);
+
+	for (int i = 0; i < (int)LastWriters.size(); i++)
+		State.SetLastWriterForAddress(LastWriterStart + i, LastWriters[i]);
+
+	if (pOutCharacterSets != nullptr)
+		*pOutCharacterSets = CharacterSets;
+	else
 	{
-		for (const auto& charSet : jsonGameData["CharacterSets"])
-		{
-			FCharSetCreateParams params;
-			params.Address = charSet["Address"];
-			params.AttribsAddress = charSet["AttribsAddress"];
-			params.MaskInfo = charSet["MaskInfo"];
-			params.ColourInfo = charSet["ColourInfo"];
-			params.bDynamic = charSet["Dynamic"];
-			CreateCharacterSetAt(state, params);
-		}
+		for (const FCharSetCreateParams& params : CharacterSets)
+			CreateCharacterSetAt(State, params);
 	}
 
-	if (jsonGameData.contains("CharacterMaps"))
+	if (pOutCharacterMaps != nullptr)
+		*pOutCharacterMaps = CharacterMaps;
+	else
 	{
-		for (const auto& charMap : jsonGameData["CharacterMaps"])
+		for (const FCharMapCreateParams& params : CharacterMaps)
+			CreateCharacterMap(State, params);
+	}
+}
+
+bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, std::vector<FCharSetCreateParams>* pOutCharacterSets, std::vector<FCharMapCreateParams>* pOutCharacterMaps)
+{
+	FILE* fp = fopen(pJsonFileName, "rb");
+	if (fp == nullptr)
+		return false;
+
+	const FItemAllocationMark allocationMark;
+	char readBuffer[64 * 1024];
+	rapidjson::FileReadStream inStream(fp, readBuffer, sizeof(readBuffer));
+	FAnalysisJsonReader jsonReader(state);
+	rapidjson::Reader reader;
+	const rapidjson::ParseResult result = reader.Parse(inStream, jsonReader);
+	fclose(fp);
+
+	if (result.IsError())
+	{
+		LOGERROR("Error parsing '%s' at offset %d: %s", pJsonFileName, (int)result.Offset(), rapidjson::GetParseError_En(result.Code()));
+		allocationMark.FreeItemsAllocatedSince();	// nothing staged has reached the state
+		return false;
+	}
+
+	jsonReader.Finish(pOutCharacterSets, pOutCharacterMaps);
+	return true;
+}
+
+// Time writing & parsing the current game's analysis json.
+// Load a fully annotated 48K game first for meaningful numbers.
+// The read is a parse only - importing would re-apply the analysis to the live state.
+void BenchmarkAnalysisJson(FSpectrumEmu* pSpectrumEmu)
+{
+	const int kNoIterations = 3;
+	const std::string root = GetGlobalConfig().WorkspaceRoot;
+	const std::string fileName = root + "AnalysisJson/_benchmark.json";
+	double writeTimeMs = 0;
+	double readTimeMs = 0;
+	size_t fileSize = 0;
+	bool bOk = true;
+
+	EnsureDirectoryExists(std::string(root + "AnalysisJson").c_str());
+
+	FAnalysisJsonSnapshot* pSnapshot = CreateGameJsonSnapshot(pSpectrumEmu);
+
+	for (int it = 0; it < kNoIterations; it++)
+	{
+		const auto writeStart = std::chrono::high_resolution_clock::now();
+		bOk &= WriteJsonSnapshot(*pSnapshot, fileName.c_str());
+		const auto writeEnd = std::chrono::high_resolution_clock::now();
+		writeTimeMs += std::chrono::duration<double, std::milli>(writeEnd - writeStart).count();
+
+		const auto readStart = std::chrono::high_resolution_clock::now();
+		FILE* fp = fopen(fileName.c_str(), "rb");
+		if (fp != nullptr)
 		{
-			FCharMapCreateParams params;
-			params.Address = charMap["Address"];
-			params.Width = charMap["Width"];
-			params.Height = charMap["Height"];
-			params.CharacterSet = charMap["CharacterSet"];
-			params.IgnoreCharacter = charMap["IgnoreCharacter"];
-			CreateCharacterMap(state, params);
+			char readBuffer[64 * 1024];
+			rapidjson::FileReadStream inStream(fp, readBuffer, sizeof(readBuffer));
+			rapidjson::BaseReaderHandler<> nullHandler;
+			rapidjson::Reader reader;
+			bOk &= reader.Parse(inStream, nullHandler).IsError() == false;
+			fileSize = ftell(fp);
+			fclose(fp);
 		}
+		else
+		{
+			bOk = false;
+		}
+		const auto readEnd = std::chrono::high_resolution_clock::now();
+		readTimeMs += std::chrono::duration<double, std::milli>(readEnd - readStart).count();
 	}
 
-	return true;
+	remove(fileName.c_str());
+	delete pSnapshot;
+
+	LOGINFO("Analysis json benchmark: %d iterations%s", kNoIterations, bOk ? "" : " - FAILED");
+	LOGINFO("  %d bytes, write %.2fms, parse %.2fms", (int)fileSize, writeTimeMs / kNoIterations, readTimeMs / kNoIterations);
 }
 
 // write a 16K bank to Json
@@ -1,8 +1,70 @@
 #pragma once
 
+#include <cstdint>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "CodeAnalyser/CodeAnaysisPage.h"
+#include "Util/GraphicsView.h"
+
 struct FCodeAnalysisState;
 class FSpectrumEmu;
+class FBackgroundTask;
+
+// Values of the analysis items written to json.
+// These are copies rather than page items so a snapshot doesn't hold on to (or leak) items from the global allocators.
+struct FJsonSnapshotCommentBlock
+{
+	uint16_t	Address = 0;
+	std::string	Comment;
+};
+
+struct FJsonSnapshotLabel
+{
+	uint16_t				Address = 0;
+	std::string				Name;
+	std::string				Comment;
+	bool					Global = false;
+	ELabelType				LabelType = ELabelType::Data;
+	std::map<uint16_t, int>	References;
+};
+
+struct FJsonSnapshotCodeInfo
+{
+	uint16_t		Address = 0;
+	uint16_t		ByteSize = 0;
+	std::string		Comment;
+	uint32_t		Flags = 0;
+	EOperandType	OperandType = EOperandType::Unknown;
+	bool			bSelfModifyingCode = false;
+};
+
+// Copy of the analysis needed to write a json file, items in address order.
+// Taking one is a quick walk of the pages, so the slow json formatting & file writing can be done on a worker thread.
+struct FAnalysisJsonSnapshot
+{
+	int		StartAddress = 0;
+	int		EndAddress = 0;
+	std::vector<uint16_t>					LastWriter;	// one per address of the range
+	std::vector<FJsonSnapshotCommentBlock>	CommentBlocks;
+	std::vector<FJsonSnapshotLabel>			Labels;
+	std::vector<FJsonSnapshotCodeInfo>		CodeInfo;
+	std::vector<FDataInfo>					DataInfo;	// only data items that differ from the defaults
+	std::set<uint16_t>						Watches;
+	std::vector<FCharSetCreateParams>		CharacterSets;
+	std::vector<FCharMapCreateParams>		CharacterMaps;
+};
+
+FAnalysisJsonSnapshot* CreateROMJsonSnapshot(FCodeAnalysisState& state);
+FAnalysisJsonSnapshot* CreateGameJsonSnapshot(FSpectrumEmu* pSpectrumEmu);
+bool WriteJsonSnapshot(const FAnalysisJsonSnapshot& snapshot, const char* pJsonFileName, FBackgroundTask* pTask = nullptr);
 
 bool ExportROMJson(FCodeAnalysisState& state, const char* pJsonFileName);
 bool ExportGameJson(FSpectrumEmu* pSpectrumEmu, const char* pJsonFileName);
-bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName);
\ No newline at end of file
+// Character sets & maps are created unless pOutCharacterSets/pOutCharacterMaps are passed, then they're returned instead
+// e.g. when importing into a scratch state, as character sets & maps are global.
+bool ImportAnalysisJson(FCodeAnalysisState& state, const char* pJsonFileName, std::vector<FCharSetCreateParams>* pOutCharacterSets = nullptr, std::vector<FCharMapCreateParams>* pOutCharacterMaps = nullptr);
+
+void BenchmarkAnalysisJson(FSpectrumEmu* pSpectrumEmu);
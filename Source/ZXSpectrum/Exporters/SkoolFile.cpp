@@ -1,9 +1,10 @@
 #include "SkoolFile.h"
 
 #include "Util/Misc.h"
+#include "Util/BackgroundTask.h"
 
 #include <cassert>
-#include <sstream>
+#include <cstdio>
 
 FSkoolEntry::~FSkoolEntry()
 {
@@ -33,88 +34,127 @@ void FSkoolFile::Parse()
 	// todo
 }
 
-int FSkoolFile::WriteLinesToFile(FILE* fp, const std::string& str)
+void FSkoolFile::WriteCommentLines(const std::string& str, std::string& outText)
 {
-	std::stringstream stringStream(str);
-	std::string line;
-	int linesWritten = 0;
-	while (std::getline(stringStream, line, '\n'))
+	size_t lineStart = 0;
+	while (lineStart < str.size())
 	{
-		if (!line.empty() && line[0] == '@')
-			fprintf(fp, "%s\n", line.c_str());
-		else
-			fprintf(fp, "; %s\n", line.c_str());
-		linesWritten++;
+		size_t lineEnd = str.find('\n', lineStart);
+		if (lineEnd == std::string::npos)
+			lineEnd = str.size();
+
+		if (lineEnd == lineStart || str[lineStart] != '@')
+			outText += "; ";
+		outText.append(str, lineStart, lineEnd - lineStart);
+		outText += '\n';
+		lineStart = lineEnd + 1;
 	}
-	return linesWritten;
 }
 
-bool FSkoolFile::Export(const char* pFilename, Base base)
+void FSkoolFile::WriteEntryText(const FSkoolEntry* pEntry, Base base, std::string& outText) const
 {
-	FILE* fp = fopen(pFilename, "wt");
-
-	if (fp == nullptr)
-		return false;
+	assert(!pEntry->Instructions.empty());
 
-	// go through all the entries and write to disk
-	for (FSkoolEntry* pEntry : Entries)
+	std::vector<std::string> commentLines;
+	for (const FSkoolInstruction* pInst : pEntry->Instructions)
 	{
-		assert(!pEntry->Instructions.empty());
-
-		for (FSkoolInstruction* pInst : pEntry->Instructions)
+		if (!pInst->CommentLines.empty())
 		{
-			if (!pInst->CommentLines.empty())
-			{
-				WriteLinesToFile(fp, pInst->CommentLines);
-			}
+			WriteCommentLines(pInst->CommentLines, outText);
+		}
 
-			if (const char* pLabel = GetLabel(pInst->Address))
-			{
-				fprintf(fp, "@label=%s\n", pLabel);
-			}
+		if (const char* pLabel = GetLabel(pInst->Address))
+		{
+			outText += "@label=";
+			outText += pLabel;
+			outText += '\n';
+		}
 
-			if (!pInst->Comment.empty() || !pInst->Operation.empty())
-			{
-				std::vector<std::string> commentLines;
-				Tokenize(pInst->Comment, '\n', commentLines);
+		if (!pInst->Comment.empty() || !pInst->Operation.empty())
+		{
+			Tokenize(pInst->Comment, '\n', commentLines);
 
-				// code lines always have a semicolon, even if the comment is empty.
-				// other types only have a semicolon if we have a comment or we're in a brace comment segment.
-				bool bDisplaySemicolon = true;
-				if (pEntry->Type != SkoolDirective::Code && pInst->Comment.empty())
-					bDisplaySemicolon = false;
+			// code lines always have a semicolon, even if the comment is empty.
+			// other types only have a semicolon if we have a comment or we're in a brace comment segment.
+			bool bDisplaySemicolon = true;
+			if (pEntry->Type != SkoolDirective::Code && pInst->Comment.empty())
+				bDisplaySemicolon = false;
 
-				for (int i=0; i<commentLines.size(); i++)
+			for (int i=0; i<commentLines.size(); i++)
+			{
+				if (i == 0)
 				{
-					if (i == 0)
-					{
-						fprintf(fp, base == Base::Decimal ? "%c%05d " : "%c$%04X ", pInst->CharPrefix, pInst->Address);
-						fprintf(fp, "%-14s", pInst->Operation.c_str());
-						if (pInst->Operation.length() > 14)
-							fprintf(fp, " ");
-						if (bDisplaySemicolon)
-						{	
-							if (commentLines[i].empty()) 
-								fprintf(fp, ";");
-							else
-								fprintf(fp, "; ");
-						}
-						fprintf(fp, "%s\n", commentLines[i].c_str());
-					}
-					else
-					{
-						fprintf(fp, "%-20s ; %s\n", "", commentLines[i].c_str());
+					char addressText[16];
+					snprintf(addressText, sizeof(addressText), base == Base::Decimal ? "%c%05d " : "%c$%04X ", pInst->CharPrefix, pInst->Address);
+					outText += addressText;
+
+					// operation is padded to 14 characters, longer ones get a separating space
+					outText += pInst->Operation;
+					if (pInst->Operation.length() < 14)
+						outText.append(14 - pInst->Operation.length(), ' ');
+					else if (pInst->Operation.length() > 14)
+						outText += ' ';
+
+					if (bDisplaySemicolon)
+					{	
+						if (commentLines[i].empty()) 
+							outText += ";";
+						else
+							outText += "; ";
 					}
+					outText += commentLines[i];
+					outText += '\n';
+				}
+				else
+				{
+					outText.append(20, ' ');
+					outText += " ; ";
+					outText += commentLines[i];
+					outText += '\n';
 				}
 			}
 		}
-
-		if (pEntry != Entries.back())
-			fprintf(fp, "\n");
 	}
+}
+
+// Entries are formatted in parallel chunks then written with a single write
+bool FSkoolFile::Export(const char* pFilename, Base base)
+{
+	FILE* fp = fopen(pFilename, "wt");
+
+	if (fp == nullptr)
+		return false;
+
+	const int kMinEntriesPerChunk = 64;
+	const int noEntries = (int)Entries.size();
+	const int noChunks = CalcNoParallelChunks(noEntries, kMinEntriesPerChunk);
+	std::vector<std::string> chunkText(noChunks);
+
+	ParallelForChunks(noEntries, noChunks, [&](int chunkNo, int begin, int end)
+	{
+		std::string& outText = chunkText[chunkNo];
+		for (int entryNo = begin; entryNo < end; entryNo++)
+		{
+			WriteEntryText(Entries[entryNo], base, outText);
+
+			if (entryNo != noEntries - 1)
+				outText += '\n';
+		}
+	});
+
+	size_t totalSize = 0;
+	for (const std::string& text : chunkText)
+		totalSize += text.size();
+
+	std::string outputText;
+	outputText.reserve(totalSize);
+	for (const std::string& text : chunkText)
+		outputText += text;
+
+	const bool bWritten = fwrite(outputText.data(), 1, outputText.size(), fp) == outputText.size();
 	fclose(fp);
 
-	return true;
+	return bWritten;
 }
 
 void FSkoolFile::Dump()
@@ -71,7 +71,8 @@ public:
 	const char* GetLabel(uint16_t address) const;
 
 private:
-	int WriteLinesToFile(FILE* fp, const std::string& str);
+	static void WriteCommentLines(const std::string& str, std::string& outText);
+	void WriteEntryText(const FSkoolEntry* pEntry, Base base, std::string& outText) const;
 	void Dump();
 	
 	typedef std::map<uint16_t, std::string> TLabelMap;
@@ -2,12 +2,14 @@
 #include "CodeAnalyser/CodeAnalyser.h"
 #include "Debug/DebugLog.h"
 #include "Util/Misc.h"
+#include "Util/BackgroundTask.h"
 
 #include "SkoolFile.h"
 #include "SkoolFileInfo.h"
 
 #include <cassert>
 #include <chrono>
+#include <vector>
 
 bool IsSpectrumChar(char value)
 {
@@ -185,23 +187,20 @@ public:
 	}
 
 	// Try to add a code/data instruction to the entry from the FItem.
+	// The operation text is generated later by FormatOperations().
 	// Returns true if we added one sucessfully.
 	bool AddInstruction(FSkoolEntry* pEntry, uint16_t addr)
 	{
 		if (pEntry)
 		{
 			FItem* pItem = nullptr;
-			std::string operationText;
 			
 			if (pCodeInfo != nullptr)
 			{
-				UpdateCodeInfoForAddress(State, addr); // what does this do again?
-				operationText = pCodeInfo->Text;
 				pItem = pCodeInfo;
 			}
 			else if (pDataInfo != nullptr)
 			{
-				operationText = MakeDataAsmText(pDataInfo);
 				pItem = pDataInfo;
 			}
 			else
@@ -241,7 +240,8 @@ public:
 			}
 
 			assert(pItem);
-			pEntry->AddInstruction(addr, pItem->Comment, operationText, prefix, commentLines);
+			FSkoolInstruction* pInstruction = pEntry->AddInstruction(addr, pItem->Comment, std::string(), prefix, commentLines);
+			PendingOperations.push_back({ pInstruction, pCodeInfo, pCodeInfo == nullptr ? pDataInfo : nullptr });
 			return true;
 		}
 		return false;
@@ -258,13 +258,39 @@ public:
 		}
 
 		BuildSkoolFile(startAddr, endAddr);
+		FormatOperations();
 
 		//SkoolFile.Dump();
 		
 		return SkoolFile.Export(pFilename, base);
 	}
 
-	std::string MakeDataAsmText(const FDataInfo* pDataInfo)
+	// Generate the disassembly text for the instructions in parallel chunks.
+	// The workers only read the code analysis & memory, so every page is loaded first and the emulator doesn't run until they finish.
+	// GenerateDasmText produces the same text UpdateCodeInfoForAddress used to write back to the code info, without the write.
+	void FormatOperations()
+	{
+		const ENumberDisplayMode displayMode = Base == FSkoolFile::Base::Hexadecimal ? ENumberDisplayMode::HexDollar : ENumberDisplayMode::Decimal;
+		const int kMinOperationsPerChunk = 1024;
+		const int noOperations = (int)PendingOperations.size();
+
+		State.LoadAllPendingPages();
+		ParallelForChunks(noOperations, CalcNoParallelChunks(noOperations, kMinOperationsPerChunk), [&](int, int begin, int end)
+		{
+			for (int opNo = begin; opNo < end; opNo++)
+			{
+				const FPendingOperation& operation = PendingOperations[opNo];
+				if (operation.pCodeInfo != nullptr)
+					operation.pInstruction->Operation = GenerateDasmText(State, operation.pInstruction->Address, displayMode);
+				else
+					operation.pInstruction->Operation = MakeDataAsmText(operation.pDataInfo);
+			}
+		});
+
+		PendingOperations.clear();
+	}
+
+	std::string MakeDataAsmText(const FDataInfo* pDataInfo) const
 	{
 		std::string asmText;
 		char tmp[16] = { 0 };
@@ -386,6 +412,15 @@ private:
 
 	FSkoolFile::Base Base = FSkoolFile::Base::Hexadecimal;
 
+	// instructions waiting for their operation text
+	struct FPendingOperation
+	{
+		FSkoolInstruction*	pInstruction = nullptr;
+		const FCodeInfo*	pCodeInfo = nullptr;
+		const FDataInfo*	pDataInfo = nullptr;
+	};
+	std::vector<FPendingOperation>	PendingOperations;
+
 	FSkoolFile SkoolFile;
 	FCodeAnalysisState& State;
 	const FSkoolFileInfo* pSkoolInfo = nullptr;
@@ -399,13 +434,6 @@ bool ExportSkoolFile(FCodeAnalysisState& state, const char* pTextFileName, FSkoo
 
 	FSkoolKitExporter exporter = FSkoolKitExporter(state, pSkoolInfo);
 
-	const ENumberDisplayMode previousDisplayMode = GetNumberDisplayMode();
-
-	if (base == FSkoolFile::Base::Hexadecimal)
-		SetNumberDisplayMode(ENumberDisplayMode::HexDollar);
-	else
-		SetNumberDisplayMode(ENumberDisplayMode::Decimal);
-
 	bool bExportedOk = exporter.Export(pTextFileName, startAddr, endAddr, base);
 
 	if (bExportedOk)
@@ -413,10 +441,9 @@ bool ExportSkoolFile(FCodeAnalysisState& state, const char* pTextFileName, FSkoo
 	else
 		LOGINFO("Failed to export '%s'", pTextFileName);
 
-	SetNumberDisplayMode(previousDisplayMode);
 	state.SetCodeAnalysisDirty();
 
 	std::chrono::duration<double, std::milli> ms_double = std::chrono::high_resolution_clock::now() - t1;
-	LOGDEBUG("Exporting %s took %.2f ms", pTextFileName, ms_double);
+	LOGDEBUG("Exporting %s took %.2f ms", pTextFileName, ms_double.count());
 	return true;
 }
\ No newline at end of file
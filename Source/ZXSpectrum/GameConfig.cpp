@@ -3,6 +3,7 @@
 #include "Util/FileUtil.h"
 #include "json.hpp"
 //#include "magic_enum.hpp"
+#include <algorithm>
 #include <iomanip>
 #include <fstream>
 #include <sstream>
@@ -34,7 +35,8 @@ FGameConfig * CreateNewGameConfigFromSnapshot(const FGameSnapshot& snapshot)
 	FGameConfig *pNewConfig = new FGameConfig;
 
 	pNewConfig->Name = RemoveFileExtension(snapshot.DisplayName.c_str());
-	pNewConfig->SnapshotFile = GetFileFromPath(snapshot.FileName.c_str());
+	std::replace(pNewConfig->Name.begin(), pNewConfig->Name.end(), '/', '_');	// name is used for file names, archive entries have a path
+	pNewConfig->SnapshotFile = GetSnapshotFileFromPath(snapshot.FileName.c_str());
 	pNewConfig->pViewerConfig = GetViewConfigForGame(pNewConfig->Name.c_str());
 
 	return pNewConfig;
@@ -45,6 +47,7 @@ bool SaveGameConfigToFile(const FGameConfig &config, const char *fname)
 	json jsonConfigFile;
 	jsonConfigFile["Name"] = config.Name;
 	jsonConfigFile["SnapshotFile"] = config.SnapshotFile;
+	jsonConfigFile["SaveGeneration"] = config.SaveGeneration;
 
 	for (const auto&sprConfigIt : config.SpriteConfigs)
 	{
@@ -115,8 +118,10 @@ bool LoadGameConfigFromFile(FGameConfig &config, const char *fname)
 	}
 	if (jsonConfigFile["SnapshotFile"].is_null() == false)
 	{
-		config.SnapshotFile = GetFileFromPath(jsonConfigFile["SnapshotFile"].get<std::string>().c_str());
+		config.SnapshotFile = GetSnapshotFileFromPath(jsonConfigFile["SnapshotFile"].get<std::string>().c_str());
 	}
+	if (jsonConfigFile["SaveGeneration"].is_null() == false)
+		config.SaveGeneration = jsonConfigFile["SaveGeneration"].get<uint32_t>();
 	config.pViewerConfig = GetViewConfigForGame(config.Name.c_str());
 
 	for(const auto & jsonSprConfig : jsonConfigFile["SpriteConfigs"])
@@ -61,6 +61,7 @@ struct FGameConfig
 	std::string		Name;
 	std::string		SnapshotFile;
 	bool			WriteSnapshot = false;
+	uint32_t		SaveGeneration = 0;	// bumped on each full save, the analysis journal is only replayed over a matching save
 
 	FViewerConfig *pViewerConfig = nullptr;
 
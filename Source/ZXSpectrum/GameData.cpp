@@ -13,7 +13,10 @@
 #include "GameConfig.h"
 #include "Debug/DebugLog.h"
 #include "Util/Misc.h"
+#include "Util/MemoryBuffer.h"
 #include <Util/GraphicsView.h>
+#include "Exporters/JsonExport.h"
+#include <algorithm>
 
 static const int g_kBinaryFileVersionNo = 17;
 static const int g_kBinaryFileMagic = 0xdeadface;
@@ -820,3 +823,193 @@ bool LoadROMData(FCodeAnalysisState& state, const char* fname)
 	fclose(fp);
 	return true;
 }
+
+// Compiled ROM analysis cache
+// Parsing the ROM analysis json on every launch is slow, so the first load compiles it into a binary image of the ROM pages.
+// The image is page relative so it can be applied to whichever set of ROM pages is mapped in (48K or 128K).
+// It's rebuilt whenever the json's size or modified time changes.
+
+static const uint32_t kROMCacheMagic = 0x524f4d43;	// 'ROMC'
+static const uint32_t kROMCacheVersion = 2;			// 2 - json size & modified time key, character sets & maps
+static const int kNoROMAnalysisPages = 0x4000 / FCodeAnalysisPage::kPageSize;
+
+static bool CompileROMAnalysisCache(const char* pJsonFileName, size_t jsonSize, int64_t jsonModifiedTime, FMemoryBuffer& cacheBuffer)
+{
+	// import into a scratch state so label names aren't affected by what's already loaded
+	const FItemAllocationMark allocationMark;
+	const int kNoAddressPages = (1 << 16) / FCodeAnalysisPage::kPageSize;
+	FCodeAnalysisState* pScratchState = new FCodeAnalysisState;
+	FCodeAnalysisPage* pScratchPages = new FCodeAnalysisPage[kNoROMAnalysisPages + 1];	// extra page catches anything outside the ROM
+	for (int pageNo = 0; pageNo <= kNoROMAnalysisPages; pageNo++)
+		pScratchPages[pageNo].Initialise(pageNo * FCodeAnalysisPage::kPageSize);
+	for (int pageNo = 0; pageNo < kNoAddressPages; pageNo++)
+	{
+		FCodeAnalysisPage* pPage = &pScratchPages[std::min(pageNo, kNoROMAnalysisPages)];
+		pScratchState->SetCodeAnalysisRWPage(pageNo, pPage, pPage);
+	}
+
+	// character sets & maps are global, so keep them to create against the real state
+	std::vector<FCharSetCreateParams> characterSets;
+	std::vector<FCharMapCreateParams> characterMaps;
+	const bool bImported = ImportAnalysisJson(*pScratchState, pJsonFileName, &characterSets, &characterMaps);
+	if (bImported)
+	{
+		cacheBuffer.Init(256 * 1024);
+		cacheBuffer.Write(kROMCacheMagic);
+		cacheBuffer.Write(kROMCacheVersion);
+		cacheBuffer.Write((uint64_t)jsonSize);
+		cacheBuffer.Write(jsonModifiedTime);
+		for (int pageNo = 0; pageNo < kNoROMAnalysisPages; pageNo++)
+		{
+			pScratchPages[pageNo].WriteToBuffer(cacheBuffer);
+			cacheBuffer.WriteBytes(pScratchPages[pageNo].LastWriter, sizeof(pScratchPages[pageNo].LastWriter));
+		}
+
+		cacheBuffer.Write((uint32_t)characterSets.size());
+		for (const FCharSetCreateParams& params : characterSets)
+		{
+			cacheBuffer.Write(params.Address);
+			cacheBuffer.Write(params.AttribsAddress);
+			cacheBuffer.Write((int32_t)params.MaskInfo);
+			cacheBuffer.Write((int32_t)params.ColourInfo);
+			cacheBuffer.Write(params.bDynamic);
+		}
+		cacheBuffer.Write((uint32_t)characterMaps.size());
+		for (const FCharMapCreateParams& params : characterMaps)
+		{
+			cacheBuffer.Write(params.Address);
+			cacheBuffer.Write((int32_t)params.Width);
+			cacheBuffer.Write((int32_t)params.Height);
+			cacheBuffer.Write(params.CharacterSet);
+			cacheBuffer.Write(params.IgnoreCharacter);
+		}
+	}
+
+	delete[] pScratchPages;
+	delete pScratchState;
+	allocationMark.FreeItemsAllocatedSince();
+	return bImported;
+}
+
+// Merge a page read from the cache in to a ROM page, the same way importing the json would:
+// items in the cache replace what's there, data access history is added to rather than replaced.
+static void MergeROMAnalysisPage(FCodeAnalysisState& state, const FCodeAnalysisPage& cachedPage, FCodeAnalysisPage& page)
+{
+	for (int pageAddr = 0; pageAddr < FCodeAnalysisPage::kPageSize; pageAddr++)
+	{
+		if (cachedPage.Labels[pageAddr] != nullptr)
+		{
+			page.Labels[pageAddr] = cachedPage.Labels[pageAddr];
+			state.EnsureUniqueLabelName(page.Labels[pageAddr]->Name);	// register label names so later labels don't clash
+		}
+		if (cachedPage.CodeInfo[pageAddr] != nullptr)
+			page.CodeInfo[pageAddr] = cachedPage.CodeInfo[pageAddr];
+		if (cachedPage.CommentBlocks[pageAddr] != nullptr)
+			page.CommentBlocks[pageAddr] = cachedPage.CommentBlocks[pageAddr];
+
+		const FDataInfo& cachedDataInfo = cachedPage.DataInfo[pageAddr];
+		FDataInfo& dataInfo = page.DataInfo[pageAddr];
+		dataInfo.DataType = cachedDataInfo.DataType;
+		dataInfo.OperandType = cachedDataInfo.OperandType;
+		dataInfo.ByteSize = cachedDataInfo.ByteSize;
+		dataInfo.Flags = cachedDataInfo.Flags;
+		dataInfo.Comment = cachedDataInfo.Comment;
+		if (cachedDataInfo.DataType == EDataType::CharacterMap)
+		{
+			dataInfo.CharSetAddress = cachedDataInfo.CharSetAddress;
+			dataInfo.EmptyCharNo = cachedDataInfo.EmptyCharNo;
+		}
+		dataInfo.Reads.insert(cachedDataInfo.Reads.begin(), cachedDataInfo.Reads.end());
+		dataInfo.Writes.insert(cachedDataInfo.Writes.begin(), cachedDataInfo.Writes.end());
+	}
+
+	memcpy(page.LastWriter, cachedPage.LastWriter, sizeof(page.LastWriter));
+}
+
+static bool ApplyROMAnalysisCache(FCodeAnalysisState& state, FMemoryBuffer& cacheBuffer, size_t jsonSize, int64_t jsonModifiedTime)
+{
+	if (cacheBuffer.Read<uint32_t>() != kROMCacheMagic || cacheBuffer.Read<uint32_t>() != kROMCacheVersion)
+		return false;
+	if (cacheBuffer.Read<uint64_t>() != (uint64_t)jsonSize || cacheBuffer.Read<int64_t>() != jsonModifiedTime)	// out of date
+		return false;
+
+	// each page is read in to a scratch page first so a bad cache doesn't leave a page half loaded
+	FCodeAnalysisPage* pCachedPage = new FCodeAnalysisPage;
+	bool bOk = true;
+	for (int pageNo = 0; pageNo < kNoROMAnalysisPages && bOk; pageNo++)
+	{
+		const FItemAllocationMark allocationMark;
+		FCodeAnalysisPage* pPage = state.GetReadPage(pageNo * FCodeAnalysisPage::kPageSize);
+		pCachedPage->Initialise(pPage->BaseAddress);
+		bOk = pCachedPage->ReadFromBuffer(cacheBuffer);
+		cacheBuffer.ReadBytes(pCachedPage->LastWriter, sizeof(pCachedPage->LastWriter));
+		bOk = bOk && cacheBuffer.HasReadError() == false;
+		if (bOk)
+			MergeROMAnalysisPage(state, *pCachedPage, *pPage);
+		else
+			allocationMark.FreeItemsAllocatedSince();
+	}
+	delete pCachedPage;
+	state.LabelsChanged();	// labels merged in directly
+	if (bOk == false)
+		return false;
+
+	// pages only hold the part of an instruction inside them, restore the rest
+	for (int addr = 0; addr < 0x4000; addr++)
+	{
+		FCodeInfo* pCodeInfo = state.GetCodeInfoForAddress(addr);
+		if (pCodeInfo == nullptr || pCodeInfo->Address != addr)
+			continue;
+		for (int codeByte = 1; codeByte < pCodeInfo->ByteSize; codeByte++)
+			state.SetCodeInfoForAddress(addr + codeByte, pCodeInfo);
+	}
+
+	const uint32_t noCharacterSets = cacheBuffer.Read<uint32_t>();
+	for (uint32_t i = 0; i < noCharacterSets && cacheBuffer.HasReadError() == false; i++)
+	{
+		FCharSetCreateParams params;
+		params.Address = cacheBuffer.Read<uint16_t>();
+		params.AttribsAddress = cacheBuffer.Read<uint16_t>();
+		params.MaskInfo = (EMaskInfo)cacheBuffer.Read<int32_t>();
+		params.ColourInfo = (EColourInfo)cacheBuffer.Read<int32_t>();
+		params.bDynamic = cacheBuffer.Read<bool>();
+		if (cacheBuffer.HasReadError() == false)
+			CreateCharacterSetAt(state, params);
+	}
+	const uint32_t noCharacterMaps = cacheBuffer.Read<uint32_t>();
+	for (uint32_t i = 0; i < noCharacterMaps && cacheBuffer.HasReadError() == false; i++)
+	{
+		FCharMapCreateParams params;
+		params.Address = cacheBuffer.Read<uint16_t>();
+		params.Width = cacheBuffer.Read<int32_t>();
+		params.Height = cacheBuffer.Read<int32_t>();
+		params.CharacterSet = cacheBuffer.Read<uint16_t>();
+		params.IgnoreCharacter = cacheBuffer.Read<uint8_t>();
+		if (cacheBuffer.HasReadError() == false)
+			CreateCharacterMap(state, params);
+	}
+
+	return cacheBuffer.HasReadError() == false;
+}
+
+// Load the ROM analysis json into the currently mapped ROM pages, via the compiled cache if it's up to date
+bool LoadROMAnalysis(FCodeAnalysisState& state, const char* pJsonFileName, const char* pCacheFileName)
+{
+	size_t jsonSize = 0;
+	int64_t jsonModifiedTime = 0;
+	if (GetFileSizeAndModifiedTime(pJsonFileName, jsonSize, jsonModifiedTime) == false)
+		return false;
+
+	FMemoryBuffer cacheBuffer;
+	if (cacheBuffer.LoadFromFile(pCacheFileName) && ApplyROMAnalysisCache(state, cacheBuffer, jsonSize, jsonModifiedTime))
+		return true;
+
+	LOGINFO("Compiling ROM analysis '%s' to '%s'", pJsonFileName, pCacheFileName);
+	if (CompileROMAnalysisCache(pJsonFileName, jsonSize, jsonModifiedTime, cacheBuffer) == false)
+		return false;
+
+	if (cacheBuffer.SaveToFile(pCacheFileName) == false)
+		LOGWARNING("Could not save ROM analysis cache '%s'", pCacheFileName);
+
+	return ApplyROMAnalysisCache(state, cacheBuffer, jsonSize, jsonModifiedTime);
+}
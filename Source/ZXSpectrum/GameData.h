@@ -8,6 +8,7 @@ bool LoadGameData(FSpectrumEmu* pSpectrumEmu, const char* fname);
 
 bool SaveROMData(const FCodeAnalysisState& state, const char* fname);
 bool LoadROMData(FCodeAnalysisState& state, const char* fname);
+bool LoadROMAnalysis(FCodeAnalysisState& state, const char* pJsonFileName, const char* pCacheFileName);
 
 bool SaveGameState(FSpectrumEmu* pSpectrumEmu, const char* fname);
 bool LoadGameState(FSpectrumEmu* pSpectrumEmu, const char* fname);
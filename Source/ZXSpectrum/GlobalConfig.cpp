@@ -35,6 +35,8 @@ bool LoadGlobalConfig(const char* fileName)
 		config.bShowOpcodeValues = jsonConfigFile["ShowOpcodeValues"];
 	config.LastGame = jsonConfigFile["LastGame"];
 	config.NumberDisplayMode = (ENumberDisplayMode)jsonConfigFile["NumberMode"];
+	if (jsonConfigFile.contains("AutoSaveInterval"))
+		config.AutoSaveInterval = jsonConfigFile["AutoSaveInterval"];
 
 	if(jsonConfigFile.contains("WorkspaceRoot"))
 		config.WorkspaceRoot = jsonConfigFile["WorkspaceRoot"];
@@ -67,6 +69,7 @@ bool SaveGlobalConfig(const char* fileName)
 	jsonConfigFile["ShowOpcodeValues"] = config.bShowOpcodeValues;
 	jsonConfigFile["LastGame"] = config.LastGame;
 	jsonConfigFile["NumberMode"] = (int)config.NumberDisplayMode;
+	jsonConfigFile["AutoSaveInterval"] = config.AutoSaveInterval;
 	jsonConfigFile["WorkspaceRoot"] = config.WorkspaceRoot;
 	jsonConfigFile["SnapshotFolder"] = config.SnapshotFolder;
 	jsonConfigFile["PokesFolder"] = config.PokesFolder;
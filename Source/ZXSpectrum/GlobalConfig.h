@@ -10,6 +10,7 @@ struct FGlobalConfig
 	bool				bShowOpcodeValues = false;
 	ENumberDisplayMode	NumberDisplayMode = ENumberDisplayMode::HexAitch;
 	std::string			LastGame;
+	int					AutoSaveInterval = 60;	// seconds between analysis journal saves, 0 to disable
 
 	std::string			WorkspaceRoot = "./";
 	std::string			SnapshotFolder = "./Games/";
@@ -4,29 +4,36 @@
 #include "CodeAnalyser/CodeAnalyser.h"
 #include "Debug/DebugLog.h"
 #include "Util/Misc.h"
+#include "Util/FileUtil.h"
 
 #include <algorithm> // for std::count
+#include <charconv>
+#include <cstdlib>
+#include <string_view>
+#include <vector>
 
-const std::string kWhiteSpace = " \n\r\t\f\v";
+static const char* const kWhiteSpace = " \n\r\t\f\v";
 const char kSkoolkitDirectiveNone = '-';
 
+// Lines are parsed in place as views into the loaded file, so nothing is allocated per line.
+// Views are only copied into strings when they're stored in the analysis.
 struct FSkoolkitInstruction
 {
 	char BlockDirective = kSkoolkitDirectiveNone;
 	char SubBlockDirective = kSkoolkitDirectiveNone;
 	bool bBranchDestination = false; // is this address a branch destination (i.e. a line starting with an asterisk '*')
 	uint16_t Address = 0;
-	std::string Comment;
-	std::string Operation; // the disassembly text
+	std::string_view Comment;
+	std::string_view Operation; // the disassembly text
 };
 
-std::string TrimLeadingChars(const std::string& str, const std::string& charsToTrim)
+std::string_view TrimLeadingChars(std::string_view str, const char* charsToTrim)
 {
 	size_t start = str.find_first_not_of(charsToTrim);
-	return (start == std::string::npos) ? "" : str.substr(start);
+	return (start == std::string_view::npos) ? std::string_view() : str.substr(start);
 }
 
-std::string TrimLeadingWhitespace(const std::string& str)
+std::string_view TrimLeadingWhitespace(std::string_view str)
 {
 	return TrimLeadingChars(str, kWhiteSpace);
 }
@@ -39,14 +46,40 @@ void RemoveCarriageReturn(std::string& str)
 		str.pop_back();
 }
 
-bool StringStartsWith(const std::string& str, const std::string& substring)
+bool StringStartsWith(std::string_view str, std::string_view substring)
 {
-	return (str.rfind(substring, 0) == 0);
+	return str.compare(0, substring.size(), substring) == 0;
 }
 
-char GetDirectiveFromAsm(const std::string& str)
+// Parse a whole field as a number, ignoring surrounding spaces. Unlike strtol this can tell a failure apart from 0.
+bool ParseNumber(std::string_view str, int base, uint16_t& outValue)
 {
-	if (StringStartsWith(str, "DEF") || StringStartsWith(str, "def"))
+	str = TrimLeadingChars(str, " ");
+	const size_t end = str.find_last_not_of(' ');
+	str = end == std::string_view::npos ? std::string_view() : str.substr(0, end + 1);
+	const std::from_chars_result result = std::from_chars(str.data(), str.data() + str.size(), outValue, base);
+	return result.ec == std::errc() && str.empty() == false && result.ptr == str.data() + str.size();
+}
+
+// Get the next line from the buffer, without its line ending.
+// Windows line endings are handled here as the file is no longer read in text mode.
+bool GetNextLine(std::string_view& buffer, std::string_view& outLine)
+{
+	if (buffer.empty())
+		return false;
+
+	const size_t lineEnd = buffer.find('\n');
+	outLine = buffer.substr(0, lineEnd);
+	buffer = lineEnd == std::string_view::npos ? std::string_view() : buffer.substr(lineEnd + 1);
+
+	if (!outLine.empty() && outLine.back() == '\r')
+		outLine.remove_suffix(1);
+	return true;
+}
+
+char GetDirectiveFromAsm(std::string_view str)
+{
+	if (str.size() > 3 && (StringStartsWith(str, "DEF") || StringStartsWith(str, "def")))
 	{
 		if (str[3] == 'B' || str[3] == 'b')
 			return 'b';
@@ -61,7 +94,7 @@ char GetDirectiveFromAsm(const std::string& str)
 	return 'c';
 }
 
-bool ParseInstruction(std::string strLine, FSkoolkitInstruction& instruction)
+bool ParseInstruction(std::string_view strLine, FSkoolkitInstruction& instruction)
 {
 	if (strLine.length() < 6)
 		return false;
@@ -74,47 +107,23 @@ bool ParseInstruction(std::string strLine, FSkoolkitInstruction& instruction)
 	if (strLine[1] == '$')
 	{
 		// hexadecimal address
-		std::string numStr = strLine.substr(2, 4);
-		instruction.Address = static_cast<uint16_t>(strtol(numStr.c_str(), nullptr, 16));
-		if (instruction.Address == 0)
-		{
-			if (numStr == "0000")
-			{
-				// Deal with the special case of the address being 0.
-				// We do this because strtol will return 0 if it fails.
-				// We want to differentiate between a valid address of 0 and a failure.
-			}
-			else
-			{
-				return false;
-			}
-		}
+		if (!ParseNumber(strLine.substr(2, 4), 16, instruction.Address))
+			return false;
 	}
 	else
 	{
 		// decimal address
-		std::string numStr = strLine.substr(1, 5);
-		instruction.Address = static_cast<uint16_t>(strtol(numStr.c_str(), nullptr, 10));
-		if (instruction.Address == 0)
-		{
-			if (numStr == "00000")
-			{
-				// do nothing
-			}
-			else
-			{
-				return false;
-			}
-		}
+		if (!ParseNumber(strLine.substr(1, 5), 10, instruction.Address))
+			return false;
 	}
 
 	const size_t opStart = 7;
-	size_t opLen = std::string::npos;
+	size_t opLen = std::string_view::npos;
 
 	// get the comment string
 	// todo deal with semicolons in strings
 	const size_t semicolonPos = strLine.find_first_of(';');
-	if (semicolonPos != std::string::npos)
+	if (semicolonPos != std::string_view::npos)
 	{
 		// calculate where the operation text begins
 		opLen = semicolonPos - opStart;
@@ -124,7 +133,7 @@ bool ParseInstruction(std::string strLine, FSkoolkitInstruction& instruction)
 		// skip ';' and leading space of comment
 		size_t commentStart = semicolonPos + 2;
 
-		if (commentStart == strLen)
+		if (commentStart == strLen + 1)
 		{
 			// Special case. We have an empty comment.
 			// Empty comments occur in the skool file on data lines when we're between lines that contain 
@@ -133,33 +142,30 @@ bool ParseInstruction(std::string strLine, FSkoolkitInstruction& instruction)
 			// to be written out when exporting.
 			instruction.Comment = "\n";
 		}
-		else if (commentStart < strLen)
+		else if (commentStart <= strLen)
 		{
 			instruction.Comment = strLine.substr(commentStart);
-
-			RemoveCarriageReturn(instruction.Comment); // do I need to do this?
 		}
 	}
 	
 	// skip trailing spaces of disassembly text
-	if (semicolonPos != std::string::npos)
+	if (semicolonPos != std::string_view::npos)
 	{
 		size_t opEnd = strLine.find_last_not_of(' ', semicolonPos-1);
-		if (opEnd != std::string::npos)
+		if (opEnd != std::string_view::npos)
 			opLen = opEnd+1 - opStart;
 	}
 
 	// get the disassembly text inbetween the address and the comment
-	instruction.Operation = strLine.substr(opStart, opLen);
-
-	RemoveCarriageReturn(instruction.Operation);
+	if (opStart < strLine.length())
+		instruction.Operation = strLine.substr(opStart, opLen);
 
 	instruction.SubBlockDirective = GetDirectiveFromAsm(instruction.Operation);
 
 	return true;
 }
 
-bool ParseAsmDirective(FCodeAnalysisState& state, const std::string& strLine, std::string& label)
+bool ParseAsmDirective(FCodeAnalysisState& state, std::string_view strLine, std::string& label)
 {
 	if (StringStartsWith(strLine, "@label="))
 	{
@@ -168,11 +174,9 @@ bool ParseAsmDirective(FCodeAnalysisState& state, const std::string& strLine, st
 		// eg @label=START
 
 		size_t eqLoc = strLine.find('=');
-		if (eqLoc != std::string::npos)
+		if (eqLoc != std::string_view::npos)
 		{
 			label = strLine.substr(eqLoc + 1);
-			if (label.back() == '\n' || label.back() == '\r')
-				label.pop_back();
 		}
 		return true;
 	}
@@ -183,25 +187,23 @@ bool ParseAsmDirective(FCodeAnalysisState& state, const std::string& strLine, st
 		// eg @equ=KSTATE=$5C00
 
 		size_t eqLoc = strLine.find('=');
-		if (eqLoc != std::string::npos)
+		if (eqLoc != std::string_view::npos)
 		{
-			std::string str = strLine.substr(eqLoc + 1);
+			std::string_view str = strLine.substr(eqLoc + 1);
 
 			// split into label and address
 			eqLoc = str.find('=');
-			if (eqLoc != std::string::npos)
+			if (eqLoc != std::string_view::npos)
 			{
-				std::string labelStr = str.substr(0, eqLoc);
-				std::string addressStr = str.substr(eqLoc + 1);
-				if (addressStr[0] == '$')
+				std::string_view labelStr = str.substr(0, eqLoc);
+				std::string_view addressStr = str.substr(eqLoc + 1);
+				uint16_t address = 0;
+				if (!addressStr.empty() && addressStr[0] == '$' && ParseNumber(addressStr.substr(1, 4), 16, address))
 				{
-					addressStr = addressStr.substr(1, 4);
-					uint16_t address = static_cast<uint16_t>(std::stoul(addressStr, nullptr, 16));
-
 					AddLabelAtAddress(state, address);
 					if (FLabelInfo* pLabelInfo = state.GetLabelForAddress(address))
 					{
-						SetLabelName(state, pLabelInfo, labelStr.c_str());
+						SetLabelName(state, pLabelInfo, std::string(labelStr).c_str());
 					}
 				}
 				// todo: decimal and 0x notation
@@ -216,7 +218,7 @@ bool ParseAsmDirective(FCodeAnalysisState& state, const std::string& strLine, st
 
 // Split a string containing comma delimited items into individual strings.
 // Items can be text in quotes or numeric values.
-void SplitCommaDelimitedItems(const std::string& str, std::vector<std::string>& items)
+void SplitCommaDelimitedItems(std::string_view str, std::vector<std::string_view>& items)
 {
 	items.clear();
 	
@@ -246,8 +248,7 @@ void SplitCommaDelimitedItems(const std::string& str, std::vector<std::string>&
 		{
 			if (c == ',')
 			{
-				std::string subStr = str.substr(start, i-start);
-				items.push_back(subStr);
+				items.push_back(str.substr(start, i-start));
 				start = i+1; 
 			}
 		}
@@ -261,12 +262,12 @@ void SplitCommaDelimitedItems(const std::string& str, std::vector<std::string>&
 // eg "RND" = 3 bytes
 //    255 = 1 byte
 //    "\"" = 1 byte
-uint16_t CountDataBytes(std::string str)
+uint16_t CountDataBytes(std::string_view str)
 {
 	uint16_t size = 0;
 	size_t first = str.find('"');
 	size_t last = str.find_last_of('"');
-	if (first != std::string::npos && last != std::string::npos)
+	if (first != std::string_view::npos && last != std::string_view::npos)
 	{
 		for (size_t i=first+1; i<last; i++)
 		{
@@ -286,13 +287,12 @@ uint16_t CountDataBytes(std::string str)
 
 bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FSkoolFileInfo* pSkoolInfo /*=nullptr*/)
 {
-	FILE* fp = fopen(pTextFileName, "rt");
-	char pchLine[65536];
-	// note: "rt" = text mode, which means Windows line endings \r\n will be converted into \n
-	
-
-	if (fp == nullptr)
+	// load the whole file and parse it in place
+	size_t fileSize = 0;
+	char* pFileData = (char*)LoadBinaryFile(pTextFileName, fileSize);
+	if (pFileData == nullptr)
 		return false;
+	std::string_view fileText(pFileData, fileSize);
 
 	char blockDirective = kSkoolkitDirectiveNone;
 	char subBlockDirective = kSkoolkitDirectiveNone;
@@ -310,9 +310,10 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 	bool bInRsubSection = false;
 
 	unsigned int lineNum = 0;
-	while (fgets(pchLine, 65536, fp))
+	std::vector<std::string_view> elements;
+	std::string_view strLine;
+	while (GetNextLine(fileText, strLine))
 	{
-		std::string strLine = pchLine;
 		lineNum++;
 
 		if (bInRsubSection)
@@ -320,14 +321,17 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 			if (StringStartsWith(strLine, "@rsub+end"))
 				bInRsubSection = false;
 			else
-				LOGINFO("Skipping @rsub text '%s' on line %d", pchLine, lineNum);
+				LOGINFO("Skipping @rsub text '%.*s' on line %d", (int)strLine.size(), strLine.data(), lineNum);
 			continue;
 		}
 
-		if (strLine[0] == '@')
+		if (StringStartsWith(strLine, "@"))
 		{
 			if (!ParseAsmDirective(state, strLine, label))
+			{
 				comments += strLine;
+				comments += '\n';
+			}
 
 			if (StringStartsWith(strLine, "@rsub+begin"))
 			{
@@ -337,31 +341,32 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 			continue;
 		}
 
-		if (strLine[0] == ';')
+		if (StringStartsWith(strLine, ";"))
 		{
 			comments += TrimLeadingChars(strLine, "; ");
+			comments += '\n';
+			continue;
+		}
+
+		std::string_view trimmed = TrimLeadingWhitespace(strLine);
+		if (trimmed.empty())
+		{
+			// skip blank lines
 			continue;
 		}
 
-		std::string trimmed = TrimLeadingWhitespace(strLine);
 		if (trimmed[0] == ';')
 		{
 			// instruction comment continuation
 			if (pLastItem)
 			{
-				if (pLastItem->Comment.back() != '\n')
+				if (pLastItem->Comment.empty() || pLastItem->Comment.back() != '\n')
 					pLastItem->Comment += "\n";
-				pLastItem->Comment += trimmed.substr(2);
-				RemoveCarriageReturn(pLastItem->Comment);
+				if (trimmed.size() > 2)
+					pLastItem->Comment += trimmed.substr(2);
 			}
 			continue;
 		}
-
-		if (trimmed.empty())
-		{
-			// skip blank lines
-			continue;
-		}
 		
 		// we've got an instruction.
 		// get directive, address and comment 
@@ -369,9 +374,8 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 		FSkoolkitInstruction instruction;
 		if (!ParseInstruction(strLine, instruction))
 		{
-			RemoveCarriageReturn(strLine);
-			LOGWARNING("Parse error on line %d. Could not parse instruction: '%s'", lineNum, strLine.c_str());
-			fclose(fp);
+			LOGWARNING("Parse error on line %d. Could not parse instruction: '%.*s'", lineNum, (int)strLine.size(), strLine.data());
+			free(pFileData);
 			return false;
 		}
 
@@ -379,7 +383,7 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 		{
 			// if this address is lower than the last one we saw then something has gone wrong, so abort
 			LOGWARNING("Parse error on line %d. Address $%x (%d) is lower than previous read address: $%x (%d)", lineNum, instruction.Address, instruction.Address, pLastItem->Address, pLastItem->Address);
-			fclose(fp);
+			free(pFileData);
 			return false;
 		}
 
@@ -448,7 +452,7 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 
 				// count how many entries we have
 				const uint16_t numItems = static_cast<uint16_t>(std::count(instruction.Operation.begin(), instruction.Operation.end(), ',') + 1);
-				std::string defStatement = instruction.Operation.substr(0, 4);
+				const std::string_view defStatement = instruction.Operation.substr(0, 4);
 				
 				if (defStatement == "DEFB" || defStatement == "defb")
 				{
@@ -490,16 +494,16 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 
 				if (bSkoolKitCompatibleText)
 				{
-					std::string defStatement = instruction.Operation.substr(0, 4);
-
-					std::vector<std::string> elements;
-					SplitCommaDelimitedItems(instruction.Operation.substr(5), elements);
+					if (instruction.Operation.size() > 5)
+						SplitCommaDelimitedItems(instruction.Operation.substr(5), elements);
+					else
+						elements.clear();
 
 					// This loop counts the number of bytes declared in the DEFM instruction.
 					// It can deal with byte values in addition to text strings.
 					// eg DEFM "One",2,"Three"
 					uint16_t byteSize = 0;
-					for (std::string& str : elements)
+					for (std::string_view str : elements)
 					{
 						byteSize += CountDataBytes(str);
 					}
@@ -579,6 +583,7 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 		minAddr = std::min(instruction.Address, minAddr);
 		maxAddr = std::max(instruction.Address, maxAddr);
 
+		state.SetPageDirty(instruction.Address);	// items above are edited in place
 		pLastItem = pItem;
 	}
 
@@ -589,6 +594,6 @@ bool ImportSkoolKitFile(FCodeAnalysisState& state, const char* pTextFileName, FS
 	}
 
 	state.SetCodeAnalysisDirty();
-	fclose(fp);
+	free(pFileData);
 	return true;
 }
@@ -0,0 +1,41 @@
+#include "ScreenWriteMap.h"
+
+#include "Debug/DebugLog.h"
+
+#include <cstring>
+
+void FScreenWriteMap::Reset()
+{
+	memset(Frames, 0, sizeof(Frames));
+	CurrentFrame = 0;
+	WriteCount = 0;
+	LastFrameWriteCount = 0;
+}
+
+void FScreenWriteMap::EndFrame()
+{
+	if (WriteCount > kMaxLoggedWrites)
+		LOGWARNING("%u screen writes weren't logged for the frame trace, the limit is %u", WriteCount - kMaxLoggedWrites, kMaxLoggedWrites);
+
+	CurrentFrame ^= 1;
+	memset(Frames[CurrentFrame], 0, sizeof(Frames[CurrentFrame]));
+	LastFrameWriteCount = WriteCount;
+	WriteCount = 0;
+}
+
+void FScreenWriteMap::GetLastFrameWrites(std::vector<FMemoryAccess>& outPixWrites, std::vector<FMemoryAccess>& outAttrWrites) const
+{
+	const FMemoryAccess* pWriteLog = WriteLogs[CurrentFrame ^ 1];
+	const uint32_t noLogged = std::min(LastFrameWriteCount, kMaxLoggedWrites);
+
+	outPixWrites.clear();
+	outAttrWrites.clear();
+	for (uint32_t writeNo = 0; writeNo < noLogged; writeNo++)
+	{
+		const FMemoryAccess& write = pWriteLog[writeNo];
+		if ((uint16_t)(write.Address - kScreenPixMemStart) < kScreenPixMemSize)
+			outPixWrites.push_back(write);
+		else
+			outAttrWrites.push_back(write);
+	}
+}
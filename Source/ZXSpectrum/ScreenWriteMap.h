@@ -0,0 +1,62 @@
+#pragma once
+
+#include "SpectrumConstants.h"
+#include <CodeAnalyser/CodeAnalyser.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// last write to a screen byte in a frame
+struct FScreenWrite
+{
+	uint32_t	Order;	// 1 for the first write in the frame, 0 if not written
+	uint16_t	PC;
+	uint8_t		Value;
+};
+
+// Records which instruction last wrote each byte of screen memory (pixels & attributes)
+// The map for the frame being run is written with one store per write, the previous frame's map is kept for lookups.
+// Every write is also logged in order for the frame trace, into a fixed array indexed by the write count.
+// Writes past the limit all land in a spare last entry so logging is one store with no branch.
+class FScreenWriteMap
+{
+public:
+	static const int kNoScreenBytes = kScreenPixMemSize + kScreenAttrMemSize;
+	static const uint32_t kMaxLoggedWrites = 0x10000;	// per frame, pixels & attributes together
+
+			FScreenWriteMap() { Reset(); }
+
+	void	Reset();
+	void	EndFrame();
+
+	void	RegisterWrite(uint16_t addr, uint8_t value, uint16_t pc)
+	{
+		const uint16_t offset = addr - kScreenPixMemStart;
+		if (offset >= kNoScreenBytes)
+			return;
+
+		WriteLogs[CurrentFrame][std::min(WriteCount, kMaxLoggedWrites)] = { addr, value, pc };
+		Frames[CurrentFrame][offset] = { ++WriteCount, pc, value };
+	}
+
+	// write info for an address in the last complete frame - nullptr if it wasn't written
+	const FScreenWrite*	GetLastFrameWrite(uint16_t addr) const
+	{
+		const uint16_t offset = addr - kScreenPixMemStart;
+		if (offset >= kNoScreenBytes || Frames[CurrentFrame ^ 1][offset].Order == 0)
+			return nullptr;
+		return &Frames[CurrentFrame ^ 1][offset];
+	}
+	uint32_t	GetLastFrameWriteCount() const { return LastFrameWriteCount; }
+
+	// all of last frame's writes in the order they happened, bytes written more than once appear each time
+	void	GetLastFrameWrites(std::vector<FMemoryAccess>& outPixWrites, std::vector<FMemoryAccess>& outAttrWrites) const;
+
+private:
+	FScreenWrite	Frames[2][kNoScreenBytes];
+	FMemoryAccess	WriteLogs[2][kMaxLoggedWrites + 1];	// last entry takes the writes over the limit
+	int				CurrentFrame = 0;
+	uint32_t		WriteCount = 0;
+	uint32_t		LastFrameWriteCount = 0;
+};
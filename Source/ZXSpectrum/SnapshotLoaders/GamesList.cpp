@@ -1,8 +1,12 @@
 #include "GamesList.h"
 #include "Util/FileUtil.h"
+#include "Util/ZipArchive.h"
+#include "Util/GraphicsView.h"
 #include "Z80Loader.h"
 #include "SNALoader.h"
 #include "RZXLoader.h"
+#include "../SpectrumEmu.h"
+#include "Debug/DebugLog.h"
 
 ESnapshotType GetSnapshotTypeFromFileName(const std::string& fn)
 {
@@ -12,35 +16,39 @@ ESnapshotType GetSnapshotTypeFromFileName(const std::string& fn)
 		return ESnapshotType::SNA;
 	else if ((fn.substr(fn.find_last_of(".") + 1) == "rzx") || (fn.substr(fn.find_last_of(".") + 1) == "RZX"))
 		return ESnapshotType::RZX;
+	else if ((fn.substr(fn.find_last_of(".") + 1) == "tap") || (fn.substr(fn.find_last_of(".") + 1) == "TAP"))
+		return ESnapshotType::TAP;
+	else if ((fn.substr(fn.find_last_of(".") + 1) == "tzx") || (fn.substr(fn.find_last_of(".") + 1) == "TZX"))
+		return ESnapshotType::TZX;
 	else
 		return ESnapshotType::Unknown;
 }
 
-bool FGamesList::EnumerateGames(const char* pDir)
+bool FGamesList::EnumerateGames(const char* pDir, const char* pCacheFileName)
 {
-	FDirFileList listing;
+	if (ScanTask.IsRunning())
+		return false;
 
 	RootDir = std::string(pDir);
+	const std::string cacheFileName = pCacheFileName != nullptr ? pCacheFileName : "";
 
-	GamesList.clear();
+	return ScanTask.Start("Snapshot scan", [this, cacheFileName](FBackgroundTask& task)
+	{
+		return BuildSnapshotIndex(RootDir, cacheFileName, ROMs, ScannedGamesList, ScanStats, task);
+	});
+}
 
-	if (EnumerateDirectory(pDir, listing) == false)
-		return false;
+void FGamesList::Update()
+{
+	if (ScanTask.Update() == false)
+		return;
 
-	for (const auto& file : listing)
+	if (ScanTask.GetResult())
 	{
-		const ESnapshotType type = GetSnapshotTypeFromFileName(file.FileName);
-
-		if (type != ESnapshotType::Unknown)
-		{
-			FGameSnapshot newGame;
-			newGame.FileName = RootDir + file.FileName;
-			newGame.DisplayName = file.FileName;
-			newGame.Type = type;
-			GamesList.push_back(newGame);
-		}
+		GamesList.swap(ScannedGamesList);
+		LOGINFO("%s: %d snapshots, %d scanned", RootDir.c_str(), ScanStats.NoFiles, ScanStats.NoRefreshed);
 	}
-	return true;
+	ScannedGamesList.clear();
 }
 
 bool FGamesList::LoadGame(int index)
@@ -53,14 +61,39 @@ bool FGamesList::LoadGame(int index)
 
 bool FGamesList::LoadGame(const char* pFileName)
 {
-	const std::string fn(pFileName);
+	const ESnapshotType type = GetSnapshotTypeFromFileName(pFileName);
 
-	switch (GetSnapshotTypeFromFileName(pFileName))
+	// tapes are loaded by resetting the machine and typing LOAD ""
+	if (type == ESnapshotType::TAP || type == ESnapshotType::TZX)
 	{
-	case ESnapshotType::Z80:
-		return LoadZ80File(pSpectrumEmu, pFileName);
-	case ESnapshotType::SNA:
-		return LoadSNAFile(pSpectrumEmu, pFileName);
-	default: return false;
+		if (pSpectrumEmu->TapePlayer.Load(pFileName) == false)
+			return false;
+		pSpectrumEmu->TapePlayer.StartAutoLoad(&pSpectrumEmu->ZXEmuState);
+		return true;
 	}
+
+	// snapshots can be in archives, so load them through memory
+	if (type != ESnapshotType::Z80 && type != ESnapshotType::SNA)
+		return false;
+
+	std::vector<uint8_t> data;
+	if (LoadFileData(pFileName, data) == false)
+		return false;
+
+	const bool bLoaded = type == ESnapshotType::Z80 ? LoadZ80FromMemory(pSpectrumEmu, data.data(), data.size()) : LoadSNAFromMemory(pSpectrumEmu, data.data(), data.size());
+	if (bLoaded)
+	{
+		InvalidateCharacterSetMemory(0, 0x10000);
+		pSpectrumEmu->ScreenWrites.Reset();
+	}
+	return bLoaded;
+}
+
+std::string GetSnapshotFileFromPath(const char* pFileName)
+{
+	std::string archiveName, entryName;
+	if (SplitZipPath(pFileName, archiveName, entryName))
+		return GetFileFromPath(archiveName.c_str()) + "/" + entryName;
+
+	return GetFileFromPath(pFileName);
 }
@@ -3,6 +3,9 @@
 #include <string>
 #include <vector>
 
+#include "SnapshotIndex.h"
+#include "Util/BackgroundTask.h"
+
 class FSpectrumEmu;
 
 enum class ESnapshotType
@@ -10,6 +13,8 @@ enum class ESnapshotType
 	Z80,
 	SNA,
 	RZX,
+	TAP,
+	TZX,
 
 	Unknown
 };
@@ -19,13 +24,18 @@ struct FGameSnapshot
 	ESnapshotType	Type;
 	std::string		DisplayName;
 	std::string		FileName;
+	FSnapshotInfo	Info;
 };
 
 class FGamesList
 {
 public:
-	void	Init(FSpectrumEmu* pEmu) { pSpectrumEmu = pEmu; }
-	bool	EnumerateGames(const char* pRootDir);
+	void	Init(FSpectrumEmu* pEmu, const FSpectrumROMs& roms) { pSpectrumEmu = pEmu; ROMs = roms; }
+	// Scans the directory in the background using the snapshot index cache, the list is filled in when Update sees it finish
+	bool	EnumerateGames(const char* pRootDir, const char* pCacheFileName = nullptr);
+	void	Update();
+	bool	IsScanning() const { return ScanTask.IsRunning(); }
+	float	GetScanProgress() const { return ScanTask.GetProgress(); }
 	bool	LoadGame(int index);
 	bool	LoadGame(const char* pFileName);
 
@@ -37,6 +47,13 @@ private:
 	FSpectrumEmu* pSpectrumEmu = nullptr;
 	std::vector< FGameSnapshot>	GamesList;
 	std::string RootDir;
+	FSpectrumROMs	ROMs;
+
+	// written by the scan task
+	FBackgroundTask				ScanTask;
+	std::vector<FGameSnapshot>	ScannedGamesList;
+	FSnapshotIndexStats			ScanStats;
 };
 
-ESnapshotType GetSnapshotTypeFromFileName(const std::string& fn);
\ No newline at end of file
+ESnapshotType GetSnapshotTypeFromFileName(const std::string& fn);
+std::string GetSnapshotFileFromPath(const char* pFileName);	// file name, with the archive name for files in archives
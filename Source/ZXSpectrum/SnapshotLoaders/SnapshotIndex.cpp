@@ -0,0 +1,317 @@
+#include "SnapshotIndex.h"
+#include "GamesList.h"
+
+#include "Util/BackgroundTask.h"
+#include "Util/FileUtil.h"
+#include "Util/MemoryBuffer.h"
+#include "Util/Misc.h"
+#include "Util/ZipArchive.h"
+
+#include "chips/z80.h"
+#include "chips/beeper.h"
+#include "chips/ay38910.h"
+#include "chips/mem.h"
+#include "chips/kbd.h"
+#include "chips/clk.h"
+#include "systems/zx.h"
+
+#include <zlib.h>
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <unordered_map>
+
+static const uint32_t kIndexCacheMagic = 0x58444953;	// 'SIDX'
+static const uint32_t kIndexCacheVersion = 2;	// 2 - 128K SNA thumbnails use the shadow screen
+
+static const uint32_t kThumbnailBootTime = 200000;	// microseconds - ~10 frames to let the game draw after loading
+static const int kPixelBufferSize = 320 * 256 * 4;
+static const size_t kSNA48KSize = 49179;
+static const size_t kSNAHeaderSize = 27;
+static const size_t kSNA128KExtraHeaderSize = 4;	// PC, port 0x7FFD & TR-DOS flag follow the first 48K
+
+typedef std::unordered_map<std::string, FSnapshotInfo> FSnapshotInfoMap;
+
+static bool LoadIndexCache(const std::string& cacheFileName, FSnapshotInfoMap& outCache)
+{
+	FMemoryBuffer buffer;
+	if (buffer.LoadFromFile(cacheFileName.c_str()) == false)
+		return false;
+
+	if (buffer.Read<uint32_t>() != kIndexCacheMagic || buffer.Read<uint32_t>() != kIndexCacheVersion)
+		return false;
+
+	const uint32_t noEntries = buffer.Read<uint32_t>();
+	for (uint32_t entryNo = 0; entryNo < noEntries; entryNo++)
+	{
+		const std::string fileName = buffer.ReadString();
+		FSnapshotInfo info;
+		buffer.Read(info.FileSize);
+		buffer.Read(info.ModifiedTime);
+		buffer.Read(info.Hash);
+		info.bIs128K = buffer.Read<uint8_t>() != 0;
+		info.bLoaded = buffer.Read<uint8_t>() != 0;
+		const uint32_t thumbnailSize = buffer.Read<uint32_t>();
+		const uint8_t* pThumbnail = (const uint8_t*)buffer.ReadBytesView(thumbnailSize);
+		if (buffer.HasReadError())	// truncated - keep what we've got
+			break;
+
+		info.Thumbnail.assign(pThumbnail, pThumbnail + thumbnailSize);
+		outCache[fileName] = std::move(info);
+	}
+	return true;
+}
+
+static bool SaveIndexCache(const std::string& cacheFileName, const std::string& rootDir, const std::vector<FGameSnapshot>& games)
+{
+	FMemoryBuffer buffer;
+	buffer.Init();
+	buffer.Write(kIndexCacheMagic);
+	buffer.Write(kIndexCacheVersion);
+	buffer.Write((uint32_t)games.size());
+	for (const FGameSnapshot& game : games)
+	{
+		const FSnapshotInfo& info = game.Info;
+		buffer.WriteString(game.FileName.substr(rootDir.size()));	// cache is keyed on the name relative to the folder
+		buffer.Write(info.FileSize);
+		buffer.Write(info.ModifiedTime);
+		buffer.Write(info.Hash);
+		buffer.Write((uint8_t)info.bIs128K);
+		buffer.Write((uint8_t)info.bLoaded);
+		buffer.Write((uint32_t)info.Thumbnail.size());
+		buffer.WriteBytes(info.Thumbnail.data(), info.Thumbnail.size());
+	}
+	return buffer.SaveToFile(cacheFileName.c_str());
+}
+
+static void CompressThumbnail(const uint8_t* pScreen, std::vector<uint8_t>& outThumbnail)
+{
+	uLongf compressedSize = compressBound(kSnapshotScreenSize);
+	outThumbnail.resize(compressedSize);
+	if (compress2(outThumbnail.data(), &compressedSize, pScreen, kSnapshotScreenSize, Z_BEST_SPEED) != Z_OK)
+		compressedSize = 0;
+	outThumbnail.resize(compressedSize);
+}
+
+bool DecompressSnapshotThumbnail(const FSnapshotInfo& info, uint8_t* pOutScreen)
+{
+	if (info.Thumbnail.empty())
+		return false;
+
+	uLongf size = kSnapshotScreenSize;
+	return uncompress(pOutScreen, &size, info.Thumbnail.data(), (uLong)info.Thumbnail.size()) == Z_OK && size == kSnapshotScreenSize;
+}
+
+// Machine for booting snapshots off the UI thread, one per worker chunk
+struct FHeadlessSpectrum
+{
+	bool	Boot(const FSpectrumROMs& roms, zx_type_t type, const uint8_t* pData, size_t dataSize)
+	{
+		zx_desc_t desc;
+		memset(&desc, 0, sizeof(zx_desc_t));
+		desc.type = type;
+		desc.pixel_buffer = PixelBuffer;
+		desc.pixel_buffer_size = kPixelBufferSize;
+		desc.rom_zx48k = roms.pROM48K;
+		desc.rom_zx48k_size = 0x4000;
+		desc.rom_zx128_0 = roms.pROM128K_0;
+		desc.rom_zx128_0_size = 0x4000;
+		desc.rom_zx128_1 = roms.pROM128K_1;
+		desc.rom_zx128_1_size = 0x4000;
+		zx_init(&Machine, &desc);
+
+		// quickload rejects snapshots for the other model
+		if (zx_quickload(&Machine, pData, (int)dataSize) == false)
+			return false;
+
+		zx_exec(&Machine, kThumbnailBootTime);
+		return true;
+	}
+
+	const uint8_t* GetScreen() const { return Machine.ram[Machine.display_ram_bank]; }
+
+	zx_t		Machine;
+	uint32_t	PixelBuffer[kPixelBufferSize / 4];
+};
+
+// 128K SNAs store banks 5, 2 & the paged bank first, then the rest in order - the shadow screen in bank 7 can be in either part
+static const uint8_t* GetSNAScreen(const uint8_t* pData, size_t dataSize)
+{
+	const uint8_t* pRAM = pData + kSNAHeaderSize;
+	if (dataSize <= kSNA48KSize + kSNA128KExtraHeaderSize)
+		return pRAM;
+
+	const uint8_t port7FFD = pData[kSNA48KSize + 2];
+	if ((port7FFD & (1 << 3)) == 0)	// normal screen in bank 5
+		return pRAM;
+
+	const int pagedBank = port7FFD & 7;
+	if (pagedBank == 7)
+		return pRAM + 0x8000;
+
+	int bankOffset = 0;
+	for (int bankNo = 0; bankNo < 7; bankNo++)
+	{
+		if (bankNo != 2 && bankNo != 5 && bankNo != pagedBank)
+			bankOffset++;
+	}
+	const size_t screenOffset = kSNA48KSize + kSNA128KExtraHeaderSize + bankOffset * 0x4000;
+	return screenOffset + kSnapshotScreenSize <= dataSize ? pData + screenOffset : pRAM;
+}
+
+static void ScanSnapshot(const FGameSnapshot& game, const uint8_t* pData, size_t dataSize, const FSpectrumROMs& roms, FHeadlessSpectrum& spectrum, FSnapshotInfo& outInfo)
+{
+	outInfo.Hash = CalculateChecksum(pData, dataSize);
+	outInfo.bIs128K = false;
+	outInfo.bLoaded = false;
+	outInfo.Thumbnail.clear();
+
+	switch (game.Type)
+	{
+	case ESnapshotType::Z80:
+		if (spectrum.Boot(roms, ZX_TYPE_48K, pData, dataSize))
+		{
+			outInfo.bLoaded = true;
+		}
+		else if (roms.pROM128K_0 != nullptr && spectrum.Boot(roms, ZX_TYPE_128, pData, dataSize))
+		{
+			outInfo.bLoaded = true;
+			outInfo.bIs128K = true;
+		}
+		if (outInfo.bLoaded)
+			CompressThumbnail(spectrum.GetScreen(), outInfo.Thumbnail);
+		break;
+	case ESnapshotType::SNA:
+		// the screen can be read straight out of the RAM image, so no need to boot
+		if (dataSize >= kSNA48KSize)
+		{
+			outInfo.bLoaded = true;
+			outInfo.bIs128K = dataSize > kSNA48KSize;
+			CompressThumbnail(GetSNAScreen(pData, dataSize), outInfo.Thumbnail);
+		}
+		break;
+	default:	// RZX & tapes - just the file details
+		break;
+	}
+}
+
+bool BuildSnapshotIndex(const std::string& rootDir, const std::string& cacheFileName, const FSpectrumROMs& roms,
+						std::vector<FGameSnapshot>& outGames, FSnapshotIndexStats& outStats, FBackgroundTask& task)
+{
+	outGames.clear();
+	outStats = FSnapshotIndexStats();
+
+	FDirFileList listing;
+	if (EnumerateDirectory(rootDir.c_str(), listing) == false)
+		return false;
+
+	FSnapshotInfoMap cache;
+	if (cacheFileName.empty() == false)
+		LoadIndexCache(cacheFileName, cache);
+
+	// games to rescan, archive entries are kept in archive order so each chunk can open an archive once
+	struct FRefreshItem
+	{
+		int		GameIndex;
+		int		ZipEntryNo;	// -1 if not in an archive
+		int		ArchiveNo;
+	};
+	std::vector<FRefreshItem> refreshList;
+	std::vector<std::string> archiveNames;
+	auto addGame = [&](const std::string& relativeName, ESnapshotType type, uint64_t fileSize, int64_t modifiedTime, int zipEntryNo)
+	{
+		FGameSnapshot newGame;
+		newGame.FileName = rootDir + relativeName;
+		newGame.DisplayName = relativeName;	// keep the archive name so entries with the same name don't clash
+		newGame.Type = type;
+
+		auto cacheIt = cache.find(relativeName);
+		if (cacheIt != cache.end() && cacheIt->second.FileSize == fileSize && cacheIt->second.ModifiedTime == modifiedTime)
+		{
+			newGame.Info = std::move(cacheIt->second);
+		}
+		else
+		{
+			newGame.Info.FileSize = fileSize;
+			newGame.Info.ModifiedTime = modifiedTime;
+			refreshList.push_back({ (int)outGames.size(), zipEntryNo, zipEntryNo == -1 ? -1 : (int)archiveNames.size() - 1 });
+		}
+		outGames.push_back(std::move(newGame));
+	};
+
+	for (const auto& file : listing)
+	{
+		size_t fileSize = 0;
+		int64_t modifiedTime = 0;
+
+		if (IsZipFileName(file.FileName))
+		{
+			// entries are matched on the archive's time & their own size
+			FZipArchive archive;
+			if (archive.Open((rootDir + file.FileName).c_str()) == false)
+				continue;
+			GetFileSizeAndModifiedTime((rootDir + file.FileName).c_str(), fileSize, modifiedTime);
+			archiveNames.push_back(rootDir + file.FileName);
+
+			for (int entryNo = 0; entryNo < archive.GetNoEntries(); entryNo++)
+			{
+				const FZipEntry& entry = archive.GetEntry(entryNo);
+				const ESnapshotType type = GetSnapshotTypeFromFileName(entry.FileName);
+				if (type != ESnapshotType::Unknown && type != ESnapshotType::RZX)	// RZX needs a real file
+					addGame(file.FileName + "/" + entry.FileName, type, entry.Size, modifiedTime, entryNo);
+			}
+			continue;
+		}
+
+		const ESnapshotType type = GetSnapshotTypeFromFileName(file.FileName);
+		if (type == ESnapshotType::Unknown)
+			continue;
+
+		GetFileSizeAndModifiedTime((rootDir + file.FileName).c_str(), fileSize, modifiedTime);
+		addGame(file.FileName, type, fileSize, modifiedTime, -1);
+	}
+
+	outStats.NoFiles = (int)outGames.size();
+	outStats.NoRefreshed = (int)refreshList.size();
+
+	// nothing new and nothing deleted - leave the cache alone
+	if (refreshList.empty() && cache.size() == outGames.size())
+		return true;
+
+	const int noRefresh = (int)refreshList.size();
+	std::atomic<int> noDone = { 0 };
+	ParallelForChunks(noRefresh, CalcNoParallelChunks(noRefresh, 4), [&](int, int begin, int end)
+	{
+		std::unique_ptr<FHeadlessSpectrum> pSpectrum = std::make_unique<FHeadlessSpectrum>();
+		std::vector<uint8_t> data;
+		FZipArchive archive;
+		int openArchiveNo = -1;
+		for (int refreshNo = begin; refreshNo < end; refreshNo++)
+		{
+			const FRefreshItem& item = refreshList[refreshNo];
+			FGameSnapshot& game = outGames[item.GameIndex];
+			bool bLoaded = false;
+			if (item.ArchiveNo == -1)
+			{
+				bLoaded = LoadFileData(game.FileName, data);
+			}
+			else
+			{
+				if (item.ArchiveNo != openArchiveNo)
+				{
+					archive.Open(archiveNames[item.ArchiveNo].c_str());
+					openArchiveNo = item.ArchiveNo;
+				}
+				bLoaded = archive.IsOpen() && archive.ExtractEntry(item.ZipEntryNo, data);
+			}
+			if (bLoaded)
+				ScanSnapshot(game, data.data(), data.size(), roms, *pSpectrum, game.Info);
+			task.SetProgress((float)++noDone / (float)noRefresh);
+		}
+	});
+
+	if (cacheFileName.empty() == false)
+		SaveIndexCache(cacheFileName, rootDir, outGames);
+	return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class FBackgroundTask;
+struct FGameSnapshot;
+
+static const int kSnapshotScreenSize = 6912;	// pixels + attributes
+
+// Metadata for a snapshot file, cached on disk so only new or changed files get looked at again
+struct FSnapshotInfo
+{
+	uint64_t	FileSize = 0;
+	int64_t		ModifiedTime = 0;
+	uint32_t	Hash = 0;			// FNV-1a of the file contents
+	bool		bIs128K = false;
+	bool		bLoaded = false;	// snapshot could be loaded into a machine
+
+	std::vector<uint8_t>	Thumbnail;	// zlib compressed screen after a short boot, empty if there isn't one
+};
+
+// ROM images for the headless machines used to make thumbnails, all are 16K
+struct FSpectrumROMs
+{
+	const uint8_t*	pROM48K = nullptr;
+	const uint8_t*	pROM128K_0 = nullptr;
+	const uint8_t*	pROM128K_1 = nullptr;
+};
+
+struct FSnapshotIndexStats
+{
+	int		NoFiles = 0;
+	int		NoRefreshed = 0;	// files that weren't in the cache or had changed
+};
+
+// List the snapshots in a directory, including those in ZIP archives, and fill in their metadata.
+// Files are matched to the cache by name, size & modification time - the rest are hashed and booted
+// in parallel and the cache is rewritten. Blocking, FGamesList runs it as a background task.
+bool BuildSnapshotIndex(const std::string& rootDir, const std::string& cacheFileName, const FSpectrumROMs& roms,
+						std::vector<FGameSnapshot>& outGames, FSnapshotIndexStats& outStats, FBackgroundTask& task);
+
+bool DecompressSnapshotThumbnail(const FSnapshotInfo& info, uint8_t* pOutScreen);	// kSnapshotScreenSize bytes
@@ -0,0 +1,421 @@
+#include "TapeLoader.h"
+
+#include "Util/ZipArchive.h"
+#include "Debug/DebugLog.h"
+
+#include <cstring>
+
+static const int kTicksPerMs = 3500;
+static const int kAutoLoadBootFrames = 100;	// frames to wait for the ROM to start up before typing
+static const int kAutoLoadKeyFrames = 5;	// frames each key is held & released for
+static const int kLoaderEarReadsPerFrame = 256;	// edge detection loops read the port thousands of times a frame
+
+static uint16_t Get16(const uint8_t* pData) { return pData[0] | (pData[1] << 8); }
+static uint32_t Get24(const uint8_t* pData) { return pData[0] | (pData[1] << 8) | (pData[2] << 16); }
+static uint32_t Get32(const uint8_t* pData) { return pData[0] | (pData[1] << 8) | (pData[2] << 16) | ((uint32_t)pData[3] << 24); }
+
+// block with ROM loader timings
+static void SetStandardBlock(FTapeBlock& block, const uint8_t* pData, size_t dataSize, uint16_t pauseMs)
+{
+	block.PilotPulse = 2168;
+	block.PilotCount = (dataSize > 0 && pData[0] < 0x80) ? 8063 : 3223;	// headers have a longer pilot
+	block.Sync1Pulse = 667;
+	block.Sync2Pulse = 735;
+	block.ZeroPulse = 855;
+	block.OnePulse = 1710;
+	block.UsedBits = 8;
+	block.PauseMs = pauseMs;
+	block.Data.assign(pData, pData + dataSize);
+}
+
+bool LoadTAPFromMemory(const uint8_t* pData, size_t dataSize, std::vector<FTapeBlock>& outBlocks)
+{
+	outBlocks.clear();
+
+	// each block is a 16 bit length followed by flag, data & checksum
+	size_t pos = 0;
+	while (pos + 2 <= dataSize)
+	{
+		const size_t blockSize = Get16(pData + pos);
+		pos += 2;
+		if (pos + blockSize > dataSize)
+			return false;
+
+		FTapeBlock block;
+		SetStandardBlock(block, pData + pos, blockSize, 1000);
+		outBlocks.push_back(std::move(block));
+		pos += blockSize;
+	}
+
+	return outBlocks.empty() == false;
+}
+
+bool LoadTZXFromMemory(const uint8_t* pData, size_t dataSize, std::vector<FTapeBlock>& outBlocks)
+{
+	outBlocks.clear();
+
+	static const size_t kHeaderSize = 10;	// signature, major & minor version
+	if (dataSize < kHeaderSize || memcmp(pData, "ZXTape!\x1A", 8) != 0)
+		return false;
+
+	// padded so the fixed part of a truncated block can be read, the block size check catches it
+	static const size_t kMaxFixedBlockSize = 20;
+	std::vector<uint8_t> paddedData(pData, pData + dataSize);
+	paddedData.resize(dataSize + kMaxFixedBlockSize, 0);
+	pData = paddedData.data();
+
+	size_t loopStart = 0;
+	int loopCount = 0;
+	int noSkippedBlocks = 0;
+	size_t pos = kHeaderSize;
+	while (pos < dataSize)
+	{
+		const uint8_t blockId = pData[pos++];
+		const uint8_t* pBlock = pData + pos;
+		const size_t remaining = dataSize - pos;
+		size_t blockSize = 0;	// not including the id
+		FTapeBlock block;
+		bool bAddBlock = true;
+
+		switch (blockId)
+		{
+		case 0x10:	// standard speed data
+			blockSize = 4 + Get16(pBlock + 2);
+			if (blockSize <= remaining)
+				SetStandardBlock(block, pBlock + 4, blockSize - 4, Get16(pBlock));
+			break;
+		case 0x11:	// turbo speed data
+			blockSize = 18 + Get24(pBlock + 15);
+			if (blockSize <= remaining)
+			{
+				block.PilotPulse = Get16(pBlock);
+				block.Sync1Pulse = Get16(pBlock + 2);
+				block.Sync2Pulse = Get16(pBlock + 4);
+				block.ZeroPulse = Get16(pBlock + 6);
+				block.OnePulse = Get16(pBlock + 8);
+				block.PilotCount = Get16(pBlock + 10);
+				block.UsedBits = pBlock[12];
+				block.PauseMs = Get16(pBlock + 13);
+				block.Data.assign(pBlock + 18, pBlock + blockSize);
+			}
+			break;
+		case 0x12:	// pure tone
+			blockSize = 4;
+			block.PilotPulse = Get16(pBlock);
+			block.PilotCount = Get16(pBlock + 2);
+			break;
+		case 0x13:	// pulse sequence
+			blockSize = 1 + pBlock[0] * 2;
+			if (blockSize <= remaining)
+			{
+				for (int pulseNo = 0; pulseNo < pBlock[0]; pulseNo++)
+					block.Pulses.push_back(Get16(pBlock + 1 + pulseNo * 2));
+			}
+			break;
+		case 0x14:	// pure data
+			blockSize = 10 + Get24(pBlock + 7);
+			if (blockSize <= remaining)
+			{
+				block.ZeroPulse = Get16(pBlock);
+				block.OnePulse = Get16(pBlock + 2);
+				block.UsedBits = pBlock[4];
+				block.PauseMs = Get16(pBlock + 5);
+				block.Data.assign(pBlock + 10, pBlock + blockSize);
+			}
+			break;
+		case 0x20:	// pause or stop the tape
+			blockSize = 2;
+			block.PauseMs = Get16(pBlock);
+			block.bStopTape = block.PauseMs == 0;
+			break;
+		case 0x24:	// loop start
+			blockSize = 2;
+			loopStart = outBlocks.size();
+			loopCount = Get16(pBlock);
+			bAddBlock = false;
+			break;
+		case 0x25:	// loop end - repeat the blocks since the start
+		{
+			const size_t loopEnd = outBlocks.size();
+			for (int loopNo = 1; loopNo < loopCount; loopNo++)
+			{
+				for (size_t blockNo = loopStart; blockNo < loopEnd; blockNo++)
+					outBlocks.push_back(outBlocks[blockNo]);
+			}
+			loopCount = 0;
+			bAddBlock = false;
+			break;
+		}
+		// blocks with no signal
+		case 0x21: blockSize = 1 + pBlock[0]; bAddBlock = false; break;	// group start
+		case 0x22: blockSize = 0; bAddBlock = false; break;	// group end
+		case 0x23: blockSize = 2; bAddBlock = false; break;	// jump
+		case 0x26: blockSize = 2 + Get16(pBlock) * 2; bAddBlock = false; break;	// call sequence
+		case 0x27: blockSize = 0; bAddBlock = false; break;	// return
+		case 0x28: blockSize = 2 + Get16(pBlock); bAddBlock = false; break;	// select
+		case 0x2A: blockSize = 4; bAddBlock = false; break;	// stop if 48K
+		case 0x2B: blockSize = 5; bAddBlock = false; break;	// signal level
+		case 0x30: blockSize = 1 + pBlock[0]; bAddBlock = false; break;	// text
+		case 0x31: blockSize = 2 + pBlock[1]; bAddBlock = false; break;	// message
+		case 0x32: blockSize = 2 + Get16(pBlock); bAddBlock = false; break;	// archive info
+		case 0x33: blockSize = 1 + pBlock[0] * 3; bAddBlock = false; break;	// hardware type
+		case 0x35: blockSize = 20 + Get32(pBlock + 16); bAddBlock = false; break;	// custom info
+		case 0x5A: blockSize = 9; bAddBlock = false; break;	// glue
+		// direct recording, CSW & generalised data aren't supported, or anything newer - they all start with a length
+		case 0x15: blockSize = 8 + Get24(pBlock + 5); bAddBlock = false; noSkippedBlocks++; break;
+		default: blockSize = 4 + Get32(pBlock); bAddBlock = false; noSkippedBlocks++; break;
+		}
+
+		if (blockSize > remaining)
+			return false;
+
+		if (bAddBlock)
+			outBlocks.push_back(std::move(block));
+		pos += blockSize;
+	}
+
+	if (noSkippedBlocks > 0)
+		LOGWARNING("TZX file has %d unsupported blocks", noSkippedBlocks);
+
+	return outBlocks.empty() == false;
+}
+
+bool FTapePlayer::Load(const char* pFileName)
+{
+	Eject();
+
+	std::vector<uint8_t> data;
+	if (LoadFileData(pFileName, data) == false)
+		return false;
+
+	const bool bLoaded = LoadTZXFromMemory(data.data(), data.size(), Blocks) || LoadTAPFromMemory(data.data(), data.size(), Blocks);
+	if (bLoaded == false)
+	{
+		LOGERROR("Could not load tape file '%s'", pFileName);
+		Blocks.clear();
+		return false;
+	}
+
+	FileName = pFileName;
+	Rewind();
+	return true;
+}
+
+void FTapePlayer::Eject()
+{
+	Blocks.clear();
+	FileName.clear();
+	AutoLoadKeys.clear();
+	Rewind();
+}
+
+void FTapePlayer::Rewind()
+{
+	bPlaying = false;
+	bEarLevel = false;
+	bLoaderActive = false;
+	NoEarReads = 0;
+	StartBlock(0);
+}
+
+void FTapePlayer::StartAutoLoad(zx_t* pSys)
+{
+	zx_reset(pSys);
+	Rewind();
+
+	// LOAD "" on the 48K, Tape Loader is the first item on the 128K menu
+	AutoLoadKeys = pSys->type == ZX_TYPE_48K ? "j\"\"\r" : "\r";
+	AutoLoadFrame = 0;
+}
+
+void FTapePlayer::Update(zx_t* pSys)
+{
+	bLoaderActive = bPlaying && NoEarReads >= kLoaderEarReadsPerFrame;
+	NoEarReads = 0;
+
+	if (AutoLoadKeys.empty())
+		return;
+
+	const int frameNo = AutoLoadFrame++ - kAutoLoadBootFrames;
+	if (frameNo < 0)
+		return;
+
+	const int keyNo = frameNo / (kAutoLoadKeyFrames * 2);
+	const int keyFrameNo = frameNo % (kAutoLoadKeyFrames * 2);
+	if (keyNo >= (int)AutoLoadKeys.size())
+	{
+		AutoLoadKeys.clear();
+		Play();
+		return;
+	}
+
+	if (keyFrameNo == 0)
+		zx_key_down(pSys, AutoLoadKeys[keyNo]);
+	else if (keyFrameNo == kAutoLoadKeyFrames)
+		zx_key_up(pSys, AutoLoadKeys[keyNo]);
+}
+
+void FTapePlayer::StartBlock(int blockNo)
+{
+	BlockNo = blockNo;
+	Phase = EPhase::Pilot;
+	PhaseCount = 0;
+	PulseTicksLeft = 0;
+	if (BlockNo >= (int)Blocks.size())
+		bPlaying = false;
+}
+
+void FTapePlayer::NextPulse()
+{
+	// each pulse flips the level, keep going until there's one to play or the tape stops
+	while (bPlaying && PulseTicksLeft <= 0)
+	{
+		const FTapeBlock& block = Blocks[BlockNo];
+		int pulseLength = 0;
+
+		switch (Phase)
+		{
+		case EPhase::Pilot:
+			if (PhaseCount < block.PilotCount)
+			{
+				pulseLength = block.PilotPulse;
+				PhaseCount++;
+			}
+			else
+			{
+				Phase = EPhase::Sync1;
+			}
+			break;
+		case EPhase::Sync1:
+			pulseLength = block.Sync1Pulse;
+			Phase = EPhase::Sync2;
+			break;
+		case EPhase::Sync2:
+			pulseLength = block.Sync2Pulse;
+			Phase = EPhase::Pulses;
+			PhaseCount = 0;
+			break;
+		case EPhase::Pulses:
+			if (PhaseCount < (int)block.Pulses.size())
+			{
+				pulseLength = block.Pulses[PhaseCount++];
+			}
+			else
+			{
+				Phase = EPhase::Data;
+				PhaseCount = 0;
+			}
+			break;
+		case EPhase::Data:
+		{
+			// two pulses per bit
+			const int noBits = block.Data.empty() ? 0 : (int)(block.Data.size() - 1) * 8 + block.UsedBits;
+			if (PhaseCount < noBits * 2)
+			{
+				const int bitNo = PhaseCount++ / 2;
+				const bool bOne = (block.Data[bitNo >> 3] & (0x80 >> (bitNo & 7))) != 0;
+				pulseLength = bOne ? block.OnePulse : block.ZeroPulse;
+			}
+			else
+			{
+				Phase = EPhase::Pause;
+			}
+			break;
+		}
+		case EPhase::Pause:
+			// the level is low during a pause
+			Phase = EPhase::End;
+			if (block.PauseMs > 0)
+			{
+				bEarLevel = false;
+				PulseTicksLeft += block.PauseMs * kTicksPerMs;
+			}
+			break;
+		case EPhase::End:
+		{
+			const bool bStop = block.bStopTape;
+			StartBlock(BlockNo + 1);
+			if (bStop)
+				bPlaying = false;
+			break;
+		}
+		}
+
+		if (pulseLength > 0)
+		{
+			bEarLevel = !bEarLevel;
+			PulseTicksLeft += pulseLength;
+		}
+	}
+}
+
+bool FTapePlayer::ShouldTrapLoad(const zx_t* pSys, uint16_t pc) const
+{
+	if (bFlashLoad == false || pc != kROMLoadBytesAddr || IsLoaded() == false || BlockNo >= (int)Blocks.size())
+		return false;
+
+	// 48K BASIC ROM has to be paged in on the 128K
+	return pSys->type == ZX_TYPE_48K || (pSys->last_mem_config & (1 << 4));
+}
+
+// Does what LD-BYTES would with the next data block on the tape, then returns to the caller
+// A - flag byte, carry set to load or clear to verify, IX - address, DE - length
+// Returns with carry set on success
+bool FTapePlayer::FlashLoadBytes(zx_t* pSys)
+{
+	int blockNo = BlockNo;
+	while (blockNo < (int)Blocks.size() && Blocks[blockNo].Data.empty())
+		blockNo++;
+	if (blockNo >= (int)Blocks.size())
+		return false;	// nothing left to load - let the ROM run
+
+	z80_t* pCPU = &pSys->cpu;
+	const std::vector<uint8_t>& data = Blocks[blockNo].Data;
+	const uint8_t flag = z80_a(pCPU);
+	const bool bVerify = (z80_f(pCPU) & Z80_CF) == 0;
+	uint16_t address = z80_ix(pCPU);
+	uint16_t length = z80_de(pCPU);
+	bool bSuccess = false;
+
+	if (data[0] == flag)
+	{
+		uint8_t parity = flag;
+		size_t pos = 1;
+		bSuccess = true;
+		while (length > 0 && pos < data.size())
+		{
+			const uint8_t value = data[pos++];
+			parity ^= value;
+			if (bVerify)
+			{
+				if (mem_rd(&pSys->mem, address) != value)
+				{
+					bSuccess = false;
+					break;
+				}
+			}
+			else
+			{
+				mem_wr(&pSys->mem, address, value);
+			}
+			address++;
+			length--;
+		}
+
+		// checksum byte follows the data
+		bSuccess = bSuccess && length == 0 && pos < data.size() && (parity ^ data[pos]) == 0;
+	}
+
+	z80_set_ix(pCPU, address);
+	z80_set_de(pCPU, length);
+	z80_set_f(pCPU, bSuccess ? (z80_f(pCPU) | Z80_CF) : (z80_f(pCPU) & ~Z80_CF));
+
+	// RET
+	const uint16_t sp = z80_sp(pCPU);
+	z80_set_pc(pCPU, mem_rd(&pSys->mem, sp) | (mem_rd(&pSys->mem, sp + 1) << 8));
+	z80_set_sp(pCPU, sp + 2);
+
+	// carry on from the next block if the tape is playing
+	StartBlock(blockNo + 1);
+	return true;
+}
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "chips/z80.h"
+#include "chips/beeper.h"
+#include "chips/ay38910.h"
+#include "chips/mem.h"
+#include "chips/kbd.h"
+#include "chips/clk.h"
+#include "systems/zx.h"
+
+// trap id returned from the CPU trap callback when the ROM LD-BYTES routine is about to run
+// below UI_DBG_STEP_TRAPID so the debugger doesn't treat it as a break
+static const int kTapeLoadTrapId = 1;
+static const uint16_t kROMLoadBytesAddr = 0x0556;
+
+// A block of tape signal - any of the parts can be empty
+// Played as pilot tone, sync pulses, pulse list, data bits then pause
+struct FTapeBlock
+{
+	uint16_t	PilotPulse = 2168;	// pulse lengths are in T-states
+	uint16_t	PilotCount = 0;
+	uint16_t	Sync1Pulse = 0;
+	uint16_t	Sync2Pulse = 0;
+	uint16_t	ZeroPulse = 855;
+	uint16_t	OnePulse = 1710;
+	uint8_t		UsedBits = 8;		// bits used in the last data byte
+	uint16_t	PauseMs = 0;
+	bool		bStopTape = false;	// stop the tape after this block
+
+	std::vector<uint16_t>	Pulses;
+	std::vector<uint8_t>	Data;	// flag, data & checksum for blocks in ROM format
+};
+
+bool LoadTAPFromMemory(const uint8_t* pData, size_t dataSize, std::vector<FTapeBlock>& outBlocks);
+bool LoadTZXFromMemory(const uint8_t* pData, size_t dataSize, std::vector<FTapeBlock>& outBlocks);
+
+// Plays a tape image into the EAR bit, with flash loading of blocks the ROM loader asks for
+class FTapePlayer
+{
+public:
+	bool	Load(const char* pFileName);	// TAP or TZX, can be in an archive
+	void	Eject();
+	bool	IsLoaded() const { return Blocks.empty() == false; }
+	void	Rewind();
+
+	void	Play() { bPlaying = IsLoaded() && BlockNo < (int)Blocks.size(); }
+	void	Stop() { bPlaying = false; }
+	bool	IsPlaying() const { return bPlaying; }
+
+	// reset the machine and type the load command
+	void	StartAutoLoad(zx_t* pSys);
+	// called once per frame before the machine runs, types queued keys & checks if a loader is running
+	void	Update(zx_t* pSys);
+
+	// real time playback - called for each machine cycle
+	void	AdvanceTicks(int noTicks)
+	{
+		if (bPlaying)
+		{
+			PulseTicksLeft -= noTicks;
+			if (PulseTicksLeft <= 0)
+				NextPulse();
+		}
+	}
+	bool	GetEarLevel() const { return bEarLevel; }
+
+	// flash loading - load the next data block straight into memory when the ROM loader is called
+	bool	ShouldTrapLoad(const zx_t* pSys, uint16_t pc) const;
+	bool	FlashLoadBytes(zx_t* pSys);
+
+	// warp - for loaders that can't be trapped the machine is run faster with code analysis paused.
+	// Only while something is polling the EAR port, so analysis resumes once the loader returns or the last block has played.
+	bool	IsWarping() const { return bPlaying && bWarpLoad && bLoaderActive; }
+	void	CountEarRead() { NoEarReads++; }
+
+	bool	bFlashLoad = true;
+	bool	bWarpLoad = true;
+
+	int		GetNoBlocks() const { return (int)Blocks.size(); }
+	int		GetBlockNo() const { return BlockNo; }
+	const std::string&	GetFileName() const { return FileName; }
+
+private:
+	void	StartBlock(int blockNo);
+	void	NextPulse();
+
+	enum class EPhase
+	{
+		Pilot,
+		Sync1,
+		Sync2,
+		Pulses,
+		Data,
+		Pause,
+		End,
+	};
+
+	std::string				FileName;
+	std::vector<FTapeBlock>	Blocks;
+	bool		bPlaying = false;
+
+	// playback state
+	int			BlockNo = 0;
+	EPhase		Phase = EPhase::Pilot;
+	int			PhaseCount = 0;
+	int			PulseTicksLeft = 0;
+	bool		bEarLevel = false;
+
+	// loader detection - tape loaders read the EAR port far more often than a keyboard scan does
+	int			NoEarReads = 0;	// this frame
+	bool		bLoaderActive = false;
+
+	// auto load typing
+	std::string	AutoLoadKeys;
+	int			AutoLoadFrame = 0;
+};
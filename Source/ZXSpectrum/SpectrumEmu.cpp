@@ -24,8 +24,10 @@ void DasmOutputD8(int8_t val, z80dasm_output_t out_cb, void* user_data);
 #include "GameViewers/MiscGameViewers.h"
 #include "Viewers/SpectrumViewer.h"
 #include "Viewers/GraphicsViewer.h"
+#include "Viewers/ZXGraphicsView.h"
 #include "Viewers/BreakpointViewer.h"
 #include "Viewers/OverviewViewer.h"
+#include "Viewers/MemoryHeatmapViewer.h"
 #include "Util/FileUtil.h"
 
 #include "ui/ui_dbg.h"
@@ -35,6 +37,7 @@ void DasmOutputD8(int8_t val, z80dasm_output_t out_cb, void* user_data);
 
 #include "zx-roms.h"
 #include <algorithm>
+#include <chrono>
 #include <sokol_audio.h>
 #include "Exporters/SkoolkitExporter.h"
 #include "Importers/SkoolkitImporter.h"
@@ -57,6 +60,7 @@ void DasmOutputD8(int8_t val, z80dasm_output_t out_cb, void* user_data);
 
 const char* kGlobalConfigFilename = "GlobalConfig.json";
 const char* kRomInfoJsonFile = "AnalysisJson/RomInfo.json";
+const char* kRomAnalysisCacheFile = "GameData/RomInfo.cache";
 const std::string kAppTitle = "Spectrum Analyser";
 
 /* output an unsigned 8-bit value as hex string */
@@ -181,6 +185,7 @@ const uint8_t* FSpectrumEmu::GetMemPtr(uint16_t address) const
 void FSpectrumEmu::WriteByte(uint16_t address, uint8_t value)
 {
 	MemWriteFunc(CurrentLayer, address, value, &ZXEmuState);
+	OnCharacterSetMemoryWrite(address);
 }
 
 
@@ -417,6 +422,10 @@ int ZXSpectrumTrapCallback(uint16_t pc, int ticks, uint64_t pins, void* user_dat
 // They are only written back at end of exec function
 int	FSpectrumEmu::TrapFunction(uint16_t pc, int ticks, uint64_t pins)
 {
+	// no analysis while warping through a tape load
+	if (IsTapeWarping())
+		return TapePlayer.ShouldTrapLoad(&ZXEmuState, pc) ? kTapeLoadTrapId : 0;
+
 	FCodeAnalysisState &state = CodeAnalysis;
 	const uint16_t addr = Z80_GET_ADDR(pins);
 	const bool bMemAccess = !!((pins & Z80_CTRL_MASK) & Z80_MREQ);
@@ -429,6 +438,9 @@ int	FSpectrumEmu::TrapFunction(uint16_t pc, int ticks, uint64_t pins)
 	PCHistoryPos = (PCHistoryPos + 1) % FSpectrumEmu::kPCHistorySize;
 	PCHistory[PCHistoryPos] = pc;
 
+	if (ExecutionTrace.IsOpen())
+		ExecutionTrace.AddInstruction(nextpc);
+
 	pc = prevPC;	// set PC to pc of instruction just executed
 
 	if (irq)
@@ -475,6 +487,10 @@ int	FSpectrumEmu::TrapFunction(uint16_t pc, int ticks, uint64_t pins)
 
 	RZXManager.RegisterInstructions(iCount);
 
+	// stop before the ROM tape loader so the block can be flash loaded
+	if (trapId == 0 && TapePlayer.ShouldTrapLoad(&ZXEmuState, nextpc))
+		trapId = kTapeLoadTrapId;
+
 	return trapId;
 }
 
@@ -485,8 +501,27 @@ int UIEvalBreakpoint(ui_dbg_t* dbg_win, uint16_t pc, int ticks, uint64_t pins, v
 
 // Note - you can't read the cpu vars during tick
 // They are only written back at end of exec function
+static const uint32_t kTapeWarpSpeed = 10;
+
+// tape signal goes to the EAR bit of ULA port reads
+static uint64_t TapeTick(FTapePlayer& tapePlayer, int num, uint64_t pins)
+{
+	tapePlayer.AdvanceTicks(num);
+	if ((pins & Z80_IORQ) && (pins & Z80_RD) && (pins & Z80_A0) == 0)
+	{
+		tapePlayer.CountEarRead();
+		const uint8_t value = Z80_GET_DATA(pins);
+		Z80_SET_DATA(pins, (uint64_t)((value & ~(1 << 6)) | (tapePlayer.GetEarLevel() ? (1 << 6) : 0)));
+	}
+	return pins;
+}
+
 uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
 {
+	// no analysis while warping through a tape load
+	if (IsTapeWarping())
+		return TapeTick(TapePlayer, num, OldTickCB(num, pins, OldTickUserData));
+
 	FCodeAnalysisState &state = CodeAnalysis;
 
 	// we have to pass data to the tick through an internal state struct because the z80_t struct only gets updated after an emulation exec period
@@ -531,17 +566,10 @@ uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
 				RegisterDataWrite(state, pc, addr);
 
 			state.SetLastWriterForAddress(addr,pc);
+			OnCharacterSetMemoryWrite(addr);
 
-			// Log screen pixel writes
-			if (addr >= 0x4000 && addr < 0x5800)
-			{
-				FrameScreenPixWrites.push_back({ addr,value, pc });
-			}
-			// Log screen attribute writes
-			if (addr >= 0x5800 && addr < 0x5800 + 0x400)
-			{
-				FrameScreenAttrWrites.push_back({ addr,value, pc });
-			}
+			// Log screen pixel & attribute writes
+			ScreenWrites.RegisterWrite(addr, value, pc);
 			FCodeInfo *pCodeWrittenTo = state.GetCodeInfoForAddress(addr);
 			if (pCodeWrittenTo != nullptr && pCodeWrittenTo->bSelfModifyingCode == false)
 			{
@@ -557,6 +585,34 @@ uint64_t FSpectrumEmu::Z80Tick(int num, uint64_t pins)
 
 	pins =  OldTickCB(num, pins, OldTickUserData);
 
+	if (TapePlayer.IsPlaying())
+		pins = TapeTick(TapePlayer, num, pins);
+
+	// trace after the machine tick so reads have their data - opcode fetches are covered by the instruction events
+	if (FrameTraceViewer.IsRecordingToDisk() && (pins & Z80_MREQ) && (pins & Z80_M1) == 0 && (pins & (Z80_RD | Z80_WR)))
+		FrameTraceViewer.RecordMemoryAccess((pins & Z80_WR) != 0, Z80_GET_ADDR(pins), Z80_GET_DATA(pins), pc);
+
+	if (ExecutionTrace.IsOpen())
+	{
+		const uint16_t addr = Z80_GET_ADDR(pins);
+		const uint8_t value = Z80_GET_DATA(pins);
+		if ((pins & Z80_MREQ) && (pins & Z80_M1) == 0)
+		{
+			if (pins & Z80_RD)
+				ExecutionTrace.AddAccess(ETraceEventType::MemoryRead, pc, addr, value);
+			else if (pins & Z80_WR)
+				ExecutionTrace.AddAccess(ETraceEventType::MemoryWrite, pc, addr, value);
+		}
+		else if ((pins & Z80_IORQ) && (pins & Z80_M1) == 0)
+		{
+			if (pins & Z80_RD)
+				ExecutionTrace.AddAccess(ETraceEventType::IORead, pc, addr, value);
+			else if (pins & Z80_WR)
+				ExecutionTrace.AddAccess(ETraceEventType::IOWrite, pc, addr, value);
+		}
+		ExecutionTrace.AddTicks(num);
+	}
+
 	if (pins & Z80_INT)	// have we had a vblank interrupt?
 	{
 	}
@@ -591,8 +647,8 @@ void FSpectrumEmu::SetROMBank(int bankNo)
 
 	for (int pageNo = 0; pageNo < kNoSlotPages; pageNo++)
 	{
-		ROMPages[pageNo].ChangeAddress((pageNo * FCodeAnalysisPage::kPageSize));
-		CodeAnalysis.SetCodeAnalysisRWPage(pageNo, &RAMPages[firstBankPage + pageNo], &RAMPages[firstBankPage + pageNo]);	// Read/Write
+		ROMPages[firstBankPage + pageNo].ChangeAddress((pageNo * FCodeAnalysisPage::kPageSize));
+		CodeAnalysis.SetCodeAnalysisRWPage(pageNo, &ROMPages[firstBankPage + pageNo], &ROMPages[firstBankPage + pageNo]);	// Read Only
 	}
 }
 
@@ -606,7 +662,7 @@ void FSpectrumEmu::SetRAMBank(int slot, int bankNo)
 
 	for (int pageNo = 0; pageNo < kNoSlotPages; pageNo++)
 	{
-		RAMPages[pageNo].ChangeAddress(slotAddress + (pageNo * FCodeAnalysisPage::kPageSize));
+		RAMPages[firstBankPage + pageNo].ChangeAddress(slotAddress + (pageNo * FCodeAnalysisPage::kPageSize));
 		CodeAnalysis.SetCodeAnalysisRWPage(firstSlotPage + pageNo, &RAMPages[firstBankPage + pageNo], &RAMPages[firstBankPage + pageNo]);	// Read/Write
 	}
 }
@@ -650,12 +706,19 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 
 	zx_init(&ZXEmuState, &desc);
 
-	GamesList.Init(this);
-	GamesList.EnumerateGames(globalConfig.SnapshotFolder.c_str());
+	// snapshot folders are scanned in the background, metadata is cached in the workspace
+	FSpectrumROMs roms;
+	roms.pROM48K = dump_amstrad_zx48k_bin;
+	roms.pROM128K_0 = dump_amstrad_zx128k_0_bin;
+	roms.pROM128K_1 = dump_amstrad_zx128k_1_bin;
+	EnsureDirectoryExists(globalConfig.WorkspaceRoot.c_str());
+
+	GamesList.Init(this, roms);
+	GamesList.EnumerateGames(globalConfig.SnapshotFolder.c_str(), std::string(globalConfig.WorkspaceRoot + "SnapshotIndex.bin").c_str());
 
 	RZXManager.Init(this);
-	RZXGamesList.Init(this);
-	RZXGamesList.EnumerateGames(globalConfig.RZXFolder.c_str());
+	RZXGamesList.Init(this, roms);
+	RZXGamesList.EnumerateGames(globalConfig.RZXFolder.c_str(), std::string(globalConfig.WorkspaceRoot + "RZXIndex.bin").c_str());
 
 	// Clear UI
 	memset(&UIZX, 0, sizeof(ui_zx_t));
@@ -697,6 +760,7 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 	// This is where we add the viewers we want
 	Viewers.push_back(new FBreakpointViewer(this));
 	Viewers.push_back(new FOverviewViewer(this));
+	Viewers.push_back(new FMemoryHeatmapViewer(this));
 
 	// Initialise Viewers
 	for (auto Viewer : Viewers)
@@ -779,12 +843,11 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 		const std::string root = GetGlobalConfig().WorkspaceRoot;
 		const std::string romBinData = root + "GameData/RomInfo.bin";
 		const std::string romJsonFName = root + kRomInfoJsonFile;
+		const std::string romCacheFName = root + kRomAnalysisCacheFile;
 		
 		InitialiseCodeAnalysis(CodeAnalysis, this);
 
-		if (FileExists(romJsonFName.c_str()))
-			ImportAnalysisJson(CodeAnalysis, romJsonFName.c_str());
-		else
+		if (LoadROMAnalysis(CodeAnalysis, romJsonFName.c_str(), romCacheFName.c_str()) == false)
 			LoadROMData(CodeAnalysis, romBinData.c_str());
 	}
 
@@ -794,6 +857,12 @@ bool FSpectrumEmu::Init(const FSpectrumConfig& config)
 void FSpectrumEmu::Shutdown()
 {
 	SaveCurrentGameData();	// save on close
+	SaveTask.Wait();
+	AnalysisJournal.Close();
+	ExecutionTrace.Close();
+	delete pSnapshotThumbnailView;
+	pSnapshotThumbnailView = nullptr;
+	ShutdownCharacterMapViewer();
 
 	// Save Global Config - move to function?
 	FGlobalConfig& config = GetGlobalConfig();
@@ -811,6 +880,8 @@ void FSpectrumEmu::Shutdown()
 
 void FSpectrumEmu::StartGame(FGameConfig *pGameConfig)
 {
+	SaveTask.Wait();	// the save snapshot's items are freed when the code analysis is initialised
+
 	MemoryAccessHandlers.clear();	// remove old memory handlers
 
 	ResetMemoryStats(MemStats);
@@ -851,30 +922,50 @@ void FSpectrumEmu::StartGame(FGameConfig *pGameConfig)
 	const std::string dataFName = root + "GameData/" + pGameConfig->Name + ".bin";
 #if READ_ANALYSIS_JSON
 	const std::string romJsonFName = root + kRomInfoJsonFile;
+	const std::string romCacheFName = root + kRomAnalysisCacheFile;
 	const std::string analysisJsonFName = root + "AnalysisJson/" + pGameConfig->Name + ".json";
 	const std::string saveStateFName = root + "SaveStates/" + pGameConfig->Name + ".state";
+	bool bImportedJson = false;
 	if (FileExists(analysisJsonFName.c_str()))
-		ImportAnalysisJson(CodeAnalysis, analysisJsonFName.c_str());
-	else
+	{
+		bImportedJson = ImportAnalysisJson(CodeAnalysis, analysisJsonFName.c_str());
+		if (bImportedJson == false)
+		{
+			LOGWARNING("Could not import '%s', loading game data instead", analysisJsonFName.c_str());
+			InitialiseCodeAnalysis(CodeAnalysis, this);	// throw away whatever was imported before the error
+		}
+	}
+	if (bImportedJson == false)
 		LoadGameData(this, dataFName.c_str());
 
 	LoadGameState(this, saveStateFName.c_str());
+	InvalidateCharacterSetMemory(0, 0x10000);	// not written by the CPU
+	ScreenWrites.Reset();
 
-	if (FileExists(romJsonFName.c_str()))
-		ImportAnalysisJson(CodeAnalysis, romJsonFName.c_str());
-	else
+	if (LoadROMAnalysis(CodeAnalysis, romJsonFName.c_str(), romCacheFName.c_str()) == false)
 		LoadROMData(CodeAnalysis, romBinData.c_str());
 #else
 	// load game data if we can
 	LoadGameData(this, dataFName.c_str());
 	LoadROMData(CodeAnalysis, romJsonFName.c_str());
 #endif
+	// recover any analysis changes made since the last full save
+	const std::string journalFName = root + "GameData/" + pGameConfig->Name + ".journal";
+	const int noRecoveredPages = FAnalysisJournal::Replay(journalFName.c_str(), GetJournalPages(), pGameConfig->SaveGeneration);
+	if (noRecoveredPages > 0)
+		LOGINFO("Recovered %d analysis pages from '%s'", noRecoveredPages, journalFName.c_str());
+
 	// where do we want pokes to live?
 	LoadPOKFile(*pGameConfig, std::string(GetGlobalConfig().PokesFolder + pGameConfig->Name + ".pok").c_str());
 	ReAnalyseCode(CodeAnalysis);
 	GenerateGlobalInfo(CodeAnalysis);
 	FormatSpectrumMemory(CodeAnalysis);
 	CodeAnalysis.SetCodeAnalysisDirty();
+	CodeAnalysis.XRefs.Invalidate();	// references have been replaced by the loaded analysis
+
+	EnsureDirectoryExists(std::string(root + "GameData").c_str());
+	AnalysisJournal.Open(journalFName.c_str(), GetJournalPages(), pGameConfig->SaveGeneration);
+	LastAutoSaveTime = ImGui::GetTime();
 
 	// Start in break mode so the memory will be in it's initial state. 
 	// Otherwise, if we export a skool/asm file once the game is running the memory could be in an arbitrary state.
@@ -911,6 +1002,31 @@ bool FSpectrumEmu::StartGame(const char *pGameName)
 	return false;
 }
 
+std::vector<FCodeAnalysisPage*> FSpectrumEmu::GetJournalPages()
+{
+	std::vector<FCodeAnalysisPage*> pages;
+	for (int pageNo = 0; pageNo < kNoRAMPages; pageNo++)
+		pages.push_back(&RAMPages[pageNo]);
+	return pages;
+}
+
+// Cheap periodic save - only pages that have changed are written to the journal
+void FSpectrumEmu::AutoSaveAnalysis()
+{
+	const int autoSaveInterval = GetGlobalConfig().AutoSaveInterval;
+	if (autoSaveInterval <= 0 || AnalysisJournal.IsOpen() == false)
+		return;
+
+	const double time = ImGui::GetTime();
+	if (time - LastAutoSaveTime < autoSaveInterval)
+		return;
+
+	LastAutoSaveTime = time;
+	const int noPagesWritten = AnalysisJournal.WriteChanges();
+	if (noPagesWritten > 0)
+		LOGDEBUG("Autosave: %d analysis pages journaled", noPagesWritten);
+}
+
 // save config & data
 void FSpectrumEmu::SaveCurrentGameData()
 {
@@ -943,12 +1059,28 @@ void FSpectrumEmu::SaveCurrentGameData()
 				viewConfig.ViewAddress = viewState.GetCursorItem() ? viewState.GetCursorItem()->Address : 0;
 			}
 
+			// the config is written with the new generation before the journal restarts with it
+			// so a journal left over from before this save is never replayed on top of it
+			pGameConfig->SaveGeneration++;
 			SaveGameConfigToFile(*pGameConfig, configFName.c_str());
 			SaveGameData(this, dataFName.c_str());		// The Past
 
 			// The Future
 			SaveGameState(this, saveStateFName.c_str());
-			ExportGameJson(this, analysisJsonFName.c_str());
+
+			// snapshot the analysis and leave formatting & writing the json to a worker thread
+			SaveTask.Wait();
+			FAnalysisJsonSnapshot* pSnapshot = CreateGameJsonSnapshot(this);
+			SaveTask.Start("Save analysis json", [pSnapshot, analysisJsonFName](FBackgroundTask& task)
+			{
+				const bool bSuccess = WriteJsonSnapshot(*pSnapshot, analysisJsonFName.c_str(), &task);
+				delete pSnapshot;
+				return bSuccess;
+			});
+
+			// journal restarts from the state we've just saved
+			if (AnalysisJournal.IsOpen())
+				AnalysisJournal.Compact(pGameConfig->SaveGeneration);
 		}
 	}
 
@@ -962,6 +1094,47 @@ void FSpectrumEmu::SaveCurrentGameData()
 #endif
 }
 
+// details & screen of a snapshot from the snapshot index
+void FSpectrumEmu::DrawSnapshotTooltip(const FGameSnapshot& game)
+{
+	if (ImGui::IsItemHovered() == false)
+		return;
+
+	const FSnapshotInfo& info = game.Info;
+	ImGui::BeginTooltip();
+	if (info.bLoaded)
+		ImGui::Text("%s, %d bytes, hash %08X", info.bIs128K ? "128K" : "48K", (int)info.FileSize, info.Hash);
+	else
+		ImGui::Text("%d bytes, hash %08X", (int)info.FileSize, info.Hash);
+
+	if (info.Thumbnail.empty() == false)
+	{
+		if (pSnapshotThumbnailView == nullptr)
+			pSnapshotThumbnailView = new FZXGraphicsView(256, 192);
+
+		if (SnapshotThumbnailFileName != game.FileName)
+		{
+			uint8_t screen[kSnapshotScreenSize];
+			pSnapshotThumbnailView->Clear();
+			if (DecompressSnapshotThumbnail(info, screen))
+			{
+				for (int y = 0; y < 192; y++)
+				{
+					for (int x = 0; x < 256; x += 8)
+					{
+						const uint8_t pixels = screen[GetScreenPixMemoryAddress(x, y) - 0x4000];
+						const uint8_t attr = screen[GetScreenAttrMemoryAddress(x, y) - 0x4000];
+						pSnapshotThumbnailView->DrawCharLine(pixels, x, y, attr);
+					}
+				}
+			}
+			SnapshotThumbnailFileName = game.FileName;
+		}
+		pSnapshotThumbnailView->Draw(false);
+	}
+	ImGui::EndTooltip();
+}
+
 void FSpectrumEmu::DrawMainMenu(double timeMS)
 {
 	ui_zx_t* pZXUI = &UIZX;
@@ -973,6 +1146,9 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 		{
 			if (ImGui::BeginMenu("New Game from Snapshot File"))
 			{
+				if (GamesList.IsScanning())
+					ImGui::Text("Scanning... %d%%", (int)(GamesList.GetScanProgress() * 100.0f));
+
 				for(int gameNo=0;gameNo<GamesList.GetNoGames();gameNo++)
 				{
 					const FGameSnapshot& game = GamesList.GetGame(gameNo);
@@ -986,6 +1162,7 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 								StartGame(pNewConfig);
 						}
 					}
+					DrawSnapshotTooltip(game);
 				}
 
 				ImGui::EndMenu();
@@ -994,6 +1171,9 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 #if ENABLE_RZX
 			if (ImGui::BeginMenu("New Game from RZX File"))
 			{
+				if (RZXGamesList.IsScanning())
+					ImGui::Text("Scanning... %d%%", (int)(RZXGamesList.GetScanProgress() * 100.0f));
+
 				for (int gameNo = 0; gameNo < RZXGamesList.GetNoGames(); gameNo++)
 				{
 					const FGameSnapshot& game = RZXGamesList.GetGame(gameNo);
@@ -1007,6 +1187,7 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 								StartGame(pNewConfig);
 						}
 					}
+					DrawSnapshotTooltip(game);
 				}
 				ImGui::EndMenu();
 			}
@@ -1118,6 +1299,29 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 				pZXUI->boot_cb(pZXUI->zx, ZX_TYPE_128);
 				ui_dbg_reboot(&pZXUI->dbg);
 			}*/
+			if (ImGui::BeginMenu("Tape"))
+			{
+				if (TapePlayer.IsLoaded())
+				{
+					ImGui::Text("%s", GetFileFromPath(TapePlayer.GetFileName().c_str()).c_str());
+					ImGui::Text("Block %d/%d", TapePlayer.GetBlockNo(), TapePlayer.GetNoBlocks());
+					if (ImGui::MenuItem(TapePlayer.IsPlaying() ? "Stop" : "Play"))
+						TapePlayer.IsPlaying() ? TapePlayer.Stop() : TapePlayer.Play();
+					if (ImGui::MenuItem("Rewind"))
+						TapePlayer.Rewind();
+					if (ImGui::MenuItem("Eject"))
+						TapePlayer.Eject();
+				}
+				else
+				{
+					ImGui::Text("No tape");
+				}
+				ImGui::MenuItem("Flash Load", 0, &TapePlayer.bFlashLoad);
+				ImGui::MenuItem("Warp Load", 0, &TapePlayer.bWarpLoad);
+				if (ImGui::IsItemHovered())
+					ImGui::SetTooltip("Runs custom loaders at x%d speed.\nCode analysis is paused while a loader is reading the tape.\nNot used with an RZX or trace running, or breakpoints set.", (int)kTapeWarpSpeed);
+				ImGui::EndMenu();
+			}
 			if (ImGui::BeginMenu("Joystick")) 
 			{
 				if (ImGui::MenuItem("None", 0, (pZXUI->zx->joystick_type == ZX_JOYSTICKTYPE_NONE)))
@@ -1217,6 +1421,14 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 			{
 				CodeAnalysis.FindAsciiStrings(0x4000);
 			}
+			if (ImGui::MenuItem("Benchmark Page Serialisation"))
+			{
+				BenchmarkPageSerialisation(CodeAnalysis);
+			}
+			if (ImGui::MenuItem("Benchmark Analysis Json"))
+			{
+				BenchmarkAnalysisJson(this);
+			}
 			ImGui::EndMenu();
 		}
 #endif
@@ -1284,6 +1496,12 @@ void FSpectrumEmu::DrawMainMenu(double timeMS)
 		
 		//ui_util_options_menu(timeMS, pZXUI->dbg.dbg.stopped);
 
+		if (SaveTask.IsRunning())
+		{
+			ImGui::SameLine(ImGui::GetWindowWidth() - 320);
+			ImGui::Text("%s: %d%%", SaveTask.GetName().c_str(), (int)(SaveTask.GetProgress() * 100.0f));
+		}
+
 		// draw emu timings
 		ImGui::SameLine(ImGui::GetWindowWidth() - 120);
 		if (pZXUI->dbg.dbg.stopped) 
@@ -1354,6 +1572,9 @@ void StoreRegisters_Z80(FCodeAnalysisState& state);
 void FSpectrumEmu::Tick()
 {
 	SpectrumViewer.Tick();
+	SaveTask.Update();
+	GamesList.Update();
+	RZXGamesList.Update();
 
 	ExecThisFrame = ui_zx_before_exec(&UIZX);
 
@@ -1361,7 +1582,19 @@ void FSpectrumEmu::Tick()
 	{
 		const float frameTime = std::min(1000000.0f / ImGui::GetIO().Framerate, 32000.0f) * ExecSpeedScale;
 		//const float frameTime = min(1000000.0f / 50, 32000.0f) * ExecSpeedScale;
-		const uint32_t microSeconds = std::max(static_cast<uint32_t>(frameTime), uint32_t(1));
+		uint32_t microSeconds = std::max(static_cast<uint32_t>(frameTime), uint32_t(1));
+
+		TapePlayer.Update(&ZXEmuState);
+		if (IsTapeWarping())
+		{
+			microSeconds *= kTapeWarpSpeed;
+			bTapeWarped = true;
+		}
+		else if (bTapeWarped)
+		{
+			InvalidateCharacterSetMemory(0, 0x10000);
+			bTapeWarped = false;
+		}
 
 		// TODO: Start frame method in analyser
 		CodeAnalysis.FrameTrace.clear();
@@ -1369,6 +1602,20 @@ void FSpectrumEmu::Tick()
 
 		zx_exec(&ZXEmuState, microSeconds);
 
+		// stopped at the ROM loader
+		if (ZXEmuState.cpu.trap_id == kTapeLoadTrapId)
+		{
+			TapePlayer.FlashLoadBytes(&ZXEmuState);
+			InvalidateCharacterSetMemory(0x4000, 0xc000);	// not written by the CPU
+		}
+
+		// 128K paging changes the memory character sets see without any writes
+		if (ZXEmuState.last_mem_config != LastMemConfig)
+		{
+			InvalidateCharacterSetMemory(0xc000, 0x4000);
+			LastMemConfig = ZXEmuState.last_mem_config;
+		}
+
 		/*if (RZXManager.GetReplayMode() == EReplayMode::Playback)
 		{
 			assert(ZXEmuState.valid);
@@ -1393,9 +1640,9 @@ void FSpectrumEmu::Tick()
 		}*/
 		ImGui_UpdateTextureRGBA(Texture, FrameBuffer);
 
+		ScreenWrites.EndFrame();
 		FrameTraceViewer.CaptureFrame();
-		FrameScreenPixWrites.clear();
-		FrameScreenAttrWrites.clear();
+		ExecutionTrace.EndFrame();
 
 		if (bStepToNextFrame)
 		{
@@ -1412,6 +1659,8 @@ void FSpectrumEmu::Tick()
 	}
 
 	UpdateCharacterSets(CodeAnalysis);
+	UpdateCodeAnalysisIndices(CodeAnalysis);
+	AutoSaveAnalysis();
 
 	// Draw UI
 	DrawDockingView();
@@ -1605,6 +1854,8 @@ void FSpectrumEmu::DrawUI()
 
 	if (bShowDebugLog)
 		g_ImGuiLog.Draw("Debug Log", &bShowDebugLog);
+	else
+		g_ImGuiLog.Update();
 }
 
 bool FSpectrumEmu::DrawDockingView()
@@ -1878,6 +2129,7 @@ bool FSpectrumEmu::ExportSkoolFile(bool bHexadecimal, const char* pName /* = nul
 // You can optionally pass a game to start in pGameName. The output skool file will have the same name as the game.
 // If no game name is passed, then no game will be started and you must pass the name of the output skool file in pOutSkoolName.
 // This can be used to import and export skool files for the spectrum rom. 
+// The import and export are timed so this doubles as a benchmark for large skool files.
 void FSpectrumEmu::DoSkoolKitTest(const char* pGameName, const char* pInSkoolFileName, bool bHexadecimal, const char* pOutSkoolName /* = nullptr*/)
 {
 	if (!pGameName && !pOutSkoolName)
@@ -1891,13 +2143,25 @@ void FSpectrumEmu::DoSkoolKitTest(const char* pGameName, const char* pInSkoolFil
 
 	FSkoolFileInfo skoolInfo;
 	std::string inSkoolPath = std::string("InputSkoolKit/") + pInSkoolFileName;
+	const auto importStart = std::chrono::high_resolution_clock::now();
     if (!ImportSkoolFile(inSkoolPath.c_str(), pOutSkoolName, &skoolInfo))
 		return;
+	const auto importEnd = std::chrono::high_resolution_clock::now();
 
 	EnsureDirectoryExists("OutputSkoolKit/");
 	std::string outFname = "OutputSkoolKit/" + std::string(pGameName ? pGameName : pOutSkoolName) + ".skool";
 	FSkoolFile::Base base = bHexadecimal ? FSkoolFile::Base::Hexadecimal : FSkoolFile::Base::Decimal;
+	const auto exportStart = std::chrono::high_resolution_clock::now();
 	::ExportSkoolFile(CodeAnalysis, outFname.c_str(), base, &skoolInfo);
+	const auto exportEnd = std::chrono::high_resolution_clock::now();
+
+	const double importTimeMs = std::chrono::duration<double, std::milli>(importEnd - importStart).count();
+	const double exportTimeMs = std::chrono::duration<double, std::milli>(exportEnd - exportStart).count();
+	const double inSizeMB = (double)GetFileSizeBytes(inSkoolPath.c_str()) / (1024.0 * 1024.0);
+	const double outSizeMB = (double)GetFileSizeBytes(outFname.c_str()) / (1024.0 * 1024.0);
+	LOGINFO("SkoolKit test: import %.2fms (%.2fMB, %.1fMB/s), export %.2fms (%.2fMB, %.1fMB/s)",
+		importTimeMs, inSizeMB, importTimeMs > 0.0 ? inSizeMB * 1000.0 / importTimeMs : 0.0,
+		exportTimeMs, outSizeMB, exportTimeMs > 0.0 ? outSizeMB * 1000.0 / exportTimeMs : 0.0);
 }
 
 // Util functions - move
@@ -32,14 +32,19 @@
 //#include "Disassembler.h"
 //#include "FunctionHandlers.h"
 #include "CodeAnalyser/CodeAnalyser.h"
+#include "CodeAnalyser/AnalysisJournal.h"
 #include "Viewers/ViewerBase.h"
 #include "Viewers/GraphicsViewer.h"
 #include "Viewers/SpectrumViewer.h"
 #include "Viewers/FrameTraceViewer.h"
+#include "Util/ExecutionTrace.h"
 #include "SnapshotLoaders/GamesList.h"
 #include "IOAnalysis.h"
+#include "ScreenWriteMap.h"
 #include "SnapshotLoaders/RZXLoader.h"
+#include "SnapshotLoaders/TapeLoader.h"
 #include "Util/Misc.h"
+#include "Util/BackgroundTask.h"
 
 struct FGame;
 struct FGameViewer;
@@ -47,6 +52,7 @@ struct FGameViewerData;
 struct FGameConfig;
 struct FViewerConfig;
 struct FSkoolFileInfo;
+class FZXGraphicsView;
 
 enum class ESpectrumModel
 {
@@ -82,7 +88,9 @@ public:
 	void	StartGame(FGameConfig* pGameConfig);
 	bool	StartGame(const char* pGameName);
 	void	SaveCurrentGameData();
+	void	AutoSaveAnalysis();
 	void	DrawMainMenu(double timeMS);
+	void	DrawSnapshotTooltip(const FGameSnapshot& game);
 	void	DrawCheatsUI();
 	bool	ImportSkoolFile(const char* pFilename, const char* pOutSkoolInfoName = nullptr, FSkoolFileInfo* pSkoolInfo=nullptr);
 	bool	ExportSkoolFile(bool bHexadecimal, const char* pName = nullptr);
@@ -150,6 +158,7 @@ public:
 	ImTextureID		Texture;		// texture 
 	
 	bool			ExecThisFrame = true; // Whether the emulator should execute this frame (controlled by UI)
+	uint8_t			LastMemConfig = 0;	// 128K paging seen by the character sets
 	float			ExecSpeedScale = 1.0f;
 
 	// Chips UI
@@ -159,6 +168,8 @@ public:
 
 	FGamesList		GamesList;
 	FGamesList		RZXGamesList;
+	FZXGraphicsView*	pSnapshotThumbnailView = nullptr;
+	std::string		SnapshotThumbnailFileName;	// snapshot currently in the thumbnail view
 
 	//Viewers
 	FSpectrumViewer			SpectrumViewer;
@@ -178,8 +189,8 @@ public:
 	// Memory handling
 	std::string				SelectedMemoryHandler;
 	std::vector< FMemoryAccessHandler>	MemoryAccessHandlers;
-	std::vector< FMemoryAccess>	FrameScreenPixWrites;
-	std::vector< FMemoryAccess>	FrameScreenAttrWrites;
+	FScreenWriteMap				ScreenWrites;	// who wrote each screen byte, this frame & last
+	FExecutionTraceWriter		ExecutionTrace;	// instruction & memory access trace, recorded while open
 
 	FMemoryStats	MemStats;
 
@@ -200,6 +211,15 @@ public:
 	int PCHistoryPos = 0;
 
 	FRZXManager		RZXManager;
+	FTapePlayer		TapePlayer;
+	bool			bTapeWarped = false;	// memory writes weren't tracked, character sets need refreshing when the warp ends
+
+	// warping skips the per instruction hooks, so it's held off while anything relies on them
+	bool	IsTapeWarping() const
+	{
+		return TapePlayer.IsWarping() && RZXManager.GetReplayMode() == EReplayMode::Off && ExecutionTrace.IsOpen() == false
+			&& FrameTraceViewer.IsRecordingToDisk() == false && UIZX.dbg.dbg.num_breakpoints == 0 && bStepToNextScreenWrite == false;
+	}
 
 	bool bShowImGuiDemo = false;
 	bool bShowImPlotDemo = false;
@@ -214,6 +234,13 @@ private:
 
 	bool	bShowDebugLog = false;
 
+	// journal of analysis changes since the last full save
+	std::vector<FCodeAnalysisPage*>	GetJournalPages();
+	FAnalysisJournal	AnalysisJournal;
+	double				LastAutoSaveTime = 0;
+
+	// json export is slow for big analyses so is written on a worker thread
+	FBackgroundTask		SaveTask;
 
 };
 
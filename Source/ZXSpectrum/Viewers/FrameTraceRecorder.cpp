@@ -0,0 +1,527 @@
+#include "FrameTraceRecorder.h"
+#include "FrameTraceViewer.h"
+
+#include <Debug/DebugLog.h>
+#include <zlib.h>
+#include <cstring>
+
+static const uint32_t kTraceFileMagic = 0x43525446;	// 'FTRC'
+static const uint32_t kTraceChunkMagic = 0x4b435446;	// 'FTCK'
+static const uint32_t kTraceIndexMagic = 0x58495446;	// 'FTIX'
+static const uint32_t kTraceFileVersion = 1;
+
+static const size_t kFileHeaderSize = 8;	// magic, version
+static const size_t kChunkHeaderSize = 20;	// magic, first frame, no frames, compressed size, uncompressed size
+static const size_t kIndexEntrySize = 16;	// first frame, no frames, file offset
+static const size_t kFooterSize = 16;		// index offset, no chunks, magic
+
+static const size_t kChunkBufferInitialSize = 1024 * 1024;
+
+static bool SeekTo(FILE* fp, uint64_t offset)
+{
+#ifdef _WIN32
+	return _fseeki64(fp, (__int64)offset, SEEK_SET) == 0;
+#else
+	return fseeko(fp, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+static uint64_t GetFilePos(FILE* fp)
+{
+#ifdef _WIN32
+	return (uint64_t)_ftelli64(fp);
+#else
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+static uint64_t GetFileSize(FILE* fp)
+{
+#ifdef _WIN32
+	_fseeki64(fp, 0, SEEK_END);
+	return (uint64_t)_ftelli64(fp);
+#else
+	fseeko(fp, 0, SEEK_END);
+	return (uint64_t)ftello(fp);
+#endif
+}
+
+template <class T>
+static bool ReadValue(FILE* fp, T& value)
+{
+	return fread(&value, sizeof(T), 1, fp) == 1;
+}
+
+// Bounds checked reader over a decompressed chunk
+struct FTraceChunkParser
+{
+	const uint8_t*	pData;
+	size_t			Size;
+	size_t			Pos;
+
+	template <class T>
+	bool Read(T& value)
+	{
+		if (Pos + sizeof(T) > Size)
+			return false;
+		memcpy(&value, pData + Pos, sizeof(T));
+		Pos += sizeof(T);
+		return true;
+	}
+
+	bool Skip(size_t noBytes)
+	{
+		if (Pos + noBytes > Size)
+			return false;
+		Pos += noBytes;
+		return true;
+	}
+};
+
+static const size_t kAccessRecordSize = 5;	// address, value, pc
+static const size_t kDiffRecordSize = 4;	// address, old value, new value
+
+static void WriteAccessList(FMemoryBuffer& buffer, const std::vector<FMemoryAccess>& accesses)
+{
+	buffer.Write<uint32_t>((uint32_t)accesses.size());
+	for (const FMemoryAccess& access : accesses)
+	{
+		buffer.Write<uint16_t>(access.Address);
+		buffer.Write<uint8_t>(access.Value);
+		buffer.Write<uint16_t>(access.PC);
+	}
+}
+
+static bool ReadAccessList(FTraceChunkParser& parser, std::vector<FMemoryAccess>& accesses)
+{
+	uint32_t count = 0;
+	if (parser.Read(count) == false || (size_t)count * kAccessRecordSize > parser.Size - parser.Pos)
+		return false;
+
+	accesses.resize(count);
+	for (FMemoryAccess& access : accesses)
+	{
+		parser.Read(access.Address);
+		parser.Read(access.Value);
+		parser.Read(access.PC);
+	}
+	return true;
+}
+
+// skip over a frame record - used to build the frame offsets for a chunk
+static bool SkipFrameRecord(FTraceChunkParser& parser)
+{
+	int32_t frameNo = 0;
+	uint32_t count = 0;
+	if (parser.Read(frameNo) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * sizeof(uint16_t)) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * kAccessRecordSize) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * kAccessRecordSize) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * kDiffRecordSize) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * kAccessRecordSize) == false)
+		return false;
+	if (parser.Read(count) == false || parser.Skip(count * kAccessRecordSize) == false)
+		return false;
+	return true;
+}
+
+// Recorder
+
+bool FFrameTraceRecorder::Open(const char* pFileName)
+{
+	Close();
+
+	FilePtr = fopen(pFileName, "wb");
+	if (FilePtr == nullptr)
+	{
+		LOGWARNING("Could not open trace file '%s' for writing", pFileName);
+		return false;
+	}
+
+	FileName = pFileName;
+	bWriteError = false;
+	NoFramesRecorded = 0;
+	ChunkFirstFrame = 0;
+	ChunkNoFrames = 0;
+	ChunkIndex.clear();
+	ChunkBuffer.Init(kChunkBufferInitialSize);
+	FrameReads.clear();
+	FrameWrites.clear();
+
+	WriteToFile(&kTraceFileMagic, sizeof(uint32_t));
+	WriteToFile(&kTraceFileVersion, sizeof(uint32_t));
+	if (bWriteError)
+	{
+		CloseOnWriteError();
+		return false;
+	}
+	return true;
+}
+
+void FFrameTraceRecorder::WriteToFile(const void* pData, size_t size)
+{
+	if (bWriteError == false && fwrite(pData, 1, size, FilePtr) != size)
+		bWriteError = true;
+}
+
+// stop recording - the file is left without an index, readers will scan the complete chunks
+void FFrameTraceRecorder::CloseOnWriteError()
+{
+	LOGERROR("Failed to write trace file '%s', recording stopped after %d frames", FileName.c_str(), NoFramesRecorded);
+	fclose(FilePtr);
+	FilePtr = nullptr;
+}
+
+void FFrameTraceRecorder::Close()
+{
+	if (FilePtr == nullptr)
+		return;
+
+	FlushChunk();
+
+	// write chunk index & footer
+	if (FilePtr == nullptr)	// write failed
+		return;
+
+	const uint64_t indexOffset = GetFilePos(FilePtr);
+	for (const FFrameTraceChunkInfo& chunk : ChunkIndex)
+	{
+		const int32_t firstFrame = chunk.FirstFrame;
+		const int32_t noFrames = chunk.NoFrames;
+		WriteToFile(&firstFrame, sizeof(int32_t));
+		WriteToFile(&noFrames, sizeof(int32_t));
+		WriteToFile(&chunk.FileOffset, sizeof(uint64_t));
+	}
+	const uint32_t noChunks = (uint32_t)ChunkIndex.size();
+	WriteToFile(&indexOffset, sizeof(uint64_t));
+	WriteToFile(&noChunks, sizeof(uint32_t));
+	WriteToFile(&kTraceIndexMagic, sizeof(uint32_t));
+
+	if (bWriteError)
+	{
+		CloseOnWriteError();
+		return;
+	}
+
+	fclose(FilePtr);
+	FilePtr = nullptr;
+
+	LOGINFO("Closed trace file '%s' : %d frames in %d chunks", FileName.c_str(), NoFramesRecorded, (int)ChunkIndex.size());
+}
+
+void FFrameTraceRecorder::AddMemoryAccess(bool bWrite, uint16_t address, uint8_t value, uint16_t pc)
+{
+	if (FilePtr == nullptr)
+		return;
+
+	FMemoryAccess access;
+	access.Address = address;
+	access.Value = value;
+	access.PC = pc;
+	if (bWrite)
+		FrameWrites.push_back(access);
+	else
+		FrameReads.push_back(access);
+}
+
+void FFrameTraceRecorder::AddFrame(const FSpeccyFrameTrace& frame)
+{
+	if (FilePtr == nullptr)
+		return;
+
+	if (ChunkNoFrames == 0)
+		ChunkFirstFrame = NoFramesRecorded;
+
+	ChunkBuffer.Write<int32_t>(NoFramesRecorded);
+
+	ChunkBuffer.Write<uint32_t>((uint32_t)frame.InstructionTrace.size());
+	if (frame.InstructionTrace.empty() == false)
+		ChunkBuffer.WriteBytes(frame.InstructionTrace.data(), frame.InstructionTrace.size() * sizeof(uint16_t));
+
+	WriteAccessList(ChunkBuffer, frame.ScreenPixWrites);
+	WriteAccessList(ChunkBuffer, frame.ScreenAttrWrites);
+
+	ChunkBuffer.Write<uint32_t>((uint32_t)frame.MemoryDiffs.size());
+	for (const FMemoryDiff& diff : frame.MemoryDiffs)
+	{
+		ChunkBuffer.Write<uint16_t>(diff.Address);
+		ChunkBuffer.Write<uint8_t>(diff.OldVal);
+		ChunkBuffer.Write<uint8_t>(diff.NewVal);
+	}
+
+	WriteAccessList(ChunkBuffer, FrameReads);
+	WriteAccessList(ChunkBuffer, FrameWrites);
+	FrameReads.clear();
+	FrameWrites.clear();
+
+	NoFramesRecorded++;
+	if (++ChunkNoFrames == kFramesPerChunk)
+		FlushChunk();
+}
+
+void FFrameTraceRecorder::FlushChunk()
+{
+	if (ChunkNoFrames == 0)
+		return;
+
+	const uLong srcSize = (uLong)ChunkBuffer.GetSize();
+	uLongf compressedSize = compressBound(srcSize);
+	CompressBuffer.resize(compressedSize);
+	if (compress2(CompressBuffer.data(), &compressedSize, (const Bytef*)ChunkBuffer.GetData(), srcSize, Z_BEST_SPEED) != Z_OK)
+	{
+		LOGERROR("Failed to compress trace chunk, frames %d-%d lost", ChunkFirstFrame, ChunkFirstFrame + ChunkNoFrames - 1);
+	}
+	else
+	{
+		FFrameTraceChunkInfo chunk;
+		chunk.FirstFrame = ChunkFirstFrame;
+		chunk.NoFrames = ChunkNoFrames;
+		chunk.FileOffset = GetFilePos(FilePtr);
+
+		const int32_t firstFrame = ChunkFirstFrame;
+		const int32_t noFrames = ChunkNoFrames;
+		const uint32_t compressed = (uint32_t)compressedSize;
+		const uint32_t uncompressed = (uint32_t)srcSize;
+		WriteToFile(&kTraceChunkMagic, sizeof(uint32_t));
+		WriteToFile(&firstFrame, sizeof(int32_t));
+		WriteToFile(&noFrames, sizeof(int32_t));
+		WriteToFile(&compressed, sizeof(uint32_t));
+		WriteToFile(&uncompressed, sizeof(uint32_t));
+		WriteToFile(CompressBuffer.data(), compressedSize);
+		if (fflush(FilePtr) != 0)	// make chunk visible to readers
+			bWriteError = true;
+
+		ChunkIndex.push_back(chunk);
+	}
+
+	ChunkNoFrames = 0;
+	ChunkBuffer.Init(kChunkBufferInitialSize);
+
+	if (bWriteError)
+		CloseOnWriteError();
+}
+
+// Reader
+
+bool FFrameTraceReader::Open(const char* pFileName)
+{
+	Close();
+
+	FilePtr = fopen(pFileName, "rb");
+	if (FilePtr == nullptr)
+		return false;
+
+	uint32_t magic = 0;
+	if (ReadValue(FilePtr, magic) == false || ReadValue(FilePtr, Version) == false || magic != kTraceFileMagic || Version != kTraceFileVersion)
+	{
+		LOGWARNING("'%s' is not a valid trace file", pFileName);
+		Close();
+		return false;
+	}
+
+	ScanOffset = kFileHeaderSize;
+	if (ReadIndexFromFooter() == false)
+		ScanChunks();	// file is still being written or was not closed cleanly
+
+	return true;
+}
+
+void FFrameTraceReader::Close()
+{
+	if (FilePtr != nullptr)
+		fclose(FilePtr);
+	FilePtr = nullptr;
+	ChunkIndex.clear();
+	bIndexComplete = false;
+	CachedChunk = -1;
+	CachedFrameOffsets.clear();
+}
+
+void FFrameTraceReader::Refresh()
+{
+	if (FilePtr != nullptr && bIndexComplete == false)
+		ScanChunks();
+}
+
+int FFrameTraceReader::GetNoFrames() const
+{
+	if (ChunkIndex.empty())
+		return 0;
+	return ChunkIndex.back().FirstFrame + ChunkIndex.back().NoFrames;
+}
+
+bool FFrameTraceReader::ReadIndexFromFooter()
+{
+	const uint64_t fileSize = GetFileSize(FilePtr);
+	if (fileSize < kFileHeaderSize + kFooterSize)
+		return false;
+
+	uint64_t indexOffset = 0;
+	uint32_t noChunks = 0, magic = 0;
+	SeekTo(FilePtr, fileSize - kFooterSize);
+	if (ReadValue(FilePtr, indexOffset) == false || ReadValue(FilePtr, noChunks) == false || ReadValue(FilePtr, magic) == false)
+		return false;
+	if (magic != kTraceIndexMagic || indexOffset + (uint64_t)noChunks * kIndexEntrySize + kFooterSize != fileSize)
+		return false;
+
+	SeekTo(FilePtr, indexOffset);
+	ChunkIndex.resize(noChunks);
+	for (FFrameTraceChunkInfo& chunk : ChunkIndex)
+	{
+		int32_t firstFrame = 0, noFrames = 0;
+		if (ReadValue(FilePtr, firstFrame) == false || ReadValue(FilePtr, noFrames) == false || ReadValue(FilePtr, chunk.FileOffset) == false)
+		{
+			ChunkIndex.clear();
+			return false;
+		}
+		chunk.FirstFrame = firstFrame;
+		chunk.NoFrames = noFrames;
+	}
+
+	bIndexComplete = true;
+	return true;
+}
+
+void FFrameTraceReader::ScanChunks()
+{
+	const uint64_t fileSize = GetFileSize(FilePtr);
+
+	while (ScanOffset + kChunkHeaderSize <= fileSize)
+	{
+		uint32_t magic = 0, compressedSize = 0, uncompressedSize = 0;
+		int32_t firstFrame = 0, noFrames = 0;
+		SeekTo(FilePtr, ScanOffset);
+		ReadValue(FilePtr, magic);
+		ReadValue(FilePtr, firstFrame);
+		ReadValue(FilePtr, noFrames);
+		ReadValue(FilePtr, compressedSize);
+		ReadValue(FilePtr, uncompressedSize);
+
+		if (magic != kTraceChunkMagic)	// reached the index, or garbage
+			break;
+		if (ScanOffset + kChunkHeaderSize + compressedSize > fileSize)	// partially written chunk
+			break;
+
+		FFrameTraceChunkInfo chunk;
+		chunk.FirstFrame = firstFrame;
+		chunk.NoFrames = noFrames;
+		chunk.FileOffset = ScanOffset;
+		ChunkIndex.push_back(chunk);
+
+		ScanOffset += kChunkHeaderSize + compressedSize;
+	}
+}
+
+bool FFrameTraceReader::LoadChunk(int chunkNo)
+{
+	if (chunkNo == CachedChunk)
+		return true;
+
+	CachedChunk = -1;
+	CachedFrameOffsets.clear();
+
+	const FFrameTraceChunkInfo& chunk = ChunkIndex[chunkNo];
+	uint32_t magic = 0, compressedSize = 0, uncompressedSize = 0;
+	int32_t firstFrame = 0, noFrames = 0;
+	SeekTo(FilePtr, chunk.FileOffset);
+	ReadValue(FilePtr, magic);
+	ReadValue(FilePtr, firstFrame);
+	ReadValue(FilePtr, noFrames);
+	ReadValue(FilePtr, compressedSize);
+	ReadValue(FilePtr, uncompressedSize);
+	if (magic != kTraceChunkMagic || firstFrame != chunk.FirstFrame || noFrames != chunk.NoFrames)
+	{
+		LOGWARNING("Trace chunk %d has a bad header", chunkNo);
+		return false;
+	}
+
+	std::vector<uint8_t> compressed(compressedSize);
+	if (fread(compressed.data(), 1, compressedSize, FilePtr) != compressedSize)
+		return false;
+
+	CachedChunkData.resize(uncompressedSize);
+	uLongf destSize = uncompressedSize;
+	if (uncompress(CachedChunkData.data(), &destSize, compressed.data(), compressedSize) != Z_OK || destSize != uncompressedSize)
+	{
+		LOGWARNING("Trace chunk %d failed to decompress", chunkNo);
+		return false;
+	}
+
+	// locate frame records
+	FTraceChunkParser parser = { CachedChunkData.data(), CachedChunkData.size(), 0 };
+	for (int i = 0; i < noFrames; i++)
+	{
+		CachedFrameOffsets.push_back(parser.Pos);
+		if (SkipFrameRecord(parser) == false)
+		{
+			LOGWARNING("Trace chunk %d is truncated", chunkNo);
+			CachedFrameOffsets.clear();
+			return false;
+		}
+	}
+
+	CachedChunk = chunkNo;
+	return true;
+}
+
+bool FFrameTraceReader::ReadFrame(int frameNo, FSpeccyFrameTrace& outFrame)
+{
+	if (FilePtr == nullptr || ChunkIndex.empty())
+		return false;
+
+	// binary search for chunk containing the frame
+	int lo = 0, hi = (int)ChunkIndex.size() - 1;
+	int chunkNo = -1;
+	while (lo <= hi)
+	{
+		const int mid = (lo + hi) / 2;
+		const FFrameTraceChunkInfo& chunk = ChunkIndex[mid];
+		if (frameNo < chunk.FirstFrame)
+			hi = mid - 1;
+		else if (frameNo >= chunk.FirstFrame + chunk.NoFrames)
+			lo = mid + 1;
+		else
+		{
+			chunkNo = mid;
+			break;
+		}
+	}
+
+	if (chunkNo == -1 || LoadChunk(chunkNo) == false)
+		return false;
+
+	const size_t frameOffset = CachedFrameOffsets[frameNo - ChunkIndex[chunkNo].FirstFrame];
+	FTraceChunkParser parser = { CachedChunkData.data(), CachedChunkData.size(), frameOffset };
+
+	// records were validated when the chunk was loaded
+	int32_t recordFrameNo = 0;
+	uint32_t count = 0;
+	parser.Read(recordFrameNo);
+	parser.Read(count);
+	outFrame.InstructionTrace.resize(count);
+	for (uint16_t& pc : outFrame.InstructionTrace)
+		parser.Read(pc);
+
+	ReadAccessList(parser, outFrame.ScreenPixWrites);
+	ReadAccessList(parser, outFrame.ScreenAttrWrites);
+
+	parser.Read(count);
+	outFrame.MemoryDiffs.resize(count);
+	for (FMemoryDiff& diff : outFrame.MemoryDiffs)
+	{
+		parser.Read(diff.Address);
+		parser.Read(diff.OldVal);
+		parser.Read(diff.NewVal);
+	}
+
+	ReadAccessList(parser, outFrame.MemoryReads);
+	ReadAccessList(parser, outFrame.MemoryWrites);
+
+	outFrame.FrameOverview.clear();
+	return true;
+}
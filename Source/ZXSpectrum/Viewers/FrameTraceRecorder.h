@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "CodeAnalyser/CodeAnalyser.h"
+#include "Util/MemoryBuffer.h"
+
+struct FSpeccyFrameTrace;
+
+// On disk frame trace
+// The file is a sequence of zlib compressed chunks, each holding a run of frames.
+// Every chunk has its own header so a file from a crashed session can still be indexed by scanning.
+// A chunk index is appended when the recorder is closed.
+// Each frame holds its instruction trace, screen writes, memory diff and (from version 2) every memory read & write.
+
+struct FFrameTraceChunkInfo
+{
+	int			FirstFrame = 0;
+	int			NoFrames = 0;
+	uint64_t	FileOffset = 0;	// offset of chunk header
+};
+
+class FFrameTraceRecorder
+{
+public:
+	~FFrameTraceRecorder() { Close(); }
+
+	bool	Open(const char* pFileName);
+	void	Close();
+	bool	IsRecording() const { return FilePtr != nullptr; }
+
+	void	AddMemoryAccess(bool bWrite, uint16_t address, uint8_t value, uint16_t pc);	// recorded with the next AddFrame
+	void	AddFrame(const FSpeccyFrameTrace& frame);
+
+	int		GetNoFramesRecorded() const { return NoFramesRecorded; }
+	const std::string&	GetFileName() const { return FileName; }
+
+	static const int	kFramesPerChunk = 50;
+private:
+	void	FlushChunk();
+	void	WriteToFile(const void* pData, size_t size);
+	void	CloseOnWriteError();
+
+	FILE*		FilePtr = nullptr;
+	bool		bWriteError = false;
+	std::string	FileName;
+	FMemoryBuffer	ChunkBuffer;
+	int			ChunkFirstFrame = 0;
+	int			ChunkNoFrames = 0;
+	int			NoFramesRecorded = 0;
+	std::vector<FFrameTraceChunkInfo>	ChunkIndex;
+	std::vector<uint8_t>	CompressBuffer;
+	std::vector<FMemoryAccess>	FrameReads;		// memory accesses since the last frame
+	std::vector<FMemoryAccess>	FrameWrites;
+};
+
+class FFrameTraceReader
+{
+public:
+	~FFrameTraceReader() { Close(); }
+
+	bool	Open(const char* pFileName);
+	void	Close();
+	bool	IsOpen() const { return FilePtr != nullptr; }
+	void	Refresh();	// pick up chunks written since open (for files still being recorded)
+
+	int		GetNoFrames() const;
+	bool	ReadFrame(int frameNo, FSpeccyFrameTrace& outFrame);
+
+private:
+	bool	ReadIndexFromFooter();
+	void	ScanChunks();
+	bool	LoadChunk(int chunkNo);
+
+	FILE*		FilePtr = nullptr;
+	uint32_t	Version = 0;
+	uint64_t	ScanOffset = 0;
+	bool		bIndexComplete = false;
+	std::vector<FFrameTraceChunkInfo>	ChunkIndex;
+
+	// decompressed chunk cache
+	int			CachedChunk = -1;
+	std::vector<uint8_t>	CachedChunkData;
+	std::vector<size_t>	CachedFrameOffsets;
+};
@@ -7,8 +7,45 @@
 #include <ImGuiSupport/ImGuiTexture.h>
 
 #include <Util/Misc.h>
+#include <Util/FileUtil.h>
+#include <Debug/DebugLog.h>
+#include "../GlobalConfig.h"
+#include "../GameConfig.h"
 
 
+// Frame images are stored as indices into the 16 colour Spectrum palette
+
+static uint8_t GetPaletteIndexForColour(uint32_t col)
+{
+	const uint8_t r = col & 0xff;
+	const uint8_t g = (col >> 8) & 0xff;
+	const uint8_t b = (col >> 16) & 0xff;
+	const uint8_t index = (b ? 1 : 0) | (r ? 2 : 0) | (g ? 4 : 0);
+	const bool bBright = r == 0xff || g == 0xff || b == 0xff;
+	return bBright ? index | 8 : index;
+}
+
+static void PackFrameImage(const uint32_t* pSrc, uint8_t* pDest)
+{
+	const int noPixels = kFrameTraceImageWidth * kFrameTraceImageHeight;
+	for (int i = 0; i < noPixels; i += 2)
+		*pDest++ = GetPaletteIndexForColour(pSrc[i]) | (GetPaletteIndexForColour(pSrc[i + 1]) << 4);
+}
+
+static void UnpackFrameImage(const uint8_t* pSrc, uint32_t* pDest)
+{
+	uint32_t palette[16];
+	for (int i = 0; i < 16; i++)
+		palette[i] = GetColFromAttr(i & 7, (i & 8) != 0);
+
+	const int noBytes = kFrameTraceImageWidth * kFrameTraceImageHeight / 2;
+	for (int i = 0; i < noBytes; i++)
+	{
+		*pDest++ = palette[pSrc[i] & 15];
+		*pDest++ = palette[pSrc[i] >> 4];
+	}
+}
+
 void FFrameTraceViewer::Init(FSpectrumEmu* pEmu)
 {
 	pSpectrumEmu = pEmu;
@@ -16,24 +53,32 @@ void FFrameTraceViewer::Init(FSpectrumEmu* pEmu)
 	// Init Frame Trace
 	for (int i = 0; i < kNoFramesInTrace; i++)
 	{
-		FrameTrace[i].Texture = ImGui_CreateTextureRGBA(static_cast<unsigned char*>(pEmu->FrameBuffer), 320, 256);
+		memset(FrameTrace[i].FrameImage, 0, sizeof(FrameTrace[i].FrameImage));
 		FrameTrace[i].CPUState = malloc(sizeof(z80_t));
 	}
 
+	FrameImageRGBA = new uint32_t[kFrameTraceImageWidth * kFrameTraceImageHeight];
 	ShowWritesView = new FZXGraphicsView(320, 256);
 }
 
 void	FFrameTraceViewer::Shutdown()
 {
 	for (int i = 0; i < kNoFramesInTrace; i++)
-	{
-		ImGui_FreeTexture(FrameTrace[i].Texture);
-		FrameTrace[i].Texture = nullptr;
 		free(FrameTrace[i].CPUState);
-	}
+
+	if (FrameTexture != nullptr)
+		ImGui_FreeTexture(FrameTexture);
+	FrameTexture = nullptr;
+	UploadedFrame = -1;
+
+	delete[] FrameImageRGBA;
+	FrameImageRGBA = nullptr;
 
 	delete ShowWritesView;
 	ShowWritesView = nullptr;
+
+	Recorder.Close();
+	DiskReader.Close();
 }
 
 
@@ -41,10 +86,11 @@ void FFrameTraceViewer::CaptureFrame()
 {
 	// set up new trace frame
 	FSpeccyFrameTrace& frame = FrameTrace[CurrentTraceFrame];
-	ImGui_UpdateTextureRGBA(frame.Texture, pSpectrumEmu->FrameBuffer);
+	PackFrameImage((const uint32_t*)pSpectrumEmu->FrameBuffer, frame.FrameImage);
+	if (UploadedFrame == CurrentTraceFrame)	// texture is now stale
+		UploadedFrame = -1;
 	frame.InstructionTrace = pSpectrumEmu->CodeAnalysis.FrameTrace;
-	frame.ScreenPixWrites = pSpectrumEmu->FrameScreenPixWrites;
-	frame.ScreenAttrWrites = pSpectrumEmu->FrameScreenAttrWrites;
+	pSpectrumEmu->ScreenWrites.GetLastFrameWrites(frame.ScreenPixWrites, frame.ScreenAttrWrites);
 	frame.FrameOverview.clear();
 
 	// copy memory
@@ -65,6 +111,9 @@ void FFrameTraceViewer::CaptureFrame()
 
 	GenerateMemoryDiff(frame, prevFrame, frame.MemoryDiffs);
 
+	if (Recorder.IsRecording())
+		Recorder.AddFrame(frame);
+
 	if (++CurrentTraceFrame == kNoFramesInTrace)
 		CurrentTraceFrame = 0;
 }
@@ -85,8 +134,139 @@ void FFrameTraceViewer::RestoreFrame(const FSpeccyFrameTrace& frame)
 		pSpectrumEmu->WriteByte(i, frame.MemoryDump[i]);
 }
 
+std::string FFrameTraceViewer::GetTraceFileName() const
+{
+	const std::string root = GetGlobalConfig().WorkspaceRoot;
+	const FGame* pGame = pSpectrumEmu->pActiveGame;
+	const std::string gameName = (pGame != nullptr && pGame->pConfig != nullptr) ? pGame->pConfig->Name : "Default";
+	return root + "Traces/" + gameName + ".trace";
+}
+
+void FFrameTraceViewer::StartRecording()
+{
+	// the reader can't view a file that's being replaced
+	if (bViewDiskTrace)
+	{
+		DiskReader.Close();
+		bViewDiskTrace = false;
+		LoadedDiskFrame = -1;
+	}
+
+	EnsureDirectoryExists(std::string(GetGlobalConfig().WorkspaceRoot + "Traces").c_str());
+	Recorder.Open(GetTraceFileName().c_str());
+}
+
+void FFrameTraceViewer::DrawDiskTraceControls()
+{
+	bool bRecording = Recorder.IsRecording();
+	if (ImGui::Checkbox("Record To Disk", &bRecording))
+	{
+		if (bRecording)
+		{
+			if (FileExists(GetTraceFileName().c_str()))
+				ImGui::OpenPopup("Overwrite Trace?");
+			else
+				StartRecording();
+		}
+		else
+		{
+			Recorder.Close();
+		}
+	}
+	if (ImGui::BeginPopupModal("Overwrite Trace?", nullptr, ImGuiWindowFlags_AlwaysAutoResize))
+	{
+		ImGui::Text("'%s' already exists.", GetTraceFileName().c_str());
+		if (ImGui::Button("Overwrite"))
+		{
+			StartRecording();
+			ImGui::CloseCurrentPopup();
+		}
+		ImGui::SameLine();
+		if (ImGui::Button("Cancel"))
+			ImGui::CloseCurrentPopup();
+		ImGui::EndPopup();
+	}
+	if (Recorder.IsRecording())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%d frames recorded", Recorder.GetNoFramesRecorded());
+	}
+
+	FExecutionTraceWriter& execTrace = pSpectrumEmu->ExecutionTrace;
+	bool bRecordExecution = execTrace.IsOpen();
+	if (ImGui::Checkbox("Record Execution Trace", &bRecordExecution))
+	{
+		if (bRecordExecution)
+		{
+			EnsureDirectoryExists(std::string(GetGlobalConfig().WorkspaceRoot + "Traces").c_str());
+			const std::string fileName = RemoveFileExtension(GetTraceFileName().c_str()) + ".xtrace";
+			if (execTrace.Open(fileName.c_str()) == false)
+				LOGWARNING("Could not open execution trace '%s'", fileName.c_str());
+		}
+		else
+		{
+			execTrace.Close();
+		}
+	}
+	if (execTrace.IsOpen())
+	{
+		ImGui::SameLine();
+		ImGui::Text("%d frames, %llu events", execTrace.GetFrameNo(), (unsigned long long)execTrace.GetNoEventsWritten());
+	}
+
+	ImGui::SameLine();
+	if (ImGui::Checkbox("View Disk Trace", &bViewDiskTrace))
+	{
+		LoadedDiskFrame = -1;
+		if (bViewDiskTrace)
+			bViewDiskTrace = DiskReader.Open(GetTraceFileName().c_str());
+		else
+			DiskReader.Close();
+	}
+
+	if (bViewDiskTrace == false)
+		return;
+
+	DiskReader.Refresh();
+	const int noFrames = DiskReader.GetNoFrames();
+	if (noFrames == 0)
+	{
+		ImGui::Text("No frames in trace file");
+		return;
+	}
+
+	DiskFrameNo = std::min(DiskFrameNo, noFrames - 1);
+	if (ImGui::ArrowButton("##diskleft", ImGuiDir_Left))
+		DiskFrameNo = std::max(DiskFrameNo - 1, 0);
+	ImGui::SameLine();
+	if (ImGui::ArrowButton("##diskright", ImGuiDir_Right))
+		DiskFrameNo = std::min(DiskFrameNo + 1, noFrames - 1);
+	ImGui::SameLine();
+	ImGui::SliderInt("Disk Frame", &DiskFrameNo, 0, noFrames - 1);
+
+	// page frame in from disk
+	if (DiskFrameNo != LoadedDiskFrame)
+	{
+		PixelWriteline = -1;
+		SelectedTraceLine = -1;
+		if (DiskReader.ReadFrame(DiskFrameNo, DiskFrame))
+			LoadedDiskFrame = DiskFrameNo;
+		DrawFrameScreenWritePixels(DiskFrame);
+	}
+}
+
 void FFrameTraceViewer::Draw()
 {
+	DrawDiskTraceControls();
+
+	if (bViewDiskTrace && LoadedDiskFrame != -1)
+	{
+		// disk frames don't hold a memory snapshot so can't be restored
+		ShowWritesView->Draw();
+		DrawFrameTabs(DiskFrame);
+		return;
+	}
+
 	if (ImGui::ArrowButton("##left", ImGuiDir_Left))
 		ShowFrame = std::max(--ShowFrame, 0);
 
@@ -137,10 +317,31 @@ void FFrameTraceViewer::Draw()
 	ImGui::SameLine();
 	ImGui::Checkbox("Restore On Scrub", &RestoreOnScrub);
 	
-	ImGui::Image(frame.Texture, ImVec2(320, 256));
+	DrawFrameImage(frameNo);
 	ImGui::SameLine();
 	ShowWritesView->Draw();
 
+	DrawFrameTabs(FrameTrace[frameNo]);
+}
+
+// Only the frame being viewed is expanded and uploaded
+void FFrameTraceViewer::DrawFrameImage(int frameIndex)
+{
+	if (UploadedFrame != frameIndex)
+	{
+		UnpackFrameImage(FrameTrace[frameIndex].FrameImage, FrameImageRGBA);
+		if (FrameTexture == nullptr)
+			FrameTexture = ImGui_CreateTextureRGBA((unsigned char*)FrameImageRGBA, kFrameTraceImageWidth, kFrameTraceImageHeight);
+		else
+			ImGui_UpdateTextureRGBA(FrameTexture, (unsigned char*)FrameImageRGBA);
+		UploadedFrame = frameIndex;
+	}
+
+	ImGui::Image(FrameTexture, ImVec2((float)kFrameTraceImageWidth, (float)kFrameTraceImageHeight));
+}
+
+void FFrameTraceViewer::DrawFrameTabs(FSpeccyFrameTrace& frame)
+{
 	// draw clipped list
 	if (ImGui::BeginTabBar("FrameTraceTabs"))
 	{
@@ -153,7 +354,7 @@ void FFrameTraceViewer::Draw()
 		if (ImGui::BeginTabItem("Trace Overview"))
 		{
 			if (frame.FrameOverview.size() == 0)
-				GenerateTraceOverview(FrameTrace[frameNo]);
+				GenerateTraceOverview(frame);
 			DrawTraceOverview(frame);
 			ImGui::EndTabItem();
 		}
@@ -170,6 +371,12 @@ void FFrameTraceViewer::Draw()
 			ImGui::EndTabItem();
 		}
 
+		if (&frame == &DiskFrame && ImGui::BeginTabItem("Memory Accesses"))
+		{
+			DrawMemoryAccesses(frame);
+			ImGui::EndTabItem();
+		}
+
 		ImGui::EndTabBar();
 	}
 	
@@ -384,3 +591,46 @@ void FFrameTraceViewer::DrawMemoryDiffs(const FSpeccyFrameTrace& frame)
 		ImGui::Text("%d(%s) -> %d(%s)", diff.OldVal, NumStr(diff.OldVal), diff.NewVal, NumStr(diff.NewVal));
 	}
 }
+
+static void DrawMemoryAccessList(FCodeAnalysisState& state, FCodeAnalysisViewState& viewState, const std::vector<FMemoryAccess>& accesses)
+{
+	ImGuiListClipper clipper((int)accesses.size(), ImGui::GetTextLineHeight());
+	while (clipper.Step())
+	{
+		for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; i++)
+		{
+			const FMemoryAccess& access = accesses[i];
+			ImGui::PushID(i);
+			ImGui::Text("%s : %s", NumStr(access.Address), NumStr(access.Value));
+			ImGui::SameLine();
+			DrawAddressLabel(state, viewState, access.Address);
+			ImGui::SameLine();
+			ImGui::Text(" PC:");
+			ImGui::SameLine();
+			DrawCodeAddress(state, viewState, access.PC);
+			ImGui::PopID();
+		}
+	}
+}
+
+void FFrameTraceViewer::DrawMemoryAccesses(const FSpeccyFrameTrace& frame)
+{
+	FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+	FCodeAnalysisViewState& viewState = state.GetFocussedViewState();
+
+	ImGui::Text("%d reads, %d writes", (int)frame.MemoryReads.size(), (int)frame.MemoryWrites.size());
+	if (ImGui::BeginTabBar("MemoryAccessTabs"))
+	{
+		if (ImGui::BeginTabItem("Reads"))
+		{
+			DrawMemoryAccessList(state, viewState, frame.MemoryReads);
+			ImGui::EndTabItem();
+		}
+		if (ImGui::BeginTabItem("Writes"))
+		{
+			DrawMemoryAccessList(state, viewState, frame.MemoryWrites);
+			ImGui::EndTabItem();
+		}
+		ImGui::EndTabBar();
+	}
+}
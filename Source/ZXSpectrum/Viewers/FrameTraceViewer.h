@@ -2,6 +2,7 @@
 
 
 #include "CodeAnalyser/CodeAnalyser.h"
+#include "FrameTraceRecorder.h"
 
 #include <cstdint>
 #include <vector>
@@ -24,9 +25,12 @@ struct FMemoryDiff
 	uint8_t		NewVal;
 };
 
+static const int kFrameTraceImageWidth = 320;
+static const int kFrameTraceImageHeight = 256;
+
 struct FSpeccyFrameTrace
 {
-	void*					Texture;
+	uint8_t					FrameImage[kFrameTraceImageWidth * kFrameTraceImageHeight / 2];	// 4bpp palette indices, 2 pixels per byte
 	uint8_t					MemoryDump[1 << 16];	// 64K
 	void*					CPUState = nullptr;
 	std::vector<uint16_t>	InstructionTrace;
@@ -35,6 +39,10 @@ struct FSpeccyFrameTrace
 
 	std::vector<FFrameOverviewItem>	FrameOverview;
 	std::vector<FMemoryDiff>	MemoryDiffs;
+
+	// every memory access in the frame - only held for frames read back from a disk trace
+	std::vector<FMemoryAccess>	MemoryReads;
+	std::vector<FMemoryAccess>	MemoryWrites;
 };
 
 class FFrameTraceViewer
@@ -44,6 +52,9 @@ public:
 	void	Shutdown();
 	void	CaptureFrame();
 	void	Draw();
+
+	bool	IsRecordingToDisk() const { return Recorder.IsRecording(); }
+	void	RecordMemoryAccess(bool bWrite, uint16_t address, uint8_t value, uint16_t pc) { Recorder.AddMemoryAccess(bWrite, address, value, pc); }
 private:
 	void	RestoreFrame(const FSpeccyFrameTrace& frame);
 	void	DrawInstructionTrace(const FSpeccyFrameTrace& frame);
@@ -53,6 +64,12 @@ private:
 	void	DrawFrameScreenWritePixels(const FSpeccyFrameTrace& frame, int lastIndex = -1);
 	void	DrawScreenWrites(const FSpeccyFrameTrace& frame);
 	void	DrawMemoryDiffs(const FSpeccyFrameTrace& frame);
+	void	DrawMemoryAccesses(const FSpeccyFrameTrace& frame);
+	void	DrawFrameImage(int frameIndex);
+	void	DrawFrameTabs(FSpeccyFrameTrace& frame);
+	void	DrawDiskTraceControls();
+	void	StartRecording();
+	std::string	GetTraceFileName() const;
 
 	FSpectrumEmu* pSpectrumEmu = nullptr;
 
@@ -62,8 +79,21 @@ private:
 	static const int	kNoFramesInTrace = 300;
 	FSpeccyFrameTrace	FrameTrace[kNoFramesInTrace];
 
+	// single texture for the frame being viewed, created on first use
+	void*				FrameTexture = nullptr;
+	int					UploadedFrame = -1;
+	uint32_t*			FrameImageRGBA = nullptr;
+
 	int		SelectedTraceLine = -1;
 	int		PixelWriteline = -1;
 	FZXGraphicsView*	ShowWritesView = nullptr;
 
+	// on disk trace
+	FFrameTraceRecorder	Recorder;
+	FFrameTraceReader	DiskReader;
+	bool				bViewDiskTrace = false;
+	int					DiskFrameNo = 0;
+	int					LoadedDiskFrame = -1;
+	FSpeccyFrameTrace	DiskFrame;
+
 };
\ No newline at end of file
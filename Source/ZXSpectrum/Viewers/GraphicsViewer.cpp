@@ -9,6 +9,7 @@
 
 #include "misc/cpp/imgui_stdlib.h"
 #include <Util/Misc.h>
+#include <Util/PixelBlit.h>
 
 
 // Graphics Viewer
@@ -17,7 +18,7 @@ static int kGraphicsViewerHeight = 512;
 
 bool InitGraphicsViewer(FGraphicsViewerState &state)
 {
-	state.pGraphicsView = new FZXGraphicsView(kGraphicsViewerWidth, kGraphicsViewerHeight);
+	state.pGraphicsView = new FZXGraphicsView(kGraphicsViewerWidth, kGraphicsViewerHeight, true);	// redrawn every frame
 
 	return true;
 }
@@ -53,34 +54,17 @@ uint16_t GetAddressFromPositionInView(FGraphicsViewerState &state, int x,int y)
 
 uint8_t GetHeatmapColourForMemoryAddress(FCodeAnalysisState &state, uint16_t addr, int frameThreshold)
 {
-	const FCodeInfo *pCodeInfo = state.GetCodeInfoForAddress(addr);
-	uint8_t col = 7;	// white
+	// frames are -1 if never accessed
+	const int lastFrame = std::max(state.CurrentFrameNo - frameThreshold, -1);
 
-	if (pCodeInfo)
-	{
-		const int framesSinceExecuted = state.CurrentFrameNo - pCodeInfo->FrameLastExecuted;
-		if (pCodeInfo->FrameLastExecuted != -1 && (framesSinceExecuted < frameThreshold))
-			return 6;	// yellow code
-	}
-	
-	const FDataInfo* pReadDataInfo = state.GetReadDataInfoForAddress(addr);
-	if (pReadDataInfo && pReadDataInfo->LastFrameRead != -1)
-	{
-		const int framesSinceRead = state.CurrentFrameNo - pReadDataInfo->LastFrameRead;
-		
-		if (pReadDataInfo->LastFrameRead != -1 && (framesSinceRead < frameThreshold))
-			return 4;	// green
-	}
+	if (state.GetLastFrameExecuted(addr) > lastFrame)
+		return 6;	// yellow code
+	if (state.GetLastFrameRead(addr) > lastFrame)
+		return 4;	// green
+	if (state.GetLastFrameWritten(addr) > lastFrame)
+		return 2; // red
 
-	const FDataInfo* pWriteDataInfo = state.GetWriteDataInfoForAddress(addr);
-	if (pWriteDataInfo && pWriteDataInfo->LastFrameWritten != -1)
-	{
-		const int framesSinceWritten = state.CurrentFrameNo - pWriteDataInfo->LastFrameWritten;
-		if (pWriteDataInfo->LastFrameWritten != -1 && (framesSinceWritten < frameThreshold))
-			return 2; // red
-	}
-
-	return col;
+	return 7;	// white
 }
 
 void DrawMemoryAsGraphicsColumn(FGraphicsViewerState &state,uint16_t startAddr, int xPos, int columnWidth)
@@ -317,13 +301,8 @@ void DrawGraphicsViewer(FGraphicsViewerState &state)
 			{
 				const uint8_t charLine = *pSrc++;
 				const uint8_t col = GetHeatmapColourForMemoryAddress(state.pEmu->CodeAnalysis, addr, state.HeatmapThreshold);
-				
-				for (int xpix = 0; xpix < 8; xpix++)
-				{
-					const bool bSet = (charLine & (1 << (7 - xpix))) != 0;
-					const uint32_t colRGBA = bSet ? g_kColourLUT[col] : 0xff000000;
-					*(pLineAddr + xpix + (x * 8)) = colRGBA;
-				}
+
+				BlitBitRow(pLineAddr + (x * 8), charLine, g_kColourLUT[col], 0xff000000);
 
 				addr++;
 			}
@@ -0,0 +1,141 @@
+#include "MemoryHeatmapViewer.h"
+#include "../SpectrumEmu.h"
+
+#include <Util/GraphicsView.h>
+#include <imgui.h>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HEATMAP_SSE2
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__) || defined(_M_ARM64)
+#define HEATMAP_NEON
+#include <arm_neon.h>
+#endif
+
+// heatmap colours - later entries take priority
+static const uint32_t kNeverAccessedCol = 0xFF000000;
+static const uint32_t kOldWriteCol = 0xFF000040;
+static const uint32_t kOldReadCol = 0xFF004000;
+static const uint32_t kOldExecCol = 0xFF004040;
+static const uint32_t kRecentWriteCol = 0xFF0000FF;
+static const uint32_t kRecentReadCol = 0xFF00FF00;
+static const uint32_t kRecentExecCol = 0xFF00FFFF;
+
+// Colour a page of pixels from its access frame arrays
+// Anything accessed after recentFrame is bright, anything accessed at all (frame > -1) is dim
+static void GenerateHeatmapPage(uint32_t* pOut, const int32_t* pExecuted, const int32_t* pRead, const int32_t* pWritten, int recentFrame)
+{
+	const int noBytes = FCodeAnalysisPage::kPageSize;
+#if defined(HEATMAP_SSE2)
+	const __m128i recent = _mm_set1_epi32(recentFrame);
+	const __m128i never = _mm_set1_epi32(-1);
+	const auto select = [](__m128i mask, __m128i a, __m128i b) { return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b)); };
+
+	for (int i = 0; i < noBytes; i += 4)
+	{
+		const __m128i executed = _mm_loadu_si128((const __m128i*)(pExecuted + i));
+		const __m128i read = _mm_loadu_si128((const __m128i*)(pRead + i));
+		const __m128i written = _mm_loadu_si128((const __m128i*)(pWritten + i));
+
+		__m128i col = _mm_set1_epi32((int)kNeverAccessedCol);
+		col = select(_mm_cmpgt_epi32(written, never), _mm_set1_epi32((int)kOldWriteCol), col);
+		col = select(_mm_cmpgt_epi32(read, never), _mm_set1_epi32((int)kOldReadCol), col);
+		col = select(_mm_cmpgt_epi32(executed, never), _mm_set1_epi32((int)kOldExecCol), col);
+		col = select(_mm_cmpgt_epi32(written, recent), _mm_set1_epi32((int)kRecentWriteCol), col);
+		col = select(_mm_cmpgt_epi32(read, recent), _mm_set1_epi32((int)kRecentReadCol), col);
+		col = select(_mm_cmpgt_epi32(executed, recent), _mm_set1_epi32((int)kRecentExecCol), col);
+		_mm_storeu_si128((__m128i*)(pOut + i), col);
+	}
+#elif defined(HEATMAP_NEON)
+	const int32x4_t recent = vdupq_n_s32(recentFrame);
+	const int32x4_t never = vdupq_n_s32(-1);
+
+	for (int i = 0; i < noBytes; i += 4)
+	{
+		const int32x4_t executed = vld1q_s32(pExecuted + i);
+		const int32x4_t read = vld1q_s32(pRead + i);
+		const int32x4_t written = vld1q_s32(pWritten + i);
+
+		uint32x4_t col = vdupq_n_u32(kNeverAccessedCol);
+		col = vbslq_u32(vcgtq_s32(written, never), vdupq_n_u32(kOldWriteCol), col);
+		col = vbslq_u32(vcgtq_s32(read, never), vdupq_n_u32(kOldReadCol), col);
+		col = vbslq_u32(vcgtq_s32(executed, never), vdupq_n_u32(kOldExecCol), col);
+		col = vbslq_u32(vcgtq_s32(written, recent), vdupq_n_u32(kRecentWriteCol), col);
+		col = vbslq_u32(vcgtq_s32(read, recent), vdupq_n_u32(kRecentReadCol), col);
+		col = vbslq_u32(vcgtq_s32(executed, recent), vdupq_n_u32(kRecentExecCol), col);
+		vst1q_u32(pOut + i, col);
+	}
+#else
+	for (int i = 0; i < noBytes; i++)
+	{
+		uint32_t col = kNeverAccessedCol;
+		if (pExecuted[i] > recentFrame)
+			col = kRecentExecCol;
+		else if (pRead[i] > recentFrame)
+			col = kRecentReadCol;
+		else if (pWritten[i] > recentFrame)
+			col = kRecentWriteCol;
+		else if (pExecuted[i] > -1)
+			col = kOldExecCol;
+		else if (pRead[i] > -1)
+			col = kOldReadCol;
+		else if (pWritten[i] > -1)
+			col = kOldWriteCol;
+		pOut[i] = col;
+	}
+#endif
+}
+
+bool FMemoryHeatmapViewer::Init(void)
+{
+	pHeatmapView = new FGraphicsView(256, 256);
+	return true;
+}
+
+void FMemoryHeatmapViewer::UpdateHeatmap()
+{
+	const FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+	if (state.CurrentFrameNo == HeatmapFrameNo && FrameThreshold == HeatmapThreshold)
+		return;
+
+	HeatmapFrameNo = state.CurrentFrameNo;
+	HeatmapThreshold = FrameThreshold;
+
+	const int recentFrame = std::max(state.CurrentFrameNo - FrameThreshold, -1);
+	uint32_t* pPixels = pHeatmapView->GetPixelBuffer();
+
+	for (int pageNo = 0; pageNo < 64; pageNo++)
+	{
+		const uint16_t pageAddr = pageNo * FCodeAnalysisPage::kPageSize;
+		const FCodeAnalysisPage* pReadPage = state.GetReadPage(pageAddr);
+		const FCodeAnalysisPage* pWritePage = state.GetWritePage(pageAddr);
+
+		GenerateHeatmapPage(pPixels + pageAddr, pReadPage->FrameLastExecuted, pReadPage->FrameLastRead, pWritePage->FrameLastWritten, recentFrame);
+	}
+}
+
+void FMemoryHeatmapViewer::DrawUI(void)
+{
+	ImGui::SliderInt("Frame Threshold", &FrameThreshold, 0, 60);
+	ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f), "Execute");
+	ImGui::SameLine();
+	ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f), "Read");
+	ImGui::SameLine();
+	ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Write");
+	ImGui::SameLine();
+	ImGui::Text("(dim - accessed before threshold)");
+
+	UpdateHeatmap();
+
+	// one row of pixels per 256 bytes, drawn at double size
+	const ImVec2 pos = ImGui::GetCursorScreenPos();
+	pHeatmapView->Draw(512.0f, 512.0f, false, false);
+	if (ImGui::IsItemHovered())
+	{
+		const ImVec2 mousePos = ImGui::GetMousePos();
+		const int xp = std::min(std::max((int)((mousePos.x - pos.x) / 2.0f), 0), 255);
+		const int yp = std::min(std::max((int)((mousePos.y - pos.y) / 2.0f), 0), 255);
+		ImGui::SetTooltip("$%04X", (yp * 256) + xp);
+	}
+}
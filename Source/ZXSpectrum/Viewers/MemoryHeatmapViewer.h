@@ -0,0 +1,22 @@
+#pragma once
+
+#include "ViewerBase.h"
+
+class FGraphicsView;
+
+// The whole 64K as a 256x256 image, one pixel per byte, coloured by how recently it was executed, read or written
+class FMemoryHeatmapViewer : public FViewerBase
+{
+public:
+			FMemoryHeatmapViewer(FSpectrumEmu* pEmu) : FViewerBase(pEmu) { Name = "Memory Heatmap"; }
+
+	bool	Init(void) override;
+	void	DrawUI(void) override;
+private:
+	void	UpdateHeatmap();
+
+	FGraphicsView*	pHeatmapView = nullptr;
+	int				FrameThreshold = 4;	// accesses within this many frames are 'recent'
+	int				HeatmapFrameNo = -1;	// frame & threshold the image was made with
+	int				HeatmapThreshold = -1;
+};
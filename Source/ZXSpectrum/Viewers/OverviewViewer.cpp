@@ -29,55 +29,75 @@ void FOverviewViewer::DrawStats()
     //ImPlot::ShowDemoWindow();
 }
 
-void FOverviewViewer::CalculateStats()
+void FOverviewViewer::CalculatePageStats(int pageNo)
 {
-    int UnCommentedCodeCount = 0;
-    int CommentedCodeCount = 0;
-    int ReadOnlyDataCount = 0;
-    int WriteOnlyDataCount = 0;
-    int ReadWriteDataCount = 0;
-    int UnknownCount = 0;
+    FCodeAnalysisState& state = pSpectrumEmu->CodeAnalysis;
+    const uint16_t pageAddr = pageNo * FCodeAnalysisPage::kPageSize;
+    const FCodeAnalysisPage* pReadPage = state.GetReadPage(pageAddr);
+    const FCodeAnalysisPage* pWritePage = state.GetWritePage(pageAddr);
+    const bool bInRom = pageAddr < 0x4000;
+    int* pCounts = PageCounts[pageNo];
+
+    for (int i = 0; i < NoStatTypes; i++)
+        pCounts[i] = 0;
 
-    for (int i = 0; i < (1 << 16); i++)
+    for (int i = 0; i < FCodeAnalysisPage::kPageSize; i++)
     {
-        const bool bInRom = i < 0x4000;
-        const FCodeInfo* pCodeInfo = pSpectrumEmu->CodeAnalysis.GetCodeInfoForAddress(i);
+        const FCodeInfo* pCodeInfo = pReadPage->CodeInfo[i];
         if (pCodeInfo != nullptr)
         {
             if (pCodeInfo->Comment.empty())
-                UnCommentedCodeCount++;
+                pCounts[UncommentedCode]++;
             else
-                CommentedCodeCount++;
+                pCounts[CommentedCode]++;
         }
         else
         {
-            const FDataInfo *pDataInfo = pSpectrumEmu->CodeAnalysis.GetReadDataInfoForAddress(i);
-            const bool bRead = pDataInfo->LastFrameRead != -1;
-            const bool bWrite = pDataInfo->LastFrameWritten != -1;
+            const bool bRead = pReadPage->FrameLastRead[i] != -1;
+            const bool bWrite = pWritePage->FrameLastWritten[i] != -1;
 
             if (bInRom)
             {
-                ReadOnlyDataCount++;
+                pCounts[ReadOnlyData]++;
             }
             else
             {
                 if (bRead && !bWrite)
-                    ReadOnlyDataCount++;
+                    pCounts[ReadOnlyData]++;
                 else if (!bRead && bWrite)
-                    WriteOnlyDataCount++;
+                    pCounts[WriteOnlyData]++;
                 else if (bRead && bWrite)
-                    ReadWriteDataCount++;
+                    pCounts[ReadWriteData]++;
                 else
-                    UnknownCount++;
+                    pCounts[Unknown]++;
             }
         }
     }
+}
+
+// Stats change slowly so only a few pages are looked at each frame
+void FOverviewViewer::CalculateStats()
+{
+    const int noPages = bPageCountsValid ? kPagesPerUpdate : kNoPages;
+    for (int i = 0; i < noPages; i++)
+    {
+        CalculatePageStats(NextPageToUpdate);
+        NextPageToUpdate = (NextPageToUpdate + 1) % kNoPages;
+    }
+    bPageCountsValid = true;
+
+    int counts[NoStatTypes] = {};
+    for (int pageNo = 0; pageNo < kNoPages; pageNo++)
+    {
+        for (int i = 0; i < NoStatTypes; i++)
+            counts[i] += PageCounts[pageNo][i];
+    }
 
     // Calculate percentages
-    Stats.PercentCommentedCode = CommentedCodeCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentUncommentedCode = UnCommentedCodeCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentReadOnlyData = ReadOnlyDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentWriteOnlyData = WriteOnlyDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentReadWriteData = ReadWriteDataCount * (1.0f / 65536.0f) * 100.0f;
-    Stats.PercentUnknown = UnknownCount * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentCommentedCode = counts[CommentedCode] * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentUncommentedCode = counts[UncommentedCode] * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentReadOnlyData = counts[ReadOnlyData] * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentWriteOnlyData = counts[WriteOnlyData] * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentReadWriteData = counts[ReadWriteData] * (1.0f / 65536.0f) * 100.0f;
+    Stats.PercentUnknown = counts[Unknown] * (1.0f / 65536.0f) * 100.0f;
 }
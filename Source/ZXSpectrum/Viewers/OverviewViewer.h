@@ -25,5 +25,26 @@ public:
 	void	DrawStats();
 	void	CalculateStats();
 private:
+	void	CalculatePageStats(int pageNo);
+
+	enum EStatType
+	{
+		ReadOnlyData,
+		WriteOnlyData,
+		ReadWriteData,
+		CommentedCode,
+		UncommentedCode,
+		Unknown,
+
+		NoStatTypes
+	};
+
+	// counts for each 1K of address space - a few pages are recalculated each frame
+	static const int kNoPages = 64;
+	static const int kPagesPerUpdate = 8;
+	int				PageCounts[kNoPages][NoStatTypes] = {};
+	int				NextPageToUpdate = 0;
+	bool			bPageCountsValid = false;	// all pages have been counted once
+
 	FOverviewStats	Stats;
 };
\ No newline at end of file
@@ -120,6 +120,22 @@ void FSpectrumViewer::Draw()
 			ImGui::Text("Attribute Writer: ");
 			ImGui::SameLine();
 			DrawCodeAddress(codeAnalysis, viewState, lastAttrWriter);
+
+			// what drew this pixel row in the last frame
+			const FScreenWrite* pPixWrite = pSpectrumEmu->ScreenWrites.GetLastFrameWrite(scrPixAddress);
+			const FScreenWrite* pAttrWrite = pSpectrumEmu->ScreenWrites.GetLastFrameWrite(scrAttrAddress);
+			if (pPixWrite != nullptr)
+			{
+				ImGui::Text("Last Frame Pixel Write %u/%u: ", pPixWrite->Order, pSpectrumEmu->ScreenWrites.GetLastFrameWriteCount());
+				ImGui::SameLine();
+				DrawCodeAddress(codeAnalysis, viewState, pPixWrite->PC);
+			}
+			if (pAttrWrite != nullptr)
+			{
+				ImGui::Text("Last Frame Attribute Write %u/%u: ", pAttrWrite->Order, pSpectrumEmu->ScreenWrites.GetLastFrameWriteCount());
+				ImGui::SameLine();
+				DrawCodeAddress(codeAnalysis, viewState, pAttrWrite->PC);
+			}
 			{
 				//ImGui::Text("Image: ");
 				//const float line_height = ImGui::GetTextLineHeight();
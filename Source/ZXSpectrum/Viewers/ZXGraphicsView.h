@@ -5,7 +5,7 @@
 class FZXGraphicsView : public FGraphicsView
 {
 public:
-	FZXGraphicsView(int width, int height) :FGraphicsView(width, height) {}
+	FZXGraphicsView(int width, int height, bool bSkipUnchangedRows = false) :FGraphicsView(width, height, bSkipUnchangedRows) {}
 
 	void DrawCharLine(uint8_t charLine, int xp, int yp, uint8_t colAttr = 0x7);
 	void DrawBitImage(const uint8_t* pSrc, int xp, int yp, int widthChars, int heightChars, uint8_t colAttr = 0x7);